@@ -0,0 +1,74 @@
+//
+//  TLSAsyncFileWriter.h
+//  TwitterLoggingService
+//
+//  Created on 10/18/26.
+//  Copyright (c) 2026 Twitter, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//          http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+/* This header is private to Twitter Logging Service */
+
+#import "TLS_Project.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+#define TLS_ASYNC_FILE_WRITER_MIN_BUFFER_SIZE   (4 * 1024)
+#define TLS_ASYNC_FILE_WRITER_MIN_BUFFER_COUNT  (2)
+#define TLS_ASYNC_FILE_WRITER_MAX_BUFFER_COUNT  (16)
+
+/**
+ Writes to a file descriptor from a dedicated I/O thread.
+
+ The producer (the owning `TLSFileOutputStream` on the logging queue) only copies bytes into the
+ active buffer.  Once the active buffer is full it is handed off to the I/O thread, which writes out
+ all the buffers that are ready with a single `writev`, and the producer moves on to the next free
+ buffer.  The producer only blocks when every buffer is waiting on the I/O thread.
+
+ Not thread safe, the producer methods must be called serially.
+ The writer assumes exclusive ownership of the file descriptor's position while open.
+ */
+TLS_OBJC_FINAL
+@interface TLSAsyncFileWriter : NSObject
+
+/** the `errno` of the last failed write, `0` if no write has failed */
+@property (atomic, readonly) int lastError;
+/** number of bytes handed off to the I/O thread that were dropped because their write failed (some may have been partially written) */
+@property (atomic, readonly) unsigned long long droppedByteCount;
+
+- (nullable instancetype)initWithFileDescriptor:(int)fileDescriptor
+                                     bufferSize:(size_t)bufferSize
+                                    bufferCount:(NSUInteger)bufferCount;
+
+/** copy the bytes into the active buffer(s) */
+- (void)writeBytes:(const void *)bytes length:(size_t)length;
+/** hand off the active buffer and wait for all buffered bytes to be written */
+- (void)flush;
+/** flush and stop the I/O thread, the file descriptor is not closed */
+- (void)close;
+
+- (instancetype)init NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+@end
+
+/**
+ Write the buffered bytes the I/O thread has not written yet to the file descriptor and empty their
+ buffers: the buffers handed off to the I/O thread in order, then the active buffer.
+ A buffer the I/O thread is in the middle of writing is written again in full.
+ Async-signal-safe, for `TLSEmergencyLogDumpUnflushedOutput`.
+ @return `0` or the `errno` of the failure
+ */
+FOUNDATION_EXTERN int TLSAsyncFileWriterWriteUnwrittenBuffers(TLSAsyncFileWriter * __unsafe_unretained writer, size_t *lengthOut);
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,315 @@
+//
+//  TLSAsyncFileWriter.m
+//  TwitterLoggingService
+//
+//  Created on 10/18/26.
+//  Copyright (c) 2026 Twitter, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//          http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#include <pthread.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#import "TLSAsyncFileWriter.h"
+
+typedef struct {
+    char *bytes;
+    size_t length;
+} TLSAsyncFileWriterBuffer;
+
+// Shared between the producer and the I/O thread.
+// Buffers are used round robin: the producer fills `buffers[fillIndex]` while the I/O thread
+// writes the `pendingCount` buffers starting at `buffers[writeIndex]`.
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t buffersPendingCondition;
+    pthread_cond_t buffersWrittenCondition;
+
+    TLSAsyncFileWriterBuffer *buffers;
+    size_t bufferSize;
+    uint32_t bufferCount;
+    int fileDescriptor;
+
+    uint32_t fillIndex;     // producer only
+    uint32_t writeIndex;    // I/O thread only
+    uint32_t pendingCount;  // guarded by lock
+    int lastError;          // guarded by lock
+    unsigned long long droppedByteCount; // atomic, written by the I/O thread
+    BOOL stopping;          // guarded by lock
+} TLSAsyncFileWriterState;
+
+static void *_IOThreadMain(void *context);
+static void *_IOThreadMain(void *context)
+{
+    TLSAsyncFileWriterState *state = context;
+    pthread_setname_np("TLSAsyncFileWriter.io");
+
+    struct iovec iov[TLS_ASYNC_FILE_WRITER_MAX_BUFFER_COUNT];
+
+    pthread_mutex_lock(&state->lock);
+    while (true) {
+        while (0 == state->pendingCount && !state->stopping) {
+            pthread_cond_wait(&state->buffersPendingCondition, &state->lock);
+        }
+
+        const uint32_t count = state->pendingCount;
+        if (0 == count) {
+            // stopping and fully drained
+            break;
+        }
+        pthread_mutex_unlock(&state->lock);
+
+        // write out every pending buffer at once
+        for (uint32_t i = 0; i < count; i++) {
+            TLSAsyncFileWriterBuffer *buffer = &state->buffers[(state->writeIndex + i) % state->bufferCount];
+            iov[i].iov_base = buffer->bytes;
+            iov[i].iov_len = buffer->length;
+        }
+        const int error = TLSWriteVectorFully(state->fileDescriptor, iov, (int)count);
+        unsigned long long droppedLength = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            TLSAsyncFileWriterBuffer *buffer = &state->buffers[(state->writeIndex + i) % state->bufferCount];
+            droppedLength += buffer->length;
+            buffer->length = 0;
+        }
+        state->writeIndex = (state->writeIndex + count) % state->bufferCount;
+
+        pthread_mutex_lock(&state->lock);
+        if (error) {
+            // the bytes are dropped, blocking the producer on a failing disk would be worse
+            state->lastError = error;
+            __atomic_fetch_add(&state->droppedByteCount, droppedLength, __ATOMIC_RELEASE);
+        }
+        state->pendingCount -= count;
+        pthread_cond_broadcast(&state->buffersWrittenCondition);
+    }
+    pthread_mutex_unlock(&state->lock);
+
+    return NULL;
+}
+
+@interface TLSAsyncFileWriter ()
+- (void)_submitFillBuffer TLS_OBJC_DIRECT;
+@end
+
+@implementation TLSAsyncFileWriter
+{
+    TLSAsyncFileWriterState *_state;
+    pthread_t _thread;
+    BOOL _threadRunning;
+}
+
+- (instancetype)initWithFileDescriptor:(int)fileDescriptor
+                            bufferSize:(size_t)bufferSize
+                           bufferCount:(NSUInteger)bufferCount
+{
+    if (fileDescriptor < 0) {
+        return nil;
+    }
+
+    if (self = [super init]) {
+        bufferSize = MAX(bufferSize, (size_t)TLS_ASYNC_FILE_WRITER_MIN_BUFFER_SIZE);
+        bufferCount = MAX(MIN(bufferCount, (NSUInteger)TLS_ASYNC_FILE_WRITER_MAX_BUFFER_COUNT), (NSUInteger)TLS_ASYNC_FILE_WRITER_MIN_BUFFER_COUNT);
+
+        _state = calloc(1, sizeof(TLSAsyncFileWriterState));
+        if (!_state) {
+            return nil;
+        }
+        pthread_mutex_init(&_state->lock, NULL);
+        pthread_cond_init(&_state->buffersPendingCondition, NULL);
+        pthread_cond_init(&_state->buffersWrittenCondition, NULL);
+
+        _state->buffers = calloc(bufferCount, sizeof(TLSAsyncFileWriterBuffer));
+        if (!_state->buffers) {
+            return nil;
+        }
+        _state->bufferSize = bufferSize;
+        _state->bufferCount = (uint32_t)bufferCount;
+        _state->fileDescriptor = fileDescriptor;
+        for (NSUInteger i = 0; i < bufferCount; i++) {
+            _state->buffers[i].bytes = malloc(bufferSize);
+            if (!_state->buffers[i].bytes) {
+                return nil;
+            }
+        }
+
+        if (0 != pthread_create(&_thread, NULL, _IOThreadMain, _state)) {
+            return nil;
+        }
+        _threadRunning = YES;
+    }
+    return self;
+}
+
+- (instancetype)init
+{
+    [self doesNotRecognizeSelector:_cmd];
+    abort();
+}
+
+- (void)dealloc
+{
+    [self close];
+    if (_state) {
+        if (_state->buffers) {
+            for (uint32_t i = 0; i < _state->bufferCount; i++) {
+                free(_state->buffers[i].bytes);
+            }
+            free(_state->buffers);
+        }
+        pthread_cond_destroy(&_state->buffersWrittenCondition);
+        pthread_cond_destroy(&_state->buffersPendingCondition);
+        pthread_mutex_destroy(&_state->lock);
+        free(_state);
+    }
+}
+
+- (int)lastError
+{
+    if (!_threadRunning) {
+        return _state->lastError;
+    }
+
+    pthread_mutex_lock(&_state->lock);
+    const int lastError = _state->lastError;
+    pthread_mutex_unlock(&_state->lock);
+    return lastError;
+}
+
+- (unsigned long long)droppedByteCount
+{
+    return __atomic_load_n(&_state->droppedByteCount, __ATOMIC_ACQUIRE);
+}
+
+- (void)writeBytes:(const void *)bytes length:(size_t)length
+{
+    if (!_threadRunning) {
+        return;
+    }
+
+    const char *cursor = bytes;
+    while (length > 0) {
+        TLSAsyncFileWriterBuffer *buffer = &_state->buffers[_state->fillIndex];
+        const size_t chunkLength = MIN(length, _state->bufferSize - buffer->length);
+        memcpy(buffer->bytes + buffer->length, cursor, chunkLength);
+        buffer->length += chunkLength;
+        cursor += chunkLength;
+        length -= chunkLength;
+
+        if (buffer->length == _state->bufferSize) {
+            [self _submitFillBuffer];
+        }
+    }
+}
+
+- (void)_submitFillBuffer
+{
+    pthread_mutex_lock(&_state->lock);
+    _state->pendingCount++;
+    pthread_cond_signal(&_state->buffersPendingCondition);
+    _state->fillIndex = (_state->fillIndex + 1) % _state->bufferCount;
+    // the next buffer is only free once fewer than all the buffers are pending
+    while (_state->pendingCount == _state->bufferCount) {
+        pthread_cond_wait(&_state->buffersWrittenCondition, &_state->lock);
+    }
+    pthread_mutex_unlock(&_state->lock);
+}
+
+- (void)flush
+{
+    if (!_threadRunning) {
+        return;
+    }
+
+    if (_state->buffers[_state->fillIndex].length > 0) {
+        [self _submitFillBuffer];
+    }
+
+    pthread_mutex_lock(&_state->lock);
+    while (_state->pendingCount > 0) {
+        pthread_cond_wait(&_state->buffersWrittenCondition, &_state->lock);
+    }
+    pthread_mutex_unlock(&_state->lock);
+}
+
+- (void)close
+{
+    if (!_threadRunning) {
+        return;
+    }
+
+    [self flush];
+
+    pthread_mutex_lock(&_state->lock);
+    _state->stopping = YES;
+    pthread_cond_signal(&_state->buffersPendingCondition);
+    pthread_mutex_unlock(&_state->lock);
+
+    pthread_join(_thread, NULL);
+    _threadRunning = NO;
+}
+
+int TLSAsyncFileWriterWriteUnwrittenBuffers(TLSAsyncFileWriter *writer, size_t *lengthOut)
+{
+    // only plain reads and `writev` (no lock), the producer and the I/O thread may be mid-way
+    size_t length = 0;
+    int error = 0;
+    if (writer && writer->_threadRunning) {
+        TLSAsyncFileWriterState *state = writer->_state;
+        struct iovec iov[TLS_ASYNC_FILE_WRITER_MAX_BUFFER_COUNT + 1];
+        int iovCount = 0;
+
+        // the handed off buffers first, in order (the I/O thread empties each one it has written)
+        const uint32_t bufferCount = state->bufferCount;
+        const uint32_t writeIndex = state->writeIndex % bufferCount;
+        const uint32_t pendingCount = MIN(state->pendingCount, bufferCount);
+        TLSAsyncFileWriterBuffer *dumpedBuffers[TLS_ASYNC_FILE_WRITER_MAX_BUFFER_COUNT + 1];
+        for (uint32_t i = 0; i < pendingCount; i++) {
+            TLSAsyncFileWriterBuffer *buffer = &state->buffers[(writeIndex + i) % bufferCount];
+            const size_t bufferLength = MIN(buffer->length, state->bufferSize);
+            if (bufferLength > 0) {
+                dumpedBuffers[iovCount] = buffer;
+                iov[iovCount++] = (struct iovec){ .iov_base = buffer->bytes, .iov_len = bufferLength };
+                length += bufferLength;
+            }
+        }
+
+        // then the active buffer, unless the producer is waiting on every buffer to be written (it is one of the handed off ones)
+        if (pendingCount < bufferCount) {
+            TLSAsyncFileWriterBuffer *buffer = &state->buffers[state->fillIndex % bufferCount];
+            const size_t bufferLength = MIN(buffer->length, state->bufferSize);
+            if (bufferLength > 0) {
+                dumpedBuffers[iovCount] = buffer;
+                iov[iovCount++] = (struct iovec){ .iov_base = buffer->bytes, .iov_len = bufferLength };
+                length += bufferLength;
+            }
+        }
+
+        if (iovCount > 0) {
+            error = TLSWriteVectorFully(state->fileDescriptor, iov, iovCount);
+            if (!error) {
+                // written, empty the buffers so that neither the I/O thread nor a flush writes them again
+                for (int i = 0; i < iovCount; i++) {
+                    dumpedBuffers[i]->length = 0;
+                }
+            }
+        }
+    }
+    if (lengthOut) {
+        *lengthOut = (error) ? 0 : length;
+    }
+    return error;
+}
+
+@end
@@ -0,0 +1,56 @@
+//
+//  TLSBoundedFormat.h
+//  TwitterLoggingService
+//
+//  Created on 10/18/26.
+//  Copyright (c) 2026 Twitter, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//          http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+/* This header is private to Twitter Logging Service */
+
+#import "TLS_Project.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ Format like `-[NSString initWithFormat:arguments:]`, but stop producing output once _maxByteLength_
+ bytes of UTF-8 have been produced.  A truncated result never splits a code point and ends with
+ `TLSLogMessageTruncationMarker` (included in _maxByteLength_).
+
+ The cost is bounded by _maxByteLength_ rather than by the size of the arguments: `%@` strings and `%s`
+ C strings are only read up to the limit and no argument is visited once the limit is reached.
+ `%@` objects other than strings still produce their full `description`.
+ Formats with positional arguments (`%1$@`) are formatted in full and then truncated.
+
+ @param maxByteLength the maximum UTF-8 length of the result, must be greater than `0`
+ @param format the format string
+ @param arguments the format arguments
+ @param truncatedOut set to whether the result was truncated
+ */
+FOUNDATION_EXTERN NSString *TLSBoundedFormat(NSUInteger maxByteLength,
+                                             NSString *format,
+                                             va_list arguments,
+                                             BOOL * __nullable truncatedOut) NS_FORMAT_FUNCTION(2,0);
+
+/**
+ Truncate an already built _string_ like `TLSBoundedFormat` truncates its output: to at most
+ _maxByteLength_ bytes of UTF-8, without splitting a code point and ending with `TLSLogMessageTruncationMarker`.
+ Only converts what fits, a _string_ that already fits is returned as is.
+ */
+FOUNDATION_EXTERN NSString *TLSBoundedString(NSUInteger maxByteLength,
+                                             NSString *string,
+                                             BOOL * __nullable truncatedOut);
+
+NS_ASSUME_NONNULL_END
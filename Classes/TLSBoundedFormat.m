@@ -0,0 +1,419 @@
+//
+//  TLSBoundedFormat.m
+//  TwitterLoggingService
+//
+//  Created on 10/18/26.
+//  Copyright (c) 2026 Twitter, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//          http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#import "TLSBoundedFormat.h"
+#import "TLSLoggingService+Advanced.h"
+
+NSString * const TLSLogMessageTruncationMarker = @"…[truncated]";
+
+#define TLS_BOUNDED_FORMAT_STACK_CAPACITY (1024)
+#define TLS_BOUNDED_FORMAT_MAX_SPEC_LENGTH (128)
+
+typedef struct {
+    char *bytes;
+    size_t length;
+    size_t capacity;    // excluding the room for a NUL terminator, which `snprintf` needs
+    size_t limit;
+    BOOL truncated;
+    char stackBytes[TLS_BOUNDED_FORMAT_STACK_CAPACITY + 1];
+} TLSBoundedBuffer;
+
+// Make room for _count_ more bytes, up to the limit.  Returns the room available.
+static size_t _Reserve(TLSBoundedBuffer *buffer, size_t count)
+{
+    const size_t wanted = buffer->length + MIN(count, buffer->limit - buffer->length);
+    if (wanted > buffer->capacity) {
+        const size_t newCapacity = MIN(MAX(buffer->capacity * 2, wanted), buffer->limit);
+        const BOOL onStack = (buffer->bytes == buffer->stackBytes);
+        char *newBytes = onStack ? malloc(newCapacity + 1) : realloc(buffer->bytes, newCapacity + 1);
+        if (newBytes) {
+            if (onStack) {
+                memcpy(newBytes, buffer->stackBytes, buffer->length);
+            }
+            buffer->bytes = newBytes;
+            buffer->capacity = newCapacity;
+        }
+    }
+    return buffer->capacity - buffer->length;
+}
+
+static void _AppendBytes(TLSBoundedBuffer *buffer, const char *bytes, size_t count)
+{
+    const size_t appendCount = MIN(_Reserve(buffer, count), count);
+    memcpy(buffer->bytes + buffer->length, bytes, appendCount);
+    buffer->length += appendCount;
+    if (appendCount < count) {
+        buffer->truncated = YES;
+    }
+}
+
+static void _AppendString(TLSBoundedBuffer *buffer, NSString *string)
+{
+    CFStringRef cfString = (__bridge CFStringRef)string;
+    const CFIndex length = CFStringGetLength(cfString);
+    const CFIndex maxSize = CFStringGetMaximumSizeForEncoding(length, kCFStringEncodingUTF8);
+    const size_t room = _Reserve(buffer, (kCFNotFound == maxSize) ? SIZE_MAX : (size_t)maxSize);
+
+    // converts whole code points and stops once the buffer is full, only visits what fits
+    CFIndex usedByteCount = 0;
+    const CFIndex convertedCount = CFStringGetBytes(cfString,
+                                                    CFRangeMake(0, length),
+                                                    kCFStringEncodingUTF8,
+                                                    '?',
+                                                    false,
+                                                    (UInt8 *)(buffer->bytes + buffer->length),
+                                                    (CFIndex)room,
+                                                    &usedByteCount);
+    buffer->length += (size_t)usedByteCount;
+    if (convertedCount < length) {
+        buffer->truncated = YES;
+    }
+}
+
+static void _AppendCharacters(TLSBoundedBuffer *buffer, const unichar *characters, size_t maxCount)
+{
+    // every UTF-16 code unit is at least 1 UTF-8 byte, no need to look further than what can fit
+    maxCount = MIN(maxCount, buffer->limit - buffer->length + 1);
+    size_t count = 0;
+    while (count < maxCount && characters[count] != 0) {
+        count++;
+    }
+    CFStringRef string = CFStringCreateWithCharactersNoCopy(kCFAllocatorDefault, characters, (CFIndex)count, kCFAllocatorNull);
+    if (string) {
+        _AppendString(buffer, (__bridge NSString *)string);
+        CFRelease(string);
+    }
+}
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wformat-nonliteral"
+// _value_ is evaluated once (it is usually a `va_arg`), the retry formats the same typed local
+#define _APPEND_FORMATTED(buffer, spec, value) \
+do { \
+    const __typeof__(value) __value = (value); \
+    size_t __room = _Reserve((buffer), 64); \
+    int __count = snprintf((buffer)->bytes + (buffer)->length, __room + 1, (spec), __value); \
+    if (__count > 0 && (size_t)__count > __room) { \
+        __room = _Reserve((buffer), (size_t)__count); \
+        __count = snprintf((buffer)->bytes + (buffer)->length, __room + 1, (spec), __value); \
+    } \
+    if (__count > 0) { \
+        (buffer)->length += MIN((size_t)__count, __room); \
+        if ((size_t)__count > __room) { \
+            (buffer)->truncated = YES; \
+        } \
+    } \
+} while (0)
+
+typedef NS_ENUM(NSInteger, TLSFormatLength) {
+    TLSFormatLengthDefault = 0,
+    TLSFormatLengthChar,        // hh
+    TLSFormatLengthShort,       // h
+    TLSFormatLengthLong,        // l
+    TLSFormatLengthLongLong,    // ll, q
+    TLSFormatLengthSize,        // z
+    TLSFormatLengthPtrDiff,     // t
+    TLSFormatLengthIntMax,      // j
+    TLSFormatLengthLongDouble,  // L
+};
+
+// Format the conversion at _cursor_ (just past the `%`) and return the position after it
+static const char *_AppendConversion(TLSBoundedBuffer *buffer, const char *cursor, va_list *arguments)
+{
+    const char * const start = cursor - 1;
+    char spec[TLS_BOUNDED_FORMAT_MAX_SPEC_LENGTH];
+    size_t specLength = 0;
+    // leave room for the width, precision, length and conversion after the flags
+#define _SPEC_APPEND(c) do { if (specLength < sizeof(spec) - 64) { spec[specLength++] = (c); } } while (0)
+
+    _SPEC_APPEND('%');
+    while (*cursor && strchr("-+ #0'", *cursor)) {
+        _SPEC_APPEND(*cursor++);
+    }
+
+    // width
+    if ('*' == *cursor) {
+        cursor++;
+        specLength += (size_t)snprintf(spec + specLength, sizeof(spec) - specLength, "%d", va_arg(*arguments, int));
+    } else {
+        while (*cursor >= '0' && *cursor <= '9') {
+            _SPEC_APPEND(*cursor++);
+        }
+    }
+
+    // precision
+    BOOL hasPrecision = NO;
+    long precision = 0;
+    if ('.' == *cursor) {
+        cursor++;
+        if ('*' == *cursor) {
+            cursor++;
+            precision = va_arg(*arguments, int);
+        } else {
+            while (*cursor >= '0' && *cursor <= '9') {
+                precision = MIN((precision * 10) + (*cursor++ - '0'), (long)INT_MAX);
+            }
+        }
+        hasPrecision = (precision >= 0); // negative is as if omitted
+    }
+
+    // length
+    TLSFormatLength length = TLSFormatLengthDefault;
+    switch (*cursor) {
+        case 'h':
+            length = ('h' == cursor[1]) ? TLSFormatLengthChar : TLSFormatLengthShort;
+            cursor += (TLSFormatLengthChar == length) ? 2 : 1;
+            break;
+        case 'l':
+            length = ('l' == cursor[1]) ? TLSFormatLengthLongLong : TLSFormatLengthLong;
+            cursor += (TLSFormatLengthLongLong == length) ? 2 : 1;
+            break;
+        case 'q':
+            length = TLSFormatLengthLongLong;
+            cursor++;
+            break;
+        case 'z':
+            length = TLSFormatLengthSize;
+            cursor++;
+            break;
+        case 't':
+            length = TLSFormatLengthPtrDiff;
+            cursor++;
+            break;
+        case 'j':
+            length = TLSFormatLengthIntMax;
+            cursor++;
+            break;
+        case 'L':
+            length = TLSFormatLengthLongDouble;
+            cursor++;
+            break;
+        default:
+            break;
+    }
+
+    char conversion = *cursor;
+    if ('\0' == conversion) {
+        // dangling specifier, output it as is
+        _AppendBytes(buffer, start, (size_t)(cursor - start));
+        return cursor;
+    }
+    cursor++;
+
+    // obsolete synonyms
+    if ('D' == conversion || 'O' == conversion || 'U' == conversion) {
+        conversion = (char)(conversion - 'A' + 'a');
+        length = TLSFormatLengthLong;
+    }
+
+    static const char * const sLengthModifiers[] = { "", "hh", "h", "l", "ll", "z", "t", "j", "L" };
+    if (hasPrecision && strchr("diouxXeEfFgGaAs", conversion)) {
+        specLength += (size_t)snprintf(spec + specLength, sizeof(spec) - specLength, ".%ld", ('s' == conversion) ? MIN(precision, (long)(buffer->limit - buffer->length + 1)) : precision);
+    } else if ('s' == conversion) {
+        // never read a C string further than what can fit
+        specLength += (size_t)snprintf(spec + specLength, sizeof(spec) - specLength, ".%zu", buffer->limit - buffer->length + 1);
+    }
+    (void)snprintf(spec + specLength, sizeof(spec) - specLength, "%s%c", sLengthModifiers[length], conversion);
+
+    switch (conversion) {
+        case '%':
+            _AppendBytes(buffer, "%", 1);
+            break;
+        case '@':
+        {
+            id object = va_arg(*arguments, id);
+            NSString *string = [object isKindOfClass:[NSString class]] ? object : [object description];
+            _AppendString(buffer, string ?: @"(null)");
+            break;
+        }
+        case 'd':
+        case 'i':
+            switch (length) {
+                case TLSFormatLengthLong:       _APPEND_FORMATTED(buffer, spec, va_arg(*arguments, long)); break;
+                case TLSFormatLengthLongLong:   _APPEND_FORMATTED(buffer, spec, va_arg(*arguments, long long)); break;
+                case TLSFormatLengthSize:       _APPEND_FORMATTED(buffer, spec, va_arg(*arguments, ssize_t)); break;
+                case TLSFormatLengthPtrDiff:    _APPEND_FORMATTED(buffer, spec, va_arg(*arguments, ptrdiff_t)); break;
+                case TLSFormatLengthIntMax:     _APPEND_FORMATTED(buffer, spec, va_arg(*arguments, intmax_t)); break;
+                default:                        _APPEND_FORMATTED(buffer, spec, va_arg(*arguments, int)); break;
+            }
+            break;
+        case 'o':
+        case 'u':
+        case 'x':
+        case 'X':
+            switch (length) {
+                case TLSFormatLengthLong:       _APPEND_FORMATTED(buffer, spec, va_arg(*arguments, unsigned long)); break;
+                case TLSFormatLengthLongLong:   _APPEND_FORMATTED(buffer, spec, va_arg(*arguments, unsigned long long)); break;
+                case TLSFormatLengthSize:       _APPEND_FORMATTED(buffer, spec, va_arg(*arguments, size_t)); break;
+                case TLSFormatLengthPtrDiff:    _APPEND_FORMATTED(buffer, spec, va_arg(*arguments, ptrdiff_t)); break;
+                case TLSFormatLengthIntMax:     _APPEND_FORMATTED(buffer, spec, va_arg(*arguments, uintmax_t)); break;
+                default:                        _APPEND_FORMATTED(buffer, spec, va_arg(*arguments, unsigned int)); break;
+            }
+            break;
+        case 'e':
+        case 'E':
+        case 'f':
+        case 'F':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            if (TLSFormatLengthLongDouble == length) {
+                _APPEND_FORMATTED(buffer, spec, va_arg(*arguments, long double));
+            } else {
+                _APPEND_FORMATTED(buffer, spec, va_arg(*arguments, double));
+            }
+            break;
+        case 'c':
+            _APPEND_FORMATTED(buffer, spec, va_arg(*arguments, int));
+            break;
+        case 'C':
+        {
+            const unichar character = (unichar)va_arg(*arguments, int);
+            _AppendCharacters(buffer, &character, 1);
+            break;
+        }
+        case 's':
+            if (TLSFormatLengthLong == length) {
+                const wchar_t *wideString = va_arg(*arguments, const wchar_t *);
+                _APPEND_FORMATTED(buffer, spec, wideString ?: L"(null)");
+            } else {
+                const char *string = va_arg(*arguments, const char *);
+                _APPEND_FORMATTED(buffer, spec, string ?: "(null)");
+            }
+            break;
+        case 'S':
+        {
+            const unichar *characters = va_arg(*arguments, const unichar *);
+            if (characters) {
+                _AppendCharacters(buffer, characters, hasPrecision ? (size_t)precision : SIZE_MAX);
+            } else {
+                _AppendBytes(buffer, "(null)", 6);
+            }
+            break;
+        }
+        case 'p':
+            _APPEND_FORMATTED(buffer, spec, va_arg(*arguments, void *));
+            break;
+        case 'n':
+            // nothing is written back
+            (void)va_arg(*arguments, void *);
+            break;
+        default:
+            // unknown conversion, output it as is without consuming an argument
+            _AppendBytes(buffer, start, (size_t)(cursor - start));
+            break;
+    }
+
+#undef _SPEC_APPEND
+    return cursor;
+}
+#pragma clang diagnostic pop
+
+static void _InitBuffer(TLSBoundedBuffer *buffer, NSUInteger maxByteLength)
+{
+    buffer->bytes = buffer->stackBytes;
+    buffer->length = 0;
+    buffer->limit = MAX(maxByteLength, (NSUInteger)1);
+    buffer->capacity = MIN(buffer->limit, (size_t)TLS_BOUNDED_FORMAT_STACK_CAPACITY);
+    buffer->truncated = NO;
+}
+
+// Append the marker to a truncated _buffer_ and make a string of it, freeing the _buffer_
+static NSString *_FinishBuffer(TLSBoundedBuffer *buffer, BOOL * __nullable truncatedOut)
+{
+    if (buffer->truncated) {
+        const char *marker = TLSLogMessageTruncationMarker.UTF8String;
+        const size_t markerLength = strlen(marker);
+        const size_t contentLength = (buffer->capacity > markerLength) ? MIN(buffer->length, buffer->capacity - markerLength) : 0;
+        buffer->length = TLSUTF8CodePointBoundary(buffer->bytes, contentLength);
+        const size_t appendCount = MIN(markerLength, buffer->capacity - buffer->length);
+        memcpy(buffer->bytes + buffer->length, marker, appendCount);
+        buffer->length += appendCount;
+    }
+    if (truncatedOut) {
+        *truncatedOut = buffer->truncated;
+    }
+
+    NSString *string = [[NSString alloc] initWithBytes:buffer->bytes length:buffer->length encoding:NSUTF8StringEncoding];
+    if (!string) {
+        // invalid UTF-8 from a C string argument
+        string = [[NSString alloc] initWithBytes:buffer->bytes length:buffer->length encoding:NSISOLatin1StringEncoding];
+    }
+    if (buffer->bytes != buffer->stackBytes) {
+        free(buffer->bytes);
+    }
+    return string ?: @"";
+}
+
+NSString *TLSBoundedFormat(NSUInteger maxByteLength,
+                           NSString *format,
+                           va_list arguments,
+                           BOOL *truncatedOut)
+{
+    TLSBoundedBuffer buffer;
+    _InitBuffer(&buffer, maxByteLength);
+
+    const char *cursor = format.UTF8String ?: "";
+    if (strchr(cursor, '$')) {
+        // positional arguments, can't walk the arguments in order
+        _AppendString(&buffer, [[NSString alloc] initWithFormat:format arguments:arguments]);
+    } else {
+        va_list formatArguments;
+        va_copy(formatArguments, arguments);
+        while (*cursor && !buffer.truncated) {
+            const char *percent = strchr(cursor, '%');
+            const size_t literalLength = (percent) ? (size_t)(percent - cursor) : strlen(cursor);
+            if (literalLength > 0) {
+                _AppendBytes(&buffer, cursor, literalLength);
+                cursor += literalLength;
+            } else {
+                cursor = _AppendConversion(&buffer, cursor + 1, &formatArguments);
+            }
+        }
+        va_end(formatArguments);
+    }
+
+    return _FinishBuffer(&buffer, truncatedOut);
+}
+
+NSString *TLSBoundedString(NSUInteger maxByteLength,
+                           NSString *string,
+                           BOOL *truncatedOut)
+{
+    // every UTF-16 code unit is at most 3 UTF-8 bytes
+    const NSUInteger length = string.length;
+    if (length <= maxByteLength / 3 || [string lengthOfBytesUsingEncoding:NSUTF8StringEncoding] <= maxByteLength) {
+        if (truncatedOut) {
+            *truncatedOut = NO;
+        }
+        return string;
+    }
+
+    TLSBoundedBuffer buffer;
+    _InitBuffer(&buffer, maxByteLength);
+    _AppendString(&buffer, string);
+    return _FinishBuffer(&buffer, truncatedOut);
+}
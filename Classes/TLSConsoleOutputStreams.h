@@ -21,14 +21,22 @@
 
 /**
  concrete implementation of a `TLSOutputStream` that writes to `stderr`.
+
+ When used by a `TLSLoggingService`, the UTF-8 lines of all the log messages output together are
+ accumulated and written to `STDERR_FILENO` with a single `writev` (see `tls_didFinishOutputBatch`)
+ rather than a write per line.  Each line is always written in full before the next.
+ Used on its own, each line is written immediately.
  @note Only use one of `TLSStdErrOutputStream`, `TLSNSLogOutputStream` or `TLSOSLogOutputStream`.
  */
 @interface TLSStdErrOutputStream : NSObject <TLSOutputStream>
 
-/** uses `fprintf` to write the *logInfo* to `stderr` */
+/** accumulates the UTF-8 line of the *logInfo* for writing to `stderr` */
 - (void)tls_outputLogInfo:(nonnull TLSLogMessageInfo *)logInfo;
 
-/** flush `stderr` */
+/** write the accumulated lines to `stderr` */
+- (void)tls_didFinishOutputBatch;
+
+/** write the accumulated lines and flush `stderr` */
 - (void)tls_flush;
 
 @end
@@ -17,6 +17,12 @@
 //  See the License for the specific language governing permissions and
 //  limitations under the License.
 
+#include <limits.h>
+#include <pthread.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#import "TLS_Project.h"
 #import "TLSConsoleOutputStreams.h"
 #import "TLSLog.h"
 
@@ -32,7 +38,43 @@
 #include <os/log.h>
 #endif
 
+// write out early once this much is accumulated, bounds memory and latency for large batches
+static const size_t kStdErrMaxBatchBytes = 64 * 1024;
+static const NSUInteger kStdErrIOVCount = 64;
+
+@interface TLSStdErrOutputStream ()
+- (void)_locked_appendLine:(NSString *)line TLS_OBJC_DIRECT;
+- (void)_locked_writeLines TLS_OBJC_DIRECT;
+@end
+
 @implementation TLSStdErrOutputStream
+{
+    // stream can be used directly from any thread, outside of `TLSLoggingService`
+    pthread_mutex_t _lock;
+    char *_buffer;
+    size_t _bufferLength;
+    size_t _bufferCapacity;
+    size_t *_lineEnds; // offset into _buffer of the end of each line
+    NSUInteger _lineCount;
+    NSUInteger _lineCapacity;
+    BOOL _batching;
+}
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        pthread_mutex_init(&_lock, NULL);
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [self _locked_writeLines];
+    free(_buffer);
+    free(_lineEnds);
+    pthread_mutex_destroy(&_lock);
+}
 
 - (void)tls_outputLogInfo:(TLSLogMessageInfo *)logInfo
 {
@@ -42,12 +84,98 @@
                          TLSComposeLogMessageInfoLogChannel |
                          TLSComposeLogMessageInfoLogLevel |
                          TLSComposeLogMessageInfoLogCallsiteInfoForWarnings];
-    fprintf(stderr, "%s\n", [message UTF8String]);
+
+    pthread_mutex_lock(&_lock);
+    [self _locked_appendLine:message];
+    if (!_batching || _bufferLength >= kStdErrMaxBatchBytes) {
+        [self _locked_writeLines];
+    }
+    pthread_mutex_unlock(&_lock);
+}
+
+- (void)tls_didFinishOutputBatch
+{
+    pthread_mutex_lock(&_lock);
+    // only batch once we know a `TLSLoggingService` will tell us when to write
+    _batching = YES;
+    [self _locked_writeLines];
+    pthread_mutex_unlock(&_lock);
 }
 
 - (void)tls_flush
 {
+    // anything written through stdio goes first, it was written before the accumulated lines
     fflush(stderr);
+    pthread_mutex_lock(&_lock);
+    [self _locked_writeLines];
+    pthread_mutex_unlock(&_lock);
+}
+
+- (void)_locked_appendLine:(NSString *)line
+{
+    CFStringRef string = (__bridge CFStringRef)line;
+    const CFIndex length = CFStringGetLength(string);
+    const size_t maxSize = (size_t)CFStringGetMaximumSizeForEncoding(length, kCFStringEncodingUTF8) + 1; // + newline
+
+    if (_bufferLength + maxSize > _bufferCapacity) {
+        const size_t newCapacity = MAX(_bufferCapacity * 2, _bufferLength + maxSize);
+        char *newBuffer = realloc(_buffer, newCapacity);
+        if (!newBuffer) {
+            return;
+        }
+        _buffer = newBuffer;
+        _bufferCapacity = newCapacity;
+    }
+    if (_lineCount == _lineCapacity) {
+        const NSUInteger newCapacity = MAX(_lineCapacity * 2, kStdErrIOVCount);
+        size_t *newLineEnds = realloc(_lineEnds, newCapacity * sizeof(size_t));
+        if (!newLineEnds) {
+            return;
+        }
+        _lineEnds = newLineEnds;
+        _lineCapacity = newCapacity;
+    }
+
+    // encode straight into the batch, no intermediate C string
+    CFIndex usedLength = 0;
+    (void)CFStringGetBytes(string,
+                           CFRangeMake(0, length),
+                           kCFStringEncodingUTF8,
+                           '?',
+                           false,
+                           (UInt8 *)(_buffer + _bufferLength),
+                           (CFIndex)(_bufferCapacity - _bufferLength),
+                           &usedLength);
+    _bufferLength += (size_t)usedLength;
+    _buffer[_bufferLength++] = '\n';
+    _lineEnds[_lineCount++] = _bufferLength;
+}
+
+- (void)_locked_writeLines
+{
+    if (0 == _lineCount) {
+        return;
+    }
+
+    // 1 iovec per line, written in groups of kStdErrIOVCount (well under IOV_MAX)
+    struct iovec iov[kStdErrIOVCount];
+    size_t lineStart = 0;
+    NSUInteger line = 0;
+    while (line < _lineCount) {
+        int iovcnt = 0;
+        for (; line < _lineCount && iovcnt < (int)kStdErrIOVCount; line++, iovcnt++) {
+            iov[iovcnt].iov_base = _buffer + lineStart;
+            iov[iovcnt].iov_len = _lineEnds[line] - lineStart;
+            lineStart = _lineEnds[line];
+        }
+        if (0 != TLSWriteVectorFully(STDERR_FILENO, iov, iovcnt)) {
+            // stderr is gone, nothing more we can do
+            break;
+        }
+    }
+
+    _bufferLength = 0;
+    _lineCount = 0;
 }
 
 @end
@@ -38,8 +38,8 @@ static const NSUInteger kMaxLogMessageLength = 16 * 1024;
             return;
         }
 
-        // Truncate our message
-        message = [message substringToIndex:kMaxLogMessageLength];
+        // Truncate our message, without splitting a composed character
+        message = [message substringToIndex:[message rangeOfComposedCharacterSequenceAtIndex:kMaxLogMessageLength].location];
     }
 
     // Delegate to the subclass
@@ -113,14 +113,14 @@ typedef NS_OPTIONS(NSInteger, TLSLogLevelMask)
 typedef NS_OPTIONS(NSInteger, TLSLogMessageOptions) {
     /** no options (default behavior) */
     TLSLogMessageOptionsNone = 0,
-    /** ignore the `[TLSLoggingService maximumSafeMessageLength]` capping of the message */
+    /** ignore the `[TLSLoggingService maximumSafeMessageLength]` and `[TLSLoggingService maximumMessageByteLength]` capping of the message */
     TLSLogMessageOptionsIgnoringMaximumSafeMessageLength = 1 << 0,
 };
 
 /**
  Options for how to compose a `TLSLogMessageInfo` into a message string
  Selects which components of the message will be in the composed string.
- All components will format as `@"[TIMESTAMP][THREAD][CHANNEL][LEVEL](__FILE__:__LINE__ __PRETTY_FUNCTION___) : MESSAGE"`
+ All components will format as `@"[TIMESTAMP][SEQUENCE][PROCESS][THREAD][CHANNEL][LEVEL](__FILE__:__LINE__ __PRETTY_FUNCTION___) : MESSAGE"`
  */
 typedef NS_OPTIONS(NSInteger, TLSComposeLogMessageInfoOptions) {
     /**
@@ -138,6 +138,14 @@ typedef NS_OPTIONS(NSInteger, TLSComposeLogMessageInfoOptions) {
     //! Log the `TIMESTAMP` as the UTC time as *HHH:mm:ss.MMM* (hours, minutes, seconds, milliseconds)
     TLSComposeLogMessageInfoLogTimestampAsUTCTime = 1 << 2,
 
+    //! SEQUENCE [#SEQUENCENUMBER]
+    //! Log the `SEQUENCE` number (see `[TLSLogMessageInfo sequenceNumber]`), shows where log messages were output out of order
+    TLSComposeLogMessageInfoLogSequenceNumber = 1 << 3,
+
+    //! PROCESS [pid:PROCESSIDENTIFIER]
+    //! Log the `PROCESS` identifier of log messages from other processes (see `[TLSLogMessageInfo processIdentifier]`)
+    TLSComposeLogMessageInfoLogProcessIdentifier = 1 << 6,
+
     //! THREAD [THREADNAME] | [THREADID] | [THREADNAME(THREADID)]
     //! Log the `THREAD` identifier
     TLSComposeLogMessageInfoLogThreadId = 1 << 4,
@@ -158,25 +166,155 @@ typedef NS_OPTIONS(NSInteger, TLSComposeLogMessageInfoOptions) {
     //! Log the callsite info when message's *level* is `TLSLogLevelWarning` or higher: `(__FILE__:__LINE__ __PRETTY_FUNCTION___)`
     TLSComposeLogMessageInfoLogCallsiteInfoForWarnings = 1 << 17,
 
+    //! PAYLOAD
+    //! Log the payload (see `[TLSLogMessageInfo payload]`) after the message as hex, without either option only its length is logged
+    TLSComposeLogMessageInfoLogPayloadAsHex = 1 << 20,
+    //! Log the payload after the message as base64
+    TLSComposeLogMessageInfoLogPayloadAsBase64 = 1 << 21,
+
     //! Caching
     //! Do not cache the composed log message
     TLSComposeLogMessageInfoDoNotCache = 1 << 31,
 
     /**
      Default options
-     `@"[TIMESTAMP][THREADID][CHANNEL][LEVEL](__FILE__:__LINE__ __PRETTY_FUNCTION___) : MESSAGE"`
+     `@"[TIMESTAMP][PROCESS][THREADID][CHANNEL][LEVEL](__FILE__:__LINE__ __PRETTY_FUNCTION___) : MESSAGE"`
      Where `TIMESTAMP` is the time since logging started.
+     Where `PROCESS` is only present for log messages from other processes.
      Where `(__FILE__:__LINE__ __PRETTY_FUNCTION__)` is only present for Warning and above.
      */
     TLSComposeLogMessageInfoDefaultOptions = TLSComposeLogMessageInfoLogTimestampAsTimeSinceLoggingStarted |
+                                             TLSComposeLogMessageInfoLogProcessIdentifier |
                                              TLSComposeLogMessageInfoLogThreadId |
                                              TLSComposeLogMessageInfoLogChannel |
                                              TLSComposeLogMessageInfoLogLevel |
                                              TLSComposeLogMessageInfoLogCallsiteInfoForWarnings,
 };
 
+#pragma mark - Structured Fields
+
+/** The type of a `TLSLogField` value */
+typedef NS_ENUM(uint8_t, TLSLogFieldType)
+{
+    /** `value.integerValue` */
+    TLSLogFieldTypeInteger = 0,
+    /** `value.doubleValue` */
+    TLSLogFieldTypeDouble,
+    /** `value.boolValue` */
+    TLSLogFieldTypeBool,
+    /** `value.stringValue`, a NUL terminated UTF-8 string of at most `TLSLogFieldStringCapacity` bytes */
+    TLSLogFieldTypeString,
+};
+
+//! Max UTF-8 bytes of a `TLSLogFieldTypeString` value, longer strings are truncated
+#define TLSLogFieldStringCapacity (23)
+
+/**
+ A typed key/value field of a log message, stored inline (no boxing).
+ See `TLSLogWithFields` in `TLSLog.h`.
+
+ Create fields with `TLSLogFieldInteger`, `TLSLogFieldDouble`, `TLSLogFieldBool`, `TLSLogFieldCString` or `TLSLogFieldString`.
+ The _key_ is not copied, it must be a string literal (or otherwise live for the duration of the process).
+ */
+typedef struct TLSLogField {
+    const char * __nonnull key;
+    TLSLogFieldType type;
+    union {
+        int64_t integerValue;
+        double doubleValue;
+        BOOL boolValue;
+        char stringValue[TLSLogFieldStringCapacity + 1];
+    } value;
+} TLSLogField;
+
+//! Integer field
+NS_INLINE TLSLogField TLSLogFieldInteger(const char * __nonnull key, int64_t value)
+{
+    TLSLogField field;
+    memset(&field, 0, sizeof(field));
+    field.key = key;
+    field.type = TLSLogFieldTypeInteger;
+    field.value.integerValue = value;
+    return field;
+}
+
+//! Double field
+NS_INLINE TLSLogField TLSLogFieldDouble(const char * __nonnull key, double value)
+{
+    TLSLogField field;
+    memset(&field, 0, sizeof(field));
+    field.key = key;
+    field.type = TLSLogFieldTypeDouble;
+    field.value.doubleValue = value;
+    return field;
+}
+
+//! Bool field
+NS_INLINE TLSLogField TLSLogFieldBool(const char * __nonnull key, BOOL value)
+{
+    TLSLogField field;
+    memset(&field, 0, sizeof(field));
+    field.key = key;
+    field.type = TLSLogFieldTypeBool;
+    field.value.boolValue = value;
+    return field;
+}
+
+//! Short string field from a UTF-8 C string, copied and truncated to `TLSLogFieldStringCapacity` bytes without splitting a code point
+FOUNDATION_EXTERN TLSLogField TLSLogFieldCString(const char * __nonnull key, const char * __nullable value);
+
+//! Short string field, copied and truncated to `TLSLogFieldStringCapacity` UTF-8 bytes without splitting a code point
+FOUNDATION_EXTERN TLSLogField TLSLogFieldString(const char * __nonnull key, NSString * __nullable value);
+
+#pragma mark - Payloads
+
+/** How to render a `[TLSLogMessageInfo payload]` as text */
+typedef NS_ENUM(NSInteger, TLSLogPayloadEncoding)
+{
+    /** lowercase hex, 2 characters per byte */
+    TLSLogPayloadEncodingHex = 0,
+    /** base64, 4 characters per 3 bytes */
+    TLSLogPayloadEncodingBase64,
+};
+
 #pragma mark - Declarations
 
+/**
+ Small immutable snapshot of a context object, logged in place of the object.
+ See `TLSLogContextSnapshotting`.
+ */
+@interface TLSLogContextSnapshot : NSObject
+
+/** The class name of the object the snapshot was taken of */
+@property (nonatomic, nonnull, copy, readonly) NSString *objectClassName;
+/** The key for output streams to filter on (see `TLSFiltering`) */
+@property (nonatomic, nullable, copy, readonly) NSString *filterKey;
+/** The values worth logging, each an `NSString` or `NSNumber` */
+@property (nonatomic, nonnull, copy, readonly) NSDictionary<NSString *, id> *fields;
+/** An estimate of the memory held by the snapshot, in bytes (see `[TLSLoggingService contextSnapshotByteBudget]`) */
+@property (nonatomic, readonly) NSUInteger byteCost;
+
+/**
+ Designated initializer
+ @param object the object to take the snapshot of (not retained)
+ @param filterKey the key for output streams to filter on
+ @param fields the values worth logging, values other than `NSString` and `NSNumber` are replaced with their `description`
+ */
+- (nonnull instancetype)initWithObject:(nonnull id)object
+                             filterKey:(nullable NSString *)filterKey
+                                fields:(nullable NSDictionary<NSString *, id> *)fields NS_DESIGNATED_INITIALIZER;
+
+/**
+ `NS_UNAVAILABLE`
+ */
+- (nonnull instancetype)init NS_UNAVAILABLE;
+/**
+ `NS_UNAVAILABLE`
+ */
++ (nonnull instancetype)new NS_UNAVAILABLE;
+
+@end
+
 /**
  Encapsulation of log message information.
 
@@ -194,18 +332,58 @@ typedef NS_OPTIONS(NSInteger, TLSComposeLogMessageInfoOptions) {
 @property (nonatomic, readonly) NSInteger line;
 /** The `NSString*` channel */
 @property (nonatomic, nonnull, copy, readonly) NSString *channel;
-/** The context object */
+/** The context object, or its `TLSLogContextSnapshot` for a context object conforming to `TLSLogContextSnapshotting` */
 @property (nonatomic, nullable, readonly) id contextObject;
 /** The log message's timestamp */
 @property (nonatomic, nonnull, readonly) NSDate *timestamp;
 /** how long the `TLSLoggingService` instance had been alive when this log message was made */
 @property (nonatomic, readonly) NSTimeInterval logLifespan;
+/**
+ The order the log message was logged in by its `TLSLoggingService`, starting at `1`.
+ Log messages can be output out of order (see `[TLSLoggingService priorityLaneEnabled]`), the sequence number keeps the original order.
+ `0` when the log message was not logged through a `TLSLoggingService`.
+ */
+@property (nonatomic, readonly) uint64_t sequenceNumber;
+/**
+ The identifier of the process that logged the message, `0` when logged by this process.
+ Log messages from other processes are delivered by a `TLSSharedMemoryLogDrain`.
+ */
+@property (nonatomic, readonly) pid_t processIdentifier;
 /** The thread identifier (mach_port_t) that the message was logged from */
 @property (nonatomic, readonly) unsigned int threadId;
 /** The thread name of the thread that was logged from */
 @property (nonatomic, nullable, copy, readonly) NSString *threadName;
 /** The log message */
 @property (nonatomic, nonnull, copy, readonly) NSString *message;
+/** The number of structured fields of the log message (see `TLSLogWithFields`) */
+@property (nonatomic, readonly) NSUInteger fieldCount;
+/** The `fieldCount` structured fields of the log message, valid for the lifetime of the `TLSLogMessageInfo` (`NULL` when there are none) */
+@property (nonatomic, nullable, readonly) const TLSLogField *fields NS_RETURNS_INNER_POINTER;
+
+/**
+ Enumerate the structured fields of the log message, without allocating.
+ */
+- (void)enumerateFieldsUsingBlock:(void (NS_NOESCAPE ^ __nonnull)(const TLSLogField * __nonnull field, BOOL * __nonnull stop))block;
+
+/**
+ The binary payload of the log message (see `TLSLogWithData`), held by reference and never copied by the service.
+ A `dispatch_data_t` payload can be discontiguous, binary output streams should write it with `enumerateByteRangesUsingBlock:`.
+ */
+@property (nonatomic, nullable, readonly) NSData *payload;
+/**
+ The most characters a text rendering of the `payload` should take, `0` for no limit.
+ Set to what the `message` leaves of `[TLSLoggingService maximumSafeMessageLength]` (at least `1`, which renders nothing)
+ unless the message was logged with `TLSLogMessageOptionsIgnoringMaximumSafeMessageLength`.
+ */
+@property (nonatomic, readonly) NSUInteger maximumPayloadRenderedLength;
+
+/**
+ Render the `payload`, capped to `maximumPayloadRenderedLength`.
+ Only the bytes that fit are encoded, a capped rendering ends with `@"...(+N bytes)"` which counts against the cap too.
+ When not even the marker fits, the rendering is empty.
+ @return the rendered payload, empty when there is no payload
+ */
+- (nonnull NSString *)composePayloadWithEncoding:(TLSLogPayloadEncoding)encoding;
 
 /**
  Composes a log message in predefined format which is cached for the lifetime of this object.
@@ -215,6 +393,7 @@ typedef NS_OPTIONS(NSInteger, TLSComposeLogMessageInfoOptions) {
 
 /**
  Composes a log message in predefined format which is cached for the lifetime of this object.
+ Structured fields are rendered after the message as ` key=value` pairs, followed by the payload (if any).
  @return A log message string using the given `TLSComposeLogMessageInfoOptions` _options_
  */
 - (nonnull NSString *)composeFormattedMessageWithOptions:(TLSComposeLogMessageInfoOptions)options;
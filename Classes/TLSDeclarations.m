@@ -17,18 +17,100 @@
 //  See the License for the specific language governing permissions and
 //  limitations under the License.
 
+#include <objc/runtime.h>
+#include <stdatomic.h>
 #include <sys/sysctl.h>
+#include <sys/uio.h>
 
 #import <TwitterLoggingService/TLS_Project.h>
 #import <TwitterLoggingService/TLSDeclarations.h>
 #import <TwitterLoggingService/TLSLog.h>
+#import "TLSLoggingMetricsRecorder.h"
 
 NSErrorDomain const TLSErrorDomain = @"TLSErrorDomain";
 
+static void _AppendFieldsToString(NSMutableString *string, const TLSLogField *fields, NSUInteger fieldCount);
+static void _AppendHexToString(NSMutableString *string, NSData *data, NSUInteger length);
+static NSUInteger _PayloadLengthFittingRenderedLength(NSUInteger renderedLength, TLSLogPayloadEncoding encoding);
+
+// the allocation overhead of an object (or a dictionary entry) on top of its bytes
+#define kContextSnapshotObjectByteCost (16)
+
+@implementation TLSLogContextSnapshot
+{
+    atomic_bool _accounted;
+    TLSLogContextSnapshotLedger *_ledger;
+}
+
+- (instancetype)initWithObject:(id)object
+                     filterKey:(NSString *)filterKey
+                        fields:(NSDictionary<NSString *, id> *)fields
+{
+    if (self = [super init]) {
+        _objectClassName = NSStringFromClass([object class]);
+        _filterKey = [filterKey copy];
+
+        NSUInteger byteCost = class_getInstanceSize([self class]) + kContextSnapshotObjectByteCost;
+        byteCost += [_filterKey lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+        NSMutableDictionary<NSString *, id> *snapshotFields = [[NSMutableDictionary alloc] initWithCapacity:fields.count];
+        for (NSString *key in fields) {
+            id value = fields[key];
+            if ([value isKindOfClass:[NSString class]]) {
+                value = [value copy];
+            } else if (![value isKindOfClass:[NSNumber class]]) {
+                value = [value description] ?: @"";
+            }
+            snapshotFields[key] = value;
+            byteCost += (kContextSnapshotObjectByteCost * 2) + [key lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+            if ([value isKindOfClass:[NSString class]]) {
+                byteCost += [value lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+            }
+        }
+        _fields = [snapshotFields copy];
+        _byteCost = byteCost;
+        atomic_init(&_accounted, false);
+    }
+    return self;
+}
+
+- (instancetype)init
+{
+    [self doesNotRecognizeSelector:_cmd];
+    abort();
+}
+
+- (void)dealloc
+{
+    [_ledger releaseByteCost:_byteCost];
+}
+
+- (BOOL)tls_accountInLedger:(TLSLogContextSnapshotLedger *)ledger budget:(NSUInteger)budget
+{
+    if (atomic_exchange(&_accounted, true)) {
+        return YES;
+    }
+    if (![ledger reserveByteCost:_byteCost budget:budget]) {
+        atomic_store(&_accounted, false);
+        return NO;
+    }
+    _ledger = ledger;
+    return YES;
+}
+
+- (NSString *)description
+{
+    return [NSString stringWithFormat:@"<%@ %p: object=%@, filterKey=%@, fields=%@>", NSStringFromClass([self class]), self, _objectClassName, _filterKey, _fields];
+}
+
+@end
+
 @implementation TLSLogMessageInfo
 {
     NSDictionary<NSNumber *, NSString *> *_formattedMessages;
     NSString *_fileFunctionLineString;
+    TLSLogField *_fields;
+    // the bytes of the payload left out of a compact copy
+    NSUInteger _payloadOmittedLength;
 }
 
 - (instancetype)initWithLevel:(TLSLogLevel)level
@@ -65,6 +147,161 @@ NSErrorDomain const TLSErrorDomain = @"TLSErrorDomain";
     abort();
 }
 
+- (void)dealloc
+{
+    free(_fields);
+}
+
+- (void)tls_adoptFields:(TLSLogField *)fields count:(NSUInteger)count
+{
+    free(_fields);
+    _fields = fields;
+    _fieldCount = (fields) ? count : 0;
+}
+
+- (void)tls_setSequenceNumber:(uint64_t)sequenceNumber
+{
+    _sequenceNumber = sequenceNumber;
+}
+
+- (void)tls_setProcessIdentifier:(pid_t)processIdentifier
+{
+    _processIdentifier = processIdentifier;
+}
+
+- (void)tls_setPayload:(NSData *)payload maximumRenderedLength:(NSUInteger)maximumRenderedLength
+{
+    _payload = [payload copy];
+    _payloadOmittedLength = 0;
+    _maximumPayloadRenderedLength = maximumRenderedLength;
+}
+
+- (TLSLogMessageInfo *)tls_infoWithMessage:(NSString *)message
+{
+    return [self tls_infoWithMessage:message contextObject:_contextObject];
+}
+
+- (TLSLogMessageInfo *)tls_infoWithMessage:(NSString *)message contextObject:(id)contextObject
+{
+    TLSLogMessageInfo *info = [[TLSLogMessageInfo alloc] initWithLevel:_level
+                                                                  file:_file
+                                                              function:_function
+                                                                  line:_line
+                                                               channel:_channel
+                                                             timestamp:_timestamp
+                                                           logLifespan:_logLifespan
+                                                              threadId:_threadId
+                                                            threadName:_threadName
+                                                         contextObject:contextObject
+                                                               message:message];
+    info->_sequenceNumber = _sequenceNumber;
+    info->_processIdentifier = _processIdentifier;
+    info->_payload = _payload;
+    info->_payloadOmittedLength = _payloadOmittedLength;
+    info->_maximumPayloadRenderedLength = _maximumPayloadRenderedLength;
+    if (_fieldCount > 0) {
+        TLSLogField *fields = malloc(_fieldCount * sizeof(TLSLogField));
+        if (fields) {
+            memcpy(fields, _fields, _fieldCount * sizeof(TLSLogField));
+            [info tls_adoptFields:fields count:_fieldCount];
+        }
+    }
+    return info;
+}
+
+- (TLSLogMessageInfo *)tls_compactInfoWithMaximumPayloadLength:(NSUInteger)maximumPayloadLength
+{
+    TLSLogMessageInfo *info = [[TLSLogMessageInfo alloc] initWithLevel:_level
+                                                                  file:_file
+                                                              function:_function
+                                                                  line:_line
+                                                               channel:_channel
+                                                             timestamp:_timestamp
+                                                           logLifespan:_logLifespan
+                                                              threadId:_threadId
+                                                            threadName:_threadName
+                                                         contextObject:nil
+                                                               message:_message];
+    info->_sequenceNumber = _sequenceNumber;
+    info->_processIdentifier = _processIdentifier;
+    info->_maximumPayloadRenderedLength = _maximumPayloadRenderedLength;
+    info->_payloadOmittedLength = _payloadOmittedLength;
+    if (_payload.length > maximumPayloadLength) {
+        info->_payload = [_payload subdataWithRange:NSMakeRange(0, maximumPayloadLength)];
+        info->_payloadOmittedLength += _payload.length - maximumPayloadLength;
+    } else {
+        info->_payload = _payload;
+    }
+    if (_fieldCount > 0) {
+        TLSLogField *fields = malloc(_fieldCount * sizeof(TLSLogField));
+        if (fields) {
+            memcpy(fields, _fields, _fieldCount * sizeof(TLSLogField));
+            [info tls_adoptFields:fields count:_fieldCount];
+        }
+    }
+    return info;
+}
+
+- (const TLSLogField *)fields
+{
+    return _fields;
+}
+
+- (void)enumerateFieldsUsingBlock:(void (NS_NOESCAPE ^)(const TLSLogField *field, BOOL *stop))block
+{
+    BOOL stop = NO;
+    for (NSUInteger i = 0; i < _fieldCount && !stop; i++) {
+        block(&_fields[i], &stop);
+    }
+}
+
+- (NSString *)composePayloadWithEncoding:(TLSLogPayloadEncoding)encoding
+{
+    NSData *payload = _payload;
+    const NSUInteger totalLength = payload.length + _payloadOmittedLength;
+    if (!totalLength) {
+        return @"";
+    }
+
+    // only encode the bytes that fit (and that are held), the rest of the payload is never touched
+    NSUInteger length = payload.length;
+    NSString *marker = nil;
+    if (_maximumPayloadRenderedLength > 0) {
+        length = MIN(length, _PayloadLengthFittingRenderedLength(_maximumPayloadRenderedLength, encoding));
+        if (length < totalLength) {
+            // the marker counts against the cap too, and it grows as fewer bytes fit
+            while (true) {
+                marker = [NSString stringWithFormat:@"...(+%lu bytes)", (unsigned long)(totalLength - length)];
+                const NSUInteger markerLength = MIN(marker.length, _maximumPayloadRenderedLength);
+                const NSUInteger fittingLength = MIN(length, _PayloadLengthFittingRenderedLength(_maximumPayloadRenderedLength - markerLength, encoding));
+                if (fittingLength == length) {
+                    break;
+                }
+                length = fittingLength;
+            }
+            if (marker.length > _maximumPayloadRenderedLength) {
+                // not even the marker fits
+                return @"";
+            }
+        }
+    } else if (length < totalLength) {
+        marker = [NSString stringWithFormat:@"...(+%lu bytes)", (unsigned long)(totalLength - length)];
+    }
+
+    NSMutableString *rendered;
+    if (TLSLogPayloadEncodingBase64 == encoding) {
+        NSData *data = (length < payload.length) ? [payload subdataWithRange:NSMakeRange(0, length)] : payload;
+        rendered = [[data base64EncodedStringWithOptions:0] mutableCopy];
+    } else {
+        rendered = [[NSMutableString alloc] initWithCapacity:length * 2];
+        _AppendHexToString(rendered, payload, length);
+    }
+    if (marker) {
+        [rendered appendString:marker];
+    }
+    return rendered;
+}
+
 - (NSString *)composeFormattedMessage
 {
     return [self composeFormattedMessageWithOptions:TLSComposeLogMessageInfoDefaultOptions];
@@ -133,6 +370,16 @@ NSErrorDomain const TLSErrorDomain = @"TLSErrorDomain";
                 }
             }
 
+            // SEQUENCE
+            if (TLS_BITMASK_INTERSECTS_FLAGS(options, TLSComposeLogMessageInfoLogSequenceNumber)) {
+                [mComposedMessage appendFormat:@"[#%llu]", _sequenceNumber];
+            }
+
+            // PROCESS
+            if (TLS_BITMASK_INTERSECTS_FLAGS(options, TLSComposeLogMessageInfoLogProcessIdentifier) && _processIdentifier != 0) {
+                [mComposedMessage appendFormat:@"[pid:%d]", _processIdentifier];
+            }
+
             // THREAD
             if (TLS_BITMASK_INTERSECTS_FLAGS(options, TLSComposeLogMessageInfoLogThreadId | TLSComposeLogMessageInfoLogThreadName)) {
                 [mComposedMessage appendString:@"["];
@@ -165,6 +412,22 @@ NSErrorDomain const TLSErrorDomain = @"TLSErrorDomain";
 
             [mComposedMessage appendFormat:@" : %@", self.message];
 
+            // FIELDS
+            if (_fieldCount > 0) {
+                _AppendFieldsToString(mComposedMessage, _fields, _fieldCount);
+            }
+
+            // PAYLOAD
+            if (_payload) {
+                if (TLS_BITMASK_INTERSECTS_FLAGS(options, TLSComposeLogMessageInfoLogPayloadAsHex)) {
+                    [mComposedMessage appendFormat:@" payload=%@", [self composePayloadWithEncoding:TLSLogPayloadEncodingHex]];
+                } else if (TLS_BITMASK_INTERSECTS_FLAGS(options, TLSComposeLogMessageInfoLogPayloadAsBase64)) {
+                    [mComposedMessage appendFormat:@" payload=%@", [self composePayloadWithEncoding:TLSLogPayloadEncodingBase64]];
+                } else {
+                    [mComposedMessage appendFormat:@" payload=<%lu bytes>", (unsigned long)(_payload.length + _payloadOmittedLength)];
+                }
+            }
+
             composedMessage = [mComposedMessage copy];
             if (TLS_BITMASK_EXCLUDES_FLAGS(options, TLSComposeLogMessageInfoDoNotCache)) {
                 if (!_formattedMessages) {
@@ -190,6 +453,152 @@ NSErrorDomain const TLSErrorDomain = @"TLSErrorDomain";
 
 @end
 
+static void _AppendQuotedFieldValueToString(NSMutableString *string, NSString *value);
+static void _AppendQuotedFieldValueToString(NSMutableString *string, NSString *value)
+{
+    // logfmt quoting, control characters are escaped so a value never breaks the line
+    [string appendString:@"\""];
+    const NSUInteger length = value.length;
+    NSUInteger clean = 0;
+    for (NSUInteger i = 0; i < length; i++) {
+        const unichar c = [value characterAtIndex:i];
+        NSString *escape = nil;
+        switch (c) {
+            case '"':   escape = @"\\\""; break;
+            case '\\':  escape = @"\\\\"; break;
+            case '\n':  escape = @"\\n"; break;
+            case '\r':  escape = @"\\r"; break;
+            case '\t':  escape = @"\\t"; break;
+            default:
+                if (c < 0x20 || (c >= 0x7f && c <= 0x9f) || 0x2028 == c || 0x2029 == c) {
+                    escape = [NSString stringWithFormat:@"\\u%04x", c];
+                }
+                break;
+        }
+        if (escape) {
+            [string appendString:[value substringWithRange:NSMakeRange(clean, i - clean)]];
+            [string appendString:escape];
+            clean = i + 1;
+        }
+    }
+    [string appendString:[value substringFromIndex:clean]];
+    [string appendString:@"\""];
+}
+
+static void _AppendFieldsToString(NSMutableString *string, const TLSLogField *fields, NSUInteger fieldCount)
+{
+    for (NSUInteger i = 0; i < fieldCount; i++) {
+        const TLSLogField *field = &fields[i];
+        [string appendFormat:@" %s=", field->key];
+        switch (field->type) {
+            case TLSLogFieldTypeInteger:
+                [string appendFormat:@"%lld", (long long)field->value.integerValue];
+                break;
+            case TLSLogFieldTypeDouble:
+            {
+                // as short as possible while still round tripping, `%g` alone loses precision
+                const double value = field->value.doubleValue;
+                char number[32];
+                snprintf(number, sizeof(number), "%.15g", value);
+                if (isfinite(value) && strtod(number, NULL) != value) {
+                    snprintf(number, sizeof(number), "%.17g", value);
+                }
+                [string appendFormat:@"%s", number];
+                break;
+            }
+            case TLSLogFieldTypeBool:
+                [string appendString:(field->value.boolValue) ? @"true" : @"false"];
+                break;
+            case TLSLogFieldTypeString:
+            {
+                NSString *value = @((const char *)field->value.stringValue) ?: @"";
+                static NSCharacterSet *sQuotedCharacters;
+                static dispatch_once_t sOnceToken;
+                dispatch_once(&sOnceToken, ^{
+                    NSMutableCharacterSet *characters = [NSMutableCharacterSet controlCharacterSet];
+                    [characters addCharactersInString:@" =\"\\\u2028\u2029"];
+                    sQuotedCharacters = [characters copy];
+                });
+                const BOOL needsQuotes = (0 == value.length) || [value rangeOfCharacterFromSet:sQuotedCharacters].location != NSNotFound;
+                if (needsQuotes) {
+                    _AppendQuotedFieldValueToString(string, value);
+                } else {
+                    [string appendString:value];
+                }
+                break;
+            }
+        }
+    }
+}
+
+static NSUInteger _PayloadLengthFittingRenderedLength(NSUInteger renderedLength, TLSLogPayloadEncoding encoding)
+{
+    return (TLSLogPayloadEncodingBase64 == encoding) ? (renderedLength / 4) * 3 : renderedLength / 2;
+}
+
+static void _AppendHexToString(NSMutableString *string, NSData *data, NSUInteger length)
+{
+    static const char sHexDigits[] = "0123456789abcdef";
+    __block NSUInteger remaining = length;
+    // a dispatch_data_t payload can be discontiguous, walk its ranges instead of flattening it
+    [data enumerateByteRangesUsingBlock:^(const void *bytes, NSRange byteRange, BOOL *stop) {
+        const uint8_t *byteCursor = bytes;
+        const NSUInteger rangeLength = MIN(byteRange.length, remaining);
+        UniChar chunk[128];
+        NSUInteger i = 0;
+        while (i < rangeLength) {
+            const NSUInteger chunkBytes = MIN(rangeLength - i, sizeof(chunk) / 2);
+            for (NSUInteger j = 0; j < chunkBytes; j++) {
+                const uint8_t byte = byteCursor[i + j];
+                chunk[j * 2] = sHexDigits[byte >> 4];
+                chunk[(j * 2) + 1] = sHexDigits[byte & 0xf];
+            }
+            CFStringAppendCharacters((__bridge CFMutableStringRef)string, chunk, (CFIndex)(chunkBytes * 2));
+            i += chunkBytes;
+        }
+        remaining -= rangeLength;
+        *stop = (0 == remaining);
+    }];
+}
+
+TLSLogField TLSLogFieldCString(const char *key, const char *value)
+{
+    TLSLogField field;
+    memset(&field, 0, sizeof(field));
+    field.key = key;
+    field.type = TLSLogFieldTypeString;
+    if (value) {
+        const size_t length = strnlen(value, TLSLogFieldStringCapacity + 1);
+        memcpy(field.value.stringValue, value, MIN(length, (size_t)TLSLogFieldStringCapacity));
+        if (length > TLSLogFieldStringCapacity) {
+            const size_t boundary = TLSUTF8CodePointBoundary(field.value.stringValue, TLSLogFieldStringCapacity);
+            memset(field.value.stringValue + boundary, 0, TLSLogFieldStringCapacity - boundary);
+        }
+    }
+    return field;
+}
+
+TLSLogField TLSLogFieldString(const char *key, NSString *value)
+{
+    TLSLogField field;
+    memset(&field, 0, sizeof(field));
+    field.key = key;
+    field.type = TLSLogFieldTypeString;
+    if (value) {
+        // converts whole code points until the inline storage is full
+        CFStringRef string = (__bridge CFStringRef)value;
+        (void)CFStringGetBytes(string,
+                               CFRangeMake(0, CFStringGetLength(string)),
+                               kCFStringEncodingUTF8,
+                               '?',
+                               false,
+                               (UInt8 *)field.value.stringValue,
+                               TLSLogFieldStringCapacity,
+                               NULL);
+    }
+    return field;
+}
+
 NSString *TLSLogLevelToString(TLSLogLevel level)
 {
     static NSString * const sLevelStrings[] = {
@@ -305,3 +714,84 @@ NSString *TLSGetProcessBinaryName()
 
     return name;
 }
+
+int TLSWriteVectorFully(int fileDescriptor, struct iovec *iov, int iovcnt)
+{
+    while (iovcnt > 0) {
+        ssize_t written = writev(fileDescriptor, iov, iovcnt);
+        if (written < 0) {
+            if (EINTR == errno) {
+                continue;
+            }
+            return errno;
+        }
+
+        // partial write, skip what was written and go again
+        while (iovcnt > 0 && (size_t)written >= iov->iov_len) {
+            written -= (ssize_t)iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (char *)iov->iov_base + written;
+            iov->iov_len -= (size_t)written;
+        }
+    }
+    return 0;
+}
+
+size_t TLSStdioUnflushedBytes(FILE *file, const char **bytesOut)
+{
+    const char *bytes = NULL;
+    size_t length = 0;
+#if defined(__APPLE__)
+    // BSD stdio: `_p` is past the last buffered byte when writing
+    if (file && TLS_BITMASK_INTERSECTS_FLAGS(file->_flags, __SWR) && file->_bf._base && file->_p > file->_bf._base) {
+        bytes = (const char *)file->_bf._base;
+        length = (size_t)(file->_p - file->_bf._base);
+    }
+#elif defined(__GLIBC__)
+    if (file && file->_IO_write_base && file->_IO_write_ptr > file->_IO_write_base) {
+        bytes = file->_IO_write_base;
+        length = (size_t)(file->_IO_write_ptr - file->_IO_write_base);
+    }
+#endif
+    if (bytesOut) {
+        *bytesOut = bytes;
+    }
+    return length;
+}
+
+void TLSStdioDiscardUnflushedBytes(FILE *file)
+{
+#if defined(__APPLE__)
+    // BSD stdio: rewind the buffer like `__sflush` does once it has written it
+    if (file && TLS_BITMASK_INTERSECTS_FLAGS(file->_flags, __SWR) && file->_bf._base) {
+        file->_p = file->_bf._base;
+        file->_w = TLS_BITMASK_INTERSECTS_FLAGS(file->_flags, __SLBF | __SNBF) ? 0 : file->_bf._size;
+    }
+#elif defined(__GLIBC__)
+    if (file && file->_IO_write_base) {
+        file->_IO_write_ptr = file->_IO_write_base;
+    }
+#endif
+}
+
+size_t TLSUTF8CodePointBoundary(const char *bytes, size_t length)
+{
+    // back up to the lead byte of the last code point
+    size_t leadIndex = length;
+    size_t continuationCount = 0;
+    while (leadIndex > 0 && continuationCount < 4 && 0x80 == ((unsigned char)bytes[leadIndex - 1] & 0xC0)) {
+        leadIndex--;
+        continuationCount++;
+    }
+    if (0 == leadIndex) {
+        return 0;
+    }
+    leadIndex--;
+
+    const unsigned char lead = (unsigned char)bytes[leadIndex];
+    const size_t sequenceLength = (lead >= 0xF0) ? 4 : (lead >= 0xE0) ? 3 : (lead >= 0xC0) ? 2 : 1;
+    return (sequenceLength <= continuationCount + 1) ? length : leadIndex;
+}
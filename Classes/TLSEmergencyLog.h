@@ -0,0 +1,112 @@
+//
+//  TLSEmergencyLog.h
+//  TwitterLoggingService
+//
+//  Created on 10/18/26.
+//  Copyright (c) 2026 Twitter, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//          http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+#import <TwitterLoggingService/TLSDeclarations.h>
+
+@class TLSFileOutputStream;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ A last resort log for when the process is going down, such as from a crash signal handler.
+
+ `[TLSLoggingService flush]` cannot be called from a signal handler (it uses `dispatch_sync`,
+ autorelease pools and Objective-C messaging), so whatever is still buffered by the output streams
+ never reaches the log files.  An emergency log is set up ahead of time with its file descriptor
+ already open and its record buffer already allocated, then the emergency functions only use
+ async-signal-safe calls:
+
+ - `TLSEmergencyLogWriteRecord` writes a fixed format record to the emergency log file
+       [EMERGENCY][SECONDS.MILLISECONDS][pid:PID][CHANNEL][LEVEL] : MESSAGE
+   with the wall clock time in seconds since 1970.
+ - `TLSEmergencyLogDumpUnflushedOutput` writes what the added `TLSFileOutputStream`s have buffered
+   (the `FILE`'s stdio buffer and the buffers of asynchronous writes not yet written) to their own log files.
+
+ Only call the emergency functions when the process is about to terminate.  Output streams are not
+ paused, a log message being written out at the same time can be torn (or written twice, by the I/O
+ thread of asynchronous writes).  The dumped bytes are marked as written, so they are not written
+ again should the process carry on and flush or close the output streams.
+
+ ## Constants
+
+    #define TLSEmergencyLogMaxRecordLength (1024)            // bytes, longer records are truncated
+    #define TLSEmergencyLogMaxFileOutputStreamCount (16)
+ */
+@interface TLSEmergencyLog : NSObject
+
+/** The path of the emergency log file */
+@property (nonatomic, copy, readonly) NSString *filePath;
+
+/**
+ Open (or create) the emergency log file at _filePath_ for appending.
+ @param filePath the path of the emergency log file
+ @param errorOut an output reference to get any errors that occur while opening the file.  If there is an error, the return value will be `nil`.
+ */
+- (nullable instancetype)initWithFilePath:(NSString *)filePath
+                                    error:(out NSError * __nullable __autoreleasing * __nullable)errorOut NS_DESIGNATED_INITIALIZER;
+
+/** NS_UNAVAILABLE */
+- (instancetype)init NS_UNAVAILABLE;
+/** NS_UNAVAILABLE */
++ (instancetype)new NS_UNAVAILABLE;
+
+/**
+ Add a file output stream (retained) whose buffered output is dumped by `TLSEmergencyLogDumpUnflushedOutput`.
+ @return `NO` if `TLSEmergencyLogMaxFileOutputStreamCount` streams were already added
+ */
+- (BOOL)addFileOutputStream:(TLSFileOutputStream *)stream;
+
+/**
+ Remove a file output stream added with `addFileOutputStream:`.
+ */
+- (void)removeFileOutputStream:(TLSFileOutputStream *)stream;
+
+@end
+
+//! Max bytes of an emergency record (including the trailing newline), longer records are truncated
+#define TLSEmergencyLogMaxRecordLength (1024)
+//! Max file output streams that can be added to an emergency log
+#define TLSEmergencyLogMaxFileOutputStreamCount (16)
+
+/**
+ Write a record to the emergency log file.  Async-signal-safe.
+ Records of concurrent callers are not interleaved, the record of a caller that finds the record
+ buffer in use is dropped (`EBUSY`).
+ @param emergencyLog the emergency log
+ @param level the level of the record
+ @param channel the UTF-8 channel of the record, can be `NULL`
+ @param message the UTF-8 message of the record, can be `NULL`
+ @return `0` or the `errno` of the failure
+ */
+FOUNDATION_EXTERN int TLSEmergencyLogWriteRecord(TLSEmergencyLog * __unsafe_unretained emergencyLog,
+                                                 TLSLogLevel level,
+                                                 const char * __nullable channel,
+                                                 const char * __nullable message);
+
+/**
+ Write the buffered output of the added file output streams to their log files.  Async-signal-safe.
+ @param emergencyLog the emergency log
+ @param bytesDumpedOut an output reference to get the number of bytes written, can be `NULL`
+ @return `0` or the `errno` of the first failure (the other streams are still dumped)
+ */
+FOUNDATION_EXTERN int TLSEmergencyLogDumpUnflushedOutput(TLSEmergencyLog * __unsafe_unretained emergencyLog,
+                                                         size_t * __nullable bytesDumpedOut);
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,243 @@
+//
+//  TLSEmergencyLog.m
+//  TwitterLoggingService
+//
+//  Created on 10/18/26.
+//  Copyright (c) 2026 Twitter, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//          http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#import <TwitterLoggingService/TLSEmergencyLog.h>
+#import <TwitterLoggingService/TLSFileOutputStream.h>
+#import "TLS_Project.h"
+
+// `TLSLogLevelToString` returns an `NSString`, the emergency path needs C strings
+static const char * const sEmergencyLevelNames[] = {
+    "OMG",
+    "ALR",
+    "CRI",
+    "ERR",
+    "WRN",
+    "not",
+    "inf",
+    "dbg"
+};
+TLS_COMPILER_ASSERT(((sizeof(sEmergencyLevelNames) / sizeof(sEmergencyLevelNames[0])) == TLSLogLevelCount), sEmergencyLevelNames_NOT_EQUAL_TO_TLSLogLevelCount);
+
+#pragma mark - Async-signal-safe formatting
+
+typedef struct {
+    char *bytes;
+    size_t length;
+    size_t capacity;
+} TLSEmergencyRecord;
+
+static void _RecordAppend(TLSEmergencyRecord *record, const char *bytes, size_t length);
+static void _RecordAppend(TLSEmergencyRecord *record, const char *bytes, size_t length)
+{
+    // truncate, never overflow (and never split a code point)
+    const size_t available = record->capacity - record->length;
+    if (length > available) {
+        length = TLSUTF8CodePointBoundary(bytes, available);
+    }
+    memcpy(record->bytes + record->length, bytes, length);
+    record->length += length;
+}
+
+#define _RecordAppendLiteral(record, literal) _RecordAppend((record), (literal), sizeof(literal) - 1)
+
+static void _RecordAppendUnsigned(TLSEmergencyRecord *record, uint64_t value, unsigned int minimumDigits);
+static void _RecordAppendUnsigned(TLSEmergencyRecord *record, uint64_t value, unsigned int minimumDigits)
+{
+    char digits[20];
+    size_t index = sizeof(digits);
+    do {
+        digits[--index] = (char)('0' + (value % 10));
+        value /= 10;
+    } while (value > 0 || (sizeof(digits) - index) < minimumDigits);
+    _RecordAppend(record, digits + index, sizeof(digits) - index);
+}
+
+#pragma mark - TLSEmergencyLog
+
+@implementation TLSEmergencyLog
+{
+    int _fileDescriptor;
+    char *_recordBytes;
+    atomic_flag _recordBytesInUse;
+
+    // read by the emergency functions without locking, the streams are retained by `_streams`
+    _Atomic(void *) _streamSlots[TLSEmergencyLogMaxFileOutputStreamCount];
+    pthread_mutex_t _streamsLock;
+    NSMutableArray<TLSFileOutputStream *> *_streams;
+}
+
+- (instancetype)initWithFilePath:(NSString *)filePath
+                           error:(out NSError **)errorOut
+{
+    const int fileDescriptor = (filePath.length > 0) ? open(filePath.fileSystemRepresentation, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644) : -1;
+    if (fileDescriptor < 0) {
+        if (errorOut) {
+            *errorOut = [NSError errorWithDomain:NSPOSIXErrorDomain
+                                            code:(filePath.length > 0) ? errno : EINVAL
+                                        userInfo:@{ @"message" : @"unable to open the emergency log file",
+                                                    @"filePath" : filePath ?: [NSNull null] }];
+        }
+        return nil;
+    }
+
+    if (self = [super init]) {
+        _filePath = [filePath copy];
+        _fileDescriptor = fileDescriptor;
+        _recordBytes = malloc(TLSEmergencyLogMaxRecordLength);
+        if (!_recordBytes) {
+            if (errorOut) {
+                *errorOut = [NSError errorWithDomain:NSPOSIXErrorDomain
+                                                code:ENOMEM
+                                            userInfo:@{ @"message" : @"unable to allocate the emergency record buffer",
+                                                        @"filePath" : _filePath }];
+            }
+            return nil;
+        }
+        atomic_flag_clear(&_recordBytesInUse);
+        for (NSUInteger i = 0; i < TLSEmergencyLogMaxFileOutputStreamCount; i++) {
+            atomic_init(&_streamSlots[i], NULL);
+        }
+        pthread_mutex_init(&_streamsLock, NULL);
+        _streams = [[NSMutableArray alloc] init];
+    } else {
+        close(fileDescriptor);
+    }
+    return self;
+}
+
+- (instancetype)init
+{
+    [self doesNotRecognizeSelector:_cmd];
+    abort();
+}
+
+- (void)dealloc
+{
+    if (_streams) {
+        pthread_mutex_destroy(&_streamsLock);
+    }
+    free(_recordBytes);
+    close(_fileDescriptor);
+}
+
+- (BOOL)addFileOutputStream:(TLSFileOutputStream *)stream
+{
+    BOOL added = NO;
+    pthread_mutex_lock(&_streamsLock);
+    if ([_streams indexOfObjectIdenticalTo:stream] != NSNotFound) {
+        added = YES;
+    } else {
+        for (NSUInteger i = 0; i < TLSEmergencyLogMaxFileOutputStreamCount; i++) {
+            if (!atomic_load_explicit(&_streamSlots[i], memory_order_relaxed)) {
+                [_streams addObject:stream];
+                atomic_store_explicit(&_streamSlots[i], (__bridge void *)stream, memory_order_release);
+                added = YES;
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&_streamsLock);
+    return added;
+}
+
+- (void)removeFileOutputStream:(TLSFileOutputStream *)stream
+{
+    pthread_mutex_lock(&_streamsLock);
+    for (NSUInteger i = 0; i < TLSEmergencyLogMaxFileOutputStreamCount; i++) {
+        if (atomic_load_explicit(&_streamSlots[i], memory_order_relaxed) == (__bridge void *)stream) {
+            // unpublish before releasing
+            atomic_store_explicit(&_streamSlots[i], NULL, memory_order_release);
+            [_streams removeObjectIdenticalTo:stream];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&_streamsLock);
+}
+
+int TLSEmergencyLogWriteRecord(TLSEmergencyLog *emergencyLog, TLSLogLevel level, const char *channel, const char *message)
+{
+    if (!emergencyLog) {
+        return EINVAL;
+    }
+    if (atomic_flag_test_and_set_explicit(&emergencyLog->_recordBytesInUse, memory_order_acquire)) {
+        return EBUSY;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    // leave room for the newline
+    TLSEmergencyRecord record = { emergencyLog->_recordBytes, 0, TLSEmergencyLogMaxRecordLength - 1 };
+    _RecordAppendLiteral(&record, "[EMERGENCY][");
+    _RecordAppendUnsigned(&record, (uint64_t)now.tv_sec, 1);
+    _RecordAppendLiteral(&record, ".");
+    _RecordAppendUnsigned(&record, (uint64_t)now.tv_nsec / NSEC_PER_MSEC, 3);
+    _RecordAppendLiteral(&record, "][pid:");
+    _RecordAppendUnsigned(&record, (uint64_t)getpid(), 1);
+    _RecordAppendLiteral(&record, "][");
+    if (channel) {
+        _RecordAppend(&record, channel, strlen(channel));
+    }
+    _RecordAppendLiteral(&record, "][");
+    const char *levelName = (level >= 0 && level < TLSLogLevelCount) ? sEmergencyLevelNames[level] : "???";
+    _RecordAppend(&record, levelName, strlen(levelName));
+    _RecordAppendLiteral(&record, "] : ");
+    if (message) {
+        _RecordAppend(&record, message, strlen(message));
+    }
+    record.bytes[record.length++] = '\n';
+
+    struct iovec iov = { .iov_base = record.bytes, .iov_len = record.length };
+    const int error = TLSWriteVectorFully(emergencyLog->_fileDescriptor, &iov, 1);
+    atomic_flag_clear_explicit(&emergencyLog->_recordBytesInUse, memory_order_release);
+    return error;
+}
+
+int TLSEmergencyLogDumpUnflushedOutput(TLSEmergencyLog *emergencyLog, size_t *bytesDumpedOut)
+{
+    size_t bytesDumped = 0;
+    int firstError = 0;
+    if (emergencyLog) {
+        for (NSUInteger i = 0; i < TLSEmergencyLogMaxFileOutputStreamCount; i++) {
+            void *streamPointer = atomic_load_explicit(&emergencyLog->_streamSlots[i], memory_order_acquire);
+            if (streamPointer) {
+                size_t length = 0;
+                const int error = TLSFileOutputStreamWriteUnflushedBytes((__bridge TLSFileOutputStream *)streamPointer, &length);
+                firstError = firstError ?: error;
+                bytesDumped += length;
+            }
+        }
+    } else {
+        firstError = EINVAL;
+    }
+    if (bytesDumpedOut) {
+        *bytesDumpedOut = bytesDumped;
+    }
+    return firstError;
+}
+
+@end
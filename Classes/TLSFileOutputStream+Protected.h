@@ -41,6 +41,7 @@
  Don't override `outputLogData:`.
 
     - (void)outputLogData:(NSData *)data;
+    - (void)outputLogData:(NSData *)data forLogInfo:(TLSLogMessageInfo *)logInfo;
  */
 
 @interface TLSFileOutputStream (Protected)
@@ -67,6 +68,22 @@
  */
 - (void)outputLogData:(nonnull NSData *)data;
 
+/**
+ Output the _data_ composed from _logInfo_ by calling `outputLogData:` with `currentLogInfo` set to
+ _logInfo_ for the duration of the call.
+ The default implementation of `tls_outputLogInfo:` calls this method.  Subclasses that override
+ `tls_outputLogInfo:` should call this method rather than `outputLogData:` so that features that
+ depend on the log message's attributes (such as indexing) keep working.
+
+ **DO NOT override this method **
+ */
+- (void)outputLogData:(nonnull NSData *)data forLogInfo:(nonnull TLSLogMessageInfo *)logInfo;
+
+/**
+ The `TLSLogMessageInfo` being output while within `outputLogData:forLogInfo:`, otherwise `nil`.
+ */
+- (nullable TLSLogMessageInfo *)currentLogInfo;
+
 /**
  This overrideable method performs the inner operation of opening a log at the given filepath.
  The directory containing the file designated by the new file to be created must already exist (generally achieved by separately calling createLogFileDirectoryAtPath:error:).
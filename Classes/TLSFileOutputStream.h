@@ -21,6 +21,19 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+/**
+ How far a log message is pushed towards the disk once it is written by a `TLSFileOutputStream`.
+ See `[TLSFileOutputStream setDurability:forLevels:]`
+ */
+typedef NS_ENUM(NSInteger, TLSFileOutputDurability) {
+    /** leave the message buffered, it goes out when the buffer fills or on `tls_flush` (default) */
+    TLSFileOutputDurabilityBuffered = 0,
+    /** flush the buffered output to the OS, survives the process crashing */
+    TLSFileOutputDurabilityFlush,
+    /** flush and sync the file to storage, survives the device losing power (rate limited by `minimumSyncInterval`) */
+    TLSFileOutputDurabilitySync,
+};
+
 /**
  This is the base class for other file output stream classes to extend.
 
@@ -38,6 +51,14 @@ NS_ASSUME_NONNULL_BEGIN
  every write, but it is recommended to only do so when trying to debug something specific and never
  be enabled in production builds.   See `flushAfterEveryWriteEnabled`
 
+ Rather than flushing after every write, durability can be targeted by log level, for example:
+ flush warnings so they survive a crash and sync errors so they survive a power loss while leaving
+ debug and information messages buffered.   See `setDurability:forLevels:`
+
+ When the disk can be slow (low storage, heavy app I/O), the file output stream can instead buffer
+ writes in memory and write them out from a dedicated I/O thread so that the logging queue (and all
+ other output streams) never wait on the disk.   See `asynchronousWriteBufferSize`
+
  To offer increased control over output streams buffering, `TLSLoggingService` exposes a `flush`
  method.  It is recommended that you `flush` whenever you encounter an explicit need to have the
  buffered I/O be output to disk, such as:
@@ -55,6 +76,7 @@ NS_ASSUME_NONNULL_BEGIN
     NSUInteger _bytesWritten;
     NSString *_logFilePath;
     BOOL _flushAfterEveryWriteEnabled;
+    TLSLogMessageInfo *_currentLogInfo;
 }
 
 /**
@@ -67,6 +89,17 @@ NS_ASSUME_NONNULL_BEGIN
  established during initialization
  */
 @property (nonatomic, readonly) NSUInteger bytesWritten;
+/**
+ Number of bytes that could not be written (across every log file), they are not counted in `bytesWritten`.
+ With asynchronous writes, bytes are counted as written when handed off to the I/O thread and moved to
+ `bytesDropped` once the I/O thread reports their write failed (at the latest by the next `tls_flush`).
+ */
+@property (nonatomic, readonly) unsigned long long bytesDropped;
+/**
+ The error of the last failed write (`NSPOSIXErrorDomain`), such as the disk being full.
+ `nil` if no write has failed.
+ */
+@property (nonatomic, readonly, nullable) NSError *lastWriteError;
 /**
  The path to the `logFile`
  established during initialization
@@ -84,6 +117,39 @@ NS_ASSUME_NONNULL_BEGIN
  */
 @property (nonatomic, getter=isFlushAfterEveryWriteEnabled) BOOL flushAfterEveryWriteEnabled;
 
+/**
+ Size in bytes of each buffer used for asynchronous writes.
+ When non-zero, writes are copied into in-memory buffers that a dedicated I/O thread writes to the
+ `logFile`'s file descriptor, writing stalls only when every buffer is waiting to be written out.
+ `tls_flush` waits for the I/O thread to finish writing out the buffers.
+ Subclasses must not write to `logFile` directly while asynchronous writes are enabled.
+ If the buffers or the I/O thread cannot be created, writes go through the `logFile` until the settings change.
+ Default is `0` (disabled, writes go through the `logFile` synchronously).  Min non-zero value is `4KB`.
+ */
+@property (nonatomic) NSUInteger asynchronousWriteBufferSize;
+
+/**
+ Number of buffers used for asynchronous writes, see `asynchronousWriteBufferSize`.
+ Default is `2` (double buffering).  Min is `2`, max is `16`.
+ */
+@property (nonatomic) NSUInteger asynchronousWriteBufferCount;
+
+/**
+ The minimum time between two syncs triggered by `TLSFileOutputDurabilitySync`.
+ Messages that would sync within the interval are flushed instead, so a burst of errors cannot turn
+ into a burst of expensive syncs, and a single trailing sync is issued at the end of the interval so
+ that the last of them are made durable too.
+ Default is `1` second.
+ */
+@property (nonatomic) NSTimeInterval minimumSyncInterval;
+
+/** Number of flushes issued by the stream (from `tls_flush` and from durability and debugging settings) */
+@property (nonatomic, readonly) unsigned long long flushCount;
+/** Number of file syncs issued by the stream for `TLSFileOutputDurabilitySync` (including trailing syncs once they are done) */
+@property (nonatomic, readonly) unsigned long long syncCount;
+/** Number of `TLSFileOutputDurabilitySync` syncs that were downgraded to a flush by `minimumSyncInterval` */
+@property (nonatomic, readonly) unsigned long long rateLimitedSyncCount;
+
 /**
  The encoding of the logged data.
  Default is `NSUTF8StringEncoding`.
@@ -129,6 +195,22 @@ NS_ASSUME_NONNULL_BEGIN
  */
 + (NSString *)defaultLogFileDirectoryPath;
 
+/**
+ Set the durability for messages logged at any of the given levels.
+ Messages written without an associated `TLSLogMessageInfo` (such as direct writes by subclasses) are
+ always `TLSFileOutputDurabilityBuffered`.
+ Default is `TLSFileOutputDurabilityBuffered` for all levels.
+ @param durability the `TLSFileOutputDurability` to apply
+ @param levels the levels to apply the _durability_ to
+ */
+- (void)setDurability:(TLSFileOutputDurability)durability
+            forLevels:(TLSLogLevelMask)levels;
+
+/**
+ @return the `TLSFileOutputDurability` for messages logged at the given _level_
+ */
+- (TLSFileOutputDurability)durabilityForLevel:(TLSLogLevel)level;
+
 /**
  Reset the log and clear it
  */
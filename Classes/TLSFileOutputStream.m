@@ -17,12 +17,53 @@
 //  See the License for the specific language governing permissions and
 //  limitations under the License.
 
+#include <sys/uio.h>
+#include <unistd.h>
+
 #import "TLS_Project.h"
+#import "TLSAsyncFileWriter.h"
 #import "TLSFileOutputStream+Protected.h"
 
 static NSString * const TLSFileOutputEventKeyNewLogFilePath = @"newLogFilePath";
 
+@interface TLSFileOutputStream ()
+- (void)_closeAsyncWriter TLS_OBJC_DIRECT;
+- (void)_updateAsyncWriterDroppedBytes TLS_OBJC_DIRECT;
+- (void)_recordDroppedBytes:(unsigned long long)length error:(int)error TLS_OBJC_DIRECT;
+- (void)_flushToFileSystem TLS_OBJC_DIRECT;
+- (void)_applyDurabilityForLevel:(TLSLogLevel)level TLS_OBJC_DIRECT;
+- (void)_scheduleDeferredSyncAtTime:(CFAbsoluteTime)syncTime now:(CFAbsoluteTime)now TLS_OBJC_DIRECT;
+@end
+
+static void _SyncFileDescriptor(int fileDescriptor);
+static void _SyncFileDescriptor(int fileDescriptor)
+{
+#if __APPLE__
+    // fsync on Apple platforms only pushes to the drive (like fdatasync), F_FULLFSYNC would be overkill
+    (void)fsync(fileDescriptor);
+#else
+    (void)fdatasync(fileDescriptor);
+#endif
+}
+
 @implementation TLSFileOutputStream
+{
+    TLSAsyncFileWriter *_asyncWriter;
+    // creating the asynchronous writer failed, write through the `logFile` until the settings change
+    BOOL _asyncWriterUnavailable;
+    // the `_asyncWriter`'s dropped bytes already taken off the written byte counts
+    unsigned long long _asyncWriterDroppedByteCount;
+    TLSFileOutputDurability _durabilities[TLSLogLevelCount];
+    CFAbsoluteTime _lastSyncTime;
+    // a rate limited sync is made up for at the end of the rate window, cleared from the sync's queue
+    BOOL _deferredSyncPending;
+    // across every log file, read from any thread for `tls_metricCounters`
+    unsigned long long _totalBytesWritten;
+    unsigned long long _bytesDropped;
+    int _lastWriteErrorCode;
+    // `fileno` takes the FILE's lock, keep the descriptor for `TLSFileOutputStreamWriteUnflushedBytes`
+    int _logFileDescriptor;
+}
 
 #pragma mark - initialization/cleanup
 
@@ -56,6 +97,8 @@ static NSString * const TLSFileOutputEventKeyNewLogFilePath = @"newLogFilePath";
 
     if (self = [super init]) {
         _composeLogMessageOptions = TLSComposeLogMessageInfoDefaultOptions;
+        _asynchronousWriteBufferCount = TLS_ASYNC_FILE_WRITER_MIN_BUFFER_COUNT;
+        _minimumSyncInterval = 1.0;
         if (![self openLogFilePath:[logFileDirectoryPath stringByAppendingPathComponent:logFileName] error:errorOut]) {
             return nil;
         }
@@ -80,6 +123,7 @@ static NSString * const TLSFileOutputEventKeyNewLogFilePath = @"newLogFilePath";
 
 - (void)dealloc
 {
+    [_asyncWriter close];
     if (_logFile) {
         fflush(_logFile);
         fclose(_logFile);
@@ -118,6 +162,7 @@ static NSString * const TLSFileOutputEventKeyNewLogFilePath = @"newLogFilePath";
 - (BOOL)resetAndReturnError:(out NSError * __nullable * __nullable)error
 {
     if (_logFile) {
+        [self _closeAsyncWriter];
         fclose(_logFile);
         _logFile = NULL;
         [[NSFileManager defaultManager] removeItemAtPath:_logFilePath error:NULL];
@@ -126,20 +171,255 @@ static NSString * const TLSFileOutputEventKeyNewLogFilePath = @"newLogFilePath";
     return [self openLogFilePath:_logFilePath error:error];
 }
 
-#pragma mark - TLSOutputStream protocol implementation
+- (void)setAsynchronousWriteBufferSize:(NSUInteger)asynchronousWriteBufferSize
+{
+    if (asynchronousWriteBufferSize > 0) {
+        asynchronousWriteBufferSize = MAX(asynchronousWriteBufferSize, (NSUInteger)TLS_ASYNC_FILE_WRITER_MIN_BUFFER_SIZE);
+    }
+    if (asynchronousWriteBufferSize != _asynchronousWriteBufferSize) {
+        // drain with the old settings, the next write picks up the new ones
+        [self _closeAsyncWriter];
+        _asynchronousWriteBufferSize = asynchronousWriteBufferSize;
+        _asyncWriterUnavailable = NO;
+    }
+}
 
-- (void)tls_flush
+- (void)setAsynchronousWriteBufferCount:(NSUInteger)asynchronousWriteBufferCount
 {
-    if (_logFile) {
+    asynchronousWriteBufferCount = MAX(MIN(asynchronousWriteBufferCount, (NSUInteger)TLS_ASYNC_FILE_WRITER_MAX_BUFFER_COUNT), (NSUInteger)TLS_ASYNC_FILE_WRITER_MIN_BUFFER_COUNT);
+    if (asynchronousWriteBufferCount != _asynchronousWriteBufferCount) {
+        [self _closeAsyncWriter];
+        _asynchronousWriteBufferCount = asynchronousWriteBufferCount;
+        _asyncWriterUnavailable = NO;
+    }
+}
+
+- (void)_closeAsyncWriter
+{
+    [_asyncWriter close];
+    [self _updateAsyncWriterDroppedBytes];
+    _asyncWriter = nil;
+    _asyncWriterDroppedByteCount = 0;
+}
+
+- (void)_updateAsyncWriterDroppedBytes
+{
+    if (!_asyncWriter) {
+        return;
+    }
+
+    const unsigned long long droppedByteCount = _asyncWriter.droppedByteCount;
+    if (droppedByteCount != _asyncWriterDroppedByteCount) {
+        const unsigned long long length = droppedByteCount - _asyncWriterDroppedByteCount;
+        _asyncWriterDroppedByteCount = droppedByteCount;
+        [self _recordDroppedBytes:length error:_asyncWriter.lastError];
+    }
+}
+
+- (void)_recordDroppedBytes:(unsigned long long)length error:(int)error
+{
+    // the bytes were counted as written when they were handed off
+    _bytesWritten -= (NSUInteger)MIN(length, (unsigned long long)_bytesWritten);
+    __atomic_fetch_sub(&_totalBytesWritten, length, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&_bytesDropped, length, __ATOMIC_RELAXED);
+    __atomic_store_n(&_lastWriteErrorCode, (error) ?: EIO, __ATOMIC_RELAXED);
+}
+
+- (unsigned long long)bytesDropped
+{
+    return __atomic_load_n(&_bytesDropped, __ATOMIC_RELAXED);
+}
+
+- (NSError *)lastWriteError
+{
+    const int errorCode = __atomic_load_n(&_lastWriteErrorCode, __ATOMIC_RELAXED);
+    if (!errorCode) {
+        return nil;
+    }
+
+    return [NSError errorWithDomain:NSPOSIXErrorDomain
+                               code:errorCode
+                           userInfo:@{ @"message" : @"Could not write to the log file, bytes were dropped" }];
+}
+
+- (void)setDurability:(TLSFileOutputDurability)durability
+            forLevels:(TLSLogLevelMask)levels
+{
+    for (TLSLogLevel level = 0; level < TLSLogLevelCount; level++) {
+        if (TLS_BITMASK_INTERSECTS_FLAGS(levels, (1 << level))) {
+            _durabilities[level] = durability;
+        }
+    }
+}
+
+- (TLSFileOutputDurability)durabilityForLevel:(TLSLogLevel)level
+{
+    if (level < 0 || level >= TLSLogLevelCount) {
+        return TLSFileOutputDurabilityBuffered;
+    }
+    return _durabilities[level];
+}
+
+- (void)_flushToFileSystem
+{
+    if (_asyncWriter) {
+        [_asyncWriter flush];
+        [self _updateAsyncWriterDroppedBytes];
+    } else if (_logFile) {
         fflush(_logFile);
+    } else {
+        return;
+    }
+    // relaxed atomics since `tls_metricCounters` reads the counters from any thread
+    __atomic_fetch_add(&_flushCount, 1, __ATOMIC_RELAXED);
+}
+
+- (void)_applyDurabilityForLevel:(TLSLogLevel)level
+{
+    const TLSFileOutputDurability durability = [self durabilityForLevel:level];
+    if (TLSFileOutputDurabilityBuffered == durability || !_logFile) {
+        return;
+    }
+
+    [self _flushToFileSystem];
+
+    if (TLSFileOutputDurabilitySync == durability) {
+        const CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+        if (_syncCount > 0 && (now - _lastSyncTime) < _minimumSyncInterval) {
+            // the flush will have to do for now, a trailing sync at the end of the window makes it durable
+            __atomic_fetch_add(&_rateLimitedSyncCount, 1, __ATOMIC_RELAXED);
+            if (!__atomic_load_n(&_deferredSyncPending, __ATOMIC_ACQUIRE)) {
+                [self _scheduleDeferredSyncAtTime:_lastSyncTime + _minimumSyncInterval now:now];
+            }
+            return;
+        }
+        _SyncFileDescriptor(_logFileDescriptor);
+        _lastSyncTime = now;
+        __atomic_fetch_add(&_syncCount, 1, __ATOMIC_RELAXED);
+    }
+}
+
+- (void)_scheduleDeferredSyncAtTime:(CFAbsoluteTime)syncTime now:(CFAbsoluteTime)now
+{
+    // the log file can be closed (rolled over) before the sync, sync a duplicate of its descriptor
+    const int fileDescriptor = dup(_logFileDescriptor);
+    if (fileDescriptor < 0) {
+        return;
     }
+
+    // the window restarts with the deferred sync, which covers everything flushed until then
+    _lastSyncTime = syncTime;
+    __atomic_store_n(&_deferredSyncPending, YES, __ATOMIC_RELEASE);
+    __weak typeof(self) weakSelf = self;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(MAX(syncTime - now, 0.0) * NSEC_PER_SEC)),
+                   dispatch_get_global_queue(QOS_CLASS_UTILITY, 0),
+                   ^{
+        _SyncFileDescriptor(fileDescriptor);
+        close(fileDescriptor);
+        TLSFileOutputStream *strongSelf = weakSelf;
+        if (strongSelf) {
+            __atomic_fetch_add(&strongSelf->_syncCount, 1, __ATOMIC_RELAXED);
+            __atomic_store_n(&strongSelf->_deferredSyncPending, NO, __ATOMIC_RELEASE);
+        }
+    });
+}
+
+#pragma mark - TLSOutputStream protocol implementation
+
+- (void)tls_flush
+{
+    [self _flushToFileSystem];
 }
 
 - (void)tls_outputLogInfo:(TLSLogMessageInfo *)logInfo
 {
     NSString *message = [logInfo composeFormattedMessageWithOptions:self.composeLogMessageOptions];
     NSData *messageData = [message dataUsingEncoding:self.tls_loggedDataEncoding];
-    [self outputLogData:messageData];
+    [self outputLogData:messageData forLogInfo:logInfo];
+}
+
+- (NSDictionary<NSString *, NSNumber *> *)tls_metricCounters
+{
+    return @{
+        TLSOutputStreamMetricBytesWritten : @(__atomic_load_n(&_totalBytesWritten, __ATOMIC_RELAXED)),
+        TLSOutputStreamMetricBytesDropped : @(__atomic_load_n(&_bytesDropped, __ATOMIC_RELAXED)),
+        TLSOutputStreamMetricFlushes : @(__atomic_load_n(&_flushCount, __ATOMIC_RELAXED)),
+        TLSOutputStreamMetricSyncs : @(__atomic_load_n(&_syncCount, __ATOMIC_RELAXED)),
+    };
+}
+
+#pragma mark - Emergency
+
+int TLSFileOutputStreamWriteUnflushedBytes(TLSFileOutputStream *stream, size_t *lengthOut)
+{
+    size_t length = 0;
+    int error = 0;
+    FILE *logFile = (stream) ? stream->_logFile : NULL;
+    if (logFile) {
+        // stdio buffered bytes come before the asynchronous writes, which flush the FILE when they start
+        const char *bytes = NULL;
+        const size_t stdioLength = TLSStdioUnflushedBytes(logFile, &bytes);
+        if (stdioLength > 0) {
+            struct iovec iov = { .iov_base = (void *)bytes, .iov_len = stdioLength };
+            error = TLSWriteVectorFully(stream->_logFileDescriptor, &iov, 1);
+            if (!error) {
+                // written, the FILE must not write them again when it is flushed or closed
+                TLSStdioDiscardUnflushedBytes(logFile);
+                length += stdioLength;
+            }
+        }
+
+        __unsafe_unretained TLSAsyncFileWriter *asyncWriter = stream->_asyncWriter;
+        if (asyncWriter) {
+            size_t asyncLength = 0;
+            const int asyncError = TLSAsyncFileWriterWriteUnwrittenBuffers(asyncWriter, &asyncLength);
+            error = error ?: asyncError;
+            length += asyncLength;
+        }
+    }
+    if (lengthOut) {
+        *lengthOut = length;
+    }
+    return error;
+}
+
+#pragma mark - Open files
+
+void TLSFileOutputStreamCloseLogFile(TLSFileOutputStream *stream)
+{
+    if (stream->_logFile) {
+        [stream tls_flush];
+        [stream _closeAsyncWriter];
+        FILE *logFile = stream->_logFile;
+        stream->_logFile = NULL;
+        stream->_logFileDescriptor = -1;
+        fclose(logFile);
+    }
+}
+
+BOOL TLSFileOutputStreamReopenLogFile(TLSFileOutputStream *stream, NSError **errorOut)
+{
+    if (stream->_logFile) {
+        return YES;
+    }
+
+    FILE *logFile = fopen(stream->_logFilePath.UTF8String, "a");
+    if (!logFile) {
+        if (errorOut) {
+            int errCode = errno;
+            NSDictionary *info = @{ TLSFileOutputEventKeyNewLogFilePath : (stream->_logFilePath) ?: [NSNull null],
+                                    @"message" : @"Could not reopen file for logging to!",
+                                    @"exceptionName" : NSObjectInaccessibleException };
+            *errorOut = [NSError errorWithDomain:NSPOSIXErrorDomain
+                                            code:errCode
+                                        userInfo:info];
+        }
+        return NO;
+    }
+
+    stream->_logFileDescriptor = fileno(logFile);
+    stream->_logFile = logFile;
+    return YES;
 }
 
 @end
@@ -151,9 +431,34 @@ static NSString * const TLSFileOutputEventKeyNewLogFilePath = @"newLogFilePath";
 - (void)writeBytes:(const char*)bytes length:(size_t)length
 {
     if (_logFile && bytes != NULL && length > 0) {
-        _bytesWritten += fwrite(bytes, 1, length, _logFile);
-        if (_flushAfterEveryWriteEnabled) {
+        if (!_asyncWriter && !_asyncWriterUnavailable && _asynchronousWriteBufferSize > 0) {
+            // anything already buffered by the FILE must go out before the I/O thread takes over
             fflush(_logFile);
+            _asyncWriter = [[TLSAsyncFileWriter alloc] initWithFileDescriptor:fileno(_logFile)
+                                                                   bufferSize:_asynchronousWriteBufferSize
+                                                                  bufferCount:_asynchronousWriteBufferCount];
+            // out of memory or threads, don't try again on every write
+            _asyncWriterUnavailable = !_asyncWriter;
+        }
+
+        if (_asyncWriter) {
+            [_asyncWriter writeBytes:bytes length:length];
+            _bytesWritten += length;
+            __atomic_fetch_add(&_totalBytesWritten, length, __ATOMIC_RELAXED);
+            [self _updateAsyncWriterDroppedBytes];
+        } else {
+            const size_t writtenLength = fwrite(bytes, 1, length, _logFile);
+            _bytesWritten += writtenLength;
+            __atomic_fetch_add(&_totalBytesWritten, writtenLength, __ATOMIC_RELAXED);
+            if (writtenLength < length) {
+                const int error = errno;
+                __atomic_fetch_add(&_bytesDropped, length - writtenLength, __ATOMIC_RELAXED);
+                __atomic_store_n(&_lastWriteErrorCode, (error) ?: EIO, __ATOMIC_RELAXED);
+            }
+        }
+
+        if (_flushAfterEveryWriteEnabled) {
+            [self _flushToFileSystem];
         }
     }
 }
@@ -262,11 +567,13 @@ static NSString * const TLSFileOutputEventKeyNewLogFilePath = @"newLogFilePath";
 
     if (_logFile) {
         [self tls_flush];
+        [self _closeAsyncWriter];
         fclose(_logFile);
     }
 
     _logFilePath = [logFilePath copy];
     _logFileDirectoryPath = [_logFilePath stringByDeletingLastPathComponent];
+    _logFileDescriptor = fileno(newLogFile);
     _logFile = newLogFile;
     _bytesWritten = 0;
 
@@ -277,6 +584,22 @@ static NSString * const TLSFileOutputEventKeyNewLogFilePath = @"newLogFilePath";
 {
     [self writeData:data];
     [self writeNewline];
+    if (_currentLogInfo) {
+        [self _applyDurabilityForLevel:_currentLogInfo.level];
+    }
+}
+
+- (void)outputLogData:(NSData *)data forLogInfo:(TLSLogMessageInfo *)logInfo
+{
+    TLSLogMessageInfo *previousLogInfo = _currentLogInfo;
+    _currentLogInfo = logInfo;
+    [self outputLogData:data];
+    _currentLogInfo = previousLogInfo;
+}
+
+- (TLSLogMessageInfo *)currentLogInfo
+{
+    return _currentLogInfo;
 }
 
 @end
@@ -0,0 +1,137 @@
+//
+//  TLSFlightRecorderOutputStream.h
+//  TwitterLoggingService
+//
+//  Created on 10/18/26.
+//  Copyright (c) 2026 Twitter, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//          http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+#import <TwitterLoggingService/TLSProtocols.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ A concrete `TLSOutputStream` that keeps the most recent log messages in memory and only writes
+ them to disk when something goes wrong.
+
+ Every log message (including `TLSLogLevelDebug`) is recorded into a ring bounded by `maxBytes`
+ and `window`, nothing is composed nor written at the time it is logged.  The ring keeps compact
+ copies of the log messages (no context object and at most `1KB` of payload).
+ When triggered, by a log message at or above `triggerLevel`, by a log message to one of the
+ `triggerChannels` or by `triggerWithReason:`, the ring is composed and written to a new recording
+ log file which keeps getting the log messages that follow for `postTriggerDuration` seconds.
+ A trigger during a recording extends it.
+
+ This provides the debug context around failures for a fraction of the I/O of logging everything
+ to a `TLSRollingFileOutputStream`.
+
+ Recordings are named `<logFilePrefix><id>.log`, only the newest `maxRecordings` are kept.
+
+ ## Constants
+
+    FOUNDATION_EXTERN const NSUInteger TLSFlightRecorderOutputStreamDefaultMaxBytes;               // 1 MB
+    FOUNDATION_EXTERN const NSTimeInterval TLSFlightRecorderOutputStreamDefaultWindow;            // 30 seconds
+    FOUNDATION_EXTERN const NSTimeInterval TLSFlightRecorderOutputStreamDefaultPostTriggerDuration; // 5 seconds
+    FOUNDATION_EXTERN const NSUInteger TLSFlightRecorderOutputStreamDefaultMaxRecordings;         // 10 recordings
+    FOUNDATION_EXTERN NSString * const TLSFlightRecorderOutputStreamDefaultLogFilePrefix;         // @"flight."
+
+ @note Use a `logFilePrefix` that no other file output stream logging to the same directory uses, otherwise they will prune each other's log files.
+ */
+@interface TLSFlightRecorderOutputStream : NSObject <TLSOutputStream, TLSDataRetrieval>
+
+/** The directory containing the recordings */
+@property (nonatomic, copy, readonly) NSString *logFileDirectoryPath;
+/** The prefix for each recording */
+@property (nonatomic, copy, readonly) NSString *logFilePrefix;
+/** The maximum size of the recorded log messages (the memory held by their compact copies).  Min is `1KB`. */
+@property (nonatomic, readonly) NSUInteger maxBytes;
+/** The maximum age of the recorded log messages, relative to the newest one.  `0` for no limit. */
+@property (nonatomic, readonly) NSTimeInterval window;
+/** The number of recordings to keep.  Min is `1`. */
+@property (nonatomic, readonly) NSUInteger maxRecordings;
+
+/**
+ Log messages at this level or above trigger a recording.
+ Default is `TLSLogLevelError`
+ */
+@property (atomic) TLSLogLevel triggerLevel;
+/**
+ Log messages to these channels trigger a recording, regardless of their level.
+ Default is `nil`
+ */
+@property (atomic, nullable, copy) NSSet<NSString *> *triggerChannels;
+/**
+ How long a recording keeps going after its last trigger.
+ Default is `TLSFlightRecorderOutputStreamDefaultPostTriggerDuration`
+ */
+@property (atomic) NSTimeInterval postTriggerDuration;
+/**
+ The format to write the log messages of recordings with.
+ Default is `TLSComposeLogMessageInfoDefaultOptions`
+ */
+@property (atomic) TLSComposeLogMessageInfoOptions composeLogMessageOptions;
+
+/** The recordings, oldest to newest.  Safe to call from any thread. */
+@property (atomic, copy, readonly) NSArray<NSString *> *recordingFilePaths;
+/** Whether a recording is in progress */
+@property (atomic, readonly, getter=isRecording) BOOL recording;
+
+/**
+ Initialize the `TLSFlightRecorderOutputStream` with the provided settings
+ @param logFileDirectoryPath the directory where the recordings will live. By default uses `[TLSFileOutputStream defaultLogFileDirectoryPath]`.
+ @param logFilePrefix the string to prefix all recordings with. Default is `TLSFlightRecorderOutputStreamDefaultLogFilePrefix`.
+ @param maxBytes the maximum size of the log messages kept in memory
+ @param window the maximum age of the log messages kept in memory, `0` for no limit
+ @param maxRecordings the maximum number of recordings to keep
+ @param errorOut an output reference to get any errors that occur while creating the output stream.  If there is an error, the return value will be `nil`.
+ */
+- (nullable instancetype)initWithLogFileDirectoryPath:(nullable NSString *)logFileDirectoryPath
+                                        logFilePrefix:(nullable NSString *)logFilePrefix
+                                             maxBytes:(NSUInteger)maxBytes
+                                               window:(NSTimeInterval)window
+                                        maxRecordings:(NSUInteger)maxRecordings
+                                                error:(out NSError * __nullable __autoreleasing * __nullable)errorOut NS_DESIGNATED_INITIALIZER;
+
+/** See initWithLogFileDirectoryPath:logFilePrefix:maxBytes:window:maxRecordings:error: with the defaults */
+- (nullable instancetype)initWithError:(out NSError * __nullable __autoreleasing * __nullable)errorOut;
+
+/** NS_UNAVAILABLE */
+- (instancetype)init NS_UNAVAILABLE;
+/** NS_UNAVAILABLE */
++ (instancetype)new NS_UNAVAILABLE;
+
+/**
+ Trigger a recording, for failures that aren't logged (such as a watchdog firing).
+ Safe to call from any thread, call `[TLSLoggingService flush]` first to include the log messages still on their way.
+ @param reason the reason written at the start of the recording
+ */
+- (void)triggerWithReason:(nullable NSString *)reason;
+
+#pragma mark - protocol TLSDataRetrieval
+/**
+ Get the past recordings followed by the log messages currently in memory.
+ @param maxBytes The maximum number of bytes to get.  The newest log messages in memory come first, then whole recordings are loaded (newest first) as long as they fit.
+ */
+- (nullable NSData *)tls_retrieveLoggedData:(NSUInteger)maxBytes;
+
+@end
+
+FOUNDATION_EXTERN const NSUInteger TLSFlightRecorderOutputStreamDefaultMaxBytes;               // 1 MB
+FOUNDATION_EXTERN const NSTimeInterval TLSFlightRecorderOutputStreamDefaultWindow;            // 30 seconds
+FOUNDATION_EXTERN const NSTimeInterval TLSFlightRecorderOutputStreamDefaultPostTriggerDuration; // 5 seconds
+FOUNDATION_EXTERN const NSUInteger TLSFlightRecorderOutputStreamDefaultMaxRecordings;         // 10 recordings
+FOUNDATION_EXTERN NSString * const TLSFlightRecorderOutputStreamDefaultLogFilePrefix;         // @"flight."
+
+NS_ASSUME_NONNULL_END
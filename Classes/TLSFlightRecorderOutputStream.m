@@ -0,0 +1,441 @@
+//
+//  TLSFlightRecorderOutputStream.m
+//  TwitterLoggingService
+//
+//  Created on 10/18/26.
+//  Copyright (c) 2026 Twitter, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//          http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+#import <objc/runtime.h>
+#import <pthread.h>
+#import "TLS_Project.h"
+#import "TLSFileOutputStream+Protected.h"
+#import "TLSFlightRecorderOutputStream.h"
+
+const NSUInteger TLSFlightRecorderOutputStreamDefaultMaxBytes = 1024 * 1024;
+const NSTimeInterval TLSFlightRecorderOutputStreamDefaultWindow = 30.0;
+const NSTimeInterval TLSFlightRecorderOutputStreamDefaultPostTriggerDuration = 5.0;
+const NSUInteger TLSFlightRecorderOutputStreamDefaultMaxRecordings = 10;
+NSString * const TLSFlightRecorderOutputStreamDefaultLogFilePrefix = @"flight.";
+
+static NSString * const kLogFileExtension = @"log";
+
+static const NSUInteger kMinBytes = 1024; // 1 KB
+static const NSUInteger kMinRecordings = 1;
+
+// recorded log messages keep at most this much of their payload
+static const NSUInteger kMaxRecordedPayloadBytes = 1024;
+
+#define LOG_EVENT_PREFIX @"[LOG EVENT] : "
+
+typedef long long TLSLogFileId;
+
+static NSUInteger _RecordedSize(TLSLogMessageInfo *info);
+static NSUInteger _RecordedSize(TLSLogMessageInfo *info)
+{
+    static NSUInteger sInstanceSize;
+    static dispatch_once_t sOnceToken;
+    dispatch_once(&sOnceToken, ^{
+        sInstanceSize = (NSUInteger)class_getInstanceSize([TLSLogMessageInfo class]);
+    });
+
+    // what a compact copy holds: the info, its strings (UTF-16 worst case rather than touching the
+    // bytes), its fields and its capped payload.  The file, function and channel are callsite constants.
+    return sInstanceSize
+         + ((info.message.length + info.threadName.length) * sizeof(unichar))
+         + (info.fieldCount * sizeof(TLSLogField))
+         + info.payload.length;
+}
+
+TLS_OBJC_DIRECT_MEMBERS
+@interface TLSFlightRecorderOutputStream (Private)
+- (BOOL)_loadExistingRecordings:(out NSError **)errorOut;
+- (void)_lock_recordLogInfo:(TLSLogMessageInfo *)logInfo time:(NSTimeInterval)time;
+- (void)_lock_startRecordingWithReason:(NSString *)reason time:(NSTimeInterval)time;
+- (void)_lock_endRecordingIfNeededAtTime:(NSTimeInterval)time;
+- (void)_lock_writeLogInfo:(TLSLogMessageInfo *)logInfo options:(TLSComposeLogMessageInfoOptions)options;
+- (void)_lock_writeString:(NSString *)string;
+- (void)_lock_pruneRecordings;
+@end
+
+@interface TLSFlightRecorderOutputStream ()
+@property (atomic, copy, readwrite) NSArray<NSString *> *recordingFilePaths;
+@end
+
+@implementation TLSFlightRecorderOutputStream
+{
+    // guards everything below, output happens on the logging queue but triggers can come from any thread
+    pthread_mutex_t _lock;
+
+    // the ring, oldest to newest, front removal of an `NSMutableArray` is constant time
+    NSMutableArray<TLSLogMessageInfo *> *_ringM;
+    NSUInteger _ringBytes;
+
+    NSMutableArray<NSNumber *> *_recordingIdsM;
+    NSMutableArray<NSString *> *_recordingFilePathsM;
+    FILE *_recordingFile;
+    NSTimeInterval _recordingDeadline;
+}
+
+- (instancetype)initWithError:(out NSError **)errorOut
+{
+    return [self initWithLogFileDirectoryPath:nil
+                                logFilePrefix:nil
+                                     maxBytes:TLSFlightRecorderOutputStreamDefaultMaxBytes
+                                       window:TLSFlightRecorderOutputStreamDefaultWindow
+                                maxRecordings:TLSFlightRecorderOutputStreamDefaultMaxRecordings
+                                        error:errorOut];
+}
+
+- (instancetype)initWithLogFileDirectoryPath:(NSString *)logFileDirectoryPath
+                               logFilePrefix:(NSString *)logFilePrefix
+                                    maxBytes:(NSUInteger)maxBytes
+                                      window:(NSTimeInterval)window
+                               maxRecordings:(NSUInteger)maxRecordings
+                                       error:(out NSError **)errorOut // NS_DESIGNATED_INITIALIZER
+{
+    if (errorOut) {
+        *errorOut = nil;
+    }
+
+    if (!logFileDirectoryPath) {
+        logFileDirectoryPath = [TLSFileOutputStream defaultLogFileDirectoryPath];
+    }
+    if (!logFilePrefix) {
+        logFilePrefix = TLSFlightRecorderOutputStreamDefaultLogFilePrefix;
+    }
+
+    if (![TLSFileOutputStream createLogFileDirectoryAtPath:logFileDirectoryPath error:errorOut]) {
+        return nil;
+    }
+
+    if (self = [super init]) {
+        _logFileDirectoryPath = [logFileDirectoryPath copy];
+        _logFilePrefix = [logFilePrefix copy];
+        _maxBytes = MAX(maxBytes, kMinBytes);
+        _window = MAX(window, 0.0);
+        _maxRecordings = MAX(maxRecordings, kMinRecordings);
+        _triggerLevel = TLSLogLevelError;
+        _postTriggerDuration = TLSFlightRecorderOutputStreamDefaultPostTriggerDuration;
+        _composeLogMessageOptions = TLSComposeLogMessageInfoDefaultOptions;
+        _recordingFilePaths = @[];
+        pthread_mutex_init(&_lock, NULL);
+        _ringM = [[NSMutableArray alloc] init];
+        _recordingIdsM = [[NSMutableArray alloc] init];
+        _recordingFilePathsM = [[NSMutableArray alloc] init];
+
+        if (![self _loadExistingRecordings:errorOut]) {
+            return nil;
+        }
+    }
+
+    return self;
+}
+
+- (instancetype)init
+{
+    [self doesNotRecognizeSelector:_cmd];
+    abort();
+}
+
+- (void)dealloc
+{
+    if (_recordingFile) {
+        fflush(_recordingFile);
+        fclose(_recordingFile);
+    }
+    pthread_mutex_destroy(&_lock);
+}
+
+#pragma mark - Public
+
+- (BOOL)isRecording
+{
+    pthread_mutex_lock(&_lock);
+    const BOOL recording = (NULL != _recordingFile);
+    pthread_mutex_unlock(&_lock);
+    return recording;
+}
+
+- (void)triggerWithReason:(NSString *)reason
+{
+    reason = [NSString stringWithFormat:@"trigger (%@)", reason ?: @"no reason given"];
+    const NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+
+    pthread_mutex_lock(&_lock);
+    [self _lock_endRecordingIfNeededAtTime:now];
+    if (_recordingFile) {
+        [self _lock_writeString:[NSString stringWithFormat:LOG_EVENT_PREFIX @"flight recording extended by %@", reason]];
+        fflush(_recordingFile);
+        _recordingDeadline = now + self.postTriggerDuration;
+    } else {
+        [self _lock_startRecordingWithReason:reason time:now];
+    }
+    pthread_mutex_unlock(&_lock);
+}
+
+#pragma mark - TLSOutputStream
+
+- (void)tls_outputLogInfo:(TLSLogMessageInfo *)logInfo
+{
+    NSString *reason = nil;
+    if (logInfo.level <= self.triggerLevel) {
+        reason = [NSString stringWithFormat:@"%@ log message to %@", TLSLogLevelToString(logInfo.level), logInfo.channel];
+    } else if ([self.triggerChannels containsObject:logInfo.channel]) {
+        reason = [NSString stringWithFormat:@"log message to %@", logInfo.channel];
+    }
+    const NSTimeInterval time = logInfo.timestamp.timeIntervalSinceReferenceDate;
+
+    pthread_mutex_lock(&_lock);
+    [self _lock_endRecordingIfNeededAtTime:time];
+    if (_recordingFile) {
+        [self _lock_writeLogInfo:logInfo options:self.composeLogMessageOptions];
+        // recordings exist to explain failures, get each log message out in case the process doesn't survive
+        fflush(_recordingFile);
+        if (reason) {
+            _recordingDeadline = MAX(_recordingDeadline, time + self.postTriggerDuration);
+        }
+    } else {
+        [self _lock_recordLogInfo:logInfo time:time];
+        if (reason) {
+            [self _lock_startRecordingWithReason:reason time:time];
+        }
+    }
+    pthread_mutex_unlock(&_lock);
+}
+
+- (void)tls_flush
+{
+    pthread_mutex_lock(&_lock);
+    [self _lock_endRecordingIfNeededAtTime:[NSDate timeIntervalSinceReferenceDate]];
+    if (_recordingFile) {
+        fflush(_recordingFile);
+    }
+    pthread_mutex_unlock(&_lock);
+}
+
+#pragma mark - TLSDataRetrieval
+
+- (NSStringEncoding)tls_loggedDataEncoding
+{
+    return NSUTF8StringEncoding;
+}
+
+- (NSData *)tls_retrieveLoggedData:(NSUInteger)maxBytes
+{
+    [self tls_flush];
+
+    pthread_mutex_lock(&_lock);
+    NSArray<NSString *> *recordingFilePaths = [_recordingFilePathsM copy];
+    NSArray<TLSLogMessageInfo *> *ring = [_ringM copy];
+    pthread_mutex_unlock(&_lock);
+
+    // the log messages in memory are the newest, they get the budget first (newest to oldest)
+    NSMutableArray<NSData *> *ringLines = [[NSMutableArray alloc] init];
+    NSData *ringHeader = [LOG_EVENT_PREFIX @"flight recorder in memory log messages\n" dataUsingEncoding:NSUTF8StringEncoding];
+    NSUInteger ringLength = 0;
+    if (ring.count > 0 && ringHeader.length <= maxBytes) {
+        ringLength = ringHeader.length;
+        // don't cache the compositions in the recorded infos, they would outgrow their accounted size
+        const TLSComposeLogMessageInfoOptions options = self.composeLogMessageOptions | TLSComposeLogMessageInfoDoNotCache;
+        for (TLSLogMessageInfo *info in ring.reverseObjectEnumerator) {
+            @autoreleasepool {
+                NSData *line = [[[info composeFormattedMessageWithOptions:options] stringByAppendingString:@"\n"] dataUsingEncoding:NSUTF8StringEncoding];
+                if (ringLength + line.length > maxBytes) {
+                    break;
+                }
+                [ringLines addObject:line];
+                ringLength += line.length;
+            }
+        }
+        if (0 == ringLines.count) {
+            ringLength = 0;
+        }
+    }
+
+    NSMutableData *data = nil;
+    NSFileManager *fm = [NSFileManager defaultManager];
+
+    // go through the recordings, newest to oldest
+    // prepend 1 recording at a time so long as it doesn't exceed our maximum size restrictions
+    for (NSInteger i = ((NSInteger)recordingFilePaths.count - 1); i >= 0; i--) {
+        @autoreleasepool {
+            NSString *recordingPath = recordingFilePaths[(NSUInteger)i];
+            if ((data.length + ringLength + [fm attributesOfItemAtPath:recordingPath error:NULL].fileSize) <= maxBytes) {
+                NSMutableData *fileData = [NSMutableData dataWithContentsOfFile:recordingPath];
+                if (!fileData) {
+                    // pruned from under us
+                    continue;
+                }
+                if (data) {
+                    [fileData appendData:data];
+                }
+                data = fileData;
+            } else {
+                break;
+            }
+        }
+    }
+
+    if (ringLines.count > 0) {
+        if (!data) {
+            data = [[NSMutableData alloc] initWithCapacity:ringLength];
+        }
+        [data appendData:ringHeader];
+        for (NSData *line in ringLines.reverseObjectEnumerator) {
+            [data appendData:line];
+        }
+    }
+
+    return data;
+}
+
+@end
+
+#pragma mark - private method implementations
+
+@implementation TLSFlightRecorderOutputStream (Private)
+
+- (BOOL)_loadExistingRecordings:(out NSError **)errorOut
+{
+    NSError *error = nil;
+    NSArray<NSString *> *fileNames = [[NSFileManager defaultManager] contentsOfDirectoryAtPath:_logFileDirectoryPath
+                                                                                         error:&error];
+    if (!fileNames) {
+        if (errorOut) {
+            *errorOut = error;
+        }
+        return NO;
+    }
+
+    const NSUInteger prefixLength = _logFilePrefix.length;
+    for (NSString *fileName in fileNames) {
+        if (![fileName hasPrefix:_logFilePrefix] || ![fileName.pathExtension isEqualToString:kLogFileExtension]) {
+            continue;
+        }
+        // "<id>"
+        NSString *fileIdString = [[fileName stringByDeletingPathExtension] substringFromIndex:prefixLength];
+        if (0 == fileIdString.length) {
+            continue;
+        }
+        [_recordingIdsM addObject:@(fileIdString.longLongValue)];
+    }
+    [_recordingIdsM sortUsingSelector:@selector(compare:)];
+
+    for (NSNumber *fileId in _recordingIdsM) {
+        NSString *fileName = [NSString stringWithFormat:@"%@%lld.%@", _logFilePrefix, fileId.longLongValue, kLogFileExtension];
+        [_recordingFilePathsM addObject:[_logFileDirectoryPath stringByAppendingPathComponent:fileName]];
+    }
+    self.recordingFilePaths = _recordingFilePathsM;
+
+    return YES;
+}
+
+- (void)_lock_recordLogInfo:(TLSLogMessageInfo *)logInfo time:(NSTimeInterval)time
+{
+    // the info is shared with the other output streams, keep a compact copy rather than its context and caches
+    NSUInteger maximumPayloadLength = kMaxRecordedPayloadBytes;
+    if (logInfo.maximumPayloadRenderedLength > 0) {
+        maximumPayloadLength = MIN(maximumPayloadLength, logInfo.maximumPayloadRenderedLength);
+    }
+    TLSLogMessageInfo *recordedInfo = [logInfo tls_compactInfoWithMaximumPayloadLength:maximumPayloadLength];
+    [_ringM addObject:recordedInfo];
+    _ringBytes += _RecordedSize(recordedInfo);
+
+    // evict the oldest log messages, always keeping the newest
+    while (_ringM.count > 1) {
+        TLSLogMessageInfo *oldestInfo = _ringM.firstObject;
+        const BOOL fits = (_ringBytes <= _maxBytes);
+        const BOOL recent = (0 == _window) || (time - oldestInfo.timestamp.timeIntervalSinceReferenceDate <= _window);
+        if (fits && recent) {
+            break;
+        }
+        _ringBytes -= _RecordedSize(oldestInfo);
+        [_ringM removeObjectAtIndex:0];
+    }
+}
+
+- (void)_lock_startRecordingWithReason:(NSString *)reason time:(NSTimeInterval)time
+{
+    // ids are hundredths of a second, kept increasing so no existence checks are needed
+    TLSLogFileId fileId = (TLSLogFileId)([NSDate date].timeIntervalSince1970 * 100.0);
+    const TLSLogFileId lastFileId = _recordingIdsM.lastObject.longLongValue;
+    if (fileId <= lastFileId) {
+        fileId = lastFileId + 1;
+    }
+
+    NSString *fileName = [NSString stringWithFormat:@"%@%lld.%@", _logFilePrefix, fileId, kLogFileExtension];
+    NSString *recordingPath = [_logFileDirectoryPath stringByAppendingPathComponent:fileName];
+    FILE *recordingFile = fopen(recordingPath.fileSystemRepresentation, "w");
+    if (!recordingFile) {
+        // keep the ring for the next trigger
+        return;
+    }
+
+    _recordingFile = recordingFile;
+    _recordingDeadline = time + self.postTriggerDuration;
+    [_recordingIdsM addObject:@(fileId)];
+    [_recordingFilePathsM addObject:recordingPath];
+
+    // the window is composed only now that it is needed
+    const TLSComposeLogMessageInfoOptions options = self.composeLogMessageOptions;
+    [self _lock_writeString:[NSString stringWithFormat:LOG_EVENT_PREFIX @"flight recording triggered by %@", reason]];
+    for (TLSLogMessageInfo *info in _ringM) {
+        @autoreleasepool {
+            [self _lock_writeLogInfo:info options:options];
+        }
+    }
+    fflush(recordingFile);
+    [_ringM removeAllObjects];
+    _ringBytes = 0;
+
+    [self _lock_pruneRecordings];
+    self.recordingFilePaths = _recordingFilePathsM;
+}
+
+- (void)_lock_endRecordingIfNeededAtTime:(NSTimeInterval)time
+{
+    if (_recordingFile && time > _recordingDeadline) {
+        fflush(_recordingFile);
+        fclose(_recordingFile);
+        _recordingFile = NULL;
+    }
+}
+
+- (void)_lock_writeLogInfo:(TLSLogMessageInfo *)logInfo options:(TLSComposeLogMessageInfoOptions)options
+{
+    [self _lock_writeString:[logInfo composeFormattedMessageWithOptions:options]];
+}
+
+- (void)_lock_writeString:(NSString *)string
+{
+    const char *utf8 = string.UTF8String;
+    if (utf8) {
+        fwrite(utf8, 1, strlen(utf8), _recordingFile);
+    }
+    fwrite("\n", 1, 1, _recordingFile);
+}
+
+- (void)_lock_pruneRecordings
+{
+    NSFileManager *fm = [NSFileManager defaultManager];
+    while (_recordingFilePathsM.count > _maxRecordings) {
+        [fm removeItemAtPath:_recordingFilePathsM.firstObject error:NULL];
+        [_recordingFilePathsM removeObjectAtIndex:0];
+        [_recordingIdsM removeObjectAtIndex:0];
+    }
+}
+
+@end
@@ -0,0 +1,65 @@
+//
+//  TLSJSONLineEncoder.h
+//  TwitterLoggingService
+//
+//  Created on 10/18/26.
+//  Copyright (c) 2026 Twitter, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//          http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+/* This header is private to Twitter Logging Service */
+
+#import "TLS_Project.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ Encodes `TLSLogMessageInfo`s as single line JSON objects (no trailing newline) for JSON Lines
+ output.
+
+    {"time":"2026-10-18T17:04:05.123Z","lifespan":12.345678,"sequence":1042,"level":"error","channel":"Networking","thread":"main","threadId":259,"file":"TNetwork.m","function":"-[TNetwork fail]","line":42,"message":"request failed","fields":{"status":503}}
+
+ `sequence` is omitted when the message was not logged through a `TLSLoggingService`, `thread` is
+ omitted when the thread has no name and `fields` is omitted when there are no structured fields.
+ A payload (see `[TLSLogMessageInfo payload]`) is encoded as base64 `payload` along with its full
+ `payloadLength`, only the bytes that fit in `[TLSLogMessageInfo maximumPayloadRenderedLength]`
+ are encoded.
+ Non finite doubles are encoded as `null`.
+
+ Strings are escaped by scanning 16 bytes at a time (NEON on arm64, SSE2 on x86_64) for the bytes
+ that need escaping and copying the clean runs in between in bulk.  The encoded bytes live in a
+ buffer that is reused by every call, so there is no allocation per message once the buffer is big
+ enough.
+
+ Not thread safe.
+ */
+TLS_OBJC_FINAL
+@interface TLSJSONLineEncoder : NSObject
+
+/**
+ Encode the _logInfo_.
+ @return the encoded line, only valid until the next call or until the encoder is deallocated
+ */
+- (NSData *)dataForLogInfo:(TLSLogMessageInfo *)logInfo;
+
+@end
+
+/**
+ Append the JSON string escaping of the UTF-8 _bytes_ (without the surrounding quotes) to _output_,
+ which must have room for `6 * length` bytes.
+ @return the number of bytes appended
+ */
+FOUNDATION_EXTERN size_t TLSJSONEscapeUTF8(char *output, const char *bytes, size_t length);
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,464 @@
+//
+//  TLSJSONLineEncoder.m
+//  TwitterLoggingService
+//
+//  Created on 10/18/26.
+//  Copyright (c) 2026 Twitter, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//          http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#import "TLSJSONLineEncoder.h"
+
+// escaping is done in chunks so a huge message doesn't need a buffer 6 times its size
+#define TLS_JSON_ESCAPE_CHUNK_LENGTH (4 * 1024)
+// room for any number or timestamp we format
+#define TLS_JSON_NUMBER_CAPACITY (64)
+
+typedef struct {
+    char *bytes;
+    size_t length;
+    size_t capacity;
+} TLSJSONLineBuffer;
+
+static const char * const sLevelNames[] = {
+    "emergency",
+    "alert",
+    "critical",
+    "error",
+    "warning",
+    "notice",
+    "information",
+    "debug"
+};
+TLS_COMPILER_ASSERT(((sizeof(sLevelNames) / sizeof(sLevelNames[0])) == TLSLogLevelCount), sLevelNames_NOT_EQUAL_TO_TLSLogLevelCount);
+
+static BOOL _BufferReserve(TLSJSONLineBuffer *buffer, size_t additionalLength);
+static BOOL _BufferReserve(TLSJSONLineBuffer *buffer, size_t additionalLength)
+{
+    const size_t requiredCapacity = buffer->length + additionalLength;
+    if (requiredCapacity <= buffer->capacity) {
+        return YES;
+    }
+
+    size_t capacity = MAX(buffer->capacity, (size_t)1024);
+    while (capacity < requiredCapacity) {
+        capacity *= 2;
+    }
+    char *bytes = realloc(buffer->bytes, capacity);
+    if (!bytes) {
+        return NO;
+    }
+    buffer->bytes = bytes;
+    buffer->capacity = capacity;
+    return YES;
+}
+
+static void _BufferAppend(TLSJSONLineBuffer *buffer, const char *bytes, size_t length);
+static void _BufferAppend(TLSJSONLineBuffer *buffer, const char *bytes, size_t length)
+{
+    if (_BufferReserve(buffer, length)) {
+        memcpy(buffer->bytes + buffer->length, bytes, length);
+        buffer->length += length;
+    }
+}
+
+#define _BufferAppendLiteral(buffer, literal) _BufferAppend((buffer), (literal), sizeof(literal) - 1)
+
+static void _BufferAppendEscaped(TLSJSONLineBuffer *buffer, const char *bytes, size_t length);
+static void _BufferAppendEscaped(TLSJSONLineBuffer *buffer, const char *bytes, size_t length)
+{
+    _BufferAppendLiteral(buffer, "\"");
+    while (length > 0) {
+        const size_t chunkLength = MIN(length, (size_t)TLS_JSON_ESCAPE_CHUNK_LENGTH);
+        if (!_BufferReserve(buffer, 6 * chunkLength)) {
+            break;
+        }
+        // escaping is byte wise (only ASCII is escaped), so chunks can split a code point
+        buffer->length += TLSJSONEscapeUTF8(buffer->bytes + buffer->length, bytes, chunkLength);
+        bytes += chunkLength;
+        length -= chunkLength;
+    }
+    _BufferAppendLiteral(buffer, "\"");
+}
+
+static void _BufferAppendDouble(TLSJSONLineBuffer *buffer, double value);
+static void _BufferAppendDouble(TLSJSONLineBuffer *buffer, double value)
+{
+    if (!isfinite(value)) {
+        _BufferAppendLiteral(buffer, "null");
+        return;
+    }
+
+    char number[TLS_JSON_NUMBER_CAPACITY];
+    int length = snprintf(number, sizeof(number), "%.15g", value);
+    if (strtod(number, NULL) != value) {
+        // shortest is not enough to round trip
+        length = snprintf(number, sizeof(number), "%.17g", value);
+    }
+    _BufferAppend(buffer, number, (size_t)length);
+}
+
+static void _BufferAppendInteger(TLSJSONLineBuffer *buffer, long long value);
+static void _BufferAppendInteger(TLSJSONLineBuffer *buffer, long long value)
+{
+    char number[TLS_JSON_NUMBER_CAPACITY];
+    const int length = snprintf(number, sizeof(number), "%lld", value);
+    _BufferAppend(buffer, number, (size_t)length);
+}
+
+static size_t _Base64Encode(char *output, const uint8_t *bytes, size_t length);
+static size_t _Base64Encode(char *output, const uint8_t *bytes, size_t length)
+{
+    static const char sBase64Digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    char *cursor = output;
+    while (length >= 3) {
+        const uint32_t triplet = ((uint32_t)bytes[0] << 16) | ((uint32_t)bytes[1] << 8) | bytes[2];
+        *cursor++ = sBase64Digits[(triplet >> 18) & 0x3f];
+        *cursor++ = sBase64Digits[(triplet >> 12) & 0x3f];
+        *cursor++ = sBase64Digits[(triplet >> 6) & 0x3f];
+        *cursor++ = sBase64Digits[triplet & 0x3f];
+        bytes += 3;
+        length -= 3;
+    }
+    if (length > 0) {
+        // the final partial triplet is padded
+        const uint32_t triplet = ((uint32_t)bytes[0] << 16) | ((length > 1) ? ((uint32_t)bytes[1] << 8) : 0);
+        *cursor++ = sBase64Digits[(triplet >> 18) & 0x3f];
+        *cursor++ = sBase64Digits[(triplet >> 12) & 0x3f];
+        *cursor++ = (length > 1) ? sBase64Digits[(triplet >> 6) & 0x3f] : '=';
+        *cursor++ = '=';
+    }
+    return (size_t)(cursor - output);
+}
+
+static void _BufferAppendTimestamp(TLSJSONLineBuffer *buffer, NSTimeInterval timeIntervalSince1970);
+static void _BufferAppendTimestamp(TLSJSONLineBuffer *buffer, NSTimeInterval timeIntervalSince1970)
+{
+    const double seconds = floor(timeIntervalSince1970);
+    const time_t time = (time_t)seconds;
+    const int milliseconds = MIN((int)((timeIntervalSince1970 - seconds) * 1000.0), 999);
+    struct tm components;
+    gmtime_r(&time, &components);
+
+    char timestamp[TLS_JSON_NUMBER_CAPACITY];
+    const int length = snprintf(timestamp,
+                                sizeof(timestamp),
+                                "\"%04d-%02d-%02dT%02d:%02d:%02d.%03dZ\"",
+                                components.tm_year + 1900,
+                                components.tm_mon + 1,
+                                components.tm_mday,
+                                components.tm_hour,
+                                components.tm_min,
+                                components.tm_sec,
+                                milliseconds);
+    _BufferAppend(buffer, timestamp, (size_t)length);
+}
+
+@interface TLSJSONLineEncoder ()
+- (void)_appendString:(NSString *)string TLS_OBJC_DIRECT;
+- (void)_appendFields:(TLSLogMessageInfo *)logInfo TLS_OBJC_DIRECT;
+- (void)_appendPayload:(NSData *)payload maximumRenderedLength:(NSUInteger)maximumRenderedLength TLS_OBJC_DIRECT;
+@end
+
+@implementation TLSJSONLineEncoder
+{
+    TLSJSONLineBuffer _buffer;
+    char *_scratchBytes;
+    size_t _scratchCapacity;
+}
+
+- (void)dealloc
+{
+    free(_buffer.bytes);
+    free(_scratchBytes);
+}
+
+- (NSData *)dataForLogInfo:(TLSLogMessageInfo *)logInfo
+{
+    TLSJSONLineBuffer *buffer = &_buffer;
+    buffer->length = 0;
+
+    _BufferAppendLiteral(buffer, "{\"time\":");
+    _BufferAppendTimestamp(buffer, logInfo.timestamp.timeIntervalSince1970);
+    _BufferAppendLiteral(buffer, ",\"lifespan\":");
+    _BufferAppendDouble(buffer, logInfo.logLifespan);
+    const uint64_t sequenceNumber = logInfo.sequenceNumber;
+    if (sequenceNumber > 0) {
+        _BufferAppendLiteral(buffer, ",\"sequence\":");
+        _BufferAppendInteger(buffer, (long long)sequenceNumber);
+    }
+    const pid_t processIdentifier = logInfo.processIdentifier;
+    if (processIdentifier != 0) {
+        _BufferAppendLiteral(buffer, ",\"pid\":");
+        _BufferAppendInteger(buffer, processIdentifier);
+    }
+    _BufferAppendLiteral(buffer, ",\"level\":\"");
+    const TLSLogLevel level = logInfo.level;
+    const char *levelName = (level >= 0 && level < TLSLogLevelCount) ? sLevelNames[level] : "unknown";
+    _BufferAppend(buffer, levelName, strlen(levelName));
+    _BufferAppendLiteral(buffer, "\",\"channel\":");
+    [self _appendString:logInfo.channel];
+    NSString *threadName = logInfo.threadName;
+    if (threadName.length > 0) {
+        _BufferAppendLiteral(buffer, ",\"thread\":");
+        [self _appendString:threadName];
+    }
+    _BufferAppendLiteral(buffer, ",\"threadId\":");
+    _BufferAppendInteger(buffer, logInfo.threadId);
+    _BufferAppendLiteral(buffer, ",\"file\":");
+    [self _appendString:logInfo.file];
+    _BufferAppendLiteral(buffer, ",\"function\":");
+    [self _appendString:logInfo.function];
+    _BufferAppendLiteral(buffer, ",\"line\":");
+    _BufferAppendInteger(buffer, logInfo.line);
+    _BufferAppendLiteral(buffer, ",\"message\":");
+    [self _appendString:logInfo.message];
+    if (logInfo.fieldCount > 0) {
+        [self _appendFields:logInfo];
+    }
+    NSData *payload = logInfo.payload;
+    if (payload) {
+        [self _appendPayload:payload maximumRenderedLength:logInfo.maximumPayloadRenderedLength];
+    }
+    _BufferAppendLiteral(buffer, "}");
+
+    return [NSData dataWithBytesNoCopy:buffer->bytes length:buffer->length freeWhenDone:NO];
+}
+
+- (void)_appendString:(NSString *)string
+{
+    CFStringRef cfString = (__bridge CFStringRef)string;
+    const char *bytes = CFStringGetCStringPtr(cfString, kCFStringEncodingUTF8);
+    size_t length;
+    if (bytes) {
+        length = strlen(bytes);
+    } else {
+        const CFIndex characterCount = CFStringGetLength(cfString);
+        const CFIndex maxLength = CFStringGetMaximumSizeForEncoding(characterCount, kCFStringEncodingUTF8);
+        if ((size_t)maxLength > _scratchCapacity) {
+            char *scratchBytes = realloc(_scratchBytes, (size_t)maxLength);
+            if (!scratchBytes) {
+                _BufferAppendLiteral(&_buffer, "\"\"");
+                return;
+            }
+            _scratchBytes = scratchBytes;
+            _scratchCapacity = (size_t)maxLength;
+        }
+        CFIndex usedLength = 0;
+        CFStringGetBytes(cfString,
+                         CFRangeMake(0, characterCount),
+                         kCFStringEncodingUTF8,
+                         '?' /*lossByte*/,
+                         false /*isExternalRepresentation*/,
+                         (UInt8 *)_scratchBytes,
+                         maxLength,
+                         &usedLength);
+        bytes = _scratchBytes;
+        length = (size_t)usedLength;
+    }
+    _BufferAppendEscaped(&_buffer, bytes, length);
+}
+
+- (void)_appendFields:(TLSLogMessageInfo *)logInfo
+{
+    TLSJSONLineBuffer *buffer = &_buffer;
+    const TLSLogField *fields = logInfo.fields;
+    const NSUInteger fieldCount = logInfo.fieldCount;
+
+    _BufferAppendLiteral(buffer, ",\"fields\":{");
+    for (NSUInteger i = 0; i < fieldCount; i++) {
+        const TLSLogField *field = &fields[i];
+        if (i > 0) {
+            _BufferAppendLiteral(buffer, ",");
+        }
+        _BufferAppendEscaped(buffer, field->key, strlen(field->key));
+        _BufferAppendLiteral(buffer, ":");
+        switch (field->type) {
+            case TLSLogFieldTypeInteger:
+                _BufferAppendInteger(buffer, field->value.integerValue);
+                break;
+            case TLSLogFieldTypeDouble:
+                _BufferAppendDouble(buffer, field->value.doubleValue);
+                break;
+            case TLSLogFieldTypeBool:
+                if (field->value.boolValue) {
+                    _BufferAppendLiteral(buffer, "true");
+                } else {
+                    _BufferAppendLiteral(buffer, "false");
+                }
+                break;
+            case TLSLogFieldTypeString:
+                _BufferAppendEscaped(buffer, field->value.stringValue, strnlen(field->value.stringValue, sizeof(field->value.stringValue)));
+                break;
+        }
+    }
+    _BufferAppendLiteral(buffer, "}");
+}
+
+- (void)_appendPayload:(NSData *)payload maximumRenderedLength:(NSUInteger)maximumRenderedLength
+{
+    TLSJSONLineBuffer *buffer = &_buffer;
+    const NSUInteger totalLength = payload.length;
+    const NSUInteger length = (maximumRenderedLength > 0) ? MIN(totalLength, (maximumRenderedLength / 4) * 3) : totalLength;
+
+    _BufferAppendLiteral(buffer, ",\"payloadLength\":");
+    _BufferAppendInteger(buffer, (long long)totalLength);
+    _BufferAppendLiteral(buffer, ",\"payload\":\"");
+    if (!_BufferReserve(buffer, ((length + 2) / 3) * 4)) {
+        _BufferAppendLiteral(buffer, "\"");
+        return;
+    }
+
+    // encode straight from the (possibly discontiguous) payload, carrying partial triplets across ranges
+    __block struct {
+        uint8_t bytes[3];
+        size_t length;
+    } carry = { { 0 }, 0 };
+    __block NSUInteger remaining = length;
+    [payload enumerateByteRangesUsingBlock:^(const void *bytes, NSRange byteRange, BOOL *stop) {
+        const uint8_t *cursor = bytes;
+        size_t rangeLength = MIN(byteRange.length, remaining);
+        remaining -= rangeLength;
+        while (carry.length > 0 && carry.length < 3 && rangeLength > 0) {
+            carry.bytes[carry.length++] = *cursor++;
+            rangeLength--;
+        }
+        if (3 == carry.length) {
+            buffer->length += _Base64Encode(buffer->bytes + buffer->length, carry.bytes, 3);
+            carry.length = 0;
+        }
+        const size_t wholeLength = rangeLength - (rangeLength % 3);
+        buffer->length += _Base64Encode(buffer->bytes + buffer->length, cursor, wholeLength);
+        for (size_t i = wholeLength; i < rangeLength; i++) {
+            carry.bytes[carry.length++] = cursor[i];
+        }
+        *stop = (0 == remaining);
+    }];
+    buffer->length += _Base64Encode(buffer->bytes + buffer->length, carry.bytes, carry.length);
+    _BufferAppendLiteral(buffer, "\"");
+}
+
+@end
+
+#pragma mark - Escaping
+
+NS_INLINE BOOL _NeedsEscape(uint8_t c)
+{
+    return c < 0x20 || '"' == c || '\\' == c;
+}
+
+static size_t _CleanRunLength(const uint8_t *bytes, size_t length);
+static size_t _CleanRunLength(const uint8_t *bytes, size_t length)
+{
+    size_t i = 0;
+
+#if defined(__aarch64__)
+    const uint8x16_t quote = vdupq_n_u8('"');
+    const uint8x16_t backslash = vdupq_n_u8('\\');
+    const uint8x16_t space = vdupq_n_u8(0x20);
+    for (; i + 16 <= length; i += 16) {
+        const uint8x16_t chunk = vld1q_u8(bytes + i);
+        const uint8x16_t dirty = vorrq_u8(vorrq_u8(vceqq_u8(chunk, quote), vceqq_u8(chunk, backslash)),
+                                          vcltq_u8(chunk, space));
+        if (vmaxvq_u8(dirty) != 0) {
+            // the scalar loop finds the byte within this chunk
+            break;
+        }
+    }
+#elif defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i maxControl = _mm_set1_epi8(0x1F);
+    for (; i + 16 <= length; i += 16) {
+        const __m128i chunk = _mm_loadu_si128((const __m128i *)(const void *)(bytes + i));
+        // SSE2 has no unsigned compare, c <= 0x1F is max(c, 0x1F) == 0x1F
+        const __m128i control = _mm_cmpeq_epi8(_mm_max_epu8(chunk, maxControl), maxControl);
+        const __m128i dirty = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+                                           control);
+        const int mask = _mm_movemask_epi8(dirty);
+        if (mask != 0) {
+            return i + (size_t)__builtin_ctz((unsigned int)mask);
+        }
+    }
+#endif
+
+    for (; i < length; i++) {
+        if (_NeedsEscape(bytes[i])) {
+            break;
+        }
+    }
+    return i;
+}
+
+size_t TLSJSONEscapeUTF8(char *output, const char *bytes, size_t length)
+{
+    static const char sHexDigits[] = "0123456789abcdef";
+
+    const uint8_t *cursor = (const uint8_t *)bytes;
+    const uint8_t *end = cursor + length;
+    char *outputCursor = output;
+    while (cursor < end) {
+        const size_t runLength = _CleanRunLength(cursor, (size_t)(end - cursor));
+        memcpy(outputCursor, cursor, runLength);
+        outputCursor += runLength;
+        cursor += runLength;
+        if (cursor == end) {
+            break;
+        }
+
+        const uint8_t c = *cursor++;
+        *outputCursor++ = '\\';
+        switch (c) {
+            case '"':
+            case '\\':
+                *outputCursor++ = (char)c;
+                break;
+            case '\n':
+                *outputCursor++ = 'n';
+                break;
+            case '\r':
+                *outputCursor++ = 'r';
+                break;
+            case '\t':
+                *outputCursor++ = 't';
+                break;
+            case '\b':
+                *outputCursor++ = 'b';
+                break;
+            case '\f':
+                *outputCursor++ = 'f';
+                break;
+            default:
+                *outputCursor++ = 'u';
+                *outputCursor++ = '0';
+                *outputCursor++ = '0';
+                *outputCursor++ = sHexDigits[c >> 4];
+                *outputCursor++ = sHexDigits[c & 0xF];
+                break;
+        }
+    }
+    return (size_t)(outputCursor - output);
+}
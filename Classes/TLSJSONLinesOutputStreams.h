@@ -0,0 +1,60 @@
+//
+//  TLSJSONLinesOutputStreams.h
+//  TwitterLoggingService
+//
+//  Created on 10/18/26.
+//  Copyright (c) 2026 Twitter, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//          http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+#import <TwitterLoggingService/TLSFileOutputStream.h>
+#import <TwitterLoggingService/TLSRollingFileOutputStream.h>
+
+/**
+ A `TLSFileOutputStream` that writes each log message as a single line JSON object
+ ([JSON Lines](https://jsonlines.org), aka NDJSON) instead of composed text.
+
+    {"time":"2026-10-18T17:04:05.123Z","lifespan":12.345678,"sequence":1042,"level":"error","channel":"Networking","thread":"main","threadId":259,"file":"TNetwork.m","function":"-[TNetwork fail]","line":42,"message":"request failed","fields":{"status":503}}
+
+ `time` is UTC, `lifespan` is the `logLifespan` in seconds, `sequence` is the `sequenceNumber`,
+ `pid` is only present for log messages from other processes (see `processIdentifier`),
+ `thread` is only present for named threads and `fields` is only present when the message has
+ structured fields (see `TLSLogField`).
+ `composeLogMessageOptions` has no effect.
+
+ Lines are encoded directly to UTF-8 into a reused buffer (no `NSJSONSerialization` or intermediate
+ strings) and written with the same buffered writes (and durability) as `TLSFileOutputStream`.
+ */
+@interface TLSJSONLinesFileOutputStream : TLSFileOutputStream
+
+/** writes the JSON line of the _logInfo_ to the open log file */
+- (void)tls_outputLogInfo:(nonnull TLSLogMessageInfo *)logInfo;
+
+@end
+
+/**
+ A `TLSRollingFileOutputStream` that writes each log message as a single line JSON object, see
+ `TLSJSONLinesFileOutputStream` for the format.
+
+ The rolling events (startup, rollover and pruning) are written as JSON lines too so that every line
+ of every log file parses, for example:
+
+    {"event":"rolloverLogsFinished","oldLogFilePath":"/path/to/log.5307012345.log"}
+ */
+@interface TLSRollingJSONLinesFileOutputStream : TLSRollingFileOutputStream
+
+/** writes the JSON line of the _logInfo_ to the open log file */
+- (void)tls_outputLogInfo:(nonnull TLSLogMessageInfo *)logInfo;
+
+@end
@@ -0,0 +1,138 @@
+//
+//  TLSJSONLinesOutputStreams.m
+//  TwitterLoggingService
+//
+//  Created on 10/18/26.
+//  Copyright (c) 2026 Twitter, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//          http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+#import "TLS_Project.h"
+#import "TLSJSONLineEncoder.h"
+#import "TLSJSONLinesOutputStreams.h"
+#import "TLSLoggingService.h"
+
+@implementation TLSJSONLinesFileOutputStream
+{
+    TLSJSONLineEncoder *_encoder;
+}
+
+- (void)tls_outputLogInfo:(TLSLogMessageInfo *)logInfo
+{
+    if (!_encoder) {
+        _encoder = [[TLSJSONLineEncoder alloc] init];
+    }
+    [self outputLogData:[_encoder dataForLogInfo:logInfo] forLogInfo:logInfo];
+}
+
+@end
+
+static NSString * __nullable _EventName(TLSFileOutputEvent event);
+static NSString * __nullable _EventName(TLSFileOutputEvent event)
+{
+    switch ((TLSRollingFileOutputEvent)event) {
+        case TLSRollingFileOutputEventInitialize:
+            return @"initialize";
+        case TLSRollingFileOutputEventRolloverLogs:
+            return @"rolloverLogs";
+        case TLSRollingFileOutputEventPruneLogs:
+            return @"pruneLogs";
+        case TLSRollingFileOutputEventPurgeLog:
+            return @"purgeLog";
+        case TLSRollingFileOutputEventOutputLogData:
+            // every message, not worth a line
+            break;
+    }
+    return nil;
+}
+
+@interface TLSRollingJSONLinesFileOutputStream ()
+- (void)_writeEvent:(TLSFileOutputEvent)event
+              phase:(NSString *)phase
+               info:(nullable NSDictionary *)info
+              error:(nullable NSError *)error TLS_OBJC_DIRECT;
+@end
+
+@implementation TLSRollingJSONLinesFileOutputStream
+{
+    TLSJSONLineEncoder *_encoder;
+}
+
+- (void)tls_outputLogInfo:(TLSLogMessageInfo *)logInfo
+{
+    if (!_encoder) {
+        _encoder = [[TLSJSONLineEncoder alloc] init];
+    }
+    [self outputLogData:[_encoder dataForLogInfo:logInfo] forLogInfo:logInfo];
+}
+
+#pragma mark TLSFileOutputStreamEvent
+
+- (void)tls_fileOutputEventBegan:(TLSFileOutputEvent)event
+                            info:(NSDictionary *)info
+{
+    // like the text output, initialization is only noted once it finished (or failed)
+    if (TLSRollingFileOutputEventInitialize != event) {
+        [self _writeEvent:event phase:@"Began" info:info error:nil];
+    }
+}
+
+- (void)tls_fileOutputEventFinished:(TLSFileOutputEvent)event
+                               info:(NSDictionary *)info
+{
+    [self _writeEvent:event phase:@"Finished" info:info error:nil];
+}
+
+- (void)tls_fileOutputEventFailed:(TLSFileOutputEvent)event
+                             info:(NSDictionary *)info
+                            error:(NSError *)error
+{
+    [self _writeEvent:event phase:@"Failed" info:info error:error];
+}
+
+- (void)_writeEvent:(TLSFileOutputEvent)event
+              phase:(NSString *)phase
+               info:(NSDictionary *)info
+              error:(NSError *)error
+{
+    NSString *name = _EventName(event);
+    if (!name) {
+        return;
+    }
+
+    NSMutableDictionary<NSString *, id> *object = [[NSMutableDictionary alloc] init];
+    object[@"event"] = [name stringByAppendingString:phase];
+    [info enumerateKeysAndObjectsUsingBlock:^(id key, id value, BOOL *stop) {
+        // just the file paths, not the log data
+        if ([key isKindOfClass:[NSString class]] && [value isKindOfClass:[NSString class]]) {
+            object[key] = value;
+        }
+    }];
+    if (error) {
+        object[@"error"] = error.userInfo[@"message"] ?: error.localizedDescription;
+    }
+    if (!error && (TLSRollingFileOutputEventInitialize == event || TLSRollingFileOutputEventRolloverLogs == event) && [phase isEqualToString:@"Finished"]) {
+        // a new log file, note when the service started like the text log does
+        NSISO8601DateFormatter *formatter = [[NSISO8601DateFormatter alloc] init];
+        object[@"startup"] = [formatter stringFromDate:[TLSLoggingService sharedInstance].startupTimestamp];
+    }
+
+    NSData *data = [NSJSONSerialization dataWithJSONObject:object options:0 error:NULL];
+    if (data) {
+        [self writeData:data];
+        [self writeNewline];
+    }
+}
+
+@end
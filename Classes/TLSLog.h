@@ -46,11 +46,36 @@ NS_ASSUME_NONNULL_BEGIN
 #endif
 #endif
 
+/**
+ The state of a single log callsite, used for throttling (see `TLSLogThrottle`).
+ Declared `static` per callsite by `TLSLogCurrentCallsite()`.
+ Only the `file` and `line` are to be accessed, the rest is private to `TLSLoggingService` (and only accessed atomically).
+ */
+typedef struct TLSLogCallsite {
+    const char *file;
+    int line;
+
+    unsigned int tls_generation;
+    const void *tls_service;
+    uint64_t tls_emissionInterval;
+    uint64_t tls_burstTolerance;
+    uint64_t tls_sampleInterval;
+    uint64_t tls_theoreticalArrivalTime;
+    uint64_t tls_sampleCount;
+    uint64_t tls_suppressedCount;
+    uint64_t tls_suppressionStartTime;
+    int tls_suppressedLevel;
+} TLSLogCallsite;
+
+//! Pointer to the `TLSLogCallsite` of the current file and line
+#define TLSLogCurrentCallsite() \
+    ({ static TLSLogCallsite __tls_callsite = { __FILE__, __LINE__ }; &__tls_callsite; })
+
 #pragma mark Essential Macros
 
 //! Root Macro.  Provide the _level_, _channel_ and format string.
 #define TLSLog(level, channel, ...) \
-    if (TLSCanLog(nil, level, channel, nil)) { \
+    if (TLSCanLogCallsite(nil, level, channel, nil, TLSLogCurrentCallsite())) { \
         TLSLogEx(nil, level, channel, @(__FILE__), @(__PRETTY_FUNCTION__), __LINE__, nil, TLSLogMessageOptionsNone, __VA_ARGS__); \
     }
 
@@ -63,6 +88,47 @@ NS_ASSUME_NONNULL_BEGIN
 //! Log to Debug level
 #define TLSLogDebug(channel, ...)        TLSLog(TLSLogLevelDebug, channel, __VA_ARGS__)
 
+/**
+ Root Macro with structured fields.  Provide the _level_, _channel_, fields and format string.
+ The fields are provided with `TLSLogFieldList`.
+
+    TLSLogWithFields(TLSLogLevelError, @"Network",
+                     TLSLogFieldList(TLSLogFieldInteger("status", 503), TLSLogFieldString("host", host)),
+                     @"request failed");
+
+ See `TLSLogField` and `[TLSLogMessageInfo fields]`
+ */
+#define TLSLogWithFields(level, channel, fields, ...) \
+    if (TLSCanLogCallsite(nil, level, channel, nil, TLSLogCurrentCallsite())) { \
+        TLSLogFieldsEx(nil, level, channel, @(__FILE__), @(__PRETTY_FUNCTION__), __LINE__, nil, TLSLogMessageOptionsNone, fields, __VA_ARGS__); \
+    }
+
+//! List the `TLSLogField`s for `TLSLogWithFields`, expands to the fields array and its count
+#define TLSLogFieldList(...) \
+    ((const TLSLogField[]){ __VA_ARGS__ }), (sizeof((const TLSLogField[]){ __VA_ARGS__ }) / sizeof(TLSLogField))
+
+//! Log to Error level with fields
+#define TLSLogErrorWithFields(channel, fields, ...)        TLSLogWithFields(TLSLogLevelError, channel, fields, __VA_ARGS__)
+//! Log to Warning level with fields
+#define TLSLogWarningWithFields(channel, fields, ...)      TLSLogWithFields(TLSLogLevelWarning, channel, fields, __VA_ARGS__)
+//! Log to Information level with fields
+#define TLSLogInformationWithFields(channel, fields, ...)  TLSLogWithFields(TLSLogLevelInformation, channel, fields, __VA_ARGS__)
+//! Log to Debug level with fields
+#define TLSLogDebugWithFields(channel, fields, ...)        TLSLogWithFields(TLSLogLevelDebug, channel, fields, __VA_ARGS__)
+
+/**
+ Root Macro with a binary payload.  Provide the _level_, _channel_, payload and format string.
+ The payload (an `NSData` or `dispatch_data_t`) is attached by reference, it is only rendered by the output streams.
+
+    TLSLogWithData(TLSLogLevelDebug, @"Network", responseData, @"response for %@", requestID);
+
+ See `[TLSLogMessageInfo payload]`
+ */
+#define TLSLogWithData(level, channel, data, ...) \
+    if (TLSCanLogCallsite(nil, level, channel, nil, TLSLogCurrentCallsite())) { \
+        TLSLogDataEx(nil, level, channel, @(__FILE__), @(__PRETTY_FUNCTION__), __LINE__, nil, TLSLogMessageOptionsNone, (NSData *)(data), __VA_ARGS__); \
+    }
+
 #pragma mark Convenience Functions
 
 //! Convert the log level to a short parsable string
@@ -87,6 +153,31 @@ FOUNDATION_EXTERN void TLSLogEx(TLSLoggingService * __nullable service,
                                 TLSLogMessageOptions options,
                                 NSString *format, ...) NS_FORMAT_FUNCTION(9,10);
 
+//! Log a message with structured fields using formatted message.  The _fields_ are copied.
+FOUNDATION_EXTERN void TLSLogFieldsEx(TLSLoggingService * __nullable service,
+                                      TLSLogLevel level,
+                                      NSString *channel,
+                                      NSString *file,
+                                      NSString *function,
+                                      NSInteger line,
+                                      id __nullable contextObject,
+                                      TLSLogMessageOptions options,
+                                      const TLSLogField * __nullable fields,
+                                      NSUInteger fieldCount,
+                                      NSString *format, ...) NS_FORMAT_FUNCTION(11,12);
+
+//! Log a message with a binary payload using formatted message.  The _payload_ is retained, not copied, when immutable.
+FOUNDATION_EXTERN void TLSLogDataEx(TLSLoggingService * __nullable service,
+                                    TLSLogLevel level,
+                                    NSString *channel,
+                                    NSString *file,
+                                    NSString *function,
+                                    NSInteger line,
+                                    id __nullable contextObject,
+                                    TLSLogMessageOptions options,
+                                    NSData * __nullable payload,
+                                    NSString *format, ...) NS_FORMAT_FUNCTION(10,11);
+
 //! Log a message using a fully constructed string
 FOUNDATION_EXTERN void TLSLogString(TLSLoggingService * __nullable service,
                                     TLSLogLevel level,
@@ -116,6 +207,16 @@ FOUNDATION_EXTERN BOOL TLSCanLog(TLSLoggingService * __nullable service,
                                  NSString *channel,
                                  id __nullable contextObject);
 
+/**
+ Determine if the given _level_, _channel_ and _contextObject_ can be logged from the _callsite_.
+ Same as `TLSCanLog` followed by the `TLSLogThrottle` configured for the _callsite_ (if any).
+ */
+FOUNDATION_EXTERN BOOL TLSCanLogCallsite(TLSLoggingService * __nullable service,
+                                         TLSLogLevel level,
+                                         NSString *channel,
+                                         id __nullable contextObject,
+                                         TLSLogCallsite * __nullable callsite);
+
 NS_ASSUME_NONNULL_END
 
 #endif // __TLSLOG_H__
@@ -0,0 +1,143 @@
+//
+//  TLSLogIngestionRecord.c
+//  TwitterLoggingService
+//
+//  Created on 10/18/26.
+//  Copyright (c) 2026 Twitter, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//          http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
+#include "TLSLogIngestionRecord.h"
+
+#define kLengthFieldSize    (4)
+#define kRecordHeaderSize   (28)
+
+// the length of the longest prefix of _bytes_ that fits _capacity_ without splitting a code point
+static size_t _UTF8PrefixLength(const char *bytes, size_t length, size_t capacity)
+{
+    if (length <= capacity) {
+        return length;
+    }
+    size_t prefixLength = capacity;
+    // back up over continuation bytes to the lead byte of the code point that doesn't fit
+    while (prefixLength > 0 && 0x80 == ((unsigned char)bytes[prefixLength] & 0xC0)) {
+        prefixLength--;
+    }
+    return prefixLength;
+}
+
+// little endian, whatever the host
+static void _WriteUInt16(uint8_t *bytes, uint16_t value)
+{
+    bytes[0] = (uint8_t)value;
+    bytes[1] = (uint8_t)(value >> 8);
+}
+
+static void _WriteUInt32(uint8_t *bytes, uint32_t value)
+{
+    for (int i = 0; i < 4; i++) {
+        bytes[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+static void _WriteFloat64(uint8_t *bytes, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    for (int i = 0; i < 8; i++) {
+        bytes[i] = (uint8_t)(bits >> (8 * i));
+    }
+}
+
+// the lengths of the channel, file and function once truncated to their length fields
+static void _NameLengths(const TLSLogIngestionRecord *record, size_t lengths[3])
+{
+    const char *names[3] = { record->channel, record->file, record->function };
+    const size_t nameLengths[3] = { record->channelLength, record->fileLength, record->functionLength };
+    for (int i = 0; i < 3; i++) {
+        lengths[i] = (names[i]) ? _UTF8PrefixLength(names[i], nameLengths[i], UINT16_MAX) : 0;
+    }
+}
+
+size_t TLSLogIngestionRecordEncodedLength(const TLSLogIngestionRecord *record)
+{
+    size_t lengths[3];
+    _NameLengths(record, lengths);
+    const size_t namesLength = lengths[0] + lengths[1] + lengths[2];
+    const size_t messageCapacity = TLSLogIngestionRecordFormatMaxLength - kRecordHeaderSize - namesLength;
+    const size_t messageLength = (record->message) ? _UTF8PrefixLength(record->message, record->messageLength, messageCapacity) : 0;
+    return kLengthFieldSize + kRecordHeaderSize + namesLength + messageLength;
+}
+
+size_t TLSLogIngestionRecordEncode(const TLSLogIngestionRecord *record, uint8_t *buffer, size_t capacity)
+{
+    size_t lengths[3];
+    _NameLengths(record, lengths);
+    const size_t namesLength = lengths[0] + lengths[1] + lengths[2];
+    if (capacity < kLengthFieldSize + kRecordHeaderSize + namesLength) {
+        return 0;
+    }
+
+    size_t messageCapacity = capacity - kLengthFieldSize - kRecordHeaderSize - namesLength;
+    if (messageCapacity > TLSLogIngestionRecordFormatMaxLength - kRecordHeaderSize - namesLength) {
+        messageCapacity = TLSLogIngestionRecordFormatMaxLength - kRecordHeaderSize - namesLength;
+    }
+    const size_t messageLength = (record->message) ? _UTF8PrefixLength(record->message, record->messageLength, messageCapacity) : 0;
+    const size_t recordLength = kRecordHeaderSize + namesLength + messageLength;
+
+    uint8_t *body = buffer + kLengthFieldSize;
+    _WriteUInt32(buffer, (uint32_t)recordLength);
+    body[0] = TLSLogIngestionRecordFormatVersion;
+    body[1] = record->level;
+    _WriteUInt16(body + 2, (uint16_t)lengths[0]);
+    _WriteUInt32(body + 4, (uint32_t)record->processIdentifier);
+    _WriteUInt32(body + 8, record->threadId);
+    _WriteUInt32(body + 12, (uint32_t)record->line);
+    _WriteFloat64(body + 16, record->timestamp);
+    _WriteUInt16(body + 24, (uint16_t)lengths[1]);
+    _WriteUInt16(body + 26, (uint16_t)lengths[2]);
+
+    uint8_t *cursor = body + kRecordHeaderSize;
+    const char *strings[4] = { record->channel, record->file, record->function, record->message };
+    const size_t stringLengths[4] = { lengths[0], lengths[1], lengths[2], messageLength };
+    for (int i = 0; i < 4; i++) {
+        if (stringLengths[i] > 0) {
+            memcpy(cursor, strings[i], stringLengths[i]);
+            cursor += stringLengths[i];
+        }
+    }
+    return kLengthFieldSize + recordLength;
+}
+
+uint32_t TLSLogIngestionCurrentThreadId(void)
+{
+#if defined(__APPLE__)
+    return (uint32_t)pthread_mach_thread_np(pthread_self());
+#elif defined(__linux__)
+    return (uint32_t)syscall(SYS_gettid);
+#else
+    const pthread_t thread = pthread_self();
+    uint32_t threadId = 0;
+    memcpy(&threadId, &thread, (sizeof(thread) < sizeof(threadId)) ? sizeof(thread) : sizeof(threadId));
+    return threadId;
+#endif
+}
@@ -0,0 +1,73 @@
+//
+//  TLSLogIngestionRecord.h
+//  TwitterLoggingService
+//
+//  Created on 10/18/26.
+//  Copyright (c) 2026 Twitter, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//          http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+
+/*
+ Encodes the records read by a `TLSLogIngestionSource` (see `TLSLogIngestionSource.h` for the record format).
+
+ Plain C (no Foundation) so that producers outside of Objective-C, such as native libraries or child
+ processes, can encode records on any POSIX system.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//! The version of the record format (`TLSLogIngestionRecordVersion`)
+#define TLSLogIngestionRecordFormatVersion      (1)
+//! The max length of a record, excluding its length field (`TLSLogIngestionRecordMaxLength`)
+#define TLSLogIngestionRecordFormatMaxLength    (1024 * 1024)
+
+/** A record to encode, strings are UTF-8 and not NUL terminated */
+typedef struct TLSLogIngestionRecord {
+    uint8_t level; // TLSLogLevel
+    int32_t processIdentifier; // 0 when unknown
+    uint32_t threadId;
+    int32_t line;
+    double timestamp; // seconds since 1970, 0 for the time of ingestion
+    const char *channel;
+    size_t channelLength;
+    const char *file; // NULL for none
+    size_t fileLength;
+    const char *function; // NULL for none
+    size_t functionLength;
+    const char *message;
+    size_t messageLength;
+} TLSLogIngestionRecord;
+
+/** The length of the encoded _record_ (including its length field) once its strings are truncated to fit */
+size_t TLSLogIngestionRecordEncodedLength(const TLSLogIngestionRecord *record);
+
+/**
+ Encode a _record_ into _buffer_, truncating its strings (at UTF-8 code point boundaries) to fit their
+ length fields, the max length of a record and the _capacity_ (message first).
+ Returns the number of bytes encoded, `0` when the _capacity_ is too small for even an empty message.
+ */
+size_t TLSLogIngestionRecordEncode(const TLSLogIngestionRecord *record, uint8_t *buffer, size_t capacity);
+
+/** An identifier of the calling thread for `TLSLogIngestionRecord.threadId` (the Mach thread port on Apple platforms, the kernel thread id on Linux) */
+uint32_t TLSLogIngestionCurrentThreadId(void);
+
+#ifdef __cplusplus
+}
+#endif
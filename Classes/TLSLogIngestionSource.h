@@ -0,0 +1,127 @@
+//
+//  TLSLogIngestionSource.h
+//  TwitterLoggingService
+//
+//  Created on 10/18/26.
+//  Copyright (c) 2026 Twitter, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//          http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+#import <TwitterLoggingService/TLSDeclarations.h>
+
+@class TLSLoggingService;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ Ingests log messages produced outside of the process's `TLSLog` calls (such as by child processes
+ or native libraries) from a pipe or a Unix domain socket into a `TLSLoggingService`.
+
+ Producers write length prefixed binary records, which are read in batches as they arrive and logged
+ as is with `[TLSLoggingService logMessageInfos:]` (capped like any other log message): messages are not formatted again and channels (as
+ well as files and functions) are interned so that each distinct name is only allocated once.
+
+ ## Record format
+
+ All integers are little endian, strings are UTF-8 without a NUL terminator.
+
+    uint32  length           // of the record, excluding this field
+    uint8   version          // TLSLogIngestionRecordVersion
+    uint8   level            // TLSLogLevel
+    uint16  channelLength
+    int32   processIdentifier // 0 when unknown
+    uint32  threadId
+    int32   line
+    float64 timestamp        // seconds since 1970, 0 for the time of ingestion
+    uint16  fileLength
+    uint16  functionLength
+    char    channel[channelLength]
+    char    file[fileLength]
+    char    function[functionLength]
+    char    message[]        // the rest of the record
+
+ See `TLSLogIngestionRecordData` to encode records, or `TLSLogIngestionRecordEncode` (TLSLogIngestionRecord.h, plain C)
+ for producers outside of Objective-C.
+ A connection that sends a malformed record (or one larger than `TLSLogIngestionRecordMaxLength`) is closed.
+
+ ## Constants
+
+    FOUNDATION_EXTERN const uint8_t TLSLogIngestionRecordVersion;       // 1
+    FOUNDATION_EXTERN const NSUInteger TLSLogIngestionRecordMaxLength;  // 1 MB
+ */
+@interface TLSLogIngestionSource : NSObject
+
+/** The service the log messages are ingested into */
+@property (nonatomic, readonly) TLSLoggingService *loggingService;
+/** The path of the listening socket, `nil` for a source reading a file descriptor */
+@property (nonatomic, nullable, copy, readonly) NSString *socketPath;
+/** The number of log messages ingested */
+@property (nonatomic, readonly) uint64_t ingestedCount;
+/** The number of connections closed for sending malformed records */
+@property (nonatomic, readonly) uint64_t malformedCount;
+
+/**
+ Ingest the records read from a pipe or a connected socket, until it is closed by the producer.
+ @param fileDescriptor the file descriptor to read, made non blocking and closed by the source
+ @param loggingService the service to log into, `nil` for `[TLSLoggingService sharedInstance]`
+ */
+- (instancetype)initWithFileDescriptor:(int)fileDescriptor
+                        loggingService:(nullable TLSLoggingService *)loggingService NS_DESIGNATED_INITIALIZER;
+
+/**
+ Listen on a Unix domain socket and ingest the records of every producer that connects to it.
+ An existing socket file at the _socketPath_ is replaced, the socket file is removed when the source is deallocated.
+ @param socketPath the path to bind the socket to (at most 103 bytes)
+ @param loggingService the service to log into, `nil` for `[TLSLoggingService sharedInstance]`
+ @param errorOut an output reference to get any errors that occur while creating the socket.  If there is an error, the return value will be `nil`.
+ */
+- (nullable instancetype)initWithSocketPath:(NSString *)socketPath
+                             loggingService:(nullable TLSLoggingService *)loggingService
+                                      error:(out NSError * __nullable __autoreleasing * __nullable)errorOut NS_DESIGNATED_INITIALIZER;
+
+/** NS_UNAVAILABLE */
+- (instancetype)init NS_UNAVAILABLE;
+/** NS_UNAVAILABLE */
++ (instancetype)new NS_UNAVAILABLE;
+
+/** Start ingesting */
+- (void)start;
+
+/** Stop ingesting and close the connections (and the listening socket) */
+- (void)stop;
+
+/**
+ Synchronously wait for the records read so far to be handed to the `loggingService`.
+ Call `[TLSLoggingService flush]` after to wait for them to be output.
+ */
+- (void)waitUntilIngested;
+
+@end
+
+/**
+ Encode a record for a `TLSLogIngestionSource`.
+ The strings are truncated (at code point boundaries) to fit their length fields.
+ */
+FOUNDATION_EXTERN NSData *TLSLogIngestionRecordData(TLSLogLevel level,
+                                                    NSString *channel,
+                                                    NSString * __nullable file,
+                                                    NSString * __nullable function,
+                                                    NSInteger line,
+                                                    NSDate * __nullable timestamp,
+                                                    NSString *message);
+
+FOUNDATION_EXTERN const uint8_t TLSLogIngestionRecordVersion;       // 1
+FOUNDATION_EXTERN const NSUInteger TLSLogIngestionRecordMaxLength;  // 1 MB
+
+NS_ASSUME_NONNULL_END
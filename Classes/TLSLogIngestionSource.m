@@ -0,0 +1,549 @@
+//
+//  TLSLogIngestionSource.m
+//  TwitterLoggingService
+//
+//  Created on 10/18/26.
+//  Copyright (c) 2026 Twitter, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//          http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#import "TLS_Project.h"
+#import "TLSLogIngestionRecord.h"
+#import "TLSLogIngestionSource.h"
+#import "TLSLoggingService+Advanced.h"
+
+const uint8_t TLSLogIngestionRecordVersion = TLSLogIngestionRecordFormatVersion;
+const NSUInteger TLSLogIngestionRecordMaxLength = TLSLogIngestionRecordFormatMaxLength;
+
+static const size_t kLengthFieldSize = sizeof(uint32_t);
+static const size_t kRecordHeaderSize = 28;
+static const size_t kReadSize = 64 * 1024;
+// bounds the interned strings when a producer sends many distinct names
+static const NSUInteger kInternedStringsCapacity = 1024;
+
+#pragma mark Little endian
+
+NS_INLINE uint16_t _ReadUInt16(const uint8_t *bytes)
+{
+    return (uint16_t)(bytes[0] | (bytes[1] << 8));
+}
+
+NS_INLINE uint32_t _ReadUInt32(const uint8_t *bytes)
+{
+    return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+NS_INLINE double _ReadFloat64(const uint8_t *bytes)
+{
+    const uint64_t bits = (uint64_t)_ReadUInt32(bytes) | ((uint64_t)_ReadUInt32(bytes + 4) << 32);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+NSData *TLSLogIngestionRecordData(TLSLogLevel level,
+                                  NSString *channel,
+                                  NSString * __nullable file,
+                                  NSString * __nullable function,
+                                  NSInteger line,
+                                  NSDate * __nullable timestamp,
+                                  NSString *message)
+{
+    @autoreleasepool {
+        NSData *channelData = [channel dataUsingEncoding:NSUTF8StringEncoding];
+        NSData *fileData = [file dataUsingEncoding:NSUTF8StringEncoding];
+        NSData *functionData = [function dataUsingEncoding:NSUTF8StringEncoding];
+        NSData *messageData = [message dataUsingEncoding:NSUTF8StringEncoding];
+
+        TLSLogIngestionRecord record;
+        memset(&record, 0, sizeof(record));
+        record.level = (uint8_t)level;
+        record.processIdentifier = (int32_t)getpid();
+        record.threadId = TLSLogIngestionCurrentThreadId();
+        record.line = (int32_t)line;
+        record.timestamp = (timestamp) ? timestamp.timeIntervalSince1970 : 0;
+        record.channel = channelData.bytes;
+        record.channelLength = channelData.length;
+        record.file = fileData.bytes;
+        record.fileLength = fileData.length;
+        record.function = functionData.bytes;
+        record.functionLength = functionData.length;
+        record.message = messageData.bytes;
+        record.messageLength = messageData.length;
+
+        NSMutableData *data = [NSMutableData dataWithLength:TLSLogIngestionRecordEncodedLength(&record)];
+        data.length = TLSLogIngestionRecordEncode(&record, data.mutableBytes, data.length);
+        return data;
+    }
+}
+
+static int _SetNonBlocking(int fileDescriptor);
+static int _SetNonBlocking(int fileDescriptor)
+{
+    const int flags = fcntl(fileDescriptor, F_GETFL);
+    if (flags < 0 || fcntl(fileDescriptor, F_SETFL, flags | O_NONBLOCK) < 0) {
+        return errno;
+    }
+    (void)fcntl(fileDescriptor, F_SETFD, FD_CLOEXEC);
+    return 0;
+}
+
+#pragma mark - Connection
+
+TLS_OBJC_FINAL
+@interface TLSLogIngestionConnection : NSObject
+@property (tls_nonatomic_direct, readonly) int fileDescriptor;
+@property (tls_nonatomic_direct, readonly) NSMutableData *buffer;
+@property (tls_nonatomic_direct) dispatch_source_t readSource;
+- (instancetype)initWithFileDescriptor:(int)fileDescriptor NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+@end
+
+@implementation TLSLogIngestionConnection
+
+- (instancetype)initWithFileDescriptor:(int)fileDescriptor
+{
+    if (self = [super init]) {
+        _fileDescriptor = fileDescriptor;
+        _buffer = [[NSMutableData alloc] initWithCapacity:kReadSize];
+    }
+    return self;
+}
+
+- (instancetype)init
+{
+    [self doesNotRecognizeSelector:_cmd];
+    abort();
+}
+
+@end
+
+#pragma mark - Source
+
+@interface TLSLogIngestionSource ()
+- (void)_setupWithLoggingService:(nullable TLSLoggingService *)loggingService TLS_OBJC_DIRECT;
+- (void)_queue_start TLS_OBJC_DIRECT;
+- (void)_queue_stop TLS_OBJC_DIRECT;
+- (void)_queue_acceptConnections TLS_OBJC_DIRECT;
+- (void)_queue_openConnectionWithFileDescriptor:(int)fileDescriptor TLS_OBJC_DIRECT;
+- (void)_queue_closeConnection:(TLSLogIngestionConnection *)connection TLS_OBJC_DIRECT;
+- (void)_queue_readConnection:(TLSLogIngestionConnection *)connection
+                 untilDrained:(BOOL)untilDrained TLS_OBJC_DIRECT;
+- (BOOL)_queue_parseConnection:(TLSLogIngestionConnection *)connection
+                     intoInfos:(NSMutableArray<TLSLogMessageInfo *> *)infos TLS_OBJC_DIRECT;
+- (nullable TLSLogMessageInfo *)_queue_infoFromRecordBytes:(const uint8_t *)bytes
+                                                    length:(size_t)length TLS_OBJC_DIRECT;
+- (NSString *)_queue_internedStringWithBytes:(const uint8_t *)bytes
+                                      length:(size_t)length TLS_OBJC_DIRECT;
+@end
+
+@implementation TLSLogIngestionSource
+{
+    dispatch_queue_t _queue;
+    int _queue_pendingFileDescriptor;
+    int _queue_listeningFileDescriptor;
+    dispatch_source_t _queue_listeningSource;
+    NSMutableSet<TLSLogIngestionConnection *> *_queue_connections;
+    NSMutableDictionary<NSData *, NSString *> *_queue_internedStrings;
+    BOOL _queue_started;
+    BOOL _queue_stopped;
+    atomic_ullong _ingestedCount;
+    atomic_ullong _malformedCount;
+}
+
+- (void)_setupWithLoggingService:(nullable TLSLoggingService *)loggingService
+{
+    _loggingService = loggingService ?: [TLSLoggingService sharedInstance];
+    _queue = dispatch_queue_create("TLSLogIngestionSource.queue", DISPATCH_QUEUE_SERIAL);
+    _queue_pendingFileDescriptor = -1;
+    _queue_listeningFileDescriptor = -1;
+    _queue_connections = [[NSMutableSet alloc] init];
+    _queue_internedStrings = [[NSMutableDictionary alloc] init];
+    atomic_init(&_ingestedCount, 0);
+    atomic_init(&_malformedCount, 0);
+}
+
+- (instancetype)initWithFileDescriptor:(int)fileDescriptor
+                        loggingService:(nullable TLSLoggingService *)loggingService // NS_DESIGNATED_INITIALIZER
+{
+    if (self = [super init]) {
+        [self _setupWithLoggingService:loggingService];
+        (void)_SetNonBlocking(fileDescriptor);
+        _queue_pendingFileDescriptor = fileDescriptor;
+    }
+    return self;
+}
+
+- (nullable instancetype)initWithSocketPath:(NSString *)socketPath
+                             loggingService:(nullable TLSLoggingService *)loggingService
+                                      error:(out NSError **)errorOut // NS_DESIGNATED_INITIALIZER
+{
+    if (errorOut) {
+        *errorOut = nil;
+    }
+
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    const char *path = socketPath.fileSystemRepresentation;
+    int code = (path && strlen(path) < sizeof(address.sun_path)) ? 0 : ENAMETOOLONG;
+
+    int fileDescriptor = -1;
+    if (0 == code) {
+        strlcpy(address.sun_path, path, sizeof(address.sun_path));
+        (void)unlink(path);
+        fileDescriptor = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fileDescriptor < 0 ||
+            bind(fileDescriptor, (const struct sockaddr *)&address, sizeof(address)) != 0 ||
+            listen(fileDescriptor, SOMAXCONN) != 0) {
+            code = errno;
+        } else {
+            code = _SetNonBlocking(fileDescriptor);
+        }
+    }
+
+    if (code != 0) {
+        if (fileDescriptor >= 0) {
+            close(fileDescriptor);
+        }
+        if (errorOut) {
+            *errorOut = [NSError errorWithDomain:NSPOSIXErrorDomain
+                                            code:code
+                                        userInfo:@{ @"message" : @"unable to listen on the log ingestion socket",
+                                                    @"socketPath" : socketPath ?: [NSNull null] }];
+        }
+        return nil;
+    }
+
+    if (self = [super init]) {
+        [self _setupWithLoggingService:loggingService];
+        _socketPath = [socketPath copy];
+        _queue_listeningFileDescriptor = fileDescriptor;
+    } else {
+        close(fileDescriptor);
+    }
+    return self;
+}
+
+- (instancetype)init
+{
+    [self doesNotRecognizeSelector:_cmd];
+    abort();
+}
+
+- (void)dealloc
+{
+    // the event handlers only hold the source weakly, nothing else is running on the queue
+    [self _queue_stop];
+    if (_socketPath) {
+        (void)unlink(_socketPath.fileSystemRepresentation);
+    }
+}
+
+- (uint64_t)ingestedCount
+{
+    return atomic_load_explicit(&_ingestedCount, memory_order_relaxed);
+}
+
+- (uint64_t)malformedCount
+{
+    return atomic_load_explicit(&_malformedCount, memory_order_relaxed);
+}
+
+- (void)start
+{
+    dispatch_async(_queue, ^{
+        [self _queue_start];
+    });
+}
+
+- (void)stop
+{
+    dispatch_async(_queue, ^{
+        [self _queue_stop];
+    });
+}
+
+- (void)waitUntilIngested
+{
+    dispatch_sync(_queue, ^{
+        if (!self->_queue_started || self->_queue_stopped) {
+            return;
+        }
+        [self _queue_acceptConnections];
+        for (TLSLogIngestionConnection *connection in [self->_queue_connections allObjects]) {
+            [self _queue_readConnection:connection untilDrained:YES];
+        }
+    });
+}
+
+#pragma mark Private
+
+- (void)_queue_start
+{
+    if (_queue_started || _queue_stopped) {
+        return;
+    }
+    _queue_started = YES;
+
+    if (_queue_pendingFileDescriptor >= 0) {
+        [self _queue_openConnectionWithFileDescriptor:_queue_pendingFileDescriptor];
+        _queue_pendingFileDescriptor = -1;
+    }
+
+    if (_queue_listeningFileDescriptor >= 0) {
+        const int listeningFileDescriptor = _queue_listeningFileDescriptor;
+        __weak typeof(self) weakSelf = self;
+        _queue_listeningSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, (uintptr_t)listeningFileDescriptor, 0, _queue);
+        dispatch_source_set_event_handler(_queue_listeningSource, ^{
+            [weakSelf _queue_acceptConnections];
+        });
+        dispatch_source_set_cancel_handler(_queue_listeningSource, ^{
+            close(listeningFileDescriptor);
+        });
+        _queue_listeningFileDescriptor = -1;
+        dispatch_resume(_queue_listeningSource);
+    }
+}
+
+- (void)_queue_stop
+{
+    if (_queue_stopped) {
+        return;
+    }
+    _queue_stopped = YES;
+
+    if (_queue_listeningSource) {
+        dispatch_source_cancel(_queue_listeningSource);
+        _queue_listeningSource = nil;
+    } else if (_queue_listeningFileDescriptor >= 0) {
+        close(_queue_listeningFileDescriptor);
+        _queue_listeningFileDescriptor = -1;
+    }
+
+    if (_queue_pendingFileDescriptor >= 0) {
+        close(_queue_pendingFileDescriptor);
+        _queue_pendingFileDescriptor = -1;
+    }
+
+    for (TLSLogIngestionConnection *connection in [_queue_connections allObjects]) {
+        [self _queue_closeConnection:connection];
+    }
+}
+
+- (void)_queue_acceptConnections
+{
+    if (!_queue_listeningSource) {
+        return;
+    }
+
+    const int listeningFileDescriptor = (int)dispatch_source_get_handle(_queue_listeningSource);
+    while (1) {
+        const int fileDescriptor = accept(listeningFileDescriptor, NULL, NULL);
+        if (fileDescriptor < 0) {
+            if (EINTR == errno) {
+                continue;
+            }
+            break; // EAGAIN, or nothing we can do about it now
+        }
+        (void)_SetNonBlocking(fileDescriptor);
+        [self _queue_openConnectionWithFileDescriptor:fileDescriptor];
+    }
+}
+
+- (void)_queue_openConnectionWithFileDescriptor:(int)fileDescriptor
+{
+    TLSLogIngestionConnection *connection = [[TLSLogIngestionConnection alloc] initWithFileDescriptor:fileDescriptor];
+    __weak typeof(self) weakSelf = self;
+    __weak typeof(connection) weakConnection = connection;
+    connection.readSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, (uintptr_t)fileDescriptor, 0, _queue);
+    dispatch_source_set_event_handler(connection.readSource, ^{
+        TLSLogIngestionConnection *strongConnection = weakConnection;
+        if (strongConnection) {
+            [weakSelf _queue_readConnection:strongConnection untilDrained:NO];
+        }
+    });
+    dispatch_source_set_cancel_handler(connection.readSource, ^{
+        close(fileDescriptor);
+    });
+    [_queue_connections addObject:connection];
+    dispatch_resume(connection.readSource);
+}
+
+- (void)_queue_closeConnection:(TLSLogIngestionConnection *)connection
+{
+    if (connection.readSource) {
+        dispatch_source_cancel(connection.readSource);
+        connection.readSource = nil;
+    }
+    [_queue_connections removeObject:connection];
+}
+
+- (void)_queue_readConnection:(TLSLogIngestionConnection *)connection
+                 untilDrained:(BOOL)untilDrained
+{
+    if (!connection.readSource) {
+        return;
+    }
+
+    NSMutableData *buffer = connection.buffer;
+    NSMutableArray<TLSLogMessageInfo *> *infos = [[NSMutableArray alloc] init];
+    BOOL shouldClose = NO;
+    BOOL malformed = NO;
+    do {
+        // a read source fires again while there is more to read, only drain it all when asked to
+        const NSUInteger bufferedLength = buffer.length;
+        buffer.length = bufferedLength + kReadSize;
+        ssize_t readLength;
+        do {
+            readLength = read(connection.fileDescriptor, (uint8_t *)buffer.mutableBytes + bufferedLength, kReadSize);
+        } while (readLength < 0 && EINTR == errno);
+        const int readError = (readLength < 0) ? errno : 0;
+        buffer.length = bufferedLength + (NSUInteger)MAX(readLength, (ssize_t)0);
+
+        if (readLength > 0) {
+            malformed = ![self _queue_parseConnection:connection intoInfos:infos];
+            shouldClose = malformed;
+        } else if (0 == readLength) {
+            // closed by the producer, a trailing partial record is malformed
+            malformed = buffer.length > 0;
+            shouldClose = YES;
+        } else {
+            shouldClose = (readError != EAGAIN && readError != EWOULDBLOCK);
+            break;
+        }
+    } while (untilDrained && !shouldClose);
+
+    if (infos.count > 0) {
+        [_loggingService logMessageInfos:infos];
+        atomic_fetch_add_explicit(&_ingestedCount, infos.count, memory_order_relaxed);
+    }
+    if (malformed) {
+        atomic_fetch_add_explicit(&_malformedCount, 1, memory_order_relaxed);
+    }
+    if (shouldClose) {
+        [self _queue_closeConnection:connection];
+    }
+}
+
+- (BOOL)_queue_parseConnection:(TLSLogIngestionConnection *)connection
+                     intoInfos:(NSMutableArray<TLSLogMessageInfo *> *)infos
+{
+    NSMutableData *buffer = connection.buffer;
+    const uint8_t *bytes = buffer.bytes;
+    const size_t length = buffer.length;
+    size_t offset = 0;
+    BOOL wellFormed = YES;
+
+    while (length - offset >= kLengthFieldSize) {
+        const size_t recordLength = _ReadUInt32(bytes + offset);
+        if (recordLength < kRecordHeaderSize || recordLength > TLSLogIngestionRecordMaxLength) {
+            wellFormed = NO;
+            break;
+        }
+        if (length - offset - kLengthFieldSize < recordLength) {
+            break; // the rest is still to come
+        }
+
+        TLSLogMessageInfo *info = [self _queue_infoFromRecordBytes:bytes + offset + kLengthFieldSize
+                                                            length:recordLength];
+        if (!info) {
+            wellFormed = NO;
+            break;
+        }
+        [infos addObject:info];
+        offset += kLengthFieldSize + recordLength;
+    }
+
+    // carry over the partial record
+    [buffer replaceBytesInRange:NSMakeRange(0, offset) withBytes:NULL length:0];
+    return wellFormed;
+}
+
+- (nullable TLSLogMessageInfo *)_queue_infoFromRecordBytes:(const uint8_t *)bytes
+                                                    length:(size_t)length
+{
+    const uint8_t version = bytes[0];
+    const uint8_t level = bytes[1];
+    const size_t channelLength = _ReadUInt16(bytes + 2);
+    const pid_t processIdentifier = (pid_t)(int32_t)_ReadUInt32(bytes + 4);
+    const unsigned int threadId = _ReadUInt32(bytes + 8);
+    const NSInteger line = (int32_t)_ReadUInt32(bytes + 12);
+    const double timestamp = _ReadFloat64(bytes + 16);
+    const size_t fileLength = _ReadUInt16(bytes + 24);
+    const size_t functionLength = _ReadUInt16(bytes + 26);
+
+    if (version != TLSLogIngestionRecordVersion || level >= TLSLogLevelCount) {
+        return nil;
+    }
+    if (kRecordHeaderSize + channelLength + fileLength + functionLength > length) {
+        return nil;
+    }
+
+    const uint8_t *channelBytes = bytes + kRecordHeaderSize;
+    const uint8_t *fileBytes = channelBytes + channelLength;
+    const uint8_t *functionBytes = fileBytes + fileLength;
+    const uint8_t *messageBytes = functionBytes + functionLength;
+    const size_t messageLength = length - (size_t)(messageBytes - bytes);
+
+    NSString *message = [[NSString alloc] initWithBytes:messageBytes length:messageLength encoding:NSUTF8StringEncoding];
+    if (!message) {
+        // keep what the producer sent rather than dropping it, Latin-1 decodes any bytes
+        message = [[NSString alloc] initWithBytes:messageBytes length:messageLength encoding:NSISOLatin1StringEncoding] ?: @"";
+    }
+
+    NSDate *startupTimestamp = _loggingService.startupTimestamp;
+    NSDate *date = (timestamp > 0) ? [NSDate dateWithTimeIntervalSince1970:timestamp] : [NSDate date];
+    TLSLogMessageInfo *info = [[TLSLogMessageInfo alloc] initWithLevel:(TLSLogLevel)level
+                                                                  file:[self _queue_internedStringWithBytes:fileBytes length:fileLength]
+                                                              function:[self _queue_internedStringWithBytes:functionBytes length:functionLength]
+                                                                  line:line
+                                                               channel:[self _queue_internedStringWithBytes:channelBytes length:channelLength]
+                                                             timestamp:date
+                                                           logLifespan:[date timeIntervalSinceDate:startupTimestamp]
+                                                              threadId:threadId
+                                                            threadName:nil
+                                                         contextObject:nil
+                                                               message:message];
+    // never `0`, which means this process
+    [info tls_setProcessIdentifier:(processIdentifier != 0) ? processIdentifier : -1];
+    return info;
+}
+
+- (NSString *)_queue_internedStringWithBytes:(const uint8_t *)bytes
+                                      length:(size_t)length
+{
+    if (0 == length) {
+        return @"";
+    }
+
+    NSData *key = [[NSData alloc] initWithBytesNoCopy:(void *)bytes length:length freeWhenDone:NO];
+    NSString *string = _queue_internedStrings[key];
+    if (!string) {
+        string = [[NSString alloc] initWithBytes:bytes length:length encoding:NSUTF8StringEncoding] ?: @"";
+        if (_queue_internedStrings.count < kInternedStringsCapacity) {
+            _queue_internedStrings[[NSData dataWithBytes:bytes length:length]] = string;
+        }
+    }
+    return string;
+}
+
+@end
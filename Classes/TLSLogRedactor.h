@@ -0,0 +1,117 @@
+//
+//  TLSLogRedactor.h
+//  TwitterLoggingService
+//
+//  Created on 10/18/26.
+//  Copyright (c) 2026 Twitter, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//          http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** Classes of tokens a `TLSLogRedactor` recognizes without patterns */
+typedef NS_OPTIONS(NSUInteger, TLSLogRedactionTokenClasses)
+{
+    /** no token classes */
+    TLSLogRedactionTokenClassesNone = 0,
+    /** email addresses, `local@domain.tld` */
+    TLSLogRedactionTokenClassEmailAddresses = 1 << 0,
+    /** runs of at least `TLSLogRedactorMinimumDigitRunLength` digits (such as user IDs) */
+    TLSLogRedactionTokenClassDigitRuns = 1 << 1,
+    /** runs of at least `TLSLogRedactorMinimumSecretTokenLength` letters, digits, `-` and `_` mixing letters and digits (such as access tokens) */
+    TLSLogRedactionTokenClassSecretTokens = 1 << 2,
+
+    /** all token classes */
+    TLSLogRedactionTokenClassesAll = TLSLogRedactionTokenClassEmailAddresses |
+                                     TLSLogRedactionTokenClassDigitRuns |
+                                     TLSLogRedactionTokenClassSecretTokens,
+};
+
+/**
+ Redacts personal information and secrets from log messages.
+
+ The rules are compiled once into an Aho-Corasick automaton which matches every pattern (together
+ with the token classes) in a single pass over the UTF-8 bytes of a message, regardless of the number of patterns.
+
+ - _literals_ are redacted where they occur, e.g. `@"hunter2"`
+ - _keys_ have the value that follows them redacted, e.g. `@"token="` redacts `abc123` in `token=abc123&user=1`.
+   The value starts after any spaces and an opening quote, and ends at whitespace, a quote or one of `,;&)]}`.
+ - _tokenClasses_ are redacted where they occur, see `TLSLogRedactionTokenClasses`
+
+ Each redacted range is replaced with the `replacement`, overlapping ranges are merged.
+
+ Attach a redactor to output streams with `[TLSLoggingService setRedactor:forOutputStream:]`:
+ the message and the string field values are redacted, the payload is dropped.
+ Streams that share a redactor share the redacted log message, so it is redacted once.
+ A redactor is immutable and can be used from any thread.
+
+ ## Constants
+
+    FOUNDATION_EXTERN NSString * const TLSLogRedactorDefaultReplacement;       // @"<redacted>"
+    FOUNDATION_EXTERN const NSUInteger TLSLogRedactorMinimumDigitRunLength;    // 6 digits
+    FOUNDATION_EXTERN const NSUInteger TLSLogRedactorMinimumSecretTokenLength; // 20 characters
+ */
+@interface TLSLogRedactor : NSObject
+
+/** The strings redacted where they occur */
+@property (nonatomic, copy, readonly) NSArray<NSString *> *literals;
+/** The strings that have the value that follows them redacted */
+@property (nonatomic, copy, readonly) NSArray<NSString *> *keys;
+/** The token classes redacted where they occur */
+@property (nonatomic, readonly) TLSLogRedactionTokenClasses tokenClasses;
+/** Whether _literals_ and _keys_ match regardless of (ASCII) case */
+@property (nonatomic, readonly, getter=isCaseInsensitive) BOOL caseInsensitive;
+/** What redacted ranges are replaced with */
+@property (nonatomic, copy, readonly) NSString *replacement;
+
+/**
+ Compile a redactor.
+ @param literals the strings to redact
+ @param keys the strings to redact the value following
+ @param tokenClasses the token classes to redact
+ @param caseInsensitive match _literals_ and _keys_ regardless of (ASCII) case
+ @param replacement what redacted ranges are replaced with, `nil` for `TLSLogRedactorDefaultReplacement`
+ */
+- (instancetype)initWithLiterals:(nullable NSArray<NSString *> *)literals
+                            keys:(nullable NSArray<NSString *> *)keys
+                    tokenClasses:(TLSLogRedactionTokenClasses)tokenClasses
+                 caseInsensitive:(BOOL)caseInsensitive
+                     replacement:(nullable NSString *)replacement NS_DESIGNATED_INITIALIZER;
+
+/** Compile a case sensitive redactor using `TLSLogRedactorDefaultReplacement` */
+- (instancetype)initWithLiterals:(nullable NSArray<NSString *> *)literals
+                            keys:(nullable NSArray<NSString *> *)keys
+                    tokenClasses:(TLSLogRedactionTokenClasses)tokenClasses;
+
+/** NS_UNAVAILABLE */
+- (instancetype)init NS_UNAVAILABLE;
+/** NS_UNAVAILABLE */
++ (instancetype)new NS_UNAVAILABLE;
+
+/**
+ Redact a string.
+ @param string the string to redact
+ @return the redacted string, `nil` when there was nothing to redact
+ */
+- (nullable NSString *)redactedString:(NSString *)string;
+
+@end
+
+FOUNDATION_EXTERN NSString * const TLSLogRedactorDefaultReplacement;       // @"<redacted>"
+FOUNDATION_EXTERN const NSUInteger TLSLogRedactorMinimumDigitRunLength;    // 6 digits
+FOUNDATION_EXTERN const NSUInteger TLSLogRedactorMinimumSecretTokenLength; // 20 characters
+
+NS_ASSUME_NONNULL_END
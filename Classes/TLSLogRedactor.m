@@ -0,0 +1,597 @@
+//
+//  TLSLogRedactor.m
+//  TwitterLoggingService
+//
+//  Created on 10/18/26.
+//  Copyright (c) 2026 Twitter, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//          http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#import "TLS_Project.h"
+#import "TLSLogRedactor.h"
+
+NSString * const TLSLogRedactorDefaultReplacement = @"<redacted>";
+const NSUInteger TLSLogRedactorMinimumDigitRunLength = 6;
+const NSUInteger TLSLogRedactorMinimumSecretTokenLength = 20;
+
+#pragma mark Spans
+
+//! A byte range to redact
+typedef struct {
+    size_t start;
+    size_t end;
+} TLSRedactionSpan;
+
+typedef struct {
+    TLSRedactionSpan *spans;
+    size_t count;
+    size_t capacity;
+    TLSRedactionSpan inlineSpans[16];
+} TLSRedactionSpans;
+
+static void _SpansInit(TLSRedactionSpans *spans);
+static void _SpansInit(TLSRedactionSpans *spans)
+{
+    spans->spans = spans->inlineSpans;
+    spans->count = 0;
+    spans->capacity = sizeof(spans->inlineSpans) / sizeof(spans->inlineSpans[0]);
+}
+
+static void _SpansFree(TLSRedactionSpans *spans);
+static void _SpansFree(TLSRedactionSpans *spans)
+{
+    if (spans->spans != spans->inlineSpans) {
+        free(spans->spans);
+    }
+}
+
+static void _SpansAdd(TLSRedactionSpans *spans, size_t start, size_t end);
+static void _SpansAdd(TLSRedactionSpans *spans, size_t start, size_t end)
+{
+    if (end <= start) {
+        return;
+    }
+    if (spans->count == spans->capacity) {
+        const size_t capacity = spans->capacity * 2;
+        TLSRedactionSpan *grown = malloc(capacity * sizeof(TLSRedactionSpan));
+        if (!grown) {
+            return;
+        }
+        memcpy(grown, spans->spans, spans->count * sizeof(TLSRedactionSpan));
+        _SpansFree(spans);
+        spans->spans = grown;
+        spans->capacity = capacity;
+    }
+    spans->spans[spans->count].start = start;
+    spans->spans[spans->count].end = end;
+    spans->count++;
+}
+
+static int _SpanCompare(const void *span1, const void *span2);
+static int _SpanCompare(const void *span1, const void *span2)
+{
+    const size_t start1 = ((const TLSRedactionSpan *)span1)->start;
+    const size_t start2 = ((const TLSRedactionSpan *)span2)->start;
+    return (start1 < start2) ? -1 : ((start1 > start2) ? 1 : 0);
+}
+
+//! sort and merge overlapping (and adjacent) spans
+static void _SpansNormalize(TLSRedactionSpans *spans);
+static void _SpansNormalize(TLSRedactionSpans *spans)
+{
+    if (spans->count < 2) {
+        return;
+    }
+    qsort(spans->spans, spans->count, sizeof(TLSRedactionSpan), _SpanCompare);
+    size_t merged = 0;
+    for (size_t i = 1; i < spans->count; i++) {
+        if (spans->spans[i].start <= spans->spans[merged].end) {
+            if (spans->spans[i].end > spans->spans[merged].end) {
+                spans->spans[merged].end = spans->spans[i].end;
+            }
+        } else {
+            spans->spans[++merged] = spans->spans[i];
+        }
+    }
+    spans->count = merged + 1;
+}
+
+#pragma mark Character classes
+
+enum {
+    kCharDigit = 1 << 0,
+    kCharAlpha = 1 << 1,
+    kCharToken = 1 << 2,
+    kCharEmailLocal = 1 << 3,
+    kCharEmailDomain = 1 << 4,
+    kCharValueEnd = 1 << 5,
+};
+
+static uint8_t sCharClasses[256];
+
+static void _CharClassesInit(void);
+static void _CharClassesInit(void)
+{
+    for (unsigned int c = 0; c < 256; c++) {
+        uint8_t classes = 0;
+        const bool digit = (c >= '0' && c <= '9');
+        const bool alpha = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+        if (digit) {
+            classes |= kCharDigit;
+        }
+        if (alpha) {
+            classes |= kCharAlpha;
+        }
+        if (digit || alpha || '-' == c || '_' == c) {
+            classes |= kCharToken;
+        }
+        if (digit || alpha || '.' == c || '_' == c || '%' == c || '+' == c || '-' == c) {
+            classes |= kCharEmailLocal;
+        }
+        if (digit || alpha || '.' == c || '-' == c) {
+            classes |= kCharEmailDomain;
+        }
+        if (strchr(" \t\r\n\"',;&)]}", (int)c) && c != 0) {
+            classes |= kCharValueEnd;
+        }
+        sCharClasses[c] = classes;
+    }
+}
+
+#pragma mark Automaton
+
+//! A pattern to compile into the automaton
+typedef struct {
+    const uint8_t *bytes;
+    size_t length;
+    bool isKey;
+} TLSRedactionPattern;
+
+/**
+ Aho-Corasick automaton as a full DFA (failure transitions are folded into the transition table),
+ so matching is 1 table lookup per byte.  Bytes are mapped to classes (the distinct bytes of the
+ patterns, case folded when case insensitive, plus 1 class for every other byte) to keep the table small.
+ */
+typedef struct {
+    uint16_t byteClasses[256];  // up to 257 classes: every byte value plus the class for other bytes
+    uint32_t classCount;
+    uint32_t stateCount;
+    uint32_t *transitions;      // [state * classCount + byteClass]
+    uint32_t *matchLengths;     // the longest pattern ending in the state, `0` for none
+    uint8_t *matchIsKey;        // whether that pattern is a key
+} TLSRedactionAutomaton;
+
+static uint8_t _FoldByte(uint8_t byte, bool caseInsensitive);
+static uint8_t _FoldByte(uint8_t byte, bool caseInsensitive)
+{
+    return (caseInsensitive && byte >= 'A' && byte <= 'Z') ? (uint8_t)(byte + ('a' - 'A')) : byte;
+}
+
+static void _AutomatonFree(TLSRedactionAutomaton *automaton);
+static void _AutomatonFree(TLSRedactionAutomaton *automaton)
+{
+    free(automaton->transitions);
+    free(automaton->matchLengths);
+    free(automaton->matchIsKey);
+    memset(automaton, 0, sizeof(*automaton));
+}
+
+static bool _AutomatonBuild(TLSRedactionAutomaton *automaton,
+                            const TLSRedactionPattern *patterns,
+                            size_t patternCount,
+                            bool caseInsensitive);
+static bool _AutomatonBuild(TLSRedactionAutomaton *automaton,
+                            const TLSRedactionPattern *patterns,
+                            size_t patternCount,
+                            bool caseInsensitive)
+{
+    memset(automaton, 0, sizeof(*automaton));
+
+    uint32_t classCount = 1;
+    size_t totalLength = 0;
+    for (size_t p = 0; p < patternCount; p++) {
+        for (size_t i = 0; i < patterns[p].length; i++) {
+            const uint8_t byte = _FoldByte(patterns[p].bytes[i], caseInsensitive);
+            if (!automaton->byteClasses[byte]) {
+                automaton->byteClasses[byte] = (uint16_t)classCount++;
+            }
+        }
+        totalLength += patterns[p].length;
+    }
+    if (caseInsensitive) {
+        for (unsigned int c = 'A'; c <= 'Z'; c++) {
+            automaton->byteClasses[c] = automaton->byteClasses[c + ('a' - 'A')];
+        }
+    }
+    automaton->classCount = classCount;
+
+    const size_t maxStateCount = totalLength + 1;
+    automaton->transitions = malloc(maxStateCount * classCount * sizeof(uint32_t));
+    automaton->matchLengths = calloc(maxStateCount, sizeof(uint32_t));
+    automaton->matchIsKey = calloc(maxStateCount, sizeof(uint8_t));
+    uint32_t *failures = calloc(maxStateCount, sizeof(uint32_t));
+    uint32_t *queue = malloc(maxStateCount * sizeof(uint32_t));
+    if (!automaton->transitions || !automaton->matchLengths || !automaton->matchIsKey || !failures || !queue) {
+        free(failures);
+        free(queue);
+        _AutomatonFree(automaton);
+        return false;
+    }
+    memset(automaton->transitions, 0xff, maxStateCount * classCount * sizeof(uint32_t));
+
+    // the trie
+    uint32_t stateCount = 1;
+    for (size_t p = 0; p < patternCount; p++) {
+        if (0 == patterns[p].length) {
+            continue;
+        }
+        uint32_t state = 0;
+        for (size_t i = 0; i < patterns[p].length; i++) {
+            uint32_t *transition = &automaton->transitions[state * classCount + automaton->byteClasses[_FoldByte(patterns[p].bytes[i], caseInsensitive)]];
+            if (UINT32_MAX == *transition) {
+                *transition = stateCount++;
+            }
+            state = *transition;
+        }
+        automaton->matchLengths[state] = (uint32_t)patterns[p].length;
+        automaton->matchIsKey[state] |= (uint8_t)patterns[p].isKey;
+    }
+    automaton->stateCount = stateCount;
+
+    // breadth first: fill in the failure transitions and inherit the matches of the failure states
+    size_t head = 0, tail = 0;
+    for (uint32_t c = 0; c < classCount; c++) {
+        uint32_t *transition = &automaton->transitions[c];
+        if (UINT32_MAX == *transition) {
+            *transition = 0;
+        } else {
+            failures[*transition] = 0;
+            queue[tail++] = *transition;
+        }
+    }
+    while (head < tail) {
+        const uint32_t state = queue[head++];
+        const uint32_t failure = failures[state];
+        if (0 == automaton->matchLengths[state]) {
+            automaton->matchLengths[state] = automaton->matchLengths[failure];
+            automaton->matchIsKey[state] = automaton->matchIsKey[failure];
+        }
+        for (uint32_t c = 0; c < classCount; c++) {
+            uint32_t *transition = &automaton->transitions[state * classCount + c];
+            const uint32_t failureTransition = automaton->transitions[failure * classCount + c];
+            if (UINT32_MAX == *transition) {
+                *transition = failureTransition;
+            } else {
+                failures[*transition] = failureTransition;
+                queue[tail++] = *transition;
+            }
+        }
+    }
+
+    free(failures);
+    free(queue);
+    return true;
+}
+
+static void _EndTokenRun(unsigned int tokenClasses, size_t start, size_t end, bool allDigits, bool hasAlpha, bool hasDigit, TLSRedactionSpans *spans);
+static void _EndTokenRun(unsigned int tokenClasses, size_t start, size_t end, bool allDigits, bool hasAlpha, bool hasDigit, TLSRedactionSpans *spans)
+{
+    const size_t length = end - start;
+    if ((tokenClasses & TLSLogRedactionTokenClassDigitRuns) && allDigits && length >= TLSLogRedactorMinimumDigitRunLength) {
+        _SpansAdd(spans, start, end);
+    } else if ((tokenClasses & TLSLogRedactionTokenClassSecretTokens) && hasAlpha && hasDigit && length >= TLSLogRedactorMinimumSecretTokenLength) {
+        _SpansAdd(spans, start, end);
+    }
+}
+
+//! 1 pass over the _bytes_ matching the patterns and the token classes
+static void _Scan(const TLSRedactionAutomaton *automaton,
+                  unsigned int tokenClasses,
+                  const uint8_t *bytes,
+                  size_t length,
+                  TLSRedactionSpans *spans);
+static void _Scan(const TLSRedactionAutomaton *automaton,
+                  unsigned int tokenClasses,
+                  const uint8_t *bytes,
+                  size_t length,
+                  TLSRedactionSpans *spans)
+{
+    const bool hasPatterns = automaton->stateCount > 1;
+    const uint32_t classCount = automaton->classCount;
+    uint32_t state = 0;
+    size_t tokenStart = SIZE_MAX;
+    bool tokenAllDigits = false, tokenHasAlpha = false, tokenHasDigit = false;
+    size_t localStart = SIZE_MAX;
+
+    size_t i = 0;
+    while (i < length) {
+        const uint8_t byte = bytes[i];
+        const uint8_t charClasses = sCharClasses[byte];
+
+        // digit runs and secret tokens
+        if (charClasses & kCharToken) {
+            if (SIZE_MAX == tokenStart) {
+                tokenStart = i;
+                tokenAllDigits = true;
+                tokenHasAlpha = tokenHasDigit = false;
+            }
+            tokenAllDigits = tokenAllDigits && (charClasses & kCharDigit);
+            tokenHasAlpha = tokenHasAlpha || (charClasses & kCharAlpha);
+            tokenHasDigit = tokenHasDigit || (charClasses & kCharDigit);
+        } else if (tokenStart != SIZE_MAX) {
+            _EndTokenRun(tokenClasses, tokenStart, i, tokenAllDigits, tokenHasAlpha, tokenHasDigit, spans);
+            tokenStart = SIZE_MAX;
+        }
+
+        // email addresses, from the start of the local part once the '@' is reached
+        if (charClasses & kCharEmailLocal) {
+            if (SIZE_MAX == localStart) {
+                localStart = i;
+            }
+        } else {
+            if ('@' == byte && localStart != SIZE_MAX && (tokenClasses & TLSLogRedactionTokenClassEmailAddresses)) {
+                size_t domainEnd = i + 1;
+                while (domainEnd < length && (sCharClasses[bytes[domainEnd]] & kCharEmailDomain)) {
+                    domainEnd++;
+                }
+                while (domainEnd > i + 1 && '.' == bytes[domainEnd - 1]) {
+                    domainEnd--;
+                }
+                // a dot, neither first nor last
+                const size_t domainLength = domainEnd - (i + 1);
+                if (domainLength >= 3 && memchr(bytes + i + 2, '.', domainLength - 2)) {
+                    _SpansAdd(spans, localStart, domainEnd);
+                    tokenStart = localStart = SIZE_MAX;
+                    state = 0;
+                    i = domainEnd;
+                    continue;
+                }
+            }
+            localStart = SIZE_MAX;
+        }
+
+        // literals and keys
+        if (hasPatterns) {
+            state = automaton->transitions[state * classCount + automaton->byteClasses[byte]];
+            const uint32_t matchLength = automaton->matchLengths[state];
+            if (matchLength) {
+                if (!automaton->matchIsKey[state]) {
+                    _SpansAdd(spans, i + 1 - matchLength, i + 1);
+                } else {
+                    size_t valueStart = i + 1;
+                    while (valueStart < length && (' ' == bytes[valueStart] || '\t' == bytes[valueStart])) {
+                        valueStart++;
+                    }
+                    if (valueStart < length && ('"' == bytes[valueStart] || '\'' == bytes[valueStart])) {
+                        valueStart++;
+                    }
+                    size_t valueEnd = valueStart;
+                    while (valueEnd < length && !(sCharClasses[bytes[valueEnd]] & kCharValueEnd)) {
+                        valueEnd++;
+                    }
+                    if (valueEnd > valueStart) {
+                        // the value is gone, don't match within it
+                        _SpansAdd(spans, valueStart, valueEnd);
+                        tokenStart = localStart = SIZE_MAX;
+                        state = 0;
+                        i = valueEnd;
+                        continue;
+                    }
+                }
+            }
+        }
+
+        i++;
+    }
+
+    if (tokenStart != SIZE_MAX) {
+        _EndTokenRun(tokenClasses, tokenStart, length, tokenAllDigits, tokenHasAlpha, tokenHasDigit, spans);
+    }
+}
+
+// The UTF-8 bytes of the whole _string_ (`strlen` of the `UTF8String` would stop at an embedded NUL).
+// _dataOut_ holds the bytes when they had to be converted, keep it alive while using them.
+static const uint8_t *_UTF8Bytes(NSString *string, size_t *lengthOut, NSData * __strong *dataOut);
+static const uint8_t *_UTF8Bytes(NSString *string, size_t *lengthOut, NSData * __strong *dataOut)
+{
+    const char *utf8 = CFStringGetCStringPtr((__bridge CFStringRef)string, kCFStringEncodingUTF8);
+    if (utf8) {
+        *lengthOut = [string lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+        return (const uint8_t *)utf8;
+    }
+
+    NSData *data = [string dataUsingEncoding:NSUTF8StringEncoding];
+    *dataOut = data;
+    *lengthOut = data.length;
+    return data.bytes;
+}
+
+#pragma mark - TLSLogRedactor
+
+@interface TLSLogRedactor ()
+- (nullable NSMutableData *)_redactedBytes:(const uint8_t *)bytes length:(size_t)length TLS_OBJC_DIRECT;
+@end
+
+@implementation TLSLogRedactor
+{
+    TLSRedactionAutomaton _automaton;
+    NSData *_replacementData;
+}
+
+- (instancetype)initWithLiterals:(nullable NSArray<NSString *> *)literals
+                            keys:(nullable NSArray<NSString *> *)keys
+                    tokenClasses:(TLSLogRedactionTokenClasses)tokenClasses
+{
+    return [self initWithLiterals:literals
+                             keys:keys
+                     tokenClasses:tokenClasses
+                  caseInsensitive:NO
+                      replacement:nil];
+}
+
+- (instancetype)initWithLiterals:(nullable NSArray<NSString *> *)literals
+                            keys:(nullable NSArray<NSString *> *)keys
+                    tokenClasses:(TLSLogRedactionTokenClasses)tokenClasses
+                 caseInsensitive:(BOOL)caseInsensitive
+                     replacement:(nullable NSString *)replacement // NS_DESIGNATED_INITIALIZER
+{
+    static dispatch_once_t sOnceToken;
+    dispatch_once(&sOnceToken, ^{
+        _CharClassesInit();
+    });
+
+    if (self = [super init]) {
+        _literals = [literals copy] ?: @[];
+        _keys = [keys copy] ?: @[];
+        _tokenClasses = tokenClasses;
+        _caseInsensitive = caseInsensitive;
+        _replacement = [replacement copy] ?: TLSLogRedactorDefaultReplacement;
+        _replacementData = [_replacement dataUsingEncoding:NSUTF8StringEncoding];
+
+        @autoreleasepool {
+            const size_t patternCount = _literals.count + _keys.count;
+            TLSRedactionPattern *patterns = calloc(MAX(patternCount, (size_t)1), sizeof(TLSRedactionPattern));
+            size_t p = 0;
+            // the converted bytes, alive until the automaton is built
+            NSMutableArray<NSData *> *patternData NS_VALID_UNTIL_END_OF_SCOPE = [[NSMutableArray alloc] init];
+            for (NSString *literal in _literals) {
+                NSData *data = nil;
+                size_t length = 0;
+                const uint8_t *bytes = _UTF8Bytes(literal, &length, &data);
+                if (data) {
+                    [patternData addObject:data];
+                }
+                patterns[p++] = (TLSRedactionPattern){ bytes, (bytes) ? length : 0, false };
+            }
+            for (NSString *key in _keys) {
+                NSData *data = nil;
+                size_t length = 0;
+                const uint8_t *bytes = _UTF8Bytes(key, &length, &data);
+                if (data) {
+                    [patternData addObject:data];
+                }
+                patterns[p++] = (TLSRedactionPattern){ bytes, (bytes) ? length : 0, true };
+            }
+            if (!_AutomatonBuild(&_automaton, patterns, patternCount, caseInsensitive)) {
+                // out of memory, redact nothing rather than crash
+                memset(&_automaton, 0, sizeof(_automaton));
+            }
+            free(patterns);
+        }
+    }
+    return self;
+}
+
+- (instancetype)init
+{
+    [self doesNotRecognizeSelector:_cmd];
+    abort();
+}
+
+- (void)dealloc
+{
+    _AutomatonFree(&_automaton);
+}
+
+- (nullable NSString *)redactedString:(NSString *)string
+{
+    NSData *data NS_VALID_UNTIL_END_OF_SCOPE = nil;
+    size_t length = 0;
+    const uint8_t *bytes = _UTF8Bytes(string, &length, &data);
+    if (!bytes) {
+        return nil;
+    }
+
+    NSData *redacted = [self _redactedBytes:bytes length:length];
+    if (!redacted) {
+        return nil;
+    }
+    return [[NSString alloc] initWithData:redacted encoding:NSUTF8StringEncoding] ?: _replacement;
+}
+
+- (nullable NSMutableData *)_redactedBytes:(const uint8_t *)bytes length:(size_t)length
+{
+    TLSRedactionSpans spans;
+    _SpansInit(&spans);
+    _Scan(&_automaton, (unsigned int)_tokenClasses, bytes, length, &spans);
+    if (0 == spans.count) {
+        _SpansFree(&spans);
+        return nil;
+    }
+    _SpansNormalize(&spans);
+
+    NSMutableData *redacted = [[NSMutableData alloc] initWithCapacity:length];
+    size_t offset = 0;
+    for (size_t i = 0; i < spans.count; i++) {
+        [redacted appendBytes:bytes + offset length:spans.spans[i].start - offset];
+        [redacted appendData:_replacementData];
+        offset = spans.spans[i].end;
+    }
+    [redacted appendBytes:bytes + offset length:length - offset];
+    _SpansFree(&spans);
+    return redacted;
+}
+
+@end
+
+@implementation TLSLogRedactor (Project)
+
+- (nullable TLSLogMessageInfo *)tls_redactedInfo:(TLSLogMessageInfo *)info
+{
+    NSString *redactedMessage = [self redactedString:info.message];
+
+    const NSUInteger fieldCount = info.fieldCount;
+    const TLSLogField *fields = info.fields;
+    TLSLogField *redactedFields = NULL;
+    BOOL fieldsRedacted = NO;
+    for (NSUInteger i = 0; i < fieldCount; i++) {
+        if (TLSLogFieldTypeString != fields[i].type) {
+            continue;
+        }
+        const char *value = fields[i].value.stringValue;
+        NSMutableData *redactedValue = [self _redactedBytes:(const uint8_t *)value length:strnlen(value, TLSLogFieldStringCapacity)];
+        if (!redactedValue) {
+            continue;
+        }
+        if (!fieldsRedacted) {
+            fieldsRedacted = YES;
+            redactedFields = malloc(fieldCount * sizeof(TLSLogField));
+            if (!redactedFields) {
+                // out of memory, drop the fields rather than output them unredacted
+                break;
+            }
+            memcpy(redactedFields, fields, fieldCount * sizeof(TLSLogField));
+        }
+        [redactedValue appendBytes:"" length:1];
+        // truncated (the replacement can be longer than the value) without splitting a code point
+        redactedFields[i] = TLSLogFieldCString(fields[i].key, redactedValue.bytes);
+    }
+
+    if (!redactedMessage && !fieldsRedacted && !info.payload) {
+        return nil;
+    }
+
+    TLSLogMessageInfo *redactedInfo = [info tls_infoWithMessage:redactedMessage ?: info.message];
+    if (fieldsRedacted) {
+        [redactedInfo tls_adoptFields:redactedFields count:fieldCount];
+    }
+    [redactedInfo tls_setPayload:nil maximumRenderedLength:0];
+    return redactedInfo;
+}
+
+@end
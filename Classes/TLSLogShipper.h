@@ -0,0 +1,146 @@
+//
+//  TLSLogShipper.h
+//  TwitterLoggingService
+//
+//  Created on 10/18/26.
+//  Copyright (c) 2026 Twitter, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//          http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+#import <Foundation/Foundation.h>
+
+@class TLSLoggingService;
+@class TLSRollingFileOutputStream;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ Ships the log files of a `TLSRollingFileOutputStream` to an HTTP endpoint, picking up where it left off.
+
+ The shipper tails the log files (oldest to newest) from a byte cursor persisted in `cursorFilePath`.
+ The unshipped bytes are gathered into batches of up to `maxBatchBytes`, gzip compressed and `POST`ed
+ to the `endpointURL` (`Content-Encoding: gzip`).  A batch is shipped once `maxBatchBytes` are
+ pending or once `maxBatchInterval` has passed with any bytes pending.  The newest log file is only
+ shipped up to its last newline, so log messages are not split across batches.
+
+ The cursor only advances once the endpoint responds with a `2xx` status code, failures are retried with
+ exponential backoff (from `minRetryInterval` up to `maxRetryInterval`, honoring `Retry-After`),
+ so nothing is lost when the process exits mid shipment.  Since the process can also exit between a
+ successful response and persisting the cursor, every batch carries a stable `TLSLogShipperBatchIdHeaderField`
+ (the byte range it covers) for the endpoint to discard a batch it already received.
+ The same goes for a cursor that cannot be read, shipping starts over from the oldest log file.
+
+ Shipping stops for the rest of the hour once `networkBudgetBytesPerHour` (compressed bytes sent) or
+ `CPUBudgetPerHour` (time spent compressing) is used up.
+
+ Log files pruned by the output stream before they were shipped are skipped.
+
+ ## Constants
+
+    FOUNDATION_EXTERN const NSUInteger TLSLogShipperDefaultMaxBatchBytes;           // 256KB
+    FOUNDATION_EXTERN const NSTimeInterval TLSLogShipperDefaultMaxBatchInterval;   // 60 seconds
+    FOUNDATION_EXTERN const NSTimeInterval TLSLogShipperDefaultMinRetryInterval;   // 1 second
+    FOUNDATION_EXTERN const NSTimeInterval TLSLogShipperDefaultMaxRetryInterval;   // 5 minutes
+    FOUNDATION_EXTERN NSString * const TLSLogShipperBatchIdHeaderField;           // @"X-TLS-Batch-Id"
+ */
+@interface TLSLogShipper : NSObject
+
+/** The directory of the log files */
+@property (nonatomic, copy, readonly) NSString *logFileDirectoryPath;
+/** The prefix of the log files */
+@property (nonatomic, copy, readonly) NSString *logFilePrefix;
+/** The endpoint batches are `POST`ed to */
+@property (nonatomic, copy, readonly) NSURL *endpointURL;
+/** The file persisting the cursor, `<logFilePrefix>shipper.cursor` in the `logFileDirectoryPath` */
+@property (nonatomic, copy, readonly) NSString *cursorFilePath;
+
+/** The maximum uncompressed size of a batch.  Default == `TLSLogShipperDefaultMaxBatchBytes`, min is `1KB`. */
+@property (atomic) NSUInteger maxBatchBytes;
+/** The longest pending bytes wait before being shipped in a smaller batch.  Default == `TLSLogShipperDefaultMaxBatchInterval`. */
+@property (atomic) NSTimeInterval maxBatchInterval;
+/** The backoff after the first failure, doubling with each consecutive failure.  Default == `TLSLogShipperDefaultMinRetryInterval`. */
+@property (atomic) NSTimeInterval minRetryInterval;
+/** The longest backoff.  Default == `TLSLogShipperDefaultMaxRetryInterval`. */
+@property (atomic) NSTimeInterval maxRetryInterval;
+/** The compressed bytes that can be sent per hour, `0` for no limit (default) */
+@property (atomic) NSUInteger networkBudgetBytesPerHour;
+/** The CPU time that can be spent compressing per hour, `0` for no limit (default) */
+@property (atomic) NSTimeInterval CPUBudgetPerHour;
+/** The zlib compression level, `1` (fastest) to `9` (smallest).  Default == `6`. */
+@property (atomic) int compressionLevel;
+/** Headers to add to every request, such as authorization */
+@property (atomic, nullable, copy) NSDictionary<NSString *, NSString *> *additionalHTTPHeaders;
+/** The configuration of the session the batches are sent with, read on `start`.  Default is an ephemeral configuration. */
+@property (atomic, copy) NSURLSessionConfiguration *URLSessionConfiguration;
+
+/** The number of (uncompressed) bytes shipped */
+@property (atomic, readonly) uint64_t shippedByteCount;
+/** The number of batches shipped */
+@property (atomic, readonly) uint64_t shippedBatchCount;
+/** The number of failed attempts to ship a batch */
+@property (atomic, readonly) uint64_t failedAttemptCount;
+
+/**
+ Ship the log files in a directory.
+ @param logFileDirectoryPath the directory of the log files
+ @param logFilePrefix the prefix of the log files, `nil` for `TLSRollingFileOutputStreamDefaultLogFilePrefix`
+ @param endpointURL the HTTP(S) endpoint to `POST` batches to
+ @param errorOut an output reference to get any errors, such as a missing directory or endpoint.  If there is an error, the return value will be `nil`.
+ */
+- (nullable instancetype)initWithLogFileDirectoryPath:(NSString *)logFileDirectoryPath
+                                        logFilePrefix:(nullable NSString *)logFilePrefix
+                                          endpointURL:(NSURL *)endpointURL
+                                                error:(out NSError * __nullable __autoreleasing * __nullable)errorOut NS_DESIGNATED_INITIALIZER;
+
+/**
+ Ship the log files of a _stream_.
+ @param stream the output stream writing the log files
+ @param loggingService the service the _stream_ is added to, flushed (with `[TLSLoggingService flush]`) before
+ each batch so that it ships what was logged.  `nil` to only ship what the _stream_ already wrote out.
+ Held weakly.
+ @param endpointURL the HTTP(S) endpoint to `POST` batches to
+ @param errorOut an output reference to get any errors, such as a missing directory or endpoint.  If there is an error, the return value will be `nil`.
+ */
+- (nullable instancetype)initWithRollingFileOutputStream:(TLSRollingFileOutputStream *)stream
+                                          loggingService:(nullable TLSLoggingService *)loggingService
+                                             endpointURL:(NSURL *)endpointURL
+                                                   error:(out NSError * __nullable __autoreleasing * __nullable)errorOut;
+
+/** NS_UNAVAILABLE */
+- (instancetype)init NS_UNAVAILABLE;
+/** NS_UNAVAILABLE */
++ (instancetype)new NS_UNAVAILABLE;
+
+/** Start shipping on a timer */
+- (void)start;
+
+/** Stop shipping, a batch in flight still completes */
+- (void)stop;
+
+/**
+ Ship the pending bytes now (regardless of `maxBatchInterval` and backoff), batch after batch,
+ until caught up, a batch fails or the budget is used up.
+ @param completion called (on an arbitrary queue) with `nil` once caught up, the error otherwise
+ */
+- (void)shipWithCompletion:(nullable void(^)(NSError * __nullable error))completion;
+
+@end
+
+FOUNDATION_EXTERN const NSUInteger TLSLogShipperDefaultMaxBatchBytes;           // 256KB
+FOUNDATION_EXTERN const NSTimeInterval TLSLogShipperDefaultMaxBatchInterval;   // 60 seconds
+FOUNDATION_EXTERN const NSTimeInterval TLSLogShipperDefaultMinRetryInterval;   // 1 second
+FOUNDATION_EXTERN const NSTimeInterval TLSLogShipperDefaultMaxRetryInterval;   // 5 minutes
+FOUNDATION_EXTERN NSString * const TLSLogShipperBatchIdHeaderField;           // @"X-TLS-Batch-Id"
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,576 @@
+//
+//  TLSLogShipper.m
+//  TwitterLoggingService
+//
+//  Created on 10/18/26.
+//  Copyright (c) 2026 Twitter, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//          http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#import "TLS_Project.h"
+#import "TLSLogShipper.h"
+#import "TLSLoggingService+Advanced.h"
+#import "TLSRollingFileOutputStream.h"
+
+const NSUInteger TLSLogShipperDefaultMaxBatchBytes = 256 * 1024;
+const NSTimeInterval TLSLogShipperDefaultMaxBatchInterval = 60.0;
+const NSTimeInterval TLSLogShipperDefaultMinRetryInterval = 1.0;
+const NSTimeInterval TLSLogShipperDefaultMaxRetryInterval = 5.0 * 60.0;
+NSString * const TLSLogShipperBatchIdHeaderField = @"X-TLS-Batch-Id";
+
+static NSString * const kLogFileExtension = @"log";
+static NSString * const kCursorFileSuffix = @"shipper.cursor";
+static NSString * const kCursorLogFileNameKey = @"logFileName";
+static NSString * const kCursorOffsetKey = @"offset";
+static const NSUInteger kMinBatchBytes = 1024;
+static const NSTimeInterval kBudgetWindow = 60.0 * 60.0;
+static const NSTimeInterval kMaxTimerInterval = 5.0;
+static const int kDefaultCompressionLevel = 6;
+
+static NSTimeInterval _Now(void);
+static NSTimeInterval _Now()
+{
+    // keeps counting while asleep, unlike CLOCK_UPTIME_RAW
+    return (NSTimeInterval)clock_gettime_nsec_np(CLOCK_MONOTONIC_RAW) / (NSTimeInterval)NSEC_PER_SEC;
+}
+
+static long long _LogFileId(NSString *logFileName, NSString *logFilePrefix);
+static long long _LogFileId(NSString *logFileName, NSString *logFilePrefix)
+{
+    NSString *name = [logFileName stringByDeletingPathExtension];
+    return (name.length > logFilePrefix.length) ? [name substringFromIndex:logFilePrefix.length].longLongValue : 0;
+}
+
+//! the log files oldest to newest, matching how `TLSRollingFileOutputStream` names them
+static NSArray<NSString *> *_SortedLogFileNames(NSString *logFileDirectoryPath, NSString *logFilePrefix);
+static NSArray<NSString *> *_SortedLogFileNames(NSString *logFileDirectoryPath, NSString *logFilePrefix)
+{
+    NSArray<NSString *> *names = [[NSFileManager defaultManager] contentsOfDirectoryAtPath:logFileDirectoryPath error:NULL];
+    NSMutableArray<NSString *> *logFileNames = [[NSMutableArray alloc] initWithCapacity:names.count];
+    for (NSString *name in names) {
+        if ([name hasPrefix:logFilePrefix] && [name.pathExtension isEqualToString:kLogFileExtension]) {
+            [logFileNames addObject:name];
+        }
+    }
+    [logFileNames sortUsingComparator:^NSComparisonResult(NSString *name1, NSString *name2) {
+        const long long fileId1 = _LogFileId(name1, logFilePrefix);
+        const long long fileId2 = _LogFileId(name2, logFilePrefix);
+        if (fileId1 != fileId2) {
+            return (fileId1 < fileId2) ? NSOrderedAscending : NSOrderedDescending;
+        }
+        return [name1 compare:name2];
+    }];
+    return logFileNames;
+}
+
+static NSData *_ReadFileRange(NSString *filePath, unsigned long long offset, NSUInteger length);
+static NSData *_ReadFileRange(NSString *filePath, unsigned long long offset, NSUInteger length)
+{
+    const int fileDescriptor = open(filePath.fileSystemRepresentation, O_RDONLY | O_CLOEXEC);
+    if (fileDescriptor < 0) {
+        return nil;
+    }
+
+    NSMutableData *data = [NSMutableData dataWithLength:length];
+    size_t readLength = 0;
+    while (readLength < length) {
+        const ssize_t result = pread(fileDescriptor, (uint8_t *)data.mutableBytes + readLength, length - readLength, (off_t)(offset + readLength));
+        if (result < 0 && EINTR == errno) {
+            continue;
+        }
+        if (result <= 0) {
+            break;
+        }
+        readLength += (size_t)result;
+    }
+    close(fileDescriptor);
+    data.length = readLength;
+    return data;
+}
+
+static NSData *_GzipData(NSData *data, int level);
+static NSData *_GzipData(NSData *data, int level)
+{
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    // 15 bits of window, +16 for the gzip wrapper
+    if (deflateInit2(&stream, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return nil;
+    }
+
+    NSMutableData *compressed = [NSMutableData dataWithLength:deflateBound(&stream, (uLong)data.length)];
+    stream.next_in = (Bytef *)data.bytes;
+    stream.avail_in = (uInt)data.length;
+    stream.next_out = (Bytef *)compressed.mutableBytes;
+    stream.avail_out = (uInt)compressed.length;
+    const int result = deflate(&stream, Z_FINISH);
+    compressed.length = stream.total_out;
+    deflateEnd(&stream);
+    return (Z_STREAM_END == result) ? compressed : nil;
+}
+
+static NSError *_ShipperError(int code, NSString *message, NSDictionary *extraInfo);
+static NSError *_ShipperError(int code, NSString *message, NSDictionary *extraInfo)
+{
+    NSMutableDictionary *userInfo = [NSMutableDictionary dictionaryWithDictionary:extraInfo ?: @{}];
+    userInfo[@"message"] = message;
+    return [NSError errorWithDomain:NSPOSIXErrorDomain code:code userInfo:userInfo];
+}
+
+//! The unshipped bytes of a log file
+TLS_OBJC_FINAL
+@interface TLSLogShipperRange : NSObject
+@property (nonatomic, copy) NSString *logFileName;
+@property (nonatomic) unsigned long long startOffset;
+@property (nonatomic) unsigned long long endOffset;
+@end
+
+@implementation TLSLogShipperRange
+@end
+
+typedef void(^TLSLogShipperBatchCompletion)(BOOL shipped, NSError * __nullable error);
+
+@interface TLSLogShipper ()
+- (nullable NSURLSession *)_queue_session TLS_OBJC_DIRECT;
+- (void)_queue_timerFired TLS_OBJC_DIRECT;
+- (void)_queue_shipUntilCaughtUpWithCompletion:(nullable void(^)(NSError * __nullable error))completion TLS_OBJC_DIRECT;
+- (void)_queue_shipBatchForced:(BOOL)forced
+                    completion:(nullable TLSLogShipperBatchCompletion)completion TLS_OBJC_DIRECT;
+- (NSArray<TLSLogShipperRange *> *)_queue_pendingRanges TLS_OBJC_DIRECT;
+- (nullable NSError *)_queue_budgetError TLS_OBJC_DIRECT;
+- (void)_queue_didShipRange:(TLSLogShipperRange *)range
+                 batchBytes:(NSUInteger)batchBytes TLS_OBJC_DIRECT;
+- (void)_queue_didFailWithResponse:(nullable NSHTTPURLResponse *)response TLS_OBJC_DIRECT;
+@end
+
+@implementation TLSLogShipper
+{
+    dispatch_queue_t _queue;
+    __weak TLSLoggingService *_loggingService;
+
+    NSURLSession *_queue_session;
+    dispatch_source_t _queue_timer;
+    BOOL _queue_inFlight;
+    NSMutableArray<dispatch_block_t> *_queue_afterFlightBlocks;
+
+    NSString *_queue_cursorLogFileName;
+    unsigned long long _queue_cursorOffset;
+
+    NSTimeInterval _queue_lastShipTime;
+    NSTimeInterval _queue_nextAttemptTime;
+    NSUInteger _queue_consecutiveFailureCount;
+
+    NSTimeInterval _queue_budgetWindowStartTime;
+    NSUInteger _queue_budgetBytes;
+    NSTimeInterval _queue_budgetCPUTime;
+
+    atomic_ullong _shippedByteCount;
+    atomic_ullong _shippedBatchCount;
+    atomic_ullong _failedAttemptCount;
+}
+
+- (instancetype)initWithLogFileDirectoryPath:(NSString *)logFileDirectoryPath
+                               logFilePrefix:(nullable NSString *)logFilePrefix
+                                 endpointURL:(NSURL *)endpointURL
+                                       error:(out NSError **)errorOut // NS_DESIGNATED_INITIALIZER
+{
+    if (errorOut) {
+        *errorOut = nil;
+    }
+
+    if (!logFileDirectoryPath.length || !endpointURL) {
+        if (errorOut) {
+            *errorOut = _ShipperError(EINVAL, @"a log file directory and an endpoint are required", nil);
+        }
+        return nil;
+    }
+
+    logFilePrefix = logFilePrefix ?: TLSRollingFileOutputStreamDefaultLogFilePrefix;
+    NSString *cursorFilePath = [logFileDirectoryPath stringByAppendingPathComponent:[logFilePrefix stringByAppendingString:kCursorFileSuffix]];
+
+    // resume from the persisted cursor, a corrupt cursor starts over from the oldest log file
+    // (the endpoint discards the batches it already received by their batch id)
+    NSString *cursorLogFileName = nil;
+    unsigned long long cursorOffset = 0;
+    if ([[NSFileManager defaultManager] fileExistsAtPath:cursorFilePath]) {
+        NSData *cursorData = [NSData dataWithContentsOfFile:cursorFilePath];
+        NSDictionary *cursor = (cursorData) ? [NSPropertyListSerialization propertyListWithData:cursorData options:0 format:NULL error:NULL] : nil;
+        if ([cursor isKindOfClass:[NSDictionary class]] && [cursor[kCursorLogFileNameKey] isKindOfClass:[NSString class]] && [cursor[kCursorOffsetKey] isKindOfClass:[NSNumber class]]) {
+            cursorLogFileName = cursor[kCursorLogFileNameKey];
+            cursorOffset = [cursor[kCursorOffsetKey] unsignedLongLongValue];
+        }
+    }
+
+    if (self = [super init]) {
+        _logFileDirectoryPath = [logFileDirectoryPath copy];
+        _logFilePrefix = [logFilePrefix copy];
+        _endpointURL = [endpointURL copy];
+        _cursorFilePath = [cursorFilePath copy];
+        _maxBatchBytes = TLSLogShipperDefaultMaxBatchBytes;
+        _maxBatchInterval = TLSLogShipperDefaultMaxBatchInterval;
+        _minRetryInterval = TLSLogShipperDefaultMinRetryInterval;
+        _maxRetryInterval = TLSLogShipperDefaultMaxRetryInterval;
+        _compressionLevel = kDefaultCompressionLevel;
+        _URLSessionConfiguration = [NSURLSessionConfiguration ephemeralSessionConfiguration];
+
+        _queue = dispatch_queue_create("TLSLogShipper.queue", DISPATCH_QUEUE_SERIAL);
+        _queue_afterFlightBlocks = [[NSMutableArray alloc] init];
+        _queue_cursorLogFileName = [cursorLogFileName copy];
+        _queue_cursorOffset = cursorOffset;
+        _queue_lastShipTime = _Now();
+        _queue_budgetWindowStartTime = _queue_lastShipTime;
+        atomic_init(&_shippedByteCount, 0);
+        atomic_init(&_shippedBatchCount, 0);
+        atomic_init(&_failedAttemptCount, 0);
+    }
+    return self;
+}
+
+- (instancetype)initWithRollingFileOutputStream:(TLSRollingFileOutputStream *)stream
+                                 loggingService:(nullable TLSLoggingService *)loggingService
+                                    endpointURL:(NSURL *)endpointURL
+                                          error:(out NSError **)errorOut
+{
+    self = [self initWithLogFileDirectoryPath:stream.logFileDirectoryPath
+                                logFilePrefix:stream.logFilePrefix
+                                  endpointURL:endpointURL
+                                        error:errorOut];
+    if (self) {
+        _loggingService = loggingService;
+    }
+    return self;
+}
+
+- (instancetype)init
+{
+    [self doesNotRecognizeSelector:_cmd];
+    abort();
+}
+
+- (void)dealloc
+{
+    if (_queue_timer) {
+        dispatch_source_cancel(_queue_timer);
+    }
+    [_queue_session finishTasksAndInvalidate];
+}
+
+- (uint64_t)shippedByteCount
+{
+    return atomic_load_explicit(&_shippedByteCount, memory_order_relaxed);
+}
+
+- (uint64_t)shippedBatchCount
+{
+    return atomic_load_explicit(&_shippedBatchCount, memory_order_relaxed);
+}
+
+- (uint64_t)failedAttemptCount
+{
+    return atomic_load_explicit(&_failedAttemptCount, memory_order_relaxed);
+}
+
+- (void)start
+{
+    dispatch_async(_queue, ^{
+        if (self->_queue_timer) {
+            return;
+        }
+
+        const NSTimeInterval interval = MAX(MIN(self.maxBatchInterval, kMaxTimerInterval), 0.1);
+        __weak typeof(self) weakSelf = self;
+        self->_queue_timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, self->_queue);
+        dispatch_source_set_timer(self->_queue_timer,
+                                  dispatch_time(DISPATCH_TIME_NOW, (int64_t)(interval * NSEC_PER_SEC)),
+                                  (uint64_t)(interval * NSEC_PER_SEC),
+                                  (uint64_t)(interval * NSEC_PER_SEC / 10));
+        dispatch_source_set_event_handler(self->_queue_timer, ^{
+            [weakSelf _queue_timerFired];
+        });
+        dispatch_resume(self->_queue_timer);
+    });
+}
+
+- (void)stop
+{
+    dispatch_async(_queue, ^{
+        if (self->_queue_timer) {
+            dispatch_source_cancel(self->_queue_timer);
+            self->_queue_timer = nil;
+        }
+    });
+}
+
+- (void)shipWithCompletion:(nullable void(^)(NSError * __nullable error))completion
+{
+    dispatch_async(_queue, ^{
+        [self _queue_shipUntilCaughtUpWithCompletion:completion];
+    });
+}
+
+#pragma mark Private
+
+- (nullable NSURLSession *)_queue_session
+{
+    if (!_queue_session) {
+        _queue_session = [NSURLSession sessionWithConfiguration:self.URLSessionConfiguration];
+    }
+    return _queue_session;
+}
+
+- (void)_queue_timerFired
+{
+    if (!_queue_inFlight) {
+        [self _queue_shipBatchForced:NO completion:nil];
+    }
+}
+
+- (void)_queue_shipUntilCaughtUpWithCompletion:(nullable void(^)(NSError * __nullable error))completion
+{
+    if (_queue_inFlight) {
+        [_queue_afterFlightBlocks addObject:^{
+            [self _queue_shipUntilCaughtUpWithCompletion:completion];
+        }];
+        return;
+    }
+
+    [self _queue_shipBatchForced:YES completion:^(BOOL shipped, NSError *error) {
+        if (shipped) {
+            [self _queue_shipUntilCaughtUpWithCompletion:completion];
+        } else if (completion) {
+            completion(error);
+        }
+    }];
+}
+
+- (void)_queue_shipBatchForced:(BOOL)forced
+                    completion:(nullable TLSLogShipperBatchCompletion)completion
+{
+    const NSTimeInterval now = _Now();
+    if (!forced && now < _queue_nextAttemptTime) {
+        return; // backing off
+    }
+
+    // through the service, the stream is only ever written (and flushed) on its logging queue
+    [_loggingService flush];
+    NSArray<TLSLogShipperRange *> *ranges = [self _queue_pendingRanges];
+    const NSUInteger maxBatchBytes = MAX(self.maxBatchBytes, kMinBatchBytes);
+    unsigned long long pendingBytes = 0;
+    for (TLSLogShipperRange *range in ranges) {
+        pendingBytes += range.endOffset - range.startOffset;
+    }
+    if (!forced && pendingBytes < maxBatchBytes && (0 == pendingBytes || now - _queue_lastShipTime < self.maxBatchInterval)) {
+        return; // not worth a request yet
+    }
+
+    NSError *budgetError = (pendingBytes > 0) ? [self _queue_budgetError] : nil;
+    if (budgetError) {
+        if (completion) {
+            completion(NO, budgetError);
+        }
+        return;
+    }
+
+    // gather the batch, only complete lines of the newest log file (which is still being written)
+    NSMutableData *batch = [[NSMutableData alloc] init];
+    TLSLogShipperRange *firstRange = nil;
+    TLSLogShipperRange *batchRange = nil;
+    for (TLSLogShipperRange *range in ranges) {
+        const NSUInteger remaining = maxBatchBytes - batch.length;
+        const unsigned long long rangeLength = range.endOffset - range.startOffset;
+        const NSUInteger length = (NSUInteger)MIN(rangeLength, (unsigned long long)remaining);
+        NSData *data = _ReadFileRange([_logFileDirectoryPath stringByAppendingPathComponent:range.logFileName], range.startOffset, length);
+        if (!data.length) {
+            break;
+        }
+
+        const BOOL partial = (data.length < rangeLength) || (range == ranges.lastObject);
+        if (partial) {
+            const NSRange newline = [data rangeOfData:[NSData dataWithBytes:"\n" length:1]
+                                              options:NSDataSearchBackwards
+                                                range:NSMakeRange(0, data.length)];
+            if (newline.location != NSNotFound) {
+                data = [data subdataWithRange:NSMakeRange(0, NSMaxRange(newline))];
+            } else if (batch.length > 0 || data.length < remaining) {
+                break; // wait for the rest of the line
+            } // else: a line longer than a batch, ship it split
+        }
+
+        firstRange = firstRange ?: range;
+        batchRange = [[TLSLogShipperRange alloc] init];
+        batchRange.logFileName = range.logFileName;
+        batchRange.startOffset = range.startOffset;
+        batchRange.endOffset = range.startOffset + data.length;
+        [batch appendData:data];
+        if (partial) {
+            break;
+        }
+    }
+
+    if (!batchRange) {
+        if (completion) {
+            completion(NO, nil);
+        }
+        return;
+    }
+
+    // the byte range of the batch, for the endpoint to recognize bytes it already has
+    NSString *batchId = [NSString stringWithFormat:@"%@:%llu-%@:%llu",
+                         firstRange.logFileName, firstRange.startOffset,
+                         batchRange.logFileName, batchRange.endOffset];
+
+    const uint64_t cpuStartTime = clock_gettime_nsec_np(CLOCK_THREAD_CPUTIME_ID);
+    NSData *compressed = _GzipData(batch, MIN(MAX(self.compressionLevel, 1), 9));
+    _queue_budgetCPUTime += (NSTimeInterval)(clock_gettime_nsec_np(CLOCK_THREAD_CPUTIME_ID) - cpuStartTime) / (NSTimeInterval)NSEC_PER_SEC;
+    if (!compressed) {
+        if (completion) {
+            completion(NO, _ShipperError(ENOMEM, @"unable to compress the log shipping batch", nil));
+        }
+        return;
+    }
+    _queue_budgetBytes += compressed.length;
+
+    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:_endpointURL];
+    request.HTTPMethod = @"POST";
+    request.HTTPBody = compressed;
+    [self.additionalHTTPHeaders enumerateKeysAndObjectsUsingBlock:^(NSString *field, NSString *value, BOOL *stop) {
+        [request setValue:value forHTTPHeaderField:field];
+    }];
+    [request setValue:@"text/plain; charset=utf-8" forHTTPHeaderField:@"Content-Type"];
+    [request setValue:@"gzip" forHTTPHeaderField:@"Content-Encoding"];
+    [request setValue:batchId forHTTPHeaderField:TLSLogShipperBatchIdHeaderField];
+
+    _queue_inFlight = YES;
+    const NSUInteger batchBytes = batch.length;
+    NSURLSessionDataTask *task = [[self _queue_session] dataTaskWithRequest:request
+                                                          completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
+        dispatch_async(self->_queue, ^{
+            self->_queue_inFlight = NO;
+
+            NSHTTPURLResponse *HTTPResponse = [response isKindOfClass:[NSHTTPURLResponse class]] ? (NSHTTPURLResponse *)response : nil;
+            const NSInteger statusCode = HTTPResponse.statusCode;
+            NSError *shipError = error;
+            if (!shipError && (statusCode < 200 || statusCode >= 300)) {
+                shipError = _ShipperError(EIO, @"the log shipping endpoint failed", @{ @"statusCode" : @(statusCode), @"batchId" : batchId });
+            }
+
+            if (shipError) {
+                [self _queue_didFailWithResponse:HTTPResponse];
+            } else {
+                [self _queue_didShipRange:batchRange batchBytes:batchBytes];
+            }
+            if (completion) {
+                completion(!shipError, shipError);
+            }
+
+            NSArray<dispatch_block_t> *blocks = [self->_queue_afterFlightBlocks copy];
+            [self->_queue_afterFlightBlocks removeAllObjects];
+            for (dispatch_block_t block in blocks) {
+                block();
+            }
+        });
+    }];
+    [task resume];
+}
+
+- (NSArray<TLSLogShipperRange *> *)_queue_pendingRanges
+{
+    NSMutableArray<TLSLogShipperRange *> *ranges = [[NSMutableArray alloc] init];
+    const long long cursorFileId = (_queue_cursorLogFileName) ? _LogFileId(_queue_cursorLogFileName, _logFilePrefix) : LLONG_MIN;
+    for (NSString *logFileName in _SortedLogFileNames(_logFileDirectoryPath, _logFilePrefix)) {
+        const long long fileId = _LogFileId(logFileName, _logFilePrefix);
+        const BOOL isCursorFile = [logFileName isEqualToString:_queue_cursorLogFileName];
+        if (fileId < cursorFileId || (fileId == cursorFileId && !isCursorFile && _queue_cursorLogFileName)) {
+            continue; // shipped (or pruned before we got to it)
+        }
+
+        struct stat fileStat;
+        if (stat([_logFileDirectoryPath stringByAppendingPathComponent:logFileName].fileSystemRepresentation, &fileStat) != 0) {
+            continue;
+        }
+
+        TLSLogShipperRange *range = [[TLSLogShipperRange alloc] init];
+        range.logFileName = logFileName;
+        range.startOffset = (isCursorFile) ? _queue_cursorOffset : 0;
+        range.endOffset = (unsigned long long)fileStat.st_size;
+        if (range.endOffset > range.startOffset) {
+            [ranges addObject:range];
+        }
+    }
+    return ranges;
+}
+
+- (nullable NSError *)_queue_budgetError
+{
+    const NSTimeInterval now = _Now();
+    if (now - _queue_budgetWindowStartTime >= kBudgetWindow) {
+        _queue_budgetWindowStartTime = now;
+        _queue_budgetBytes = 0;
+        _queue_budgetCPUTime = 0;
+    }
+
+    const NSUInteger networkBudget = self.networkBudgetBytesPerHour;
+    const NSTimeInterval CPUBudget = self.CPUBudgetPerHour;
+    if ((networkBudget > 0 && _queue_budgetBytes >= networkBudget) || (CPUBudget > 0 && _queue_budgetCPUTime >= CPUBudget)) {
+        return _ShipperError(EDQUOT, @"the log shipping budget is used up for this hour", @{ @"bytes" : @(_queue_budgetBytes), @"CPUTime" : @(_queue_budgetCPUTime) });
+    }
+    return nil;
+}
+
+- (void)_queue_didShipRange:(TLSLogShipperRange *)range
+                 batchBytes:(NSUInteger)batchBytes
+{
+    _queue_cursorLogFileName = [range.logFileName copy];
+    _queue_cursorOffset = range.endOffset;
+    _queue_lastShipTime = _Now();
+    _queue_nextAttemptTime = 0;
+    _queue_consecutiveFailureCount = 0;
+    atomic_fetch_add_explicit(&_shippedByteCount, batchBytes, memory_order_relaxed);
+    atomic_fetch_add_explicit(&_shippedBatchCount, 1, memory_order_relaxed);
+
+    NSDictionary *cursor = @{ kCursorLogFileNameKey : _queue_cursorLogFileName, kCursorOffsetKey : @(_queue_cursorOffset) };
+    NSData *cursorData = [NSPropertyListSerialization dataWithPropertyList:cursor
+                                                                    format:NSPropertyListBinaryFormat_v1_0
+                                                                   options:0
+                                                                     error:NULL];
+    // atomically, a torn cursor would ship everything again
+    (void)[cursorData writeToFile:_cursorFilePath options:NSDataWritingAtomic error:NULL];
+}
+
+- (void)_queue_didFailWithResponse:(nullable NSHTTPURLResponse *)response
+{
+    atomic_fetch_add_explicit(&_failedAttemptCount, 1, memory_order_relaxed);
+    _queue_consecutiveFailureCount++;
+
+    const NSTimeInterval minRetryInterval = MAX(self.minRetryInterval, 0.0);
+    const NSTimeInterval maxRetryInterval = MAX(self.maxRetryInterval, minRetryInterval);
+    NSTimeInterval backoff = MIN(minRetryInterval * pow(2.0, (double)MIN(_queue_consecutiveFailureCount - 1, (NSUInteger)32)), maxRetryInterval);
+    // jitter so that a fleet of devices doesn't retry in lock step
+    backoff *= 0.75 + 0.25 * ((double)arc4random_uniform(1001) / 1000.0);
+
+    const NSTimeInterval retryAfter = [[response valueForHTTPHeaderField:@"Retry-After"] doubleValue];
+    if (retryAfter > 0) {
+        backoff = MAX(backoff, MIN(retryAfter, maxRetryInterval));
+    }
+    _queue_nextAttemptTime = _Now() + backoff;
+}
+
+@end
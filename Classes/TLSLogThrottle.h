@@ -0,0 +1,71 @@
+//
+//  TLSLogThrottle.h
+//  TwitterLoggingService
+//
+//  Created on 10/18/26.
+//  Copyright (c) 2026 Twitter, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//          http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ Throttle for the log messages of a callsite, see `[TLSLoggingService setThrottle:forChannel:]` and
+ `[TLSLoggingService setThrottle:forCallsiteFile:line:]`.
+
+ A throttle is evaluated by `TLSCanLogCallsite` (used by the `TLSLog` macros) before the message is
+ formatted, so a suppressed message costs a couple of atomic operations on the callsite's counters.
+ Messages are first sampled (1 in `sampleInterval`) and the sampled messages are then rate limited with a
+ token bucket of `burst` tokens refilled at `maximumMessagesPerSecond`.
+
+ When a callsite's rate limiting suppression ends, a summary message is logged at the callsite
+ (e.g. `"suppressed 4,212 messages from Foo.m:88 in 10s"`).  Messages suppressed by sampling alone are
+ summarized at most once a minute, and every pending summary is logged on `[TLSLoggingService flush]`.
+ */
+@interface TLSLogThrottle : NSObject
+
+/** The sustained number of messages per second allowed, `0` for no rate limit */
+@property (nonatomic, readonly) double maximumMessagesPerSecond;
+/** The number of messages allowed at once before the rate limit applies.  Min is `1`. */
+@property (nonatomic, readonly) NSUInteger burst;
+/** Log `1` in every `sampleInterval` messages, `1` to log every message.  Min is `1`. */
+@property (nonatomic, readonly) NSUInteger sampleInterval;
+
+/**
+ Initialize a `TLSLogThrottle`
+ @param maximumMessagesPerSecond the sustained rate of messages, `0` for no rate limit
+ @param burst the number of messages allowed at once
+ @param sampleInterval the `N` of sampling `1` in `N` messages
+ */
+- (instancetype)initWithMaximumMessagesPerSecond:(double)maximumMessagesPerSecond
+                                           burst:(NSUInteger)burst
+                                  sampleInterval:(NSUInteger)sampleInterval NS_DESIGNATED_INITIALIZER;
+
+/** A rate limiting throttle */
++ (instancetype)throttleWithMaximumMessagesPerSecond:(double)maximumMessagesPerSecond
+                                               burst:(NSUInteger)burst;
+
+/** A sampling throttle */
++ (instancetype)throttleWithSampleInterval:(NSUInteger)sampleInterval;
+
+/** NS_UNAVAILABLE */
+- (instancetype)init NS_UNAVAILABLE;
+/** NS_UNAVAILABLE */
++ (instancetype)new NS_UNAVAILABLE;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,63 @@
+//
+//  TLSLogThrottle.m
+//  TwitterLoggingService
+//
+//  Created on 10/18/26.
+//  Copyright (c) 2026 Twitter, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//          http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+#import "TLSLogThrottle.h"
+
+@implementation TLSLogThrottle
+
+- (instancetype)initWithMaximumMessagesPerSecond:(double)maximumMessagesPerSecond
+                                           burst:(NSUInteger)burst
+                                  sampleInterval:(NSUInteger)sampleInterval
+{
+    if (self = [super init]) {
+        _maximumMessagesPerSecond = (maximumMessagesPerSecond > 0) ? maximumMessagesPerSecond : 0;
+        _burst = MAX(burst, (NSUInteger)1);
+        _sampleInterval = MAX(sampleInterval, (NSUInteger)1);
+    }
+    return self;
+}
+
++ (instancetype)throttleWithMaximumMessagesPerSecond:(double)maximumMessagesPerSecond
+                                               burst:(NSUInteger)burst
+{
+    return [[self alloc] initWithMaximumMessagesPerSecond:maximumMessagesPerSecond
+                                                    burst:burst
+                                           sampleInterval:1];
+}
+
++ (instancetype)throttleWithSampleInterval:(NSUInteger)sampleInterval
+{
+    return [[self alloc] initWithMaximumMessagesPerSecond:0
+                                                    burst:1
+                                           sampleInterval:sampleInterval];
+}
+
+- (instancetype)init
+{
+    [self doesNotRecognizeSelector:_cmd];
+    abort();
+}
+
+- (NSString *)description
+{
+    return [NSString stringWithFormat:@"<%@ %p: maximumMessagesPerSecond=%g, burst=%tu, sampleInterval=%tu>", NSStringFromClass([self class]), self, _maximumMessagesPerSecond, _burst, _sampleInterval];
+}
+
+@end
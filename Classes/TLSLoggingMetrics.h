@@ -0,0 +1,145 @@
+//
+//  TLSLoggingMetrics.h
+//  TwitterLoggingService
+//
+//  Created on 10/18/26.
+//  Copyright (c) 2026 Twitter, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//          http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+#import <Foundation/Foundation.h>
+
+@protocol TLSOutputStream;
+
+NS_ASSUME_NONNULL_BEGIN
+
+//! The number of buckets of a `TLSLoggingHistogram`
+#define TLSLoggingHistogramBucketCount (32)
+
+/**
+ Snapshot of a histogram of durations, see `TLSLoggingMetrics`.
+
+ Bucket `0` counts durations under 1 microsecond and bucket `i` counts the durations from `2^(i-1)` up
+ to `2^i` microseconds, the last bucket also counting everything longer.
+ */
+@interface TLSLoggingHistogram : NSObject
+
+/** The number of recorded durations */
+@property (nonatomic, readonly) uint64_t count;
+/** The sum of the recorded durations */
+@property (nonatomic, readonly) NSTimeInterval totalDuration;
+/** The mean of the recorded durations, `0` when there are none */
+@property (nonatomic, readonly) NSTimeInterval averageDuration;
+
+/** The number of recorded durations in the bucket at _index_ (`0` to `TLSLoggingHistogramBucketCount - 1`) */
+- (uint64_t)countForBucketAtIndex:(NSUInteger)index;
+
+/** The (exclusive) upper bound of the durations counted by the bucket at _index_ */
++ (NSTimeInterval)upperBoundForBucketAtIndex:(NSUInteger)index;
+
+/**
+ An estimate of the duration at the _percentile_ (`0.0` to `1.0`): the upper bound of the bucket it falls in.
+ `0` when there are no recorded durations.
+ */
+- (NSTimeInterval)durationAtPercentile:(double)percentile;
+
+/** NS_UNAVAILABLE */
+- (instancetype)init NS_UNAVAILABLE;
+/** NS_UNAVAILABLE */
++ (instancetype)new NS_UNAVAILABLE;
+
+@end
+
+/**
+ Snapshot of the metrics of a single `TLSOutputStream` of a `TLSLoggingService`
+ */
+@interface TLSOutputStreamMetrics : NSObject
+
+/** The output stream */
+@property (nonatomic, readonly) id<TLSOutputStream> stream;
+/** The number of log messages output to the stream */
+@property (nonatomic, readonly) uint64_t outputCount;
+/** The number of log messages the stream filtered (see `TLSFiltering`) */
+@property (nonatomic, readonly) uint64_t filteredCount;
+/** The number of log messages dropped for not fitting in the buffer of the stream once isolated */
+@property (nonatomic, readonly) uint64_t droppedCount;
+/** Whether the stream was isolated for exceeding the `outputStreamLatencyBudget` of the service */
+@property (nonatomic, readonly, getter=isIsolated) BOOL isolated;
+/** The time spent in `tls_outputLogInfo:` of the stream */
+@property (nonatomic, readonly) TLSLoggingHistogram *outputDuration;
+/** The stream's own counters (see `[TLSOutputStream tls_metricCounters]`), empty if the stream has none */
+@property (nonatomic, readonly, copy) NSDictionary<NSString *, NSNumber *> *counters;
+
+/** NS_UNAVAILABLE */
+- (instancetype)init NS_UNAVAILABLE;
+/** NS_UNAVAILABLE */
++ (instancetype)new NS_UNAVAILABLE;
+
+@end
+
+/**
+ Snapshot of the metrics of a `TLSLoggingService`, see `[TLSLoggingService metricsSnapshot]`.
+
+ The counters accumulate for the lifetime of the service, compare two snapshots for rates.
+ Each value is read on its own without stopping the pipeline, so values of an active service can be
+ slightly out of step with one another.
+ */
+@interface TLSLoggingMetrics : NSObject
+
+/** When the snapshot was taken */
+@property (nonatomic, readonly) NSDate *timestamp;
+
+/** The number of `TLSCanLog` checks that returned `NO` */
+@property (nonatomic, readonly) uint64_t canLogFilteredCount;
+/** The number of log messages suppressed by a `TLSLogThrottle` */
+@property (nonatomic, readonly) uint64_t throttledCount;
+/** The number of log messages shed while the service was behind (see `loadSheddingBacklogThreshold`) */
+@property (nonatomic, readonly) uint64_t shedCount;
+/** The number of log messages submitted to the service */
+@property (nonatomic, readonly) uint64_t submittedCount;
+/** The number of submitted log messages discarded for exceeding `maximumSafeMessageLength`, the `contextSnapshotByteBudget` or for having no output streams */
+@property (nonatomic, readonly) uint64_t droppedCount;
+/** The number of submitted log messages held back as repeats (see `repeatedMessageCoalescingInterval`) */
+@property (nonatomic, readonly) uint64_t coalescedCount;
+/** The number of log messages filtered by every output stream */
+@property (nonatomic, readonly) uint64_t streamFilteredCount;
+/** The number of log messages output to at least one output stream */
+@property (nonatomic, readonly) uint64_t outputCount;
+
+/** The `TLSLogContextSnapshot`s held by the service's log messages (in the queues, output streams and elsewhere), see `TLSLogContextSnapshotting` */
+@property (nonatomic, readonly) uint64_t contextSnapshotCount;
+/** The sum of the `byteCost` of the `contextSnapshotCount` snapshots */
+@property (nonatomic, readonly) uint64_t contextSnapshotByteCost;
+/** The number of context snapshots that exceeded the `contextSnapshotByteBudget` (replaced with a minimal snapshot, or dropped with their log message) */
+@property (nonatomic, readonly) uint64_t contextSnapshotDroppedCount;
+
+/** The number of transactions (such as log messages) waiting on the transaction queue */
+@property (nonatomic, readonly) NSUInteger transactionQueueDepth;
+/** The number of log messages waiting on the logging queue */
+@property (nonatomic, readonly) NSUInteger loggingQueueDepth;
+
+/** The time between a log message being submitted and the transaction queue picking it up */
+@property (nonatomic, readonly) TLSLoggingHistogram *transactionLatency;
+
+/** The metrics of each output stream */
+@property (nonatomic, readonly, copy) NSArray<TLSOutputStreamMetrics *> *streamMetrics;
+
+/** NS_UNAVAILABLE */
+- (instancetype)init NS_UNAVAILABLE;
+/** NS_UNAVAILABLE */
++ (instancetype)new NS_UNAVAILABLE;
+
+@end
+
+NS_ASSUME_NONNULL_END
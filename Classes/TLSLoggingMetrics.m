@@ -0,0 +1,339 @@
+//
+//  TLSLoggingMetrics.m
+//  TwitterLoggingService
+//
+//  Created on 10/18/26.
+//  Copyright (c) 2026 Twitter, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//          http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+#import <TwitterLoggingService/TLSProtocols.h>
+#import "TLSLoggingMetricsRecorder.h"
+
+NSString * const TLSOutputStreamMetricBytesWritten = @"bytesWritten";
+NSString * const TLSOutputStreamMetricBytesDropped = @"bytesDropped";
+NSString * const TLSOutputStreamMetricFlushes = @"flushes";
+NSString * const TLSOutputStreamMetricSyncs = @"syncs";
+NSString * const TLSOutputStreamMetricRollovers = @"rollovers";
+NSString * const TLSOutputStreamMetricPurges = @"purges";
+
+@interface TLSLoggingHistogram ()
+- (instancetype)initWithBuckets:(const uint64_t *)buckets
+                totalNanoseconds:(uint64_t)totalNanoseconds NS_DESIGNATED_INITIALIZER;
+@end
+
+@interface TLSOutputStreamMetrics ()
+- (instancetype)initWithStream:(id<TLSOutputStream>)stream
+                 filteredCount:(uint64_t)filteredCount
+                  droppedCount:(uint64_t)droppedCount
+                      isolated:(BOOL)isolated
+                outputDuration:(TLSLoggingHistogram *)outputDuration
+                      counters:(NSDictionary<NSString *, NSNumber *> *)counters NS_DESIGNATED_INITIALIZER;
+@end
+
+@interface TLSLoggingMetrics ()
+@property (nonatomic, readwrite) uint64_t canLogFilteredCount;
+@property (nonatomic, readwrite) uint64_t throttledCount;
+@property (nonatomic, readwrite) uint64_t shedCount;
+@property (nonatomic, readwrite) uint64_t submittedCount;
+@property (nonatomic, readwrite) uint64_t droppedCount;
+@property (nonatomic, readwrite) uint64_t coalescedCount;
+@property (nonatomic, readwrite) uint64_t streamFilteredCount;
+@property (nonatomic, readwrite) uint64_t outputCount;
+@property (nonatomic, readwrite) uint64_t contextSnapshotCount;
+@property (nonatomic, readwrite) uint64_t contextSnapshotByteCost;
+@property (nonatomic, readwrite) uint64_t contextSnapshotDroppedCount;
+@property (nonatomic, readwrite) NSUInteger transactionQueueDepth;
+@property (nonatomic, readwrite) NSUInteger loggingQueueDepth;
+- (instancetype)initWithTransactionLatency:(TLSLoggingHistogram *)transactionLatency
+                             streamMetrics:(NSArray<TLSOutputStreamMetrics *> *)streamMetrics NS_DESIGNATED_INITIALIZER;
+@end
+
+@implementation TLSLoggingHistogram
+{
+    uint64_t _buckets[TLSLoggingHistogramBucketCount];
+}
+
+- (instancetype)initWithBuckets:(const uint64_t *)buckets
+               totalNanoseconds:(uint64_t)totalNanoseconds
+{
+    if (self = [super init]) {
+        for (NSUInteger i = 0; i < TLSLoggingHistogramBucketCount; i++) {
+            _buckets[i] = buckets[i];
+            _count += buckets[i];
+        }
+        _totalDuration = (NSTimeInterval)totalNanoseconds / (NSTimeInterval)NSEC_PER_SEC;
+    }
+    return self;
+}
+
+- (instancetype)init
+{
+    [self doesNotRecognizeSelector:_cmd];
+    abort();
+}
+
+- (NSTimeInterval)averageDuration
+{
+    return (_count > 0) ? _totalDuration / (NSTimeInterval)_count : 0;
+}
+
+- (uint64_t)countForBucketAtIndex:(NSUInteger)index
+{
+    return (index < TLSLoggingHistogramBucketCount) ? _buckets[index] : 0;
+}
+
++ (NSTimeInterval)upperBoundForBucketAtIndex:(NSUInteger)index
+{
+    index = MIN(index, (NSUInteger)(TLSLoggingHistogramBucketCount - 1));
+    return (NSTimeInterval)(1ULL << index) / (NSTimeInterval)USEC_PER_SEC;
+}
+
+- (NSTimeInterval)durationAtPercentile:(double)percentile
+{
+    if (0 == _count) {
+        return 0;
+    }
+
+    percentile = (percentile > 0) ? MIN(percentile, 1.0) : 0;
+    const uint64_t rank = MAX((uint64_t)ceil(percentile * (double)_count), (uint64_t)1);
+    uint64_t cumulativeCount = 0;
+    NSUInteger index = 0;
+    for (; index < TLSLoggingHistogramBucketCount - 1; index++) {
+        cumulativeCount += _buckets[index];
+        if (cumulativeCount >= rank) {
+            break;
+        }
+    }
+    return [[self class] upperBoundForBucketAtIndex:index];
+}
+
+- (NSString *)description
+{
+    return [NSString stringWithFormat:@"<%@ %p: count=%llu, average=%.3fms, p50=%.3fms, p99=%.3fms>", NSStringFromClass([self class]), self, _count, self.averageDuration * 1000., [self durationAtPercentile:0.5] * 1000., [self durationAtPercentile:0.99] * 1000.];
+}
+
+@end
+
+@implementation TLSOutputStreamMetrics
+
+- (instancetype)initWithStream:(id<TLSOutputStream>)stream
+                 filteredCount:(uint64_t)filteredCount
+                  droppedCount:(uint64_t)droppedCount
+                      isolated:(BOOL)isolated
+                outputDuration:(TLSLoggingHistogram *)outputDuration
+                      counters:(NSDictionary<NSString *, NSNumber *> *)counters
+{
+    if (self = [super init]) {
+        _stream = stream;
+        _outputCount = outputDuration.count;
+        _filteredCount = filteredCount;
+        _droppedCount = droppedCount;
+        _isolated = isolated;
+        _outputDuration = outputDuration;
+        _counters = [counters copy];
+    }
+    return self;
+}
+
+- (instancetype)init
+{
+    [self doesNotRecognizeSelector:_cmd];
+    abort();
+}
+
+- (NSString *)description
+{
+    return [NSString stringWithFormat:@"<%@ %p: stream=%@, outputCount=%llu, filteredCount=%llu, droppedCount=%llu, isolated=%@, outputDuration=%@, counters=%@>", NSStringFromClass([self class]), self, _stream, _outputCount, _filteredCount, _droppedCount, _isolated ? @"YES" : @"NO", _outputDuration, _counters];
+}
+
+@end
+
+@implementation TLSLoggingMetrics
+
+- (instancetype)initWithTransactionLatency:(TLSLoggingHistogram *)transactionLatency
+                             streamMetrics:(NSArray<TLSOutputStreamMetrics *> *)streamMetrics
+{
+    if (self = [super init]) {
+        _timestamp = [NSDate date];
+        _transactionLatency = transactionLatency;
+        _streamMetrics = [streamMetrics copy];
+    }
+    return self;
+}
+
+- (instancetype)init
+{
+    [self doesNotRecognizeSelector:_cmd];
+    abort();
+}
+
+- (NSString *)description
+{
+    return [NSString stringWithFormat:@"<%@ %p: submitted=%llu, output=%llu, canLogFiltered=%llu, throttled=%llu, shed=%llu, dropped=%llu, coalesced=%llu, streamFiltered=%llu, contextSnapshots=%llu, contextSnapshotByteCost=%llu, contextSnapshotDropped=%llu, transactionQueueDepth=%tu, loggingQueueDepth=%tu, transactionLatency=%@, streamMetrics=%@>", NSStringFromClass([self class]), self, _submittedCount, _outputCount, _canLogFilteredCount, _throttledCount, _shedCount, _droppedCount, _coalescedCount, _streamFilteredCount, _contextSnapshotCount, _contextSnapshotByteCost, _contextSnapshotDroppedCount, _transactionQueueDepth, _loggingQueueDepth, _transactionLatency, _streamMetrics];
+}
+
+@end
+
+@implementation TLSLogContextSnapshotLedger
+{
+    atomic_ullong _byteCost;
+    atomic_ullong _count;
+    atomic_ullong _droppedCount;
+}
+
+- (uint64_t)byteCost
+{
+    return atomic_load_explicit(&_byteCost, memory_order_relaxed);
+}
+
+- (uint64_t)count
+{
+    return atomic_load_explicit(&_count, memory_order_relaxed);
+}
+
+- (uint64_t)droppedCount
+{
+    return atomic_load_explicit(&_droppedCount, memory_order_relaxed);
+}
+
+- (BOOL)reserveByteCost:(NSUInteger)byteCost budget:(NSUInteger)budget
+{
+    uint64_t current = atomic_load_explicit(&_byteCost, memory_order_relaxed);
+    do {
+        if (budget > 0 && current + byteCost > budget) {
+            TLSMetricsIncrement(&_droppedCount);
+            return NO;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&_byteCost, &current, current + byteCost, memory_order_relaxed, memory_order_relaxed));
+    TLSMetricsIncrement(&_count);
+    return YES;
+}
+
+- (void)releaseByteCost:(NSUInteger)byteCost
+{
+    atomic_fetch_sub_explicit(&_byteCost, byteCost, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&_count, 1, memory_order_relaxed);
+}
+
+@end
+
+// outputs before the moving average of a stream's output duration is meaningful
+#define kAverageOutputDurationMinimumCount (8)
+
+@implementation TLSOutputStreamMetricsRecorder
+{
+    atomic_ullong _filteredCount;
+    atomic_ullong _droppedCount;
+    atomic_bool _isolated;
+    TLSHistogramRecorder _outputDuration;
+
+    // logging queue only
+    uint64_t _averageOutputNanoseconds;
+    NSUInteger _averageOutputCount;
+}
+
+- (instancetype)initWithStream:(id<TLSOutputStream>)stream
+{
+    if (self = [super init]) {
+        _stream = stream;
+    }
+    return self;
+}
+
+- (instancetype)init
+{
+    [self doesNotRecognizeSelector:_cmd];
+    abort();
+}
+
+- (void)recordFiltered
+{
+    TLSMetricsIncrement(&_filteredCount);
+}
+
+- (void)recordDropped
+{
+    TLSMetricsIncrement(&_droppedCount);
+}
+
+- (void)recordIsolated
+{
+    atomic_store_explicit(&_isolated, true, memory_order_relaxed);
+}
+
+- (void)recordOutputDuration:(uint64_t)nanoseconds
+{
+    TLSHistogramRecord(&_outputDuration, nanoseconds);
+}
+
+- (uint64_t)updateAverageOutputDuration:(uint64_t)nanoseconds
+{
+    // exponentially weighted (1/8) so a single hiccup doesn't count for much but a slow streak does
+    if (0 == _averageOutputCount++) {
+        _averageOutputNanoseconds = nanoseconds;
+    } else {
+        _averageOutputNanoseconds = ((_averageOutputNanoseconds * 7) + nanoseconds) / 8;
+    }
+    return (_averageOutputCount >= kAverageOutputDurationMinimumCount) ? _averageOutputNanoseconds : 0;
+}
+
+- (TLSOutputStreamMetrics *)snapshot
+{
+    NSDictionary<NSString *, NSNumber *> *counters = nil;
+    if ([_stream respondsToSelector:@selector(tls_metricCounters)]) {
+        counters = [_stream tls_metricCounters];
+    }
+    return [[TLSOutputStreamMetrics alloc] initWithStream:_stream
+                                            filteredCount:atomic_load_explicit(&_filteredCount, memory_order_relaxed)
+                                             droppedCount:atomic_load_explicit(&_droppedCount, memory_order_relaxed)
+                                                 isolated:atomic_load_explicit(&_isolated, memory_order_relaxed)
+                                           outputDuration:TLSHistogramSnapshot(&_outputDuration)
+                                                 counters:counters ?: @{}];
+}
+
+@end
+
+TLSLoggingHistogram *TLSHistogramSnapshot(TLSHistogramRecorder *histogram)
+{
+    uint64_t buckets[TLSLoggingHistogramBucketCount];
+    for (NSUInteger i = 0; i < TLSLoggingHistogramBucketCount; i++) {
+        buckets[i] = atomic_load_explicit(&histogram->buckets[i], memory_order_relaxed);
+    }
+    return [[TLSLoggingHistogram alloc] initWithBuckets:buckets
+                                       totalNanoseconds:atomic_load_explicit(&histogram->totalNanoseconds, memory_order_relaxed)];
+}
+
+TLSLoggingMetrics *TLSLoggingMetricsSnapshot(TLSLoggingMetricsCounters *counters,
+                                             TLSLogContextSnapshotLedger *contextSnapshotLedger,
+                                             NSUInteger loggingQueueDepth,
+                                             NSArray<TLSOutputStreamMetrics *> *streamMetrics)
+{
+    TLSLoggingMetrics *metrics = [[TLSLoggingMetrics alloc] initWithTransactionLatency:TLSHistogramSnapshot(&counters->transactionLatency)
+                                                                         streamMetrics:streamMetrics];
+    metrics.canLogFilteredCount = atomic_load_explicit(&counters->canLogFilteredCount, memory_order_relaxed);
+    metrics.throttledCount = atomic_load_explicit(&counters->throttledCount, memory_order_relaxed);
+    metrics.shedCount = atomic_load_explicit(&counters->shedCount, memory_order_relaxed);
+    metrics.submittedCount = atomic_load_explicit(&counters->submittedCount, memory_order_relaxed);
+    metrics.droppedCount = atomic_load_explicit(&counters->droppedCount, memory_order_relaxed);
+    metrics.coalescedCount = atomic_load_explicit(&counters->coalescedCount, memory_order_relaxed);
+    metrics.streamFilteredCount = atomic_load_explicit(&counters->streamFilteredCount, memory_order_relaxed);
+    metrics.outputCount = atomic_load_explicit(&counters->outputCount, memory_order_relaxed);
+    metrics.contextSnapshotCount = contextSnapshotLedger.count;
+    metrics.contextSnapshotByteCost = contextSnapshotLedger.byteCost;
+    metrics.contextSnapshotDroppedCount = contextSnapshotLedger.droppedCount;
+    metrics.transactionQueueDepth = atomic_load_explicit(&counters->transactionQueueDepth, memory_order_relaxed);
+    metrics.loggingQueueDepth = loggingQueueDepth;
+    return metrics;
+}
@@ -0,0 +1,139 @@
+//
+//  TLSLoggingMetricsRecorder.h
+//  TwitterLoggingService
+//
+//  Created on 10/18/26.
+//  Copyright (c) 2026 Twitter, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//          http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+/* This header is private to Twitter Logging Service */
+
+#include <stdatomic.h>
+#import <TwitterLoggingService/TLSLoggingMetrics.h>
+#import "TLS_Project.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ Lock free histogram of durations, the recording side of `TLSLoggingHistogram`.
+ Zero initialized memory is an empty histogram.
+ */
+typedef struct TLSHistogramRecorder {
+    atomic_ullong totalNanoseconds;
+    atomic_ullong buckets[TLSLoggingHistogramBucketCount];
+} TLSHistogramRecorder;
+
+/**
+ Lock free counters of a `TLSLoggingService`, the recording side of `TLSLoggingMetrics`.
+ Zero initialized memory is a set of zeroed counters.
+ */
+typedef struct TLSLoggingMetricsCounters {
+    atomic_ullong canLogFilteredCount;
+    atomic_ullong throttledCount;
+    atomic_ullong shedCount;
+    atomic_ullong submittedCount;
+    atomic_ullong droppedCount;
+    atomic_ullong coalescedCount;
+    atomic_ullong streamFilteredCount;
+    atomic_ullong outputCount;
+    atomic_uint transactionQueueDepth;
+    TLSHistogramRecorder transactionLatency;
+} TLSLoggingMetricsCounters;
+
+//! Increment a metrics _counter_, relaxed since counters order nothing
+NS_INLINE void TLSMetricsIncrement(atomic_ullong *counter)
+{
+    atomic_fetch_add_explicit(counter, 1, memory_order_relaxed);
+}
+
+//! Add _count_ to a metrics _counter_
+NS_INLINE void TLSMetricsAdd(atomic_ullong *counter, uint64_t count)
+{
+    atomic_fetch_add_explicit(counter, count, memory_order_relaxed);
+}
+
+//! The `TLSLoggingHistogram` bucket of a duration
+NS_INLINE NSUInteger TLSHistogramBucketIndex(uint64_t nanoseconds)
+{
+    const uint64_t microseconds = nanoseconds / NSEC_PER_USEC;
+    if (0 == microseconds) {
+        return 0;
+    }
+    return MIN((NSUInteger)(64 - __builtin_clzll(microseconds)), (NSUInteger)(TLSLoggingHistogramBucketCount - 1));
+}
+
+//! Record a duration in the _histogram_
+NS_INLINE void TLSHistogramRecord(TLSHistogramRecorder *histogram, uint64_t nanoseconds)
+{
+    atomic_fetch_add_explicit(&histogram->totalNanoseconds, nanoseconds, memory_order_relaxed);
+    atomic_fetch_add_explicit(&histogram->buckets[TLSHistogramBucketIndex(nanoseconds)], 1, memory_order_relaxed);
+}
+
+//! Snapshot the _histogram_
+FOUNDATION_EXTERN TLSLoggingHistogram *TLSHistogramSnapshot(TLSHistogramRecorder *histogram);
+
+/**
+ The context snapshots (see `TLSLogContextSnapshotting`) held by the log messages of a `TLSLoggingService`.
+ Retained by each accounted `TLSLogContextSnapshot` so that it outlives them, thread safe.
+ */
+TLS_OBJC_FINAL
+@interface TLSLogContextSnapshotLedger : NSObject
+
+@property (atomic, readonly) uint64_t byteCost;
+@property (atomic, readonly) uint64_t count;
+@property (atomic, readonly) uint64_t droppedCount;
+
+/** Reserve the _byteCost_ of a snapshot, `NO` (and counted as dropped) if it would exceed the _budget_ (`0` for no budget) */
+- (BOOL)reserveByteCost:(NSUInteger)byteCost budget:(NSUInteger)budget;
+/** Release the _byteCost_ of a deallocated snapshot */
+- (void)releaseByteCost:(NSUInteger)byteCost;
+
+@end
+
+//! Snapshot the _counters_
+FOUNDATION_EXTERN TLSLoggingMetrics *TLSLoggingMetricsSnapshot(TLSLoggingMetricsCounters *counters,
+                                                              TLSLogContextSnapshotLedger *contextSnapshotLedger,
+                                                              NSUInteger loggingQueueDepth,
+                                                              NSArray<TLSOutputStreamMetrics *> *streamMetrics);
+
+/**
+ The recording side of `TLSOutputStreamMetrics`.
+ Recorded from the transaction queue (filtering) and the logging queue (output), snapshot from any queue.
+ */
+TLS_OBJC_FINAL
+@interface TLSOutputStreamMetricsRecorder : NSObject
+
+@property (nonatomic, readonly) id<TLSOutputStream> stream;
+
+- (instancetype)initWithStream:(id<TLSOutputStream>)stream NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+- (void)recordFiltered;
+- (void)recordDropped;
+- (void)recordIsolated;
+- (void)recordOutputDuration:(uint64_t)nanoseconds;
+- (TLSOutputStreamMetrics *)snapshot;
+
+/**
+ Fold the _nanoseconds_ of an output into the moving average of the stream's output duration.
+ Logging queue only.
+ @return the moving average, `0` until there have been enough outputs for it to be meaningful
+ */
+- (uint64_t)updateAverageOutputDuration:(uint64_t)nanoseconds;
+
+@end
+
+NS_ASSUME_NONNULL_END
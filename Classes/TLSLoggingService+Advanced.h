@@ -17,11 +17,14 @@
 //  See the License for the specific language governing permissions and
 //  limitations under the License.
 
+#import <TwitterLoggingService/TLSLoggingMetrics.h>
 #import <TwitterLoggingService/TLSLoggingService.h>
 
 NS_ASSUME_NONNULL_BEGIN
 
 @protocol TLSLoggingServiceDelegate;
+@class TLSLogRedactor;
+@class TLSLogThrottle;
 
 @interface TLSLoggingService (Advanced)
 
@@ -39,6 +42,101 @@ NS_ASSUME_NONNULL_BEGIN
  */
 @property (nonatomic, readwrite) NSUInteger maximumSafeMessageLength;
 
+/**
+ the maximum length of a log message in UTF-8 bytes.
+ Messages are formatted with a bounded formatter that stops producing output at the limit, without
+ splitting code points, and ends truncated messages with `TLSLogMessageTruncationMarker`.
+ Unlike `maximumSafeMessageLength`, an oversized message is never built in full so logging a huge
+ payload costs the limit and not the payload.
+ Applied before `maximumSafeMessageLength`.
+ `0` means no maximum.
+
+ Default == `0`
+ */
+@property (nonatomic, readwrite) NSUInteger maximumMessageByteLength;
+
+/**
+ Coalesce consecutive identical log messages of a channel (same level, callsite and message).
+ Repeats are held back and replaced with a single `"last message repeated N times"` message, logged when
+ the run of repeats ends, on `flush` or at the latest `repeatedMessageCoalescingInterval` seconds after
+ the first repeat was held back.  Once summarized, the next occurrence of the message is logged again.
+ `0` means no coalescing.
+
+ Default == `0`
+ */
+@property (atomic, readwrite) NSTimeInterval repeatedMessageCoalescingInterval;
+
+/**
+ Give log messages of `TLSLogLevelWarning` and above a lane of their own to the output streams, ahead of
+ the backlog of lower level log messages waiting to be output.
+ Without it, a warning or error logged during a storm of lower level log messages waits behind all of
+ them, and is lost if the process crashes in the meantime.
+ Log messages are output out of order with it, `[TLSLogMessageInfo sequenceNumber]` keeps the order they
+ were logged in (see `TLSComposeLogMessageInfoLogSequenceNumber`).
+ `flush` drains the priority lane first.
+
+ Default == `NO`
+ */
+@property (atomic, readwrite, getter=isPriorityLaneEnabled) BOOL priorityLaneEnabled;
+
+/**
+ The time budget of a single `tls_outputLogInfo:` of an output stream.
+ Every output stream shares the logging queue, so a slow output stream delays the output of all of them.
+ An output stream whose moving average time per `tls_outputLogInfo:` exceeds the budget is isolated:
+ it is moved to a queue of its own with a buffer of `isolatedOutputStreamBufferCount` log messages,
+ log messages that don't fit in the buffer are dropped for that stream (see `TLSOutputStreamMetrics`)
+ and the delegate is notified with `tls_loggingService:didIsolateOutputStream:averageOutputDuration:`.
+ An isolated output stream stays isolated until it is removed.
+ `flush` waits for isolated output streams to output their buffered log messages, whether or not they implement `tls_flush`.
+ `0` means no budget.
+
+ Default == `0`
+ */
+@property (atomic, readwrite) NSTimeInterval outputStreamLatencyBudget;
+
+/**
+ The number of log messages an isolated output stream can fall behind by before its log messages are dropped.
+ See `outputStreamLatencyBudget`.  Min is `1`.
+
+ Default == `1024`
+ */
+@property (atomic, readwrite) NSUInteger isolatedOutputStreamBufferCount;
+
+/**
+ The backlog of log messages, waiting on the transaction queue and the logging queue, at which the
+ service starts shedding log messages less severe than `loadSheddingLevel`.
+ While shedding, `TLSCanLog` returns `NO` for those levels so the logging thread doesn't even format
+ the log message, keeping the cost of logging on the caller's thread flat while the output streams catch up.
+ Shedding ends once the backlog drains to a quarter of the threshold.
+ Both transitions are logged to `TLSLoggingServiceChannel`, with the backlog and the rate it drained at,
+ and shed log messages are counted in `[TLSLoggingMetrics shedCount]`.
+ `0` means no shedding.
+
+ Default == `0`
+ */
+@property (atomic, readwrite) NSUInteger loadSheddingBacklogThreshold;
+
+/**
+ The least severe level that is still logged while shedding, see `loadSheddingBacklogThreshold`.
+
+ Default == `TLSLogLevelWarning`
+ */
+@property (atomic, readwrite) TLSLogLevel loadSheddingLevel;
+
+/**
+ The budget, in bytes, for the `TLSLogContextSnapshot`s held by the service's log messages (see `TLSLogContextSnapshotting`).
+ A log message whose context snapshot would exceed the budget is logged with a minimal snapshot instead
+ (only the `objectClassName` and `filterKey`, so output streams still filter it), or dropped (counted in
+ `[TLSLoggingMetrics droppedCount]`) when that would exceed the budget too.
+ Each snapshot over budget is counted in `[TLSLoggingMetrics contextSnapshotDroppedCount]`.
+ The snapshots are accounted for (`[TLSLoggingMetrics contextSnapshotByteCost]`) for as long as they live,
+ which includes the time their log messages wait in the queues and are held by output streams.
+ `0` means no budget.
+
+ Default == `0`
+ */
+@property (atomic, readwrite) NSUInteger contextSnapshotByteBudget;
+
 /**
  The time that the `TLSLoggingService` was initialized for convenience.
  */
@@ -48,6 +146,90 @@ NS_ASSUME_NONNULL_BEGIN
  */
 @property (atomic, nonnull, readonly) NSSet<id<TLSOutputStream>> *outputStreams;
 
+/**
+ Capture log messages while output streams are not added yet, so that building output streams (which
+ can mean file system work) can be moved off of the launch path.
+
+ Begin the capture as early as possible (e.g. in `main`), it costs no more than holding on to the captured
+ log messages.  The first _capacity_ log messages are captured, with or without output streams, and
+ replayed (with their original timestamps and filtered as usual) to each output stream as it is added.
+ An output stream that is removed and added again is only replayed the log messages captured while it was removed.
+ Capture stops once full, the captured log messages are held for replay until `endLaunchCapture`.
+ @param capacity the maximum number of log messages to capture
+ */
+- (void)beginLaunchCaptureWithCapacity:(NSUInteger)capacity;
+
+/**
+ End the capture started with `beginLaunchCaptureWithCapacity:` and release the captured log messages.
+ Call once every output stream that should see the launch log messages has been added.
+ */
+- (void)endLaunchCapture;
+
+/**
+ Begin capturing a trace of the logging calls made to the service, to replay a real workload against
+ any setup of output streams (see `TLSWorkloadTrace` and the `replay` benchmark of `TwitterLoggingServiceBenchmarks`).
+
+ Each call is captured with its time, thread, callsite, level, channel, formatted message length and
+ whether it was filtered; the message itself is never captured.  Filtered calls are captured for the
+ `TLSLog` macros (see `TLSCanLogCallsite`) and for log messages shed under load.
+ Capturing adds to the cost of every logging call, it is not meant to be left on.
+ A capture already in progress is ended first.
+ @param filePath the path of the trace file to write (replaced if it exists)
+ @param errorOut an output reference to get any errors that occur while creating the trace file.  If there is an error, the return value will be `NO`.
+ */
+- (BOOL)beginWorkloadCaptureToFilePath:(NSString *)filePath
+                                 error:(out NSError * __nullable __autoreleasing * __nullable)errorOut;
+
+/**
+ End the capture started with `beginWorkloadCaptureToFilePath:error:` and close its trace file.
+ */
+- (void)endWorkloadCapture;
+
+/**
+ Log a message that was built outside of the service, such as a log message of another process
+ delivered by a `TLSSharedMemoryLogDrain`.
+ The _info_ is output as is (keeping its timestamp, thread and `processIdentifier`), after being
+ capped (`maximumMessageByteLength` then `maximumSafeMessageLength`), filtered and coalesced like
+ any other log message.  A copy of the _info_ is output, carrying the next `sequenceNumber` and the
+ snapshot of its `contextObject` (see `TLSLogContextSnapshotting`), the _info_ itself is not modified.
+ @param info the log message, not yet output by any service
+ */
+- (void)logMessageInfo:(TLSLogMessageInfo *)info;
+
+/**
+ Log a batch of messages that were built outside of the service, in order, see `logMessageInfo:`.
+ The batch is handed to the transaction queue at once, which is cheaper than 1 at a time.
+ @param infos the log messages, not yet output by any service
+ */
+- (void)logMessageInfos:(NSArray<TLSLogMessageInfo *> *)infos;
+
+/**
+ Throttle the messages of every callsite logging to the _channel_.
+ Each callsite is throttled on its own, a noisy callsite does not suppress the others in its channel.
+ Only messages logged with the `TLSLog` macros (which identify their callsite) are throttled.
+ @param throttle the `TLSLogThrottle` to apply, `nil` to stop throttling the _channel_
+ @param channel the channel to throttle
+ */
+- (void)setThrottle:(nullable TLSLogThrottle *)throttle forChannel:(NSString *)channel;
+
+/**
+ Throttle the messages of a single callsite, takes precedence over the throttle of the callsite's channel.
+ @param throttle the `TLSLogThrottle` to apply, `nil` to stop throttling the callsite
+ @param file the file name of the callsite (e.g. `@"Foo.m"`)
+ @param line the line of the callsite
+ */
+- (void)setThrottle:(nullable TLSLogThrottle *)throttle forCallsiteFile:(NSString *)file line:(NSInteger)line;
+
+/**
+ Redact the messages output to the _stream_, from the messages logged after this call on.
+ The _stream_ is given a copy of each `TLSLogMessageInfo` with the `message` and the `TLSLogFieldTypeString` field values redacted
+ and without the payload, which is binary and cannot be redacted (or the original when there is nothing to redact and no payload).
+ Each message is redacted once per redactor, output streams sharing a redactor share the redacted copy.
+ @param redactor the `TLSLogRedactor` to apply, `nil` to stop redacting the _stream_
+ @param stream the output stream to redact the messages of
+ */
+- (void)setRedactor:(nullable TLSLogRedactor *)redactor forOutputStream:(id<TLSOutputStream>)stream;
+
 /**
  Call this when any of the results of a `TLSOutputStream`'s `TLSFiltering` methods change.
  If `TLSCANLOGMODE` is not `1` this is a no-op.
@@ -59,7 +241,8 @@ NS_ASSUME_NONNULL_BEGIN
 - (void)removeOutputStream:(id<TLSOutputStream>)stream;
 
 /**
- synchronously flushes all internal queues and calls flush on all `TLSOutputStream`s that implement `flush`
+ synchronously flushes all internal queues and calls flush on all `TLSOutputStream`s that implement `flush`.
+ Callsites with suppressed messages (see `TLSLogThrottle`) log their summary first.
  */
 - (void)flush;
 
@@ -85,8 +268,47 @@ NS_ASSUME_NONNULL_BEGIN
 - (nullable NSData *)retrieveLoggedDataFromOutputStream:(id<TLSOutputStream, TLSDataRetrieval>)stream
                                                maxBytes:(NSUInteger)maxBytes;
 
+/**
+ Enumerate the past logged records of an indexed output stream matching the _query_.
+
+ This method brings the output stream's index up to date on the logging queue, then queries it
+ on the calling thread: logging is not held up by the query.
+ _block_ is called synchronously on the calling thread, it can log (and `flush`) as usual.
+
+ @param stream The output stream that conforms to `TLSIndexedDataRetrieval`
+ @param query The `TLSLogIndexQuery` to match records against
+ @param block The block to call with each matching record, in the order they were logged
+ */
+- (void)enumerateIndexedRecordsFromOutputStream:(id<TLSOutputStream, TLSIndexedDataRetrieval>)stream
+                                  matchingQuery:(TLSLogIndexQuery *)query
+                                     usingBlock:(TLSLogIndexRecordBlock NS_NOESCAPE)block;
+
+/**
+ A snapshot of the metrics of the logging pipeline: what was filtered and where, queue depths, time
+ spent by each output stream and the output streams' own counters (see `TLSLoggingMetrics`).
+
+ Recording the metrics only costs relaxed atomic increments on the logging path and taking a snapshot
+ does not block logging, so it is cheap enough to poll.
+ */
+- (TLSLoggingMetrics *)metricsSnapshot;
+
+/**
+ How often to report a `metricsSnapshot` to the `TLSLoggingServiceDelegate` (see
+ `tls_loggingService:didCaptureMetrics:`).
+ `0` means no reporting.
+
+ Default == `0`
+ */
+@property (atomic, readwrite) NSTimeInterval metricsReportingInterval;
+
 @end
 
+//! The marker that ends messages truncated by `[TLSLoggingService maximumMessageByteLength]`
+FOUNDATION_EXTERN NSString * const TLSLogMessageTruncationMarker;
+
+//! The channel the `TLSLoggingService` logs its own events to (such as `loadSheddingBacklogThreshold` transitions)
+FOUNDATION_EXTERN NSString * const TLSLoggingServiceChannel;
+
 /** Delegate protocol for `TLSLoggingService` */
 @protocol TLSLoggingServiceDelegate <NSObject>
 
@@ -117,6 +339,26 @@ NS_ASSUME_NONNULL_BEGIN
               contextObject:(nullable id)contextObject
               message:(NSString *)message;
 
+/**
+ Called every `metricsReportingInterval` seconds with a `metricsSnapshot` of the _service_.
+ Called on a background queue, not on any of the _service_'s queues, so logging from it is safe.
+ @param service The `TLSLoggingService`
+ @param metrics The `TLSLoggingMetrics` snapshot
+ */
+- (void)tls_loggingService:(TLSLoggingService *)service
+         didCaptureMetrics:(TLSLoggingMetrics *)metrics;
+
+/**
+ Called when the _service_ isolates an output stream for exceeding the `outputStreamLatencyBudget`.
+ Called on a background queue, not on any of the _service_'s queues, so logging from it is safe.
+ @param service The `TLSLoggingService`
+ @param stream The isolated `TLSOutputStream`
+ @param averageOutputDuration The moving average time per `tls_outputLogInfo:` of the _stream_ that exceeded the budget
+ */
+- (void)tls_loggingService:(TLSLoggingService *)service
+    didIsolateOutputStream:(id<TLSOutputStream>)stream
+     averageOutputDuration:(NSTimeInterval)averageOutputDuration;
+
 @end
 
 NS_ASSUME_NONNULL_END
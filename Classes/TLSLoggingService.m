@@ -18,9 +18,16 @@
 //  limitations under the License.
 
 #import <pthread.h>
+#import <stdatomic.h>
+#import <time.h>
+#import <TwitterLoggingService/TLSLogRedactor.h>
 #import <TwitterLoggingService/TLSLoggingService+Advanced.h>
+#import <TwitterLoggingService/TLSLogThrottle.h>
 #import <TwitterLoggingService/TLSProtocols.h>
 #import "TLS_Project.h"
+#import "TLSBoundedFormat.h"
+#import "TLSLoggingMetricsRecorder.h"
+#import "TLSWorkloadTraceWriter.h"
 
 @class TLSLoggingService;
 
@@ -32,6 +39,12 @@
 #define TLSCANLOGMODE TLSCANLOGMODE_CHECKCACHED
 #endif
 
+#if TLSCANLOGMODE == TLSCANLOGMODE_CHECKFULL
+// thread dictionary key of the context snapshot the last check filtered on (keyed weakly by its context object),
+// taken by the log message that follows on the thread instead of snapshotting its context again
+static NSString * const kCanLogContextSnapshotsThreadKey = @"TLSCanLogContextSnapshots";
+#endif
+
 // Singleton Reference
 static TLSLoggingService *sLoggingService;
 
@@ -43,6 +56,168 @@ static TLSLoggingService *sLoggingService;
 
 static NSString * const kMainThreadName = @"Main";
 
+NSString * const TLSLoggingServiceChannel = @"TwitterLoggingService";
+
+// Bumped on every throttle configuration change (of any service), invalidating the throttle
+// resolved by each `TLSLogCallsite`.  Starts at `1` since zero initialized callsites are unresolved.
+static atomic_uint sThrottleGeneration = 1;
+
+// 1 in N sampling suppresses messages for as long as it is in place, its suppressed messages are
+// summarized at most once per interval (and on flush) instead of after every sampled message
+#define kThrottleSampleSummaryInterval (60 * NSEC_PER_SEC)
+
+static NSString *_GroupedCount(uint64_t count);
+static NSString *_CallsiteKey(NSString *file, NSInteger line);
+static NSUInteger _RepeatHash(TLSLogMessageInfo *info);
+
+/**
+ A run of consecutive identical log messages in a channel, transaction queue only.
+ Keeps what identifies the message and what its summary needs rather than the log messages themselves.
+ */
+TLS_OBJC_FINAL
+@interface TLSRepeatedMessageRun : NSObject
+// first occurrence
+@property (tls_nonatomic_direct, readonly) TLSLogLevel level;
+@property (tls_nonatomic_direct, readonly, copy) NSString *file;
+@property (tls_nonatomic_direct, readonly, copy) NSString *function;
+@property (tls_nonatomic_direct, readonly) NSInteger line;
+@property (tls_nonatomic_direct, readonly, copy) NSString *channel;
+@property (tls_nonatomic_direct, nullable, readonly) id contextObject;
+@property (tls_nonatomic_direct, readonly) NSUInteger repeatHash;
+// last repeat
+@property (tls_nonatomic_direct, nullable, readonly) NSDate *lastRepeatTimestamp;
+@property (tls_nonatomic_direct, readonly) NSTimeInterval lastRepeatLogLifespan;
+@property (tls_nonatomic_direct, readonly) unsigned int lastRepeatThreadId;
+@property (tls_nonatomic_direct, nullable, readonly, copy) NSString *lastRepeatThreadName;
+@property (tls_nonatomic_direct) NSUInteger repeatCount; // held back repeats not yet summarized
+- (instancetype)initWithInfo:(TLSLogMessageInfo *)info repeatHash:(NSUInteger)repeatHash TLS_OBJC_DIRECT;
+- (BOOL)matchesInfo:(TLSLogMessageInfo *)info repeatHash:(NSUInteger)repeatHash TLS_OBJC_DIRECT;
+- (void)addRepeatInfo:(TLSLogMessageInfo *)info TLS_OBJC_DIRECT;
+@end
+
+@implementation TLSRepeatedMessageRun
+{
+    NSString *_message;
+    TLSLogField *_fields;
+    NSUInteger _fieldCount;
+    NSData *_payload;
+}
+
+- (instancetype)initWithInfo:(TLSLogMessageInfo *)info repeatHash:(NSUInteger)repeatHash
+{
+    if (self = [super init]) {
+        _level = info.level;
+        _file = info.file;
+        _function = info.function;
+        _line = info.line;
+        _channel = info.channel;
+        _contextObject = info.contextObject;
+        _repeatHash = repeatHash;
+        _message = info.message;
+        _fieldCount = info.fieldCount;
+        if (_fieldCount > 0) {
+            _fields = malloc(_fieldCount * sizeof(TLSLogField));
+            memcpy(_fields, info.fields, _fieldCount * sizeof(TLSLogField));
+        }
+        _payload = info.payload;
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    free(_fields);
+}
+
+- (BOOL)matchesInfo:(TLSLogMessageInfo *)info repeatHash:(NSUInteger)repeatHash
+{
+    // the hash rules out nearly all non-repeats, only confirm the likely repeats
+    return _repeatHash == repeatHash
+        && _level == info.level
+        && _line == info.line
+        && _fieldCount == info.fieldCount
+        && _payload.length == info.payload.length
+        && [_file isEqualToString:info.file]
+        && [_message isEqualToString:info.message]
+        && (0 == _fieldCount || 0 == memcmp(_fields, info.fields, _fieldCount * sizeof(TLSLogField)))
+        && (_payload == info.payload || [_payload isEqualToData:info.payload]);
+}
+
+- (void)addRepeatInfo:(TLSLogMessageInfo *)info
+{
+    _lastRepeatTimestamp = info.timestamp;
+    _lastRepeatLogLifespan = info.logLifespan;
+    _lastRepeatThreadId = info.threadId;
+    _lastRepeatThreadName = info.threadName;
+    _repeatCount++;
+}
+
+@end
+
+/**
+ An output stream isolated on a queue of its own for exceeding the latency budget of the service.
+ Enqueued to from the logging queue only.
+ */
+TLS_OBJC_FINAL
+@interface TLSIsolatedOutputStream : NSObject
+@property (tls_nonatomic_direct, readonly) TLSOutputStreamMetricsRecorder *recorder;
+- (instancetype)initWithRecorder:(TLSOutputStreamMetricsRecorder *)recorder bufferCount:(NSUInteger)bufferCount TLS_OBJC_DIRECT;
+- (void)enqueueLogInfo:(TLSLogMessageInfo *)info TLS_OBJC_DIRECT;
+- (void)performSynchronously:(dispatch_block_t NS_NOESCAPE)block TLS_OBJC_DIRECT;
+@end
+
+@implementation TLSIsolatedOutputStream
+{
+    dispatch_queue_t _queue;
+    NSUInteger _bufferCount;
+    // log messages enqueued but not yet output
+    atomic_uint _pendingCount;
+}
+
+- (instancetype)initWithRecorder:(TLSOutputStreamMetricsRecorder *)recorder bufferCount:(NSUInteger)bufferCount
+{
+    if (self = [super init]) {
+        _recorder = recorder;
+        _bufferCount = MAX(bufferCount, (NSUInteger)1);
+        atomic_init(&_pendingCount, 0);
+        NSString *label = [NSString stringWithFormat:@"TLSLoggingService.isolated.%@", NSStringFromClass([recorder.stream class])];
+        _queue = dispatch_queue_create(label.UTF8String, DISPATCH_QUEUE_SERIAL);
+    }
+    return self;
+}
+
+- (void)enqueueLogInfo:(TLSLogMessageInfo *)info
+{
+    // the logging queue is the only producer, so the check can't be raced past the buffer
+    if (atomic_load_explicit(&_pendingCount, memory_order_relaxed) >= _bufferCount) {
+        [_recorder recordDropped];
+        return;
+    }
+
+    atomic_fetch_add_explicit(&_pendingCount, 1, memory_order_relaxed);
+    TLSOutputStreamMetricsRecorder *recorder = _recorder;
+    dispatch_async(_queue, ^{
+        @autoreleasepool {
+            id<TLSOutputStream> stream = recorder.stream;
+            const uint64_t start = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+            [stream tls_outputLogInfo:info];
+            [recorder recordOutputDuration:clock_gettime_nsec_np(CLOCK_UPTIME_RAW) - start];
+            if (1 == atomic_fetch_sub_explicit(&self->_pendingCount, 1, memory_order_acq_rel)) {
+                if ([stream respondsToSelector:@selector(tls_didFinishOutputBatch)]) {
+                    [stream tls_didFinishOutputBatch];
+                }
+            }
+        }
+    });
+}
+
+- (void)performSynchronously:(dispatch_block_t NS_NOESCAPE)block
+{
+    dispatch_sync(_queue, block);
+}
+
+@end
+
 @interface TLSLoggingService ()
 {
     dispatch_queue_t _transactionQueue;
@@ -50,6 +225,58 @@ static NSString * const kMainThreadName = @"Main";
     CFAbsoluteTime _baseTimestamp;
     NSMutableSet<id<TLSOutputStream>> *_streamsM;
 
+    // log messages dispatched to the logging queue but not yet output
+    atomic_uint _pendingOutputCount;
+    // log messages are being captured for replay, see `beginLaunchCaptureWithCapacity:`
+    atomic_bool _launchCapturing;
+    // the last `sequenceNumber` assigned
+    atomic_ullong _sequenceNumber;
+    // the `TLSLogLevelMask` of the levels being shed, `0` when not shedding, see `loadSheddingBacklogThreshold`
+    atomic_uint _loadSheddingLevels;
+
+    // load shedding transitions, guarded by the load shedding lock
+    pthread_mutex_t _loadSheddingLock;
+    uint64_t _loadSheddingStartTime;
+    uint64_t _loadSheddingStartShedCount;
+    uint64_t _loadSheddingStartOutputCount;
+    NSUInteger _loadSheddingStartPendingOutputCount;
+
+    // output lanes to the logging queue, guarded by the output lanes lock, see `priorityLaneEnabled`
+    pthread_mutex_t _outputLanesLock;
+    NSMutableArray<dispatch_block_t> *_priorityOutputLaneM;
+    NSMutableArray<dispatch_block_t> *_outputLaneM;
+    // logging queue only
+    NSMutableSet<id<TLSOutputStream>> *_loggingBatchStreamsM;
+    NSMapTable<id<TLSOutputStream>, TLSIsolatedOutputStream *> *_loggingIsolatedStreamsM;
+
+    // throttling, guarded by the throttle lock
+    pthread_mutex_t _throttleLock;
+    NSMutableDictionary<NSString *, TLSLogThrottle *> *_throttlesByChannelM;
+    NSMutableDictionary<NSString *, TLSLogThrottle *> *_throttlesByCallsiteM;
+    NSMutableDictionary<NSValue *, NSString *> *_suppressedCallsiteChannelsM;
+
+    // workload capture, guarded by the workload capture lock (read locked to capture), see `beginWorkloadCaptureToFilePath:error:`
+    atomic_bool _workloadCapturing;
+    pthread_rwlock_t _workloadCaptureLock;
+    TLSWorkloadTraceWriter *_workloadCaptureWriter;
+
+    // context snapshots, see `contextSnapshotByteBudget`
+    TLSLogContextSnapshotLedger *_contextSnapshotLedger;
+
+    // metrics, relaxed atomics recorded from any queue
+    TLSLoggingMetricsCounters _metrics;
+
+    // transaction queue only
+    NSMutableDictionary<NSString *, TLSRepeatedMessageRun *> *_transactionRepeatRunsM;
+    NSMapTable<id<TLSOutputStream>, TLSOutputStreamMetricsRecorder *> *_transactionStreamMetricsRecordersM;
+    NSTimeInterval _transactionMetricsReportingInterval;
+    dispatch_source_t _transactionMetricsTimer;
+    NSMutableArray<TLSLogMessageInfo *> *_transactionLaunchCaptureM;
+    NSUInteger _transactionLaunchCaptureCapacity;
+    // how many of the captured log messages each removed output stream has seen, so that re-adding it only replays the rest
+    NSMapTable<id<TLSOutputStream>, NSNumber *> *_transactionLaunchCaptureSeenCountsM;
+    NSMapTable<id<TLSOutputStream>, TLSLogRedactor *> *_transactionRedactorsM;
+
 #if TLSCANLOGMODE == TLSCANLOGMODE_CHECKCACHED
     dispatch_queue_t _quickFilterQueue;
     TLSLogLevelMask _quickFilterLevels;
@@ -59,7 +286,17 @@ static NSString * const kMainThreadName = @"Main";
 }
 
 @property (nonatomic, readwrite) NSUInteger maximumSafeMessageLength;
+@property (nonatomic, readwrite) NSUInteger maximumMessageByteLength;
+@property (atomic, readwrite) NSTimeInterval repeatedMessageCoalescingInterval;
+@property (atomic, readwrite, getter=isPriorityLaneEnabled) BOOL priorityLaneEnabled;
+@property (atomic, readwrite) NSTimeInterval outputStreamLatencyBudget;
+@property (atomic, readwrite) NSUInteger isolatedOutputStreamBufferCount;
+@property (atomic, readwrite) NSUInteger loadSheddingBacklogThreshold;
+@property (atomic, readwrite) TLSLogLevel loadSheddingLevel;
+@property (atomic, readwrite) NSUInteger contextSnapshotByteBudget;
 @property (atomic, readwrite, nullable, weak) id<TLSLoggingServiceDelegate> delegate;
+// published by the transaction queue, read from any queue for `metricsSnapshot`
+@property (tls_atomic_direct, copy) NSArray<TLSOutputStreamMetricsRecorder *> *streamMetricsRecorders;
 
 // accessible from external queues
 
@@ -70,11 +307,44 @@ static NSString * const kMainThreadName = @"Main";
                          line:(NSInteger)line
                       context:(id)contextObject
                       options:(TLSLogMessageOptions)options
+                       fields:(nullable const TLSLogField *)fields
+                   fieldCount:(NSUInteger)fieldCount
+                      payload:(nullable NSData *)payload
                        format:(NSString *)format
                     arguments:(va_list)arguments TLS_OBJC_DIRECT;
 - (BOOL)_canLogWithLevel:(TLSLogLevel)level
                  channel:(NSString *)channel
                  context:(id)contextObject TLS_OBJC_DIRECT;
+- (BOOL)_throttlePermitCallsite:(TLSLogCallsite *)callsite
+                          level:(TLSLogLevel)level
+                        channel:(NSString *)channel TLS_OBJC_DIRECT;
+- (void)_throttleResolveCallsite:(TLSLogCallsite *)callsite
+                         channel:(NSString *)channel
+                      generation:(unsigned int)generation TLS_OBJC_DIRECT;
+- (void)_throttleSummarizeCallsite:(TLSLogCallsite *)callsite
+                           channel:(nullable NSString *)channel
+                               now:(uint64_t)now TLS_OBJC_DIRECT;
+- (void)_throttleSummarizeAllSuppressedCallsites TLS_OBJC_DIRECT;
+- (void)_loadSheddingUpdate TLS_OBJC_DIRECT;
+- (void)_loadSheddingStartWithBacklog:(NSUInteger)backlog TLS_OBJC_DIRECT;
+- (void)_loadSheddingEnd TLS_OBJC_DIRECT;
+- (void)_workloadCaptureCallAtTime:(uint64_t)time
+                             level:(TLSLogLevel)level
+                           channel:(NSString *)channel
+                              file:(nullable const char *)file
+                        fileString:(nullable NSString *)fileString
+                          function:(nullable NSString *)function
+                              line:(NSInteger)line
+                           message:(nullable NSString *)message
+                          filtered:(BOOL)filtered TLS_OBJC_DIRECT;
+- (nullable id)_contextSnapshotOfObject:(nullable id)contextObject dropMessage:(BOOL *)dropMessageOut TLS_OBJC_DIRECT;
+- (nullable NSString *)_cappedMessage:(NSString *)message
+                                level:(TLSLogLevel)level
+                              channel:(NSString *)channel
+                                 file:(nullable NSString *)file
+                             function:(nullable NSString *)function
+                                 line:(NSInteger)line
+                        contextObject:(nullable id)contextObject TLS_OBJC_DIRECT;
 
 // accessible from any queue except the quickFilter queue
 
@@ -91,11 +361,44 @@ static NSString * const kMainThreadName = @"Main";
                                      context:(id)contextObject
                                     threadId:(unsigned int)threadId
                                   threadName:(NSString *)threadName
-                                     message:(NSString *)message TLS_OBJC_DIRECT;
+                                     message:(NSString *)message
+                                      fields:(nullable TLSLogField *)fields
+                                  fieldCount:(NSUInteger)fieldCount
+                                     payload:(nullable NSData *)payload
+                maximumPayloadRenderedLength:(NSUInteger)maximumPayloadRenderedLength
+                              sequenceNumber:(uint64_t)sequenceNumber TLS_OBJC_DIRECT;
+- (void)_transaction_submitLogInfo:(TLSLogMessageInfo *)info TLS_OBJC_DIRECT;
+- (void)_transaction_outputLogInfo:(TLSLogMessageInfo *)info TLS_OBJC_DIRECT;
+- (void)_transaction_enqueueOutput:(dispatch_block_t)outputBlock priority:(BOOL)priority TLS_OBJC_DIRECT;
 - (TLSFilterStatus)_transaction_filterLogStream:(id<TLSOutputStream>)stream
                                           level:(TLSLogLevel)level
                                         channel:(NSString *)channel
                                         context:(id)contextObject TLS_OBJC_DIRECT;
+- (BOOL)_transaction_coalesceLogInfo:(TLSLogMessageInfo *)info
+                            interval:(NSTimeInterval)interval TLS_OBJC_DIRECT;
+- (void)_transaction_summarizeRepeatedMessageRun:(TLSRepeatedMessageRun *)run TLS_OBJC_DIRECT;
+- (void)_transaction_summarizeAllRepeatedMessageRuns TLS_OBJC_DIRECT;
+- (void)_transaction_publishStreamMetricsRecorders TLS_OBJC_DIRECT;
+- (void)_transaction_captureLogInfo:(TLSLogMessageInfo *)info TLS_OBJC_DIRECT;
+- (void)_transaction_replayLaunchCaptureToOutputStream:(id<TLSOutputStream>)stream TLS_OBJC_DIRECT;
+- (void)_transaction_setMetricsReportingInterval:(NSTimeInterval)interval TLS_OBJC_DIRECT;
+
+// accessible from the metrics timer queue
+
+- (void)_metrics_report TLS_OBJC_DIRECT;
+
+// accessible from logging queue
+
+- (void)_logging_outputNextFromLanes TLS_OBJC_DIRECT;
+- (void)_logging_outputLogInfo:(TLSLogMessageInfo *)info
+                     toStreams:(NSSet<id<TLSOutputStream>> *)streams
+                     recorders:(NSArray<TLSOutputStreamMetricsRecorder *> *)recorders
+                     redactors:(nullable NSArray *)redactors TLS_OBJC_DIRECT;
+- (void)_logging_isolateOutputStreamWithRecorder:(TLSOutputStreamMetricsRecorder *)recorder
+                           averageOutputDuration:(uint64_t)averageOutputDuration TLS_OBJC_DIRECT;
+- (void)_logging_performOnOutputStream:(id<TLSOutputStream>)stream
+                                 block:(dispatch_block_t NS_NOESCAPE)block TLS_OBJC_DIRECT;
+- (void)_logging_didOutputToStreams:(NSSet<id<TLSOutputStream>> *)streams TLS_OBJC_DIRECT;
 
 @end
 
@@ -115,9 +418,36 @@ static NSString * const kMainThreadName = @"Main";
     if (self = [super init]) {
         _baseTimestamp = CFAbsoluteTimeGetCurrent();
         _streamsM = [[NSMutableSet alloc] init];
+        _loggingBatchStreamsM = [[NSMutableSet alloc] init];
+        _loggingIsolatedStreamsM = [NSMapTable strongToStrongObjectsMapTable];
+        atomic_init(&_pendingOutputCount, 0);
+        atomic_init(&_launchCapturing, false);
+        atomic_init(&_sequenceNumber, 0);
+        atomic_init(&_loadSheddingLevels, 0);
+        pthread_mutex_init(&_loadSheddingLock, NULL);
+        pthread_mutex_init(&_outputLanesLock, NULL);
+        _priorityOutputLaneM = [[NSMutableArray alloc] init];
+        _outputLaneM = [[NSMutableArray alloc] init];
+        pthread_mutex_init(&_throttleLock, NULL);
+        atomic_init(&_workloadCapturing, false);
+        pthread_rwlock_init(&_workloadCaptureLock, NULL);
+        _contextSnapshotLedger = [[TLSLogContextSnapshotLedger alloc] init];
+        _throttlesByChannelM = [[NSMutableDictionary alloc] init];
+        _throttlesByCallsiteM = [[NSMutableDictionary alloc] init];
+        _suppressedCallsiteChannelsM = [[NSMutableDictionary alloc] init];
+        _transactionRepeatRunsM = [[NSMutableDictionary alloc] init];
+        _transactionStreamMetricsRecordersM = [NSMapTable strongToStrongObjectsMapTable];
+        _transactionRedactorsM = [NSMapTable strongToStrongObjectsMapTable];
+        _streamMetricsRecorders = @[];
         _loggingQueue = dispatch_queue_create("TLSLoggingService.logging", DISPATCH_QUEUE_SERIAL);
         _transactionQueue = dispatch_queue_create("TLSLoggingService.transaction", DISPATCH_QUEUE_SERIAL);
         _maximumSafeMessageLength = 0;
+        _maximumMessageByteLength = 0;
+        _outputStreamLatencyBudget = 0;
+        _isolatedOutputStreamBufferCount = 1024;
+        _loadSheddingBacklogThreshold = 0;
+        _loadSheddingLevel = TLSLogLevelWarning;
+        _contextSnapshotByteBudget = 0;
 
 #if TLSCANLOGMODE == TLSCANLOGMODE_CHECKCACHED
         _quickFilterQueue = dispatch_queue_create("TLSLoggingService.quickFilter", DISPATCH_QUEUE_SERIAL);
@@ -131,7 +461,15 @@ static NSString * const kMainThreadName = @"Main";
 
 - (void)dealloc
 {
+    if (_transactionMetricsTimer) {
+        dispatch_source_cancel(_transactionMetricsTimer);
+    }
     [self flush];
+    [_workloadCaptureWriter close];
+    pthread_rwlock_destroy(&_workloadCaptureLock);
+    pthread_mutex_destroy(&_throttleLock);
+    pthread_mutex_destroy(&_outputLanesLock);
+    pthread_mutex_destroy(&_loadSheddingLock);
 }
 
 - (void)addOutputStream:(id<TLSOutputStream>)stream
@@ -141,7 +479,13 @@ static NSString * const kMainThreadName = @"Main";
     }
 
     [self dispatchAsynchronousTransaction:^{
-        [self->_streamsM addObject:stream];
+        if (![self->_streamsM containsObject:stream]) {
+            [self->_streamsM addObject:stream];
+            [self->_transactionStreamMetricsRecordersM setObject:[[TLSOutputStreamMetricsRecorder alloc] initWithStream:stream]
+                                                          forKey:stream];
+            [self _transaction_publishStreamMetricsRecorders];
+            [self _transaction_replayLaunchCaptureToOutputStream:stream];
+        }
         [self _nonquickFilter_resetQuickFilter:self->_streamsM.count];
     }];
 }
@@ -164,6 +508,9 @@ static NSString * const kMainThreadName = @"Main";
                            line:line
                         context:contextObject
                         options:options
+                         fields:NULL
+                     fieldCount:0
+                        payload:nil
                          format:message
                       arguments:arguments];
     va_end(arguments);
@@ -191,45 +538,93 @@ static NSString * const kMainThreadName = @"Main";
                          line:(NSInteger)line
                       context:(id)contextObject
                       options:(TLSLogMessageOptions)options
+                       fields:(const TLSLogField *)fields
+                   fieldCount:(NSUInteger)fieldCount
+                      payload:(NSData *)payload
                        format:(NSString *)format
                     arguments:(va_list)arguments
 {
+    if (TLS_BITMASK_INTERSECTS_FLAGS(atomic_load_explicit(&_loadSheddingLevels, memory_order_relaxed), (1 << level))) {
+        // shed before paying for the formatting
+        TLSMetricsIncrement(&_metrics.shedCount);
+        [self _workloadCaptureCallAtTime:clock_gettime_nsec_np(CLOCK_UPTIME_RAW)
+                                   level:level
+                                 channel:channel
+                                    file:NULL
+                              fileString:file
+                                function:function
+                                    line:line
+                                 message:nil
+                                filtered:YES];
+        return;
+    }
+
     if (channel && format) {
+        TLSMetricsIncrement(&_metrics.submittedCount);
+        // carry the snapshot from here on, not the context object
+        BOOL dropMessage = NO;
+        contextObject = [self _contextSnapshotOfObject:contextObject dropMessage:&dropMessage];
+        if (dropMessage) {
+            TLSMetricsIncrement(&_metrics.droppedCount);
+            return;
+        }
+        const uint64_t sequenceNumber = atomic_fetch_add_explicit(&_sequenceNumber, 1, memory_order_relaxed) + 1;
+        const uint64_t submitTime = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
         const mach_port_t threadId = pthread_mach_thread_np(pthread_self());
         NSString * const threadName = TLSCurrentThreadName();
         const CFAbsoluteTime timestamp = CFAbsoluteTimeGetCurrent();
-        NSString * message = [[NSString alloc] initWithFormat:format arguments:arguments];
-
-        if (TLS_BITMASK_EXCLUDES_FLAGS(options, TLSLogMessageOptionsIgnoringMaximumSafeMessageLength)) {
-            const NSUInteger maximumMessageLength = self.maximumSafeMessageLength;
-            if (maximumMessageLength > 0) {
-                const NSUInteger length = message.length;
-                if (length > maximumMessageLength) {
-                    NSUInteger lengthToLog = maximumMessageLength;
-
-                    const id<TLSLoggingServiceDelegate> delegate = self.delegate;
-                    if ([delegate respondsToSelector:@selector(tls_loggingService:lengthToLogForMessageExceedingMaxSafeLength:level:channel:file:function:line:contextObject:message:)]) {
-                        lengthToLog = [delegate tls_loggingService:self
-                       lengthToLogForMessageExceedingMaxSafeLength:maximumMessageLength
-                                                             level:level
-                                                           channel:channel
-                                                              file:file
-                                                          function:function
-                                                              line:line
-                                                     contextObject:contextObject
-                                                           message:message];
-                    }
+        const BOOL capped = TLS_BITMASK_EXCLUDES_FLAGS(options, TLSLogMessageOptionsIgnoringMaximumSafeMessageLength);
+        const NSUInteger maximumMessageByteLength = (capped) ? self.maximumMessageByteLength : 0;
+        NSString * message = (maximumMessageByteLength > 0) ?
+                                TLSBoundedFormat(maximumMessageByteLength, format, arguments, NULL) :
+                                [[NSString alloc] initWithFormat:format arguments:arguments];
+
+        if (capped) {
+            message = [self _cappedMessage:message
+                                     level:level
+                                   channel:channel
+                                      file:file
+                                  function:function
+                                      line:line
+                             contextObject:contextObject];
+            if (!message) {
+                TLSMetricsIncrement(&_metrics.droppedCount);
+                return;
+            }
+        }
 
-                    if (!lengthToLog) {
-                        return;
-                    } else if (lengthToLog < length) {
-                        message = [message substringToIndex:lengthToLog];
-                    }
-                }
+        [self _workloadCaptureCallAtTime:submitTime
+                                   level:level
+                                 channel:channel
+                                    file:NULL
+                              fileString:file
+                                function:function
+                                    line:line
+                                 message:message
+                                filtered:NO];
+
+        // the fields can live on the caller's stack, copy them for the transaction queue to hand off to the info
+        TLSLogField *fieldsCopy = NULL;
+        if (fields && fieldCount > 0) {
+            fieldsCopy = malloc(fieldCount * sizeof(TLSLogField));
+            if (fieldsCopy) {
+                memcpy(fieldsCopy, fields, fieldCount * sizeof(TLSLogField));
             }
         }
 
+        // the payload is held by reference (a retain for immutable data), it is only rendered by the streams
+        NSData * const payloadReference = [payload copy];
+        // the message and the rendered payload share the maximum safe length, the (capped) message goes first
+        const NSUInteger maximumSafeMessageLength = (payloadReference && capped) ? self.maximumSafeMessageLength : 0;
+        NSUInteger maximumPayloadRenderedLength = 0;
+        if (maximumSafeMessageLength > 0) {
+            const NSUInteger messageLength = MIN(message.length, maximumSafeMessageLength);
+            // at least 1 (`0` is no limit), which renders none of the payload when the message takes it all
+            maximumPayloadRenderedLength = MAX(maximumSafeMessageLength - messageLength, (NSUInteger)1);
+        }
+
         [self dispatchAsynchronousTransaction:^{
+            TLSHistogramRecord(&self->_metrics.transactionLatency, clock_gettime_nsec_np(CLOCK_UPTIME_RAW) - submitTime);
             [self _transaction_logExecuteWithTimestamp:timestamp
                                                  level:level
                                                channel:channel
@@ -239,8 +634,15 @@ static NSString * const kMainThreadName = @"Main";
                                                context:contextObject
                                               threadId:threadId
                                             threadName:threadName
-                                               message:message];
+                                               message:message
+                                                fields:fieldsCopy
+                                            fieldCount:fieldCount
+                                               payload:payloadReference
+                          maximumPayloadRenderedLength:maximumPayloadRenderedLength
+                                        sequenceNumber:sequenceNumber];
+            [self _loadSheddingUpdate];
         }];
+        [self _loadSheddingUpdate];
     }
 }
 
@@ -254,8 +656,13 @@ static NSString * const kMainThreadName = @"Main";
                                     threadId:(unsigned int)threadId
                                   threadName:(NSString *)threadName
                                      message:(NSString *)message
+                                      fields:(TLSLogField *)fields
+                                  fieldCount:(NSUInteger)fieldCount
+                                     payload:(NSData *)payload
+                maximumPayloadRenderedLength:(NSUInteger)maximumPayloadRenderedLength
+                              sequenceNumber:(uint64_t)sequenceNumber
 {
-    if (_streamsM.count > 0) {
+    if (_streamsM.count > 0 || _transactionLaunchCaptureM) {
         const NSTimeInterval elapsedTime = timestamp - _baseTimestamp;
         TLSLogMessageInfo *info = [[TLSLogMessageInfo alloc] initWithLevel:level
                                                                       file:file
@@ -268,41 +675,99 @@ static NSString * const kMainThreadName = @"Main";
                                                                 threadName:threadName
                                                              contextObject:contextObject
                                                                    message:message];
-        NSMutableSet *permittedStreams = [[NSMutableSet alloc] init];
-        struct {
-            unsigned int channel:1;
-            unsigned int level:1;
-            unsigned int streamEncountered:1;
-        } exclusiveFiltering;
-        exclusiveFiltering.channel = exclusiveFiltering.level = 1;
-        exclusiveFiltering.streamEncountered = 0;
-        for (id<TLSOutputStream> stream in _streamsM) {
-            const TLSFilterStatus status = [self _transaction_filterLogStream:stream
-                                                                        level:level
-                                                                      channel:channel
-                                                                      context:contextObject];
-            if (TLSFilterStatusOK == status) {
-                [permittedStreams addObject:stream];
-            }
-            if (exclusiveFiltering.channel && TLS_BITMASK_EXCLUDES_FLAGS(status, TLSFilterStatusCannotLogChannel)) {
-                exclusiveFiltering.channel = 0;
-            }
-            if (exclusiveFiltering.level && TLS_BITMASK_EXCLUDES_FLAGS(status, TLSFilterStatusCannotLogLevel)) {
-                exclusiveFiltering.level = 0;
-            }
-            exclusiveFiltering.streamEncountered = 1;
+        [info tls_adoptFields:fields count:fieldCount];
+        if (payload) {
+            [info tls_setPayload:payload maximumRenderedLength:maximumPayloadRenderedLength];
         }
-        if (permittedStreams.count > 0) {
-            dispatch_async(_loggingQueue, ^{
-                @autoreleasepool {
-                    for (id<TLSOutputStream> stream in permittedStreams) {
-                        [stream tls_outputLogInfo:info];
-                    }
-                }
-            });
+        [info tls_setSequenceNumber:sequenceNumber];
+        [self _transaction_submitLogInfo:info];
+    } else {
+        TLSMetricsIncrement(&_metrics.droppedCount);
+        free(fields);
+    }
+}
+
+- (void)_transaction_submitLogInfo:(TLSLogMessageInfo *)info
+{
+    const NSTimeInterval coalescingInterval = self.repeatedMessageCoalescingInterval;
+    if (coalescingInterval > 0) {
+        if ([self _transaction_coalesceLogInfo:info interval:coalescingInterval]) {
+            // held back as a repeat
+            TLSMetricsIncrement(&_metrics.coalescedCount);
+            return;
+        }
+    } else if (_transactionRepeatRunsM.count > 0) {
+        // coalescing was disabled
+        [self _transaction_summarizeAllRepeatedMessageRuns];
+    }
+
+    [self _transaction_outputLogInfo:info];
+}
+
+- (void)_transaction_outputLogInfo:(TLSLogMessageInfo *)info
+{
+    const TLSLogLevel level = info.level;
+    NSString *channel = info.channel;
+    id contextObject = info.contextObject;
+
+    if (_transactionLaunchCaptureM) {
+        [self _transaction_captureLogInfo:info];
+        if (0 == _streamsM.count) {
+            return;
+        }
+    }
+
+    NSMutableSet *permittedStreams = [[NSMutableSet alloc] init];
+    NSMutableArray<TLSOutputStreamMetricsRecorder *> *permittedRecorders = [[NSMutableArray alloc] init];
+    // parallel to the recorders (`NSNull` for no redactor), captured now so that redaction follows the order of logging
+    NSMutableArray *permittedRedactors = (_transactionRedactorsM.count > 0) ? [[NSMutableArray alloc] init] : nil;
+    struct {
+        unsigned int channel:1;
+        unsigned int level:1;
+        unsigned int streamEncountered:1;
+    } exclusiveFiltering;
+    exclusiveFiltering.channel = exclusiveFiltering.level = 1;
+    exclusiveFiltering.streamEncountered = 0;
+    for (id<TLSOutputStream> stream in _streamsM) {
+        const TLSFilterStatus status = [self _transaction_filterLogStream:stream
+                                                                    level:level
+                                                                  channel:channel
+                                                                  context:contextObject];
+        TLSOutputStreamMetricsRecorder *recorder = [_transactionStreamMetricsRecordersM objectForKey:stream];
+        if (TLSFilterStatusOK == status) {
+            [permittedStreams addObject:stream];
+            [permittedRecorders addObject:recorder];
+            [permittedRedactors addObject:[_transactionRedactorsM objectForKey:stream] ?: [NSNull null]];
+        } else {
+            [recorder recordFiltered];
+        }
+        if (exclusiveFiltering.channel && TLS_BITMASK_EXCLUDES_FLAGS(status, TLSFilterStatusCannotLogChannel)) {
+            exclusiveFiltering.channel = 0;
         }
+        if (exclusiveFiltering.level && TLS_BITMASK_EXCLUDES_FLAGS(status, TLSFilterStatusCannotLogLevel)) {
+            exclusiveFiltering.level = 0;
+        }
+        exclusiveFiltering.streamEncountered = 1;
+    }
+    if (permittedStreams.count > 0) {
+        TLSMetricsIncrement(&_metrics.outputCount);
+        atomic_fetch_add_explicit(&_pendingOutputCount, 1, memory_order_relaxed);
+        dispatch_block_t outputBlock = ^{
+            @autoreleasepool {
+                [self _logging_outputLogInfo:info toStreams:permittedStreams recorders:permittedRecorders redactors:permittedRedactors];
+            }
+        };
+        if (self.isPriorityLaneEnabled) {
+            [self _transaction_enqueueOutput:outputBlock priority:(level <= TLSLogLevelWarning)];
+        } else {
+            dispatch_async(_loggingQueue, outputBlock);
+        }
+    } else {
+        TLSMetricsIncrement(&_metrics.streamFilteredCount);
 #if TLSCANLOGMODE == TLSCANLOGMODE_CHECKCACHED
-        else if (exclusiveFiltering.streamEncountered && (exclusiveFiltering.channel || exclusiveFiltering.level)) {
+        // while capturing, later added output streams could want what the current ones filter
+        const BOOL capturing = atomic_load_explicit(&_launchCapturing, memory_order_relaxed);
+        if (!capturing && exclusiveFiltering.streamEncountered && (exclusiveFiltering.channel || exclusiveFiltering.level)) {
             @autoreleasepool {
                 dispatch_sync(_quickFilterQueue, ^{
                     if (exclusiveFiltering.channel) {
@@ -318,6 +783,19 @@ static NSString * const kMainThreadName = @"Main";
     }
 }
 
+- (void)_transaction_enqueueOutput:(dispatch_block_t)outputBlock priority:(BOOL)priority
+{
+    pthread_mutex_lock(&_outputLanesLock);
+    [((priority) ? _priorityOutputLaneM : _outputLaneM) addObject:outputBlock];
+    pthread_mutex_unlock(&_outputLanesLock);
+
+    // one dispatch per output, but each takes the next output from the lanes (priority first) so
+    // priority outputs overtake the ones that are already waiting
+    dispatch_async(_loggingQueue, ^{
+        [self _logging_outputNextFromLanes];
+    });
+}
+
 - (TLSFilterStatus)_transaction_filterLogStream:(id<TLSOutputStream>)stream
                                           level:(TLSLogLevel)level
                                         channel:(NSString *)channel
@@ -339,10 +817,329 @@ static NSString * const kMainThreadName = @"Main";
     return TLSFilterStatusOK;
 }
 
+- (BOOL)_transaction_coalesceLogInfo:(TLSLogMessageInfo *)info
+                            interval:(NSTimeInterval)interval
+{
+    NSString *channel = info.channel;
+    const NSUInteger repeatHash = _RepeatHash(info);
+    TLSRepeatedMessageRun *run = _transactionRepeatRunsM[channel];
+
+    if (run && [run matchesInfo:info repeatHash:repeatHash]) {
+        [run addRepeatInfo:info];
+        if (1 == run.repeatCount) {
+            // bound how long the repeats can be held back if the run doesn't end
+            __weak TLSLoggingService *weakSelf = self;
+            dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(interval * NSEC_PER_SEC)), _transactionQueue, ^{
+                @autoreleasepool {
+                    [weakSelf _transaction_summarizeRepeatedMessageRun:run];
+                }
+            });
+        }
+        return YES;
+    }
+
+    if (run) {
+        // run ended
+        [self _transaction_summarizeRepeatedMessageRun:run];
+    }
+    _transactionRepeatRunsM[channel] = [[TLSRepeatedMessageRun alloc] initWithInfo:info repeatHash:repeatHash];
+    return NO;
+}
+
+- (void)_transaction_summarizeRepeatedMessageRun:(TLSRepeatedMessageRun *)run
+{
+    // a summarized run is over, the next occurrence of the message is logged and starts a new run
+    if (_transactionRepeatRunsM[run.channel] == run) {
+        [_transactionRepeatRunsM removeObjectForKey:run.channel];
+    }
+
+    const NSUInteger repeatCount = run.repeatCount;
+    if (0 == repeatCount) {
+        return;
+    }
+    run.repeatCount = 0;
+
+    NSString *message = (1 == repeatCount) ? @"last message repeated 1 time" : [NSString stringWithFormat:@"last message repeated %tu times", repeatCount];
+    TLSLogMessageInfo *summaryInfo = [[TLSLogMessageInfo alloc] initWithLevel:run.level
+                                                                         file:run.file
+                                                                     function:run.function
+                                                                         line:run.line
+                                                                      channel:run.channel
+                                                                    timestamp:run.lastRepeatTimestamp
+                                                                  logLifespan:run.lastRepeatLogLifespan
+                                                                     threadId:run.lastRepeatThreadId
+                                                                   threadName:run.lastRepeatThreadName
+                                                                contextObject:run.contextObject
+                                                                      message:message];
+    [summaryInfo tls_setSequenceNumber:atomic_fetch_add_explicit(&_sequenceNumber, 1, memory_order_relaxed) + 1];
+    [self _transaction_outputLogInfo:summaryInfo];
+}
+
+- (void)_transaction_summarizeAllRepeatedMessageRuns
+{
+    // summarizing removes the run
+    for (TLSRepeatedMessageRun *run in _transactionRepeatRunsM.allValues) {
+        [self _transaction_summarizeRepeatedMessageRun:run];
+    }
+}
+
+- (void)_transaction_publishStreamMetricsRecorders
+{
+    self.streamMetricsRecorders = _transactionStreamMetricsRecordersM.objectEnumerator.allObjects;
+}
+
+- (void)_transaction_captureLogInfo:(TLSLogMessageInfo *)info
+{
+    if (_transactionLaunchCaptureM.count >= _transactionLaunchCaptureCapacity) {
+        return;
+    }
+
+    if (TLS_BITMASK_INTERSECTS_FLAGS(SANITIZED_LEVEL(TLSLogLevelMaskAll), (1 << info.level))) {
+        [_transactionLaunchCaptureM addObject:info];
+        if (_transactionLaunchCaptureM.count >= _transactionLaunchCaptureCapacity) {
+            // full, stop logging for the capture's sake
+            atomic_store_explicit(&_launchCapturing, false, memory_order_relaxed);
+        }
+    }
+}
+
+- (void)_transaction_replayLaunchCaptureToOutputStream:(id<TLSOutputStream>)stream
+{
+    const NSUInteger seenCount = [[_transactionLaunchCaptureSeenCountsM objectForKey:stream] unsignedIntegerValue];
+    [_transactionLaunchCaptureSeenCountsM removeObjectForKey:stream];
+    if (seenCount >= _transactionLaunchCaptureM.count) {
+        return;
+    }
+
+    NSArray<TLSLogMessageInfo *> *unseenInfos = [_transactionLaunchCaptureM subarrayWithRange:NSMakeRange(seenCount, _transactionLaunchCaptureM.count - seenCount)];
+    NSMutableArray<TLSLogMessageInfo *> *infos = [[NSMutableArray alloc] initWithCapacity:unseenInfos.count];
+    for (TLSLogMessageInfo *info in unseenInfos) {
+        const TLSFilterStatus status = [self _transaction_filterLogStream:stream
+                                                                    level:info.level
+                                                                  channel:info.channel
+                                                                  context:info.contextObject];
+        if (TLSFilterStatusOK == status) {
+            [infos addObject:info];
+        }
+    }
+    if (0 == infos.count) {
+        return;
+    }
+
+    NSSet<id<TLSOutputStream>> *streams = [NSSet setWithObject:stream];
+    NSArray<TLSOutputStreamMetricsRecorder *> *recorders = @[[_transactionStreamMetricsRecordersM objectForKey:stream]];
+    TLSLogRedactor *redactor = [_transactionRedactorsM objectForKey:stream];
+    NSArray *redactors = (redactor) ? @[redactor] : nil;
+    atomic_fetch_add_explicit(&_pendingOutputCount, (unsigned int)infos.count, memory_order_relaxed);
+    dispatch_async(_loggingQueue, ^{
+        for (TLSLogMessageInfo *info in infos) {
+            @autoreleasepool {
+                [self _logging_outputLogInfo:info toStreams:streams recorders:recorders redactors:redactors];
+            }
+        }
+    });
+}
+
+- (void)_transaction_setMetricsReportingInterval:(NSTimeInterval)interval
+{
+    interval = (interval > 0) ? interval : 0;
+    if (interval == _transactionMetricsReportingInterval) {
+        return;
+    }
+    _transactionMetricsReportingInterval = interval;
+
+    if (_transactionMetricsTimer) {
+        dispatch_source_cancel(_transactionMetricsTimer);
+        _transactionMetricsTimer = nil;
+    }
+
+    if (interval > 0) {
+        // report off of the service's queues so the delegate can log
+        const uint64_t intervalNanoseconds = (uint64_t)(interval * NSEC_PER_SEC);
+        dispatch_source_t timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, dispatch_get_global_queue(QOS_CLASS_UTILITY, 0));
+        dispatch_source_set_timer(timer,
+                                  dispatch_time(DISPATCH_TIME_NOW, (int64_t)intervalNanoseconds),
+                                  intervalNanoseconds,
+                                  intervalNanoseconds / 10 /*leeway*/);
+        __weak TLSLoggingService *weakSelf = self;
+        dispatch_source_set_event_handler(timer, ^{
+            @autoreleasepool {
+                [weakSelf _metrics_report];
+            }
+        });
+        dispatch_resume(timer);
+        _transactionMetricsTimer = timer;
+    }
+}
+
+- (void)_metrics_report
+{
+    const id<TLSLoggingServiceDelegate> delegate = self.delegate;
+    if ([delegate respondsToSelector:@selector(tls_loggingService:didCaptureMetrics:)]) {
+        [delegate tls_loggingService:self didCaptureMetrics:[self metricsSnapshot]];
+    }
+}
+
+- (void)_logging_outputNextFromLanes
+{
+    pthread_mutex_lock(&_outputLanesLock);
+    NSMutableArray<dispatch_block_t> *lane = (_priorityOutputLaneM.count > 0) ? _priorityOutputLaneM : _outputLaneM;
+    dispatch_block_t outputBlock = lane.firstObject;
+    if (outputBlock) {
+        [lane removeObjectAtIndex:0];
+    }
+    pthread_mutex_unlock(&_outputLanesLock);
+
+    if (outputBlock) {
+        outputBlock();
+    }
+}
+
+- (void)_logging_outputLogInfo:(TLSLogMessageInfo *)info
+                     toStreams:(NSSet<id<TLSOutputStream>> *)streams
+                     recorders:(NSArray<TLSOutputStreamMetricsRecorder *> *)recorders
+                     redactors:(nullable NSArray *)redactors
+{
+    const NSTimeInterval latencyBudget = self.outputStreamLatencyBudget;
+    const uint64_t latencyBudgetNanoseconds = (latencyBudget > 0) ? (uint64_t)(latencyBudget * NSEC_PER_SEC) : 0;
+    NSMutableSet<id<TLSOutputStream>> *isolatedStreams = nil;
+    // redact once per redactor, most messages only ever see 1
+    TLSLogRedactor *lastRedactor = nil;
+    TLSLogMessageInfo *lastRedactedInfo = nil;
+    NSMapTable<TLSLogRedactor *, TLSLogMessageInfo *> *redactedInfos = nil;
+
+    const NSUInteger recorderCount = recorders.count;
+    for (NSUInteger recorderIndex = 0; recorderIndex < recorderCount; recorderIndex++) {
+        TLSOutputStreamMetricsRecorder *recorder = recorders[recorderIndex];
+        id<TLSOutputStream> stream = recorder.stream;
+
+        TLSLogMessageInfo *streamInfo = info;
+        TLSLogRedactor *redactor = (redactors) ? redactors[recorderIndex] : nil;
+        if ([redactor isKindOfClass:[TLSLogRedactor class]]) {
+            if (redactor != lastRedactor) {
+                if (lastRedactor) {
+                    redactedInfos = redactedInfos ?: [NSMapTable strongToStrongObjectsMapTable];
+                    [redactedInfos setObject:lastRedactedInfo forKey:lastRedactor];
+                }
+                lastRedactedInfo = [redactedInfos objectForKey:redactor];
+                if (!lastRedactedInfo) {
+                    lastRedactedInfo = [redactor tls_redactedInfo:info] ?: info;
+                }
+                lastRedactor = redactor;
+            }
+            streamInfo = lastRedactedInfo;
+        }
+
+        TLSIsolatedOutputStream *isolatedStream = (_loggingIsolatedStreamsM.count > 0) ? [_loggingIsolatedStreamsM objectForKey:stream] : nil;
+        if (isolatedStream) {
+            [isolatedStream enqueueLogInfo:streamInfo];
+            isolatedStreams = isolatedStreams ?: [[NSMutableSet alloc] init];
+            [isolatedStreams addObject:stream];
+            continue;
+        }
+
+        const uint64_t start = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+        [stream tls_outputLogInfo:streamInfo];
+        const uint64_t duration = clock_gettime_nsec_np(CLOCK_UPTIME_RAW) - start;
+        [recorder recordOutputDuration:duration];
+
+        if (latencyBudgetNanoseconds > 0) {
+            const uint64_t averageDuration = [recorder updateAverageOutputDuration:duration];
+            if (averageDuration > latencyBudgetNanoseconds) {
+                [self _logging_isolateOutputStreamWithRecorder:recorder averageOutputDuration:averageDuration];
+                isolatedStreams = isolatedStreams ?: [[NSMutableSet alloc] init];
+                [isolatedStreams addObject:stream];
+            }
+        }
+    }
+
+    if (isolatedStreams) {
+        // isolated streams finish their batches on their own queues
+        NSMutableSet<id<TLSOutputStream>> *streamsM = [streams mutableCopy];
+        [streamsM minusSet:isolatedStreams];
+        streams = streamsM;
+    }
+    [self _logging_didOutputToStreams:streams];
+}
+
+- (void)_logging_isolateOutputStreamWithRecorder:(TLSOutputStreamMetricsRecorder *)recorder
+                           averageOutputDuration:(uint64_t)averageOutputDuration
+{
+    id<TLSOutputStream> stream = recorder.stream;
+
+    // finish the stream's batch here before its output moves to its own queue
+    [_loggingBatchStreamsM removeObject:stream];
+    if ([stream respondsToSelector:@selector(tls_didFinishOutputBatch)]) {
+        [stream tls_didFinishOutputBatch];
+    }
+
+    [_loggingIsolatedStreamsM setObject:[[TLSIsolatedOutputStream alloc] initWithRecorder:recorder
+                                                                              bufferCount:self.isolatedOutputStreamBufferCount]
+                                 forKey:stream];
+    [recorder recordIsolated];
+
+    const id<TLSLoggingServiceDelegate> delegate = self.delegate;
+    if ([delegate respondsToSelector:@selector(tls_loggingService:didIsolateOutputStream:averageOutputDuration:)]) {
+        // off of the service's queues so the delegate can log
+        const NSTimeInterval averageOutputSeconds = (NSTimeInterval)averageOutputDuration / (NSTimeInterval)NSEC_PER_SEC;
+        dispatch_async(dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+            @autoreleasepool {
+                [delegate tls_loggingService:self
+                      didIsolateOutputStream:stream
+                       averageOutputDuration:averageOutputSeconds];
+            }
+        });
+    }
+}
+
+- (void)_logging_performOnOutputStream:(id<TLSOutputStream>)stream
+                                 block:(dispatch_block_t NS_NOESCAPE)block
+{
+    TLSIsolatedOutputStream *isolatedStream = (_loggingIsolatedStreamsM.count > 0) ? [_loggingIsolatedStreamsM objectForKey:stream] : nil;
+    if (isolatedStream) {
+        // after the stream's pending output
+        [isolatedStream performSynchronously:block];
+    } else {
+        block();
+    }
+}
+
+- (void)_logging_didOutputToStreams:(NSSet<id<TLSOutputStream>> *)streams
+{
+    [_loggingBatchStreamsM unionSet:streams];
+
+    if (1 == atomic_fetch_sub_explicit(&_pendingOutputCount, 1, memory_order_acq_rel)) {
+        // no more log messages queued for output, the batch is done
+        for (id<TLSOutputStream> stream in _loggingBatchStreamsM) {
+            if ([stream respondsToSelector:@selector(tls_didFinishOutputBatch)]) {
+                [stream tls_didFinishOutputBatch];
+            }
+        }
+        [_loggingBatchStreamsM removeAllObjects];
+    }
+
+    [self _loadSheddingUpdate];
+}
+
 - (BOOL)_canLogWithLevel:(TLSLogLevel)level
                  channel:(NSString *)channel
                  context:(id)contextObject
 {
+    if (TLS_BITMASK_INTERSECTS_FLAGS(atomic_load_explicit(&_loadSheddingLevels, memory_order_relaxed), (1 << level))) {
+        TLSMetricsIncrement(&_metrics.canLogFilteredCount);
+        TLSMetricsIncrement(&_metrics.shedCount);
+        return NO;
+    }
+
+    if (atomic_load_explicit(&_launchCapturing, memory_order_relaxed)) {
+        // capturing for the output streams to come
+        const BOOL canLog = (nil != channel) && TLS_BITMASK_INTERSECTS_FLAGS(SANITIZED_LEVEL(TLSLogLevelMaskAll), (1 << level));
+        if (!canLog) {
+            TLSMetricsIncrement(&_metrics.canLogFilteredCount);
+        }
+        return canLog;
+    }
+
 #if TLSCANLOGMODE == TLSCANLOGMODE_CHECKCACHED
 
     __block BOOL canLog = (nil != channel);
@@ -355,36 +1152,425 @@ static NSString * const kMainThreadName = @"Main";
             });
         }
     }
+    if (!canLog) {
+        TLSMetricsIncrement(&_metrics.canLogFilteredCount);
+    }
     return canLog;
 
 #elif TLSCANLOGMODE == TLSCANLOGMODE_CHECKFULL
 
+    // filter on the snapshot the log message will carry, held for it until the thread's next check
+    NSMutableDictionary *threadDictionary = [NSThread currentThread].threadDictionary;
+    [threadDictionary removeObjectForKey:kCanLogContextSnapshotsThreadKey];
+    BOOL dropMessage = NO;
+    id filterContextObject = [self _contextSnapshotOfObject:contextObject dropMessage:&dropMessage];
+    if (dropMessage) {
+        TLSMetricsIncrement(&_metrics.canLogFilteredCount);
+        return NO;
+    }
+    if (filterContextObject != contextObject) {
+        NSMapTable *snapshots = [NSMapTable weakToStrongObjectsMapTable];
+        [snapshots setObject:filterContextObject forKey:contextObject];
+        threadDictionary[kCanLogContextSnapshotsThreadKey] = snapshots;
+    }
     __block BOOL canLog = NO;
     [self dispatchSynchronousTransaction:^{
         for (id<TLSOutputStream> stream in self->_streamsM) {
             TLSFilterStatus status = [self _transaction_filterLogStream:stream
                                                                   level:level
                                                                 channel:channel
-                                                                context:contextObject];
+                                                                context:filterContextObject];
             if (TLSFilterStatusOK == status) {
                 canLog = YES;
                 break;
             }
         }
     }];
+    if (!canLog) {
+        TLSMetricsIncrement(&_metrics.canLogFilteredCount);
+    }
     return canLog;
 
 #else // TLSCANLOGMODE == TLSCANLOGMODE_ALWAYS
 
 #if DEBUG
-    return (level <= TLSLogLevelDebug);
+    const BOOL canLog = (level <= TLSLogLevelDebug);
 #else
-    return (level < TLSLogLevelDebug);
+    const BOOL canLog = (level < TLSLogLevelDebug);
 #endif
+    if (!canLog) {
+        TLSMetricsIncrement(&_metrics.canLogFilteredCount);
+    }
+    return canLog;
 
 #endif
 }
 
+static BOOL _ThrottleConforms(TLSLogCallsite *callsite, uint64_t now, uint64_t emissionInterval, uint64_t burstTolerance);
+static BOOL _ThrottleConforms(TLSLogCallsite *callsite, uint64_t now, uint64_t emissionInterval, uint64_t burstTolerance)
+{
+    // token bucket as a "generic cell rate algorithm": a single theoretical arrival time per callsite
+    // that can be updated with compare-and-swap instead of a lock
+    uint64_t arrivalTime = __atomic_load_n(&callsite->tls_theoreticalArrivalTime, __ATOMIC_RELAXED);
+    uint64_t nextArrivalTime;
+    do {
+        const uint64_t base = MAX(arrivalTime, now);
+        if (base - now > burstTolerance) {
+            return NO;
+        }
+        nextArrivalTime = base + emissionInterval;
+    } while (!__atomic_compare_exchange_n(&callsite->tls_theoreticalArrivalTime,
+                                          &arrivalTime,
+                                          nextArrivalTime,
+                                          true /*weak*/,
+                                          __ATOMIC_RELAXED,
+                                          __ATOMIC_RELAXED));
+    return YES;
+}
+
+- (BOOL)_throttlePermitCallsite:(TLSLogCallsite *)callsite
+                          level:(TLSLogLevel)level
+                        channel:(NSString *)channel
+{
+    const unsigned int generation = atomic_load_explicit(&sThrottleGeneration, memory_order_acquire);
+    if (__atomic_load_n(&callsite->tls_generation, __ATOMIC_ACQUIRE) != generation ||
+        __atomic_load_n(&callsite->tls_service, __ATOMIC_RELAXED) != (__bridge const void *)self) {
+        [self _throttleResolveCallsite:callsite channel:channel generation:generation];
+    }
+
+    const uint64_t sampleInterval = __atomic_load_n(&callsite->tls_sampleInterval, __ATOMIC_RELAXED);
+    const uint64_t emissionInterval = __atomic_load_n(&callsite->tls_emissionInterval, __ATOMIC_RELAXED);
+    if (sampleInterval <= 1 && 0 == emissionInterval) {
+        // not throttled, but could have stopped being throttled with suppressed messages to summarize
+        if (__atomic_load_n(&callsite->tls_suppressedCount, __ATOMIC_RELAXED) > 0) {
+            [self _throttleSummarizeCallsite:callsite channel:channel now:clock_gettime_nsec_np(CLOCK_UPTIME_RAW)];
+        }
+        return YES;
+    }
+
+    const uint64_t now = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+    BOOL permitted = YES;
+    if (sampleInterval > 1) {
+        permitted = (0 == (__atomic_fetch_add(&callsite->tls_sampleCount, 1, __ATOMIC_RELAXED) % sampleInterval));
+    }
+    if (permitted && emissionInterval > 0) {
+        permitted = _ThrottleConforms(callsite,
+                                      now,
+                                      emissionInterval,
+                                      __atomic_load_n(&callsite->tls_burstTolerance, __ATOMIC_RELAXED));
+    }
+
+    if (!permitted) {
+        TLSMetricsIncrement(&_metrics.throttledCount);
+        if (0 == __atomic_fetch_add(&callsite->tls_suppressedCount, 1, __ATOMIC_RELAXED)) {
+            // suppression started, track the callsite so its summary can be logged on flush
+            __atomic_store_n(&callsite->tls_suppressionStartTime, now, __ATOMIC_RELAXED);
+            __atomic_store_n(&callsite->tls_suppressedLevel, (int)level, __ATOMIC_RELAXED);
+            pthread_mutex_lock(&_throttleLock);
+            _suppressedCallsiteChannelsM[[NSValue valueWithPointer:callsite]] = [channel copy];
+            pthread_mutex_unlock(&_throttleLock);
+        }
+        return NO;
+    }
+
+    if (__atomic_load_n(&callsite->tls_suppressedCount, __ATOMIC_RELAXED) > 0) {
+        BOOL summarize = (emissionInterval > 0);
+        if (!summarize) {
+            // sampled only, summarize once the suppression has gone on for the interval
+            const uint64_t startTime = __atomic_load_n(&callsite->tls_suppressionStartTime, __ATOMIC_RELAXED);
+            summarize = (startTime > 0 && now > startTime && (now - startTime) >= kThrottleSampleSummaryInterval);
+        }
+        if (summarize) {
+            // rate limiting suppression ended, summarize before the permitted message is logged
+            [self _throttleSummarizeCallsite:callsite channel:channel now:now];
+        }
+    }
+    return YES;
+}
+
+- (void)_throttleResolveCallsite:(TLSLogCallsite *)callsite
+                         channel:(NSString *)channel
+                      generation:(unsigned int)generation
+{
+    TLSLogThrottle *throttle = nil;
+    pthread_mutex_lock(&_throttleLock);
+    if (_throttlesByCallsiteM.count > 0) {
+        throttle = _throttlesByCallsiteM[_CallsiteKey(@(callsite->file), callsite->line)];
+    }
+    if (!throttle && channel) {
+        throttle = _throttlesByChannelM[channel];
+    }
+    pthread_mutex_unlock(&_throttleLock);
+
+    uint64_t emissionInterval = 0;
+    uint64_t burstTolerance = 0;
+    uint64_t sampleInterval = 1;
+    if (throttle) {
+        if (throttle.maximumMessagesPerSecond > 0) {
+            emissionInterval = MAX((uint64_t)((double)NSEC_PER_SEC / throttle.maximumMessagesPerSecond), (uint64_t)1);
+            burstTolerance = emissionInterval * (throttle.burst - 1);
+        }
+        sampleInterval = throttle.sampleInterval;
+    }
+
+    // racing resolutions store the same values, the generation is published last
+    __atomic_store_n(&callsite->tls_emissionInterval, emissionInterval, __ATOMIC_RELAXED);
+    __atomic_store_n(&callsite->tls_burstTolerance, burstTolerance, __ATOMIC_RELAXED);
+    __atomic_store_n(&callsite->tls_sampleInterval, sampleInterval, __ATOMIC_RELAXED);
+    __atomic_store_n(&callsite->tls_service, (__bridge const void *)self, __ATOMIC_RELAXED);
+    __atomic_store_n(&callsite->tls_generation, generation, __ATOMIC_RELEASE);
+}
+
+- (void)_throttleSummarizeCallsite:(TLSLogCallsite *)callsite
+                           channel:(NSString *)channel
+                               now:(uint64_t)now
+{
+    const uint64_t suppressedCount = __atomic_exchange_n(&callsite->tls_suppressedCount, 0, __ATOMIC_RELAXED);
+    const uint64_t startTime = __atomic_exchange_n(&callsite->tls_suppressionStartTime, 0, __ATOMIC_RELAXED);
+    const TLSLogLevel level = (TLSLogLevel)__atomic_load_n(&callsite->tls_suppressedLevel, __ATOMIC_RELAXED);
+
+    pthread_mutex_lock(&_throttleLock);
+    NSValue *key = [NSValue valueWithPointer:callsite];
+    channel = channel ?: _suppressedCallsiteChannelsM[key];
+    [_suppressedCallsiteChannelsM removeObjectForKey:key];
+    pthread_mutex_unlock(&_throttleLock);
+
+    if (0 == suppressedCount || !channel) {
+        // another thread got to it first
+        return;
+    }
+
+    const double seconds = (startTime > 0 && now > startTime) ? (double)(now - startTime) / (double)NSEC_PER_SEC : 0;
+    NSString *file = @(callsite->file);
+    TLSLogEx(self,
+             level,
+             channel,
+             file,
+             @"",
+             callsite->line,
+             nil /*contextObject*/,
+             TLSLogMessageOptionsNone,
+             @"suppressed %@ messages from %@:%d in %.3gs",
+             _GroupedCount(suppressedCount),
+             file.lastPathComponent,
+             callsite->line,
+             seconds);
+}
+
+- (void)_throttleSummarizeAllSuppressedCallsites
+{
+    pthread_mutex_lock(&_throttleLock);
+    NSArray<NSValue *> *callsites = _suppressedCallsiteChannelsM.allKeys;
+    pthread_mutex_unlock(&_throttleLock);
+
+    if (callsites.count > 0) {
+        const uint64_t now = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+        for (NSValue *callsite in callsites) {
+            [self _throttleSummarizeCallsite:(TLSLogCallsite *)callsite.pointerValue channel:nil now:now];
+        }
+    }
+}
+
+- (void)_loadSheddingUpdate
+{
+    const NSUInteger threshold = self.loadSheddingBacklogThreshold;
+    const BOOL shedding = (0 != atomic_load_explicit(&_loadSheddingLevels, memory_order_relaxed));
+    if (!shedding && 0 == threshold) {
+        return;
+    }
+
+    const NSUInteger backlog = atomic_load_explicit(&_metrics.transactionQueueDepth, memory_order_relaxed)
+                             + atomic_load_explicit(&_pendingOutputCount, memory_order_relaxed);
+    if (!shedding) {
+        if (backlog > threshold) {
+            [self _loadSheddingStartWithBacklog:backlog];
+        }
+    } else if (backlog <= threshold / 4) {
+        // the low watermark keeps a backlog hovering around the threshold from flapping
+        [self _loadSheddingEnd];
+    }
+}
+
+- (void)_loadSheddingStartWithBacklog:(NSUInteger)backlog
+{
+    const TLSLogLevel level = self.loadSheddingLevel;
+    // every level less severe than the shedding level
+    const unsigned int levels = TLSLogLevelMaskAll & ~((1u << (level + 1)) - 1);
+    if (0 == levels) {
+        return;
+    }
+
+    pthread_mutex_lock(&_loadSheddingLock);
+    const BOOL started = (0 == atomic_load_explicit(&_loadSheddingLevels, memory_order_relaxed));
+    if (started) {
+        _loadSheddingStartTime = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+        _loadSheddingStartShedCount = atomic_load_explicit(&_metrics.shedCount, memory_order_relaxed);
+        _loadSheddingStartOutputCount = atomic_load_explicit(&_metrics.outputCount, memory_order_relaxed);
+        _loadSheddingStartPendingOutputCount = atomic_load_explicit(&_pendingOutputCount, memory_order_relaxed);
+        atomic_store_explicit(&_loadSheddingLevels, levels, memory_order_relaxed);
+    }
+    pthread_mutex_unlock(&_loadSheddingLock);
+
+    if (!started) {
+        // another thread got to it first
+        return;
+    }
+
+    TLSLogEx(self,
+             MIN(TLSLogLevelWarning, level),
+             TLSLoggingServiceChannel,
+             @(TLS_FILE_NAME),
+             @(__FUNCTION__),
+             __LINE__,
+             nil /*contextObject*/,
+             TLSLogMessageOptionsNone,
+             @"load shedding started with a backlog of %@ log messages, shedding log messages below %@",
+             _GroupedCount(backlog),
+             TLSLogLevelToString(level));
+}
+
+- (void)_loadSheddingEnd
+{
+    pthread_mutex_lock(&_loadSheddingLock);
+    const BOOL ended = (0 != atomic_load_explicit(&_loadSheddingLevels, memory_order_relaxed));
+    uint64_t duration = 0;
+    uint64_t shedCount = 0;
+    uint64_t drainedCount = 0;
+    if (ended) {
+        atomic_store_explicit(&_loadSheddingLevels, 0, memory_order_relaxed);
+        duration = clock_gettime_nsec_np(CLOCK_UPTIME_RAW) - _loadSheddingStartTime;
+        shedCount = atomic_load_explicit(&_metrics.shedCount, memory_order_relaxed) - _loadSheddingStartShedCount;
+        // log messages that reached the logging queue plus the ones that were already pending, minus what is still pending
+        const uint64_t outputCount = atomic_load_explicit(&_metrics.outputCount, memory_order_relaxed) - _loadSheddingStartOutputCount;
+        const NSUInteger pendingOutputCount = atomic_load_explicit(&_pendingOutputCount, memory_order_relaxed);
+        const uint64_t outputAndPendingCount = outputCount + _loadSheddingStartPendingOutputCount;
+        drainedCount = (outputAndPendingCount > pendingOutputCount) ? outputAndPendingCount - pendingOutputCount : 0;
+    }
+    pthread_mutex_unlock(&_loadSheddingLock);
+
+    if (!ended) {
+        // another thread got to it first
+        return;
+    }
+
+    const double seconds = (double)duration / (double)NSEC_PER_SEC;
+    TLSLogEx(self,
+             MIN(TLSLogLevelWarning, self.loadSheddingLevel),
+             TLSLoggingServiceChannel,
+             @(TLS_FILE_NAME),
+             @(__FUNCTION__),
+             __LINE__,
+             nil /*contextObject*/,
+             TLSLogMessageOptionsNone,
+             @"load shedding ended after %.3gs, shed %@ log messages while the backlog drained at %@ log messages per second",
+             seconds,
+             _GroupedCount(shedCount),
+             _GroupedCount((seconds > 0) ? (uint64_t)((double)drainedCount / seconds) : drainedCount));
+}
+
+- (void)_workloadCaptureCallAtTime:(uint64_t)time
+                             level:(TLSLogLevel)level
+                           channel:(NSString *)channel
+                              file:(const char *)file
+                        fileString:(NSString *)fileString
+                          function:(NSString *)function
+                              line:(NSInteger)line
+                           message:(NSString *)message
+                          filtered:(BOOL)filtered
+{
+    if (!atomic_load_explicit(&_workloadCapturing, memory_order_relaxed)) {
+        return;
+    }
+
+    const uint32_t threadId = pthread_mach_thread_np(pthread_self());
+    const NSUInteger messageLength = [message lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+    // the writer buffers per thread, the lock is only shared to keep the writer from being swapped out
+    pthread_rwlock_rdlock(&_workloadCaptureLock);
+    __unsafe_unretained TLSWorkloadTraceWriter *writer = _workloadCaptureWriter;
+    [writer addCallAtTime:time
+                 threadId:threadId
+                    level:level
+                  channel:channel
+                     file:file
+               fileString:fileString
+                 function:function
+                     line:line
+            messageLength:messageLength
+                 filtered:filtered];
+    pthread_rwlock_unlock(&_workloadCaptureLock);
+}
+
+- (id)_contextSnapshotOfObject:(id)contextObject dropMessage:(BOOL *)dropMessageOut
+{
+    if (![contextObject conformsToProtocol:@protocol(TLSLogContextSnapshotting)]) {
+        return contextObject;
+    }
+
+#if TLSCANLOGMODE == TLSCANLOGMODE_CHECKFULL
+    // already taken (and accounted for) by the check of this log message
+    NSMutableDictionary *threadDictionary = [NSThread currentThread].threadDictionary;
+    TLSLogContextSnapshot *checkedSnapshot = [threadDictionary[kCanLogContextSnapshotsThreadKey] objectForKey:contextObject];
+    if (checkedSnapshot) {
+        [threadDictionary removeObjectForKey:kCanLogContextSnapshotsThreadKey];
+        return checkedSnapshot;
+    }
+#endif
+
+    const NSUInteger budget = self.contextSnapshotByteBudget;
+    TLSLogContextSnapshot *snapshot = [(id<TLSLogContextSnapshotting>)contextObject tls_logContextSnapshot];
+    if ([snapshot tls_accountInLedger:_contextSnapshotLedger budget:budget]) {
+        return snapshot;
+    }
+
+    // over budget, keep what output streams filter on (without the context a message could pass filters it should not)
+    TLSLogContextSnapshot *minimalSnapshot = [[TLSLogContextSnapshot alloc] initWithObject:contextObject
+                                                                                 filterKey:snapshot.filterKey
+                                                                                    fields:nil];
+    if ([minimalSnapshot tls_accountInLedger:_contextSnapshotLedger budget:budget]) {
+        return minimalSnapshot;
+    }
+
+    // not even that fits, drop the log message rather than log it without its context
+    *dropMessageOut = YES;
+    return nil;
+}
+
+- (NSString *)_cappedMessage:(NSString *)message
+                       level:(TLSLogLevel)level
+                     channel:(NSString *)channel
+                        file:(NSString *)file
+                    function:(NSString *)function
+                        line:(NSInteger)line
+               contextObject:(id)contextObject
+{
+    const NSUInteger maximumMessageLength = self.maximumSafeMessageLength;
+    const NSUInteger length = message.length;
+    if (0 == maximumMessageLength || length <= maximumMessageLength) {
+        return message;
+    }
+
+    NSUInteger lengthToLog = maximumMessageLength;
+    const id<TLSLoggingServiceDelegate> delegate = self.delegate;
+    if ([delegate respondsToSelector:@selector(tls_loggingService:lengthToLogForMessageExceedingMaxSafeLength:level:channel:file:function:line:contextObject:message:)]) {
+        lengthToLog = [delegate tls_loggingService:self
+       lengthToLogForMessageExceedingMaxSafeLength:maximumMessageLength
+                                             level:level
+                                           channel:channel
+                                              file:file
+                                          function:function
+                                              line:line
+                                     contextObject:contextObject
+                                           message:message];
+    }
+
+    if (!lengthToLog) {
+        return nil;
+    } else if (lengthToLog < length) {
+        return [message substringToIndex:lengthToLog];
+    }
+    return message;
+}
+
 @end
 
 @implementation TLSLoggingService (Advanced)
@@ -396,6 +1582,181 @@ static NSString * const kMainThreadName = @"Main";
 
 // see `@implementation TLSLoggingService` for `- (void)addOutputStream:(id<TLSOutputStream>)stream`
 
+- (void)beginLaunchCaptureWithCapacity:(NSUInteger)capacity
+{
+    if (0 == capacity) {
+        return;
+    }
+
+    // before the transaction, so that log messages from this point on are not filtered before they get to the capture
+    atomic_store_explicit(&_launchCapturing, true, memory_order_relaxed);
+    [self dispatchAsynchronousTransaction:^{
+        if (!self->_transactionLaunchCaptureM) {
+            self->_transactionLaunchCaptureM = [[NSMutableArray alloc] init];
+        }
+        self->_transactionLaunchCaptureCapacity = capacity;
+        if (self->_transactionLaunchCaptureM.count >= capacity) {
+            atomic_store_explicit(&self->_launchCapturing, false, memory_order_relaxed);
+        }
+    }];
+}
+
+- (void)endLaunchCapture
+{
+    [self dispatchAsynchronousTransaction:^{
+        self->_transactionLaunchCaptureM = nil;
+        self->_transactionLaunchCaptureCapacity = 0;
+        self->_transactionLaunchCaptureSeenCountsM = nil;
+        atomic_store_explicit(&self->_launchCapturing, false, memory_order_relaxed);
+        [self _nonquickFilter_resetQuickFilter:self->_streamsM.count];
+    }];
+}
+
+- (BOOL)beginWorkloadCaptureToFilePath:(NSString *)filePath
+                                 error:(out NSError **)errorOut
+{
+    TLSWorkloadTraceWriter *writer = [[TLSWorkloadTraceWriter alloc] initWithFilePath:filePath error:errorOut];
+    if (!writer) {
+        return NO;
+    }
+
+    pthread_rwlock_wrlock(&_workloadCaptureLock);
+    TLSWorkloadTraceWriter *previousWriter = _workloadCaptureWriter;
+    _workloadCaptureWriter = writer;
+    atomic_store_explicit(&_workloadCapturing, true, memory_order_relaxed);
+    pthread_rwlock_unlock(&_workloadCaptureLock);
+
+    [previousWriter close];
+    return YES;
+}
+
+- (void)endWorkloadCapture
+{
+    pthread_rwlock_wrlock(&_workloadCaptureLock);
+    TLSWorkloadTraceWriter *writer = _workloadCaptureWriter;
+    _workloadCaptureWriter = nil;
+    atomic_store_explicit(&_workloadCapturing, false, memory_order_relaxed);
+    pthread_rwlock_unlock(&_workloadCaptureLock);
+
+    [writer close];
+}
+
+- (void)logMessageInfo:(TLSLogMessageInfo *)info
+{
+    [self logMessageInfos:@[info]];
+}
+
+- (void)logMessageInfos:(NSArray<TLSLogMessageInfo *> *)infos
+{
+    const unsigned int shedLevels = atomic_load_explicit(&_loadSheddingLevels, memory_order_relaxed);
+    if (shedLevels != 0) {
+        NSIndexSet *keptIndexes = [infos indexesOfObjectsPassingTest:^BOOL(TLSLogMessageInfo *info, NSUInteger idx, BOOL *stop) {
+            return TLS_BITMASK_EXCLUDES_FLAGS(shedLevels, (1 << info.level));
+        }];
+        TLSMetricsAdd(&_metrics.shedCount, infos.count - keptIndexes.count);
+        infos = [infos objectsAtIndexes:keptIndexes];
+    }
+
+    const NSUInteger count = infos.count;
+    if (0 == count) {
+        return;
+    }
+
+    TLSMetricsAdd(&_metrics.submittedCount, count);
+
+    // the infos belong to the caller, submit copies carrying the snapshot of their context,
+    // their capped message (like the messages formatted by the service) and their sequence number
+    const NSUInteger maximumMessageByteLength = self.maximumMessageByteLength;
+    const BOOL capped = (maximumMessageByteLength > 0 || self.maximumSafeMessageLength > 0);
+    NSMutableArray<TLSLogMessageInfo *> *submittedInfos = [[NSMutableArray alloc] initWithCapacity:count];
+    for (TLSLogMessageInfo *info in infos) {
+        BOOL dropMessage = NO;
+        id contextObject = [self _contextSnapshotOfObject:info.contextObject dropMessage:&dropMessage];
+        NSString *message = info.message;
+        if (!dropMessage && capped) {
+            if (maximumMessageByteLength > 0) {
+                message = TLSBoundedString(maximumMessageByteLength, message, NULL);
+            }
+            message = [self _cappedMessage:message
+                                     level:info.level
+                                   channel:info.channel
+                                      file:info.file
+                                  function:info.function
+                                      line:info.line
+                             contextObject:contextObject];
+            dropMessage = !message;
+        }
+        if (dropMessage) {
+            TLSMetricsIncrement(&_metrics.droppedCount);
+        } else {
+            [submittedInfos addObject:[info tls_infoWithMessage:message contextObject:contextObject]];
+        }
+    }
+    infos = submittedInfos;
+    if (0 == infos.count) {
+        return;
+    }
+
+    uint64_t sequenceNumber = atomic_fetch_add_explicit(&_sequenceNumber, infos.count, memory_order_relaxed);
+    for (TLSLogMessageInfo *info in infos) {
+        [info tls_setSequenceNumber:++sequenceNumber];
+    }
+
+    // the whole batch in 1 transaction
+    const uint64_t submitTime = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+    [self dispatchAsynchronousTransaction:^{
+        TLSHistogramRecord(&self->_metrics.transactionLatency, clock_gettime_nsec_np(CLOCK_UPTIME_RAW) - submitTime);
+        if (self->_streamsM.count > 0 || self->_transactionLaunchCaptureM) {
+            for (TLSLogMessageInfo *info in infos) {
+                [self _transaction_submitLogInfo:info];
+            }
+        } else {
+            TLSMetricsAdd(&self->_metrics.droppedCount, infos.count);
+        }
+        [self _loadSheddingUpdate];
+    }];
+    [self _loadSheddingUpdate];
+}
+
+- (void)setThrottle:(TLSLogThrottle *)throttle forChannel:(NSString *)channel
+{
+    if (!channel) {
+        return;
+    }
+
+    pthread_mutex_lock(&_throttleLock);
+    _throttlesByChannelM[channel] = throttle;
+    pthread_mutex_unlock(&_throttleLock);
+    atomic_fetch_add_explicit(&sThrottleGeneration, 1, memory_order_release);
+}
+
+- (void)setThrottle:(TLSLogThrottle *)throttle forCallsiteFile:(NSString *)file line:(NSInteger)line
+{
+    if (!file) {
+        return;
+    }
+
+    pthread_mutex_lock(&_throttleLock);
+    _throttlesByCallsiteM[_CallsiteKey(file, line)] = throttle;
+    pthread_mutex_unlock(&_throttleLock);
+    atomic_fetch_add_explicit(&sThrottleGeneration, 1, memory_order_release);
+}
+
+- (void)setRedactor:(TLSLogRedactor *)redactor forOutputStream:(id<TLSOutputStream>)stream
+{
+    if (!stream) {
+        return;
+    }
+
+    [self dispatchAsynchronousTransaction:^{
+        if (redactor) {
+            [self->_transactionRedactorsM setObject:redactor forKey:stream];
+        } else {
+            [self->_transactionRedactorsM removeObjectForKey:stream];
+        }
+    }];
+}
+
 - (void)removeOutputStream:(id<TLSOutputStream>)stream
 {
     if (!stream) {
@@ -405,14 +1766,27 @@ static NSString * const kMainThreadName = @"Main";
     [self dispatchAsynchronousTransaction:^{
         if ([self->_streamsM containsObject:stream]) {
             [self->_streamsM removeObject:stream];
+            [self->_transactionStreamMetricsRecordersM removeObjectForKey:stream];
+            [self->_transactionRedactorsM removeObjectForKey:stream];
+            [self _transaction_publishStreamMetricsRecorders];
+            if (self->_transactionLaunchCaptureM) {
+                // the stream has seen every captured log message, replayed or as it was logged
+                if (!self->_transactionLaunchCaptureSeenCountsM) {
+                    self->_transactionLaunchCaptureSeenCountsM = [NSMapTable weakToStrongObjectsMapTable];
+                }
+                [self->_transactionLaunchCaptureSeenCountsM setObject:@(self->_transactionLaunchCaptureM.count) forKey:stream];
+            }
 
             [self _nonquickFilter_resetQuickFilter:self->_streamsM.count];
 
             dispatch_async(self->_loggingQueue, ^{
                 @autoreleasepool {
-                    if ([stream respondsToSelector:@selector(tls_flush)]) {
-                        [stream tls_flush];
-                    }
+                    [self _logging_performOnOutputStream:stream block:^{
+                        if ([stream respondsToSelector:@selector(tls_flush)]) {
+                            [stream tls_flush];
+                        }
+                    }];
+                    [self->_loggingIsolatedStreamsM removeObjectForKey:stream];
                 }
             });
         }
@@ -454,7 +1828,9 @@ static NSString * const kMainThreadName = @"Main";
 
 - (void)dispatchAsynchronousTransaction:(dispatch_block_t)block
 {
+    atomic_fetch_add_explicit(&_metrics.transactionQueueDepth, 1, memory_order_relaxed);
     dispatch_async(_transactionQueue, ^{
+        atomic_fetch_sub_explicit(&self->_metrics.transactionQueueDepth, 1, memory_order_relaxed);
         @autoreleasepool {
             block();
         }
@@ -463,10 +1839,13 @@ static NSString * const kMainThreadName = @"Main";
 
 - (void)flush
 {
+    [self _throttleSummarizeAllSuppressedCallsites];
+
     // get all log message transactions onto the logging queue
     // and get our output streams from the transaction queue
     __block NSSet *streams = nil;
     [self dispatchSynchronousTransaction:^{
+        [self _transaction_summarizeAllRepeatedMessageRuns];
         streams = [self->_streamsM copy];
     }];
 
@@ -474,9 +1853,12 @@ static NSString * const kMainThreadName = @"Main";
     @autoreleasepool {
         dispatch_sync(_loggingQueue, ^{
             for (id<TLSOutputStream> stream in streams) {
-                if ([stream respondsToSelector:@selector(tls_flush)]) {
-                    [stream tls_flush];
-                }
+                // an isolated stream is drained even when it has nothing to flush
+                [self _logging_performOnOutputStream:stream block:^{
+                    if ([stream respondsToSelector:@selector(tls_flush)]) {
+                        [stream tls_flush];
+                    }
+                }];
             }
         });
     }
@@ -533,12 +1915,68 @@ static NSString * const kMainThreadName = @"Main";
     __block NSData *data;
     @autoreleasepool {
         dispatch_sync(_loggingQueue, ^{
-            data = [stream tls_retrieveLoggedData:maxBytes];
+            [self _logging_performOnOutputStream:stream block:^{
+                data = [stream tls_retrieveLoggedData:maxBytes];
+            }];
         });
     }
     return data;
 }
 
+- (void)enumerateIndexedRecordsFromOutputStream:(id<TLSOutputStream, TLSIndexedDataRetrieval>)stream
+                                  matchingQuery:(TLSLogIndexQuery *)query
+                                     usingBlock:(TLSLogIndexRecordBlock)block
+{
+    if (![stream conformsToProtocol:@protocol(TLSIndexedDataRetrieval)]) {
+        return;
+    }
+
+    // get everything dispatched so far through to the stream and its index before querying,
+    // only that is done on the logging queue: the query runs on the calling thread while logging carries on
+    dispatch_sync(_transactionQueue, ^{});
+    __block NSArray<NSString *> *logFilePaths = nil;
+    dispatch_sync(_loggingQueue, ^{
+        @autoreleasepool {
+            [self _logging_performOnOutputStream:stream block:^{
+                logFilePaths = [stream tls_indexedLogFilePaths];
+            }];
+        }
+    });
+
+    if (logFilePaths.count > 0) {
+        (void)TLSLogIndexEnumerateRecords(logFilePaths, query, block);
+    }
+}
+
+- (TLSLoggingMetrics *)metricsSnapshot
+{
+    NSArray<TLSOutputStreamMetricsRecorder *> *recorders = self.streamMetricsRecorders;
+    NSMutableArray<TLSOutputStreamMetrics *> *streamMetrics = [[NSMutableArray alloc] initWithCapacity:recorders.count];
+    for (TLSOutputStreamMetricsRecorder *recorder in recorders) {
+        [streamMetrics addObject:[recorder snapshot]];
+    }
+    return TLSLoggingMetricsSnapshot(&_metrics,
+                                     _contextSnapshotLedger,
+                                     atomic_load_explicit(&_pendingOutputCount, memory_order_relaxed),
+                                     streamMetrics);
+}
+
+- (void)setMetricsReportingInterval:(NSTimeInterval)interval
+{
+    [self dispatchAsynchronousTransaction:^{
+        [self _transaction_setMetricsReportingInterval:interval];
+    }];
+}
+
+- (NSTimeInterval)metricsReportingInterval
+{
+    __block NSTimeInterval interval;
+    [self dispatchSynchronousTransaction:^{
+        interval = self->_transactionMetricsReportingInterval;
+    }];
+    return interval;
+}
+
 @end
 
 void TLSvaLog(TLSLoggingService *service,
@@ -559,6 +1997,9 @@ void TLSvaLog(TLSLoggingService *service,
                                                    line:line
                                                 context:contextObject
                                                 options:options
+                                                 fields:NULL
+                                             fieldCount:0
+                                                payload:nil
                                                  format:format
                                               arguments:arguments];
 }
@@ -588,6 +2029,63 @@ void TLSLogEx(TLSLoggingService *service,
     va_end(arguments);
 }
 
+void TLSLogFieldsEx(TLSLoggingService *service,
+                    TLSLogLevel level,
+                    NSString *channel,
+                    NSString *file,
+                    NSString *function,
+                    NSInteger line,
+                    id contextObject,
+                    TLSLogMessageOptions options,
+                    const TLSLogField *fields,
+                    NSUInteger fieldCount,
+                    NSString *format, ...)
+{
+    va_list arguments;
+    va_start(arguments, format);
+    [(service ?: sLoggingService) _logDispatchWithLevel:level
+                                                channel:channel
+                                                   file:file
+                                               function:function
+                                                   line:line
+                                                context:contextObject
+                                                options:options
+                                                 fields:fields
+                                             fieldCount:fieldCount
+                                                payload:nil
+                                                 format:format
+                                              arguments:arguments];
+    va_end(arguments);
+}
+
+void TLSLogDataEx(TLSLoggingService *service,
+                  TLSLogLevel level,
+                  NSString *channel,
+                  NSString *file,
+                  NSString *function,
+                  NSInteger line,
+                  id contextObject,
+                  TLSLogMessageOptions options,
+                  NSData *payload,
+                  NSString *format, ...)
+{
+    va_list arguments;
+    va_start(arguments, format);
+    [(service ?: sLoggingService) _logDispatchWithLevel:level
+                                                channel:channel
+                                                   file:file
+                                               function:function
+                                                   line:line
+                                                context:contextObject
+                                                options:options
+                                                 fields:NULL
+                                             fieldCount:0
+                                                payload:payload
+                                                 format:format
+                                              arguments:arguments];
+    va_end(arguments);
+}
+
 void TLSLogString(TLSLoggingService *service,
                   TLSLogLevel level,
                   NSString *channel,
@@ -620,6 +2118,52 @@ BOOL TLSCanLog(TLSLoggingService *service,
                                                   context:contextObject];
 }
 
+BOOL TLSCanLogCallsite(TLSLoggingService *service,
+                       TLSLogLevel level,
+                       NSString *channel,
+                       id contextObject,
+                       TLSLogCallsite *callsite)
+{
+    TLSLoggingService *loggingService = service ?: sLoggingService;
+    const BOOL canLog = [loggingService _canLogWithLevel:level channel:channel context:contextObject]
+                        && (!callsite || [loggingService _throttlePermitCallsite:callsite level:level channel:channel]);
+    if (!canLog && callsite) {
+        [loggingService _workloadCaptureCallAtTime:clock_gettime_nsec_np(CLOCK_UPTIME_RAW)
+                                             level:level
+                                           channel:channel
+                                              file:callsite->file
+                                        fileString:nil
+                                          function:nil
+                                              line:callsite->line
+                                           message:nil
+                                          filtered:YES];
+    }
+    return canLog;
+}
+
+static NSString *_GroupedCount(uint64_t count)
+{
+    NSMutableString *string = [NSMutableString stringWithFormat:@"%llu", count];
+    for (NSInteger i = (NSInteger)string.length - 3; i > 0; i -= 3) {
+        [string insertString:@"," atIndex:(NSUInteger)i];
+    }
+    return string;
+}
+
+static NSString *_CallsiteKey(NSString *file, NSInteger line)
+{
+    return [NSString stringWithFormat:@"%@:%ld", file.lastPathComponent, (long)line];
+}
+
+static NSUInteger _RepeatHash(TLSLogMessageInfo *info)
+{
+    NSUInteger hash = info.message.hash;
+    hash = (hash * 31) + info.file.hash;
+    hash = (hash * 31) + (NSUInteger)info.line;
+    hash = (hash * 31) + (NSUInteger)info.level;
+    return hash;
+}
+
 NSString *TLSCurrentThreadName()
 {
     if ([NSThread isMainThread]) {
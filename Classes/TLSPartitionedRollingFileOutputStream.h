@@ -0,0 +1,172 @@
+//
+//  TLSPartitionedRollingFileOutputStream.h
+//  TwitterLoggingService
+//
+//  Created on 10/18/26.
+//  Copyright (c) 2026 Twitter, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//          http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import <TwitterLoggingService/TLSFileOutputStream.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ Configuration of a single partition of a `TLSPartitionedRollingFileOutputStream`.
+
+ Each partition has its own set of rolling log files with its own retention so that noisy channels
+ cannot evict the history of quieter ones.
+ */
+@interface TLSRollingFilePartition : NSObject
+
+/** The name of the partition, used in its log file names.  Cannot contain `.` nor `/`. */
+@property (nonatomic, copy, readonly) NSString *name;
+/** The channels routed to the partition, `nil` for the partition that gets all other channels */
+@property (nonatomic, nullable, copy, readonly) NSSet<NSString *> *channels;
+/** Max number of log files for the partition.  Min is `1`, max is `1024`. */
+@property (nonatomic, readonly) NSUInteger maxLogFiles;
+/** Max bytes per log file for the partition (soft limit).  Min is `1KB`, max is `1GB`. */
+@property (nonatomic, readonly) NSUInteger maxBytesPerLogFile;
+
+/**
+ Initialize a `TLSRollingFilePartition`
+ @param name the name of the partition
+ @param channels the channels to route to the partition, `nil` to route all channels not routed to another partition
+ @param maxLogFiles the maximum number of log files to keep for the partition
+ @param maxBytesPerLogFile the max bytes per log file before the partition's log is rolled over
+ */
+- (instancetype)initWithName:(NSString *)name
+                    channels:(nullable NSSet<NSString *> *)channels
+                 maxLogFiles:(NSUInteger)maxLogFiles
+          maxBytesPerLogFile:(NSUInteger)maxBytesPerLogFile NS_DESIGNATED_INITIALIZER;
+
+/** NS_UNAVAILABLE */
+- (instancetype)init NS_UNAVAILABLE;
+/** NS_UNAVAILABLE */
++ (instancetype)new NS_UNAVAILABLE;
+
+@end
+
+/**
+ A concrete `TLSOutputStream` that logs to rolling log files partitioned by channel.
+
+ Rather than adding one `TLSRollingFileOutputStream` per subsystem, one partitioned stream routes
+ each message to its partition with a single lookup and shares the work between partitions:
+ a single directory scan on initialization, an in memory list of each partition's log files and a
+ bounded number of open files at any given time (least recently used files are closed and later
+ reopened for appending).
+
+ Each partition writes through its own `TLSRollingFileOutputStream` (created on the partition's
+ first message), so partitions get the same rollover, pruning, asynchronous writes, durability,
+ metrics and log events as a standalone rolling stream.
+
+ Log files are named `<logFilePrefix><partition name>.<id>.log`.
+ Messages to channels without a partition are filtered, unless a partition with `nil` channels is provided.
+
+ ## Constants
+
+    FOUNDATION_EXTERN const NSUInteger TLSPartitionedRollingFileOutputStreamDefaultMaxOpenFiles;      // 4 files
+    FOUNDATION_EXTERN NSString * const TLSPartitionedRollingFileOutputStreamDefaultLogFilePrefix;     // @"partition."
+
+ @note Use a `logFilePrefix` that no `TLSRollingFileOutputStream` logging to the same directory uses, otherwise they will prune each other's log files.
+ */
+@interface TLSPartitionedRollingFileOutputStream : NSObject <TLSOutputStream, TLSDataRetrieval>
+
+/** The directory containing the log files */
+@property (nonatomic, copy, readonly) NSString *logFileDirectoryPath;
+/** The prefix for each log file */
+@property (nonatomic, copy, readonly) NSString *logFilePrefix;
+/** The partitions, in the order provided */
+@property (nonatomic, copy, readonly) NSArray<TLSRollingFilePartition *> *partitions;
+/** The maximum number of log files kept open at once.  Min is `1`. */
+@property (nonatomic, readonly) NSUInteger maxOpenFiles;
+
+/**
+ The format to log the message with.
+ Default is `TLSComposeLogMessageInfoDefaultOptions`
+ */
+@property (nonatomic) TLSComposeLogMessageInfoOptions composeLogMessageOptions;
+
+/**
+ Size in bytes of each asynchronous write buffer of the partitions' log files, see `[TLSFileOutputStream asynchronousWriteBufferSize]`.
+ Default is `0` (disabled).
+ Set before adding the stream to a `TLSLoggingService`.
+ */
+@property (nonatomic) NSUInteger asynchronousWriteBufferSize;
+
+/**
+ Initialize the `TLSPartitionedRollingFileOutputStream` with the provided settings
+ @param logFileDirectoryPath the directory where the log files will live. By default uses `[TLSFileOutputStream defaultLogFileDirectoryPath]`.
+ @param logFilePrefix the string to prefix all created log files with. Default is `TLSPartitionedRollingFileOutputStreamDefaultLogFilePrefix`.
+ @param partitions the partitions to route log messages to.  Names must be unique, a channel can only be routed to one partition and only one partition can have `nil` channels.
+ @param maxOpenFiles the maximum number of log files to keep open.  Default is `TLSPartitionedRollingFileOutputStreamDefaultMaxOpenFiles`.
+ @param errorOut an output reference to get any errors that occur while creating the output stream.  If there is an error, the return value will be `nil`.
+ */
+- (nullable instancetype)initWithLogFileDirectoryPath:(nullable NSString *)logFileDirectoryPath
+                                        logFilePrefix:(nullable NSString *)logFilePrefix
+                                           partitions:(NSArray<TLSRollingFilePartition *> *)partitions
+                                         maxOpenFiles:(NSUInteger)maxOpenFiles
+                                                error:(out NSError * __nullable __autoreleasing * __nullable)errorOut NS_DESIGNATED_INITIALIZER;
+
+/** See initWithLogFileDirectoryPath:logFilePrefix:partitions:maxOpenFiles:error: */
+- (nullable instancetype)initWithPartitions:(NSArray<TLSRollingFilePartition *> *)partitions
+                                      error:(out NSError * __nullable __autoreleasing * __nullable)errorOut;
+
+/** NS_UNAVAILABLE */
+- (instancetype)init NS_UNAVAILABLE;
+/** NS_UNAVAILABLE */
++ (instancetype)new NS_UNAVAILABLE;
+
+/**
+ Set the durability for messages logged at any of the given levels, for every partition.
+ See `[TLSFileOutputStream setDurability:forLevels:]`.
+ Call before adding the stream to a `TLSLoggingService`.
+ */
+- (void)setDurability:(TLSFileOutputDurability)durability
+            forLevels:(TLSLogLevelMask)levels;
+
+/**
+ @return the `TLSFileOutputDurability` for messages logged at the given _level_
+ */
+- (TLSFileOutputDurability)durabilityForLevel:(TLSLogLevel)level;
+
+/**
+ The log files of a partition, oldest to newest.
+ Safe to call from any thread.
+ @param partitionName the `name` of the partition
+ @return the log file paths or `nil` if there is no such partition
+ */
+- (nullable NSArray<NSString *> *)logFilePathsForPartitionNamed:(NSString *)partitionName;
+
+/**
+ Get the past logged data of a single partition.
+ Safe to call from any thread, call `[TLSLoggingService flush]` first to include buffered messages.
+ @param partitionName the `name` of the partition
+ @param maxBytes The maximum number of bytes to get, see `tls_retrieveLoggedData:`
+ */
+- (nullable NSData *)retrieveLoggedDataForPartitionNamed:(NSString *)partitionName
+                                                maxBytes:(NSUInteger)maxBytes;
+
+#pragma mark - protocol TLSDataRetrieval
+/**
+ Get the past logged data of all partitions, in partition order.
+ @param maxBytes The maximum number of bytes to get, split evenly between the partitions.  Like `TLSRollingFileOutputStream`, whole log files are loaded (newest first) and each partition provides at least its newest log file.
+ */
+- (nullable NSData *)tls_retrieveLoggedData:(NSUInteger)maxBytes;
+
+@end
+
+FOUNDATION_EXTERN const NSUInteger TLSPartitionedRollingFileOutputStreamDefaultMaxOpenFiles;      // 4 files
+FOUNDATION_EXTERN NSString * const TLSPartitionedRollingFileOutputStreamDefaultLogFilePrefix;     // @"partition."
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,508 @@
+//
+//  TLSPartitionedRollingFileOutputStream.m
+//  TwitterLoggingService
+//
+//  Created on 10/18/26.
+//  Copyright (c) 2026 Twitter, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//          http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import "TLS_Project.h"
+#import "TLSFileOutputStream+Protected.h"
+#import "TLSPartitionedRollingFileOutputStream.h"
+#import "TLSRollingFileOutputStream.h"
+
+const NSUInteger TLSPartitionedRollingFileOutputStreamDefaultMaxOpenFiles = 4;
+NSString * const TLSPartitionedRollingFileOutputStreamDefaultLogFilePrefix = @"partition.";
+
+static NSString * const kLogFileExtension = @"log";
+
+static const NSUInteger kMinLogFiles = 1;
+static const NSUInteger kMaxLogFiles = 1024;
+
+static const NSUInteger kMinBytesPerFile = 1024; // 1 KB
+static const NSUInteger kMaxBytesPerFile = 1 * 1024 * 1024 * 1024; // 1 GB
+
+static NSData *_RetrieveLoggedData(NSArray<NSString *> *logFilePaths, NSUInteger maxBytes);
+static NSData *_RetrieveLoggedData(NSArray<NSString *> *logFilePaths, NSUInteger maxBytes)
+{
+    NSMutableData *data = nil;
+    NSFileManager *fm = [NSFileManager defaultManager];
+
+    // go through the logs, newest to oldest
+    // prepend 1 log file at a time so long as it doesn't exceed our maximum size restrictions
+    for (NSInteger i = ((NSInteger)logFilePaths.count - 1); i >= 0; i--) {
+        @autoreleasepool {
+            NSString *logPath = logFilePaths[(NSUInteger)i];
+            if (!data || ((data.length + [fm attributesOfItemAtPath:logPath error:NULL].fileSize) <= maxBytes)) {
+                NSMutableData *fileData = [NSMutableData dataWithContentsOfFile:logPath];
+                if (!fileData) {
+                    // pruned from under us
+                    continue;
+                }
+                if (data) {
+                    [fileData appendData:data];
+                }
+                data = fileData;
+            } else {
+                break;
+            }
+        }
+    }
+
+    return data;
+}
+
+@implementation TLSRollingFilePartition
+
+- (instancetype)initWithName:(NSString *)name
+                    channels:(NSSet<NSString *> *)channels
+                 maxLogFiles:(NSUInteger)maxLogFiles
+          maxBytesPerLogFile:(NSUInteger)maxBytesPerLogFile
+{
+    if (self = [super init]) {
+        _name = [name copy];
+        _channels = [channels copy];
+        _maxLogFiles = MAX(MIN(maxLogFiles, kMaxLogFiles), kMinLogFiles);
+        _maxBytesPerLogFile = MAX(MIN(maxBytesPerLogFile, kMaxBytesPerFile), kMinBytesPerFile);
+    }
+    return self;
+}
+
+- (instancetype)init
+{
+    [self doesNotRecognizeSelector:_cmd];
+    abort();
+}
+
+- (NSString *)description
+{
+    return [NSString stringWithFormat:@"<%@ %p: name=%@, channels=%@, maxLogFiles=%tu, maxBytesPerLogFile=%tu>", NSStringFromClass([self class]), self, _name, (_channels) ? _channels.allObjects : @"*", _maxLogFiles, _maxBytesPerLogFile];
+}
+
+@end
+
+/**
+ The mutable state of a partition, owned by the logging queue except for `logFilePathsSnapshot`
+ and `logFileStream` (read for `tls_metricCounters`)
+ */
+TLS_OBJC_FINAL
+@interface TLSRollingFilePartitionState : NSObject
+@property (tls_nonatomic_direct, readonly) TLSRollingFilePartition *partition;
+@property (tls_nonatomic_direct, readonly) NSMutableArray<NSString *> *logFilePaths; // oldest to newest
+@property (tls_atomic_direct, copy) NSArray<NSString *> *logFilePathsSnapshot;
+@property (tls_atomic_direct, nullable) TLSRollingFileOutputStream *logFileStream;
+- (instancetype)initWithPartition:(TLSRollingFilePartition *)partition TLS_OBJC_DIRECT;
+@end
+
+@implementation TLSRollingFilePartitionState
+
+- (instancetype)initWithPartition:(TLSRollingFilePartition *)partition
+{
+    if (self = [super init]) {
+        _partition = partition;
+        _logFilePaths = [[NSMutableArray alloc] init];
+        _logFilePathsSnapshot = @[];
+    }
+    return self;
+}
+
+@end
+
+TLS_OBJC_DIRECT_MEMBERS
+@interface TLSPartitionedRollingFileOutputStream (Private)
+- (BOOL)_loadExistingLogFiles:(out NSError **)errorOut;
+- (nullable TLSRollingFileOutputStream *)_logFileStreamForState:(TLSRollingFilePartitionState *)state;
+- (void)_configureLogFileStream:(TLSRollingFileOutputStream *)logFileStream;
+- (void)_addLogFilePath:(NSString *)logFilePath toState:(TLSRollingFilePartitionState *)state;
+- (void)_closeLogFileForState:(TLSRollingFilePartitionState *)state;
+- (void)_touchOpenState:(TLSRollingFilePartitionState *)state;
+@end
+
+@implementation TLSPartitionedRollingFileOutputStream
+{
+    NSDictionary<NSString *, TLSRollingFilePartitionState *> *_statesByChannel;
+    NSDictionary<NSString *, TLSRollingFilePartitionState *> *_statesByName;
+    NSArray<TLSRollingFilePartitionState *> *_states;
+    TLSRollingFilePartitionState *_defaultState;
+    NSMutableArray<TLSRollingFilePartitionState *> *_openStates; // least to most recently used
+    TLSFileOutputDurability _durabilities[TLSLogLevelCount];
+}
+
+- (instancetype)initWithPartitions:(NSArray<TLSRollingFilePartition *> *)partitions
+                             error:(out NSError **)errorOut
+{
+    return [self initWithLogFileDirectoryPath:nil
+                                logFilePrefix:nil
+                                   partitions:partitions
+                                 maxOpenFiles:TLSPartitionedRollingFileOutputStreamDefaultMaxOpenFiles
+                                        error:errorOut];
+}
+
+- (instancetype)initWithLogFileDirectoryPath:(NSString *)logFileDirectoryPath
+                               logFilePrefix:(NSString *)logFilePrefix
+                                  partitions:(NSArray<TLSRollingFilePartition *> *)partitions
+                                maxOpenFiles:(NSUInteger)maxOpenFiles
+                                       error:(out NSError **)errorOut // NS_DESIGNATED_INITIALIZER
+{
+    if (errorOut) {
+        *errorOut = nil;
+    }
+
+    if (!logFileDirectoryPath) {
+        logFileDirectoryPath = [TLSFileOutputStream defaultLogFileDirectoryPath];
+    }
+    if (!logFilePrefix) {
+        logFilePrefix = TLSPartitionedRollingFileOutputStreamDefaultLogFilePrefix;
+    }
+
+    // validate the partitions and build the routing tables
+    NSMutableDictionary<NSString *, TLSRollingFilePartitionState *> *statesByChannel = [[NSMutableDictionary alloc] init];
+    NSMutableDictionary<NSString *, TLSRollingFilePartitionState *> *statesByName = [[NSMutableDictionary alloc] init];
+    NSMutableArray<TLSRollingFilePartitionState *> *states = [[NSMutableArray alloc] initWithCapacity:partitions.count];
+    TLSRollingFilePartitionState *defaultState = nil;
+    NSString *invalidMessage = (0 == partitions.count) ? @"at least 1 partition is required" : nil;
+    NSCharacterSet *invalidNameCharacters = [NSCharacterSet characterSetWithCharactersInString:@"./"];
+    for (TLSRollingFilePartition *partition in partitions) {
+        if (0 == partition.name.length || [partition.name rangeOfCharacterFromSet:invalidNameCharacters].location != NSNotFound) {
+            invalidMessage = [NSString stringWithFormat:@"invalid partition name '%@'", partition.name];
+            break;
+        }
+        if (statesByName[partition.name]) {
+            invalidMessage = [NSString stringWithFormat:@"duplicate partition name '%@'", partition.name];
+            break;
+        }
+
+        TLSRollingFilePartitionState *state = [[TLSRollingFilePartitionState alloc] initWithPartition:partition];
+        statesByName[partition.name] = state;
+        [states addObject:state];
+
+        if (!partition.channels) {
+            if (defaultState) {
+                invalidMessage = @"only 1 partition can have `nil` channels";
+                break;
+            }
+            defaultState = state;
+        }
+        for (NSString *channel in partition.channels) {
+            if (statesByChannel[channel]) {
+                invalidMessage = [NSString stringWithFormat:@"channel '%@' is routed to more than 1 partition", channel];
+                break;
+            }
+            statesByChannel[channel] = state;
+        }
+        if (invalidMessage) {
+            break;
+        }
+    }
+
+    if (invalidMessage) {
+        if (errorOut) {
+            *errorOut = [NSError errorWithDomain:TLSErrorDomain
+                                            code:EINVAL
+                                        userInfo:@{ @"message" : invalidMessage,
+                                                    @"exceptionName" : NSInvalidArgumentException }];
+        }
+        return nil;
+    }
+
+    if (![TLSFileOutputStream createLogFileDirectoryAtPath:logFileDirectoryPath error:errorOut]) {
+        return nil;
+    }
+
+    if (self = [super init]) {
+        _logFileDirectoryPath = [logFileDirectoryPath copy];
+        _logFilePrefix = [logFilePrefix copy];
+        _partitions = [partitions copy];
+        _maxOpenFiles = MAX(maxOpenFiles, (NSUInteger)1);
+        _composeLogMessageOptions = TLSComposeLogMessageInfoDefaultOptions;
+        _statesByChannel = [statesByChannel copy];
+        _statesByName = [statesByName copy];
+        _states = [states copy];
+        _defaultState = defaultState;
+        _openStates = [[NSMutableArray alloc] initWithCapacity:_maxOpenFiles + 1];
+
+        if (![self _loadExistingLogFiles:errorOut]) {
+            return nil;
+        }
+    }
+
+    return self;
+}
+
+- (instancetype)init
+{
+    [self doesNotRecognizeSelector:_cmd];
+    abort();
+}
+
+#pragma mark - Public
+
+- (void)setComposeLogMessageOptions:(TLSComposeLogMessageInfoOptions)composeLogMessageOptions
+{
+    _composeLogMessageOptions = composeLogMessageOptions;
+    for (TLSRollingFilePartitionState *state in _states) {
+        state.logFileStream.composeLogMessageOptions = composeLogMessageOptions;
+    }
+}
+
+- (void)setAsynchronousWriteBufferSize:(NSUInteger)asynchronousWriteBufferSize
+{
+    _asynchronousWriteBufferSize = asynchronousWriteBufferSize;
+    for (TLSRollingFilePartitionState *state in _states) {
+        state.logFileStream.asynchronousWriteBufferSize = asynchronousWriteBufferSize;
+    }
+}
+
+- (void)setDurability:(TLSFileOutputDurability)durability
+            forLevels:(TLSLogLevelMask)levels
+{
+    for (TLSLogLevel level = 0; level < TLSLogLevelCount; level++) {
+        if (TLS_BITMASK_INTERSECTS_FLAGS(levels, (1 << level))) {
+            _durabilities[level] = durability;
+        }
+    }
+    for (TLSRollingFilePartitionState *state in _states) {
+        [state.logFileStream setDurability:durability forLevels:levels];
+    }
+}
+
+- (TLSFileOutputDurability)durabilityForLevel:(TLSLogLevel)level
+{
+    if (level < 0 || level >= TLSLogLevelCount) {
+        return TLSFileOutputDurabilityBuffered;
+    }
+    return _durabilities[level];
+}
+
+- (NSArray<NSString *> *)logFilePathsForPartitionNamed:(NSString *)partitionName
+{
+    return _statesByName[partitionName].logFilePathsSnapshot;
+}
+
+- (NSData *)retrieveLoggedDataForPartitionNamed:(NSString *)partitionName
+                                       maxBytes:(NSUInteger)maxBytes
+{
+    TLSRollingFilePartitionState *state = _statesByName[partitionName];
+    if (!state) {
+        return nil;
+    }
+    return _RetrieveLoggedData(state.logFilePathsSnapshot, maxBytes);
+}
+
+#pragma mark - TLSOutputStream
+
+- (TLSFilterStatus)tls_shouldFilterLevel:(TLSLogLevel)level
+                                 channel:(NSString *)channel
+                           contextObject:(id)contextObject
+{
+    // routing tables are immutable, safe to read from the transaction queue
+    if (!_defaultState && !_statesByChannel[channel]) {
+        return TLSFilterStatusCannotLogChannel;
+    }
+    return TLSFilterStatusOK;
+}
+
+- (void)tls_outputLogInfo:(TLSLogMessageInfo *)logInfo
+{
+    TLSRollingFilePartitionState *state = _statesByChannel[logInfo.channel] ?: _defaultState;
+    if (!state) {
+        return;
+    }
+
+    TLSRollingFileOutputStream *logFileStream = [self _logFileStreamForState:state];
+    if (!logFileStream) {
+        return;
+    }
+
+    [logFileStream tls_outputLogInfo:logInfo];
+
+    NSString *logFilePath = logFileStream.logFilePath;
+    if (![state.logFilePaths.lastObject isEqualToString:logFilePath]) {
+        // rolled over
+        [self _addLogFilePath:logFilePath toState:state];
+    }
+}
+
+- (void)tls_flush
+{
+    for (TLSRollingFilePartitionState *state in _openStates) {
+        [state.logFileStream tls_flush];
+    }
+}
+
+- (NSDictionary<NSString *, NSNumber *> *)tls_metricCounters
+{
+    NSMutableDictionary<NSString *, NSNumber *> *counters = [[NSMutableDictionary alloc] init];
+    for (TLSRollingFilePartitionState *state in _states) {
+        [[state.logFileStream tls_metricCounters] enumerateKeysAndObjectsUsingBlock:^(NSString *name, NSNumber *value, BOOL *stop) {
+            counters[name] = @(counters[name].unsignedLongLongValue + value.unsignedLongLongValue);
+        }];
+    }
+    return counters;
+}
+
+#pragma mark - TLSDataRetrieval
+
+- (NSStringEncoding)tls_loggedDataEncoding
+{
+    return NSUTF8StringEncoding;
+}
+
+- (NSData *)tls_retrieveLoggedData:(NSUInteger)maxBytes
+{
+    [self tls_flush];
+
+    const NSUInteger maxBytesPerPartition = maxBytes / _states.count;
+    NSMutableData *data = nil;
+    for (TLSRollingFilePartitionState *state in _states) {
+        NSData *partitionData = _RetrieveLoggedData(state.logFilePaths, maxBytesPerPartition);
+        if (partitionData) {
+            if (!data) {
+                data = [[NSMutableData alloc] initWithCapacity:maxBytes];
+            }
+            [data appendData:partitionData];
+        }
+    }
+    return data;
+}
+
+@end
+
+#pragma mark - private method implementations
+
+@implementation TLSPartitionedRollingFileOutputStream (Private)
+
+- (BOOL)_loadExistingLogFiles:(out NSError **)errorOut
+{
+    // one scan of the directory for all the partitions,
+    // from here on each partition tracks its own log files in memory
+    NSError *error = nil;
+    NSArray<NSString *> *fileNames = [[NSFileManager defaultManager] contentsOfDirectoryAtPath:_logFileDirectoryPath
+                                                                                         error:&error];
+    if (!fileNames) {
+        if (errorOut) {
+            *errorOut = error;
+        }
+        return NO;
+    }
+
+    const NSUInteger prefixLength = _logFilePrefix.length;
+    NSMutableDictionary<NSString *, NSMutableArray<NSNumber *> *> *idsByName = [[NSMutableDictionary alloc] init];
+    for (NSString *fileName in fileNames) {
+        if (![fileName hasPrefix:_logFilePrefix] || ![fileName.pathExtension isEqualToString:kLogFileExtension]) {
+            continue;
+        }
+        // "<name>.<id>"
+        NSString *nameAndId = [[fileName stringByDeletingPathExtension] substringFromIndex:prefixLength];
+        NSString *name = [nameAndId stringByDeletingPathExtension];
+        NSString *fileIdString = nameAndId.pathExtension;
+        if (!_statesByName[name] || 0 == fileIdString.length) {
+            continue;
+        }
+        NSMutableArray<NSNumber *> *fileIds = idsByName[name];
+        if (!fileIds) {
+            fileIds = [[NSMutableArray alloc] init];
+            idsByName[name] = fileIds;
+        }
+        [fileIds addObject:@(fileIdString.longLongValue)];
+    }
+
+    [idsByName enumerateKeysAndObjectsUsingBlock:^(NSString *name, NSMutableArray<NSNumber *> *fileIds, BOOL *stop) {
+        TLSRollingFilePartitionState *state = self->_statesByName[name];
+        [fileIds sortUsingSelector:@selector(compare:)];
+        for (NSNumber *fileId in fileIds) {
+            NSString *fileName = [NSString stringWithFormat:@"%@%@.%lld.%@", self->_logFilePrefix, name, fileId.longLongValue, kLogFileExtension];
+            [state.logFilePaths addObject:[self->_logFileDirectoryPath stringByAppendingPathComponent:fileName]];
+        }
+        state.logFilePathsSnapshot = state.logFilePaths;
+    }];
+
+    return YES;
+}
+
+- (TLSRollingFileOutputStream *)_logFileStreamForState:(TLSRollingFilePartitionState *)state
+{
+    TLSRollingFileOutputStream *logFileStream = state.logFileStream;
+    if (!logFileStream) {
+        // the partition's rolling stream picks the next log file id and prunes with the partition's retention
+        NSString *logFilePrefix = [NSString stringWithFormat:@"%@%@.", _logFilePrefix, state.partition.name];
+        logFileStream = [[TLSRollingFileOutputStream alloc] initWithLogFileDirectoryPath:_logFileDirectoryPath
+                                                                           logFilePrefix:logFilePrefix
+                                                                             maxLogFiles:state.partition.maxLogFiles
+                                                                      maxBytesPerLogFile:state.partition.maxBytesPerLogFile
+                                                                                   error:NULL];
+        if (!logFileStream) {
+            return nil;
+        }
+        [self _configureLogFileStream:logFileStream];
+        state.logFileStream = logFileStream;
+        [self _addLogFilePath:logFileStream.logFilePath toState:state];
+    } else if (!logFileStream.logFile) {
+        // was closed to stay within maxOpenFiles, pick up where we left off
+        if (!TLSFileOutputStreamReopenLogFile(logFileStream, NULL)) {
+            // start over with a new log file on the next message
+            state.logFileStream = nil;
+            return nil;
+        }
+    }
+
+    [self _touchOpenState:state];
+    return logFileStream;
+}
+
+- (void)_configureLogFileStream:(TLSRollingFileOutputStream *)logFileStream
+{
+    logFileStream.composeLogMessageOptions = _composeLogMessageOptions;
+    logFileStream.asynchronousWriteBufferSize = _asynchronousWriteBufferSize;
+    for (TLSLogLevel level = 0; level < TLSLogLevelCount; level++) {
+        [logFileStream setDurability:_durabilities[level] forLevels:(1 << level)];
+    }
+}
+
+- (void)_addLogFilePath:(NSString *)logFilePath
+                toState:(TLSRollingFilePartitionState *)state
+{
+    [state.logFilePaths addObject:logFilePath];
+
+    // mirror the pruning of the rolling stream, which never prunes its newest (current) log file
+    const NSUInteger maxLogFiles = state.logFileStream.maxLogFiles;
+    while (state.logFilePaths.count > maxLogFiles) {
+        [state.logFilePaths removeObjectAtIndex:0];
+    }
+    state.logFilePathsSnapshot = state.logFilePaths;
+}
+
+- (void)_closeLogFileForState:(TLSRollingFilePartitionState *)state
+{
+    TLSRollingFileOutputStream *logFileStream = state.logFileStream;
+    if (logFileStream.logFile) {
+        TLSFileOutputStreamCloseLogFile(logFileStream);
+    }
+    [_openStates removeObjectIdenticalTo:state];
+}
+
+- (void)_touchOpenState:(TLSRollingFilePartitionState *)state
+{
+    if (_openStates.lastObject == state) {
+        return;
+    }
+
+    [_openStates removeObjectIdenticalTo:state];
+    [_openStates addObject:state];
+    while (_openStates.count > _maxOpenFiles) {
+        [self _closeLogFileForState:_openStates.firstObject];
+    }
+}
+
+@end
@@ -18,6 +18,7 @@
 //  limitations under the License.
 
 #import <TwitterLoggingService/TLSDeclarations.h>
+#import <TwitterLoggingService/TLSRollingFileIndex.h>
 
 /**
  The reasons that a log message was filtered
@@ -40,6 +41,14 @@ typedef NS_OPTIONS(NSInteger, TLSFilterStatus)
     TLSFilterStatusCannotLogExternal = (1 << 7)
 };
 
+/** Keys of the `[TLSOutputStream tls_metricCounters]` of the `TLSOutputStream` classes of Twitter Logging Service */
+FOUNDATION_EXTERN NSString * __nonnull const TLSOutputStreamMetricBytesWritten;
+FOUNDATION_EXTERN NSString * __nonnull const TLSOutputStreamMetricBytesDropped;
+FOUNDATION_EXTERN NSString * __nonnull const TLSOutputStreamMetricFlushes;
+FOUNDATION_EXTERN NSString * __nonnull const TLSOutputStreamMetricSyncs;
+FOUNDATION_EXTERN NSString * __nonnull const TLSOutputStreamMetricRollovers;
+FOUNDATION_EXTERN NSString * __nonnull const TLSOutputStreamMetricPurges;
+
 /**
  Defines filtering methods used for logging.  Used by `TLSOutputStream` implementations.
  If the behavior of any of the implemented methods in a `TLSOutputStream` change, that stream must be provided to `TLSLoggingService`'s `updateOutputStream:` method.
@@ -93,6 +102,22 @@ typedef NS_OPTIONS(NSInteger, TLSFilterStatus)
  */
 - (void)tls_flush;
 
+/**
+ Called by `TLSLoggingService` on the same serial dispatch queue as `tls_outputLogInfo:` once there are no more log messages queued for output.
+
+ Output streams that accumulate their output (to reduce their number of system calls) can output the accumulated batch when this is called.
+ @note Example: `TLSStdErrOutputStream` writes all the lines accumulated since the last batch with a single `writev`.
+ */
+- (void)tls_didFinishOutputBatch;
+
+/**
+ Counters of the output stream's own work, reported in the `[TLSLoggingService metricsSnapshot]`.
+
+ Called from any thread, so reading the counters must be thread safe and cheap (such as relaxed atomic loads).
+ @note Example: `TLSFileOutputStream` reports `TLSOutputStreamMetricBytesWritten`, `TLSOutputStreamMetricBytesDropped`, `TLSOutputStreamMetricFlushes` and `TLSOutputStreamMetricSyncs`.
+ */
+- (nonnull NSDictionary<NSString *, NSNumber *> *)tls_metricCounters;
+
 @end
 
 /**
@@ -112,6 +137,25 @@ typedef NS_OPTIONS(NSInteger, TLSFilterStatus)
 
 @end
 
+/**
+ Indexed data retrieval protocol for `TLSOutputStream` objects.
+
+ Implement this protocol on `TLSOutputStream` objects that maintain an index of their past logged
+ records and can seek directly to records matching a `TLSLogIndexQuery`.
+ */
+@protocol TLSIndexedDataRetrieval <NSObject>
+
+@required
+
+/**
+ Make the records logged so far visible to `TLSLogIndexEnumerateRecords` and get the indexed log files, oldest first.
+ Called by `TLSLoggingService` on its logging queue, the records are then enumerated off of it,
+ see `enumerateIndexedRecordsFromOutputStream:matchingQuery:usingBlock:`.
+ */
+- (nonnull NSArray<NSString *> *)tls_indexedLogFilePaths;
+
+@end
+
 /**
  Base event type for use in the protocol `TLSFileOutputStreamEvent`
  */
@@ -147,3 +191,23 @@ typedef NSInteger TLSFileOutputEvent;
                              info:(nullable NSDictionary *)info error:(nonnull NSError *)error;
 
 @end
+
+/**
+ Opt in protocol for context objects (the _contextObject_ of `TLSLogEx` and friends) that would be
+ costly to keep alive while their log messages wait in the `TLSLoggingService` queues and output streams,
+ such as view controllers or large model graphs.
+
+ The service takes the snapshot on the calling thread, and from then on carries only the snapshot:
+ `tls_shouldFilterLevel:channel:contextObject:` and `[TLSLogMessageInfo contextObject]` get the
+ `TLSLogContextSnapshot` and the context object is not retained past the logging call.
+ */
+@protocol TLSLogContextSnapshotting <NSObject>
+
+/**
+ Take a snapshot of the receiver to log in its place.
+ Called on the logging thread, it should only copy the few values worth logging or filtering on.
+ @warning The implementation of this method must never call a `TLSLoggingService` method nor a `TLSLog` function.
+ */
+- (nonnull TLSLogContextSnapshot *)tls_logContextSnapshot;
+
+@end
@@ -0,0 +1,104 @@
+//
+//  TLSRollingFileIndex.h
+//  TwitterLoggingService
+//
+//  Created on 10/18/26.
+//  Copyright (c) 2026 Twitter, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//          http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import <TwitterLoggingService/TLSDeclarations.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ A query against the sidecar index files written by `TLSRollingFileOutputStream`
+ (see `indexCheckpointInterval`).
+
+ All criteria are combined (logical AND).  Unset criteria match everything.
+ */
+@interface TLSLogIndexQuery : NSObject <NSCopying>
+
+/** earliest timestamp to match (inclusive), `nil` for no lower bound */
+@property (nonatomic, nullable, copy) NSDate *startDate;
+/** latest timestamp to match (inclusive), `nil` for no upper bound */
+@property (nonatomic, nullable, copy) NSDate *endDate;
+/** levels to match.  Default == `TLSLogLevelMaskAll` */
+@property (nonatomic) TLSLogLevelMask levelMask;
+/**
+ channels to match, `nil` matches all channels.
+ Include `TLSLogIndexOverflowChannel` to match the records of channels past the index's limit of 65535 channels per log file.
+ */
+@property (nonatomic, nullable, copy) NSSet<NSString *> *channels;
+
+@end
+
+/**
+ A log record matched by a `TLSLogIndexQuery`
+ */
+@interface TLSLogIndexRecord : NSObject
+
+/** the level the record was logged at */
+@property (nonatomic, readonly) TLSLogLevel level;
+/** the channel the record was logged to, `TLSLogIndexOverflowChannel` when the index ran out of channels */
+@property (nonatomic, copy, readonly) NSString *channel;
+/** the timestamp of the log message */
+@property (nonatomic, readonly) NSDate *timestamp;
+/** the path of the log file (segment) that contains the record */
+@property (nonatomic, copy, readonly) NSString *logFilePath;
+/** the byte offset of the record within `logFilePath` */
+@property (nonatomic, readonly) unsigned long long offset;
+/** the bytes of the record as written (without the trailing newline) */
+@property (nonatomic, readonly) NSData *data;
+
+/** NS_UNAVAILABLE */
+- (instancetype)init NS_UNAVAILABLE;
+/** NS_UNAVAILABLE */
++ (instancetype)new NS_UNAVAILABLE;
+
+@end
+
+//! Block for enumerating matched records, set `*stop` to `YES` to end the enumeration early
+typedef void(^TLSLogIndexRecordBlock)(TLSLogIndexRecord *record, BOOL *stop);
+
+/**
+ Enumerate the records from the given log files that match the _query_.
+
+ Each log file is expected to have a sidecar index file (same path with an `idx` extension).
+ Log files without an index are skipped.
+ The index of the next log file is scanned on a concurrent queue while the records of the current
+ one are delivered, the _block_ is called on the calling thread with records delivered in order: log
+ files in the order provided and records in the order they were written.  Record bytes are read from the
+ log file as they are delivered, only the compact locations of the matches (of up to 2 log files) are
+ held ahead of delivery.
+
+ This can be used on log files collected off device just as well as on a running stream.
+ For a running `TLSRollingFileOutputStream` use
+ `[TLSLoggingService enumerateIndexedRecordsFromOutputStream:matchingQuery:usingBlock:]`
+ so that the index is up to date.
+
+ @param logFilePaths the log files to query
+ @param query the `TLSLogIndexQuery` to match records against
+ @param block the block to call with each matching record
+ @return the number of records that were delivered to _block_
+ */
+FOUNDATION_EXTERN NSUInteger TLSLogIndexEnumerateRecords(NSArray<NSString *> *logFilePaths,
+                                                         TLSLogIndexQuery *query,
+                                                         TLSLogIndexRecordBlock NS_NOESCAPE block);
+
+//! The extension used for sidecar index files
+FOUNDATION_EXTERN NSString * const TLSLogIndexFileExtension; // @"idx"
+//! The channel of records whose channel didn't fit in the index, see `[TLSLogIndexQuery channels]`
+FOUNDATION_EXTERN NSString * const TLSLogIndexOverflowChannel; // @"TLSLogIndexOverflowChannel"
+
+NS_ASSUME_NONNULL_END
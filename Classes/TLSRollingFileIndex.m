@@ -0,0 +1,546 @@
+//
+//  TLSRollingFileIndex.m
+//  TwitterLoggingService
+//
+//  Created on 10/18/26.
+//  Copyright (c) 2026 Twitter, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//          http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#import "TLSRollingFileIndexWriter.h"
+
+NSString * const TLSLogIndexFileExtension = @"idx";
+NSString * const TLSLogIndexOverflowChannel = @"TLSLogIndexOverflowChannel";
+
+static const char kIndexMagic[4] = { 'T', 'L', 'S', 'I' };
+static const uint8_t kIndexRecordTypeChannel = 'C';
+static const uint8_t kIndexRecordTypeBlock = 'B';
+
+NSString *TLSLogIndexFilePathForLogFilePath(NSString *logFilePath)
+{
+    return [[logFilePath stringByDeletingPathExtension] stringByAppendingPathExtension:TLSLogIndexFileExtension];
+}
+
+NS_INLINE void _SetChannelBit(uint64_t *bitmap, uint16_t channelId)
+{
+    const uint8_t bit = (uint8_t)(channelId & 0xFF);
+    bitmap[bit / 64] |= (1ULL << (bit % 64));
+}
+
+NS_INLINE BOOL _BitmapsIntersect(const uint64_t *bitmap1, const uint64_t *bitmap2)
+{
+    for (size_t i = 0; i < TLS_LOG_INDEX_CHANNEL_BITMAP_WORDS; i++) {
+        if ((bitmap1[i] & bitmap2[i]) != 0) {
+            return YES;
+        }
+    }
+    return NO;
+}
+
+#pragma mark - Query
+
+@implementation TLSLogIndexQuery
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        _levelMask = TLSLogLevelMaskAll;
+    }
+    return self;
+}
+
+- (id)copyWithZone:(NSZone *)zone
+{
+    TLSLogIndexQuery *query = [[TLSLogIndexQuery allocWithZone:zone] init];
+    query->_startDate = _startDate;
+    query->_endDate = _endDate;
+    query->_levelMask = _levelMask;
+    query->_channels = _channels;
+    return query;
+}
+
+@end
+
+#pragma mark - Record
+
+@interface TLSLogIndexRecord ()
+- (instancetype)initWithLevel:(TLSLogLevel)level
+                      channel:(NSString *)channel
+                    timestamp:(NSDate *)timestamp
+                  logFilePath:(NSString *)logFilePath
+                       offset:(unsigned long long)offset
+                         data:(NSData *)data;
+@end
+
+@implementation TLSLogIndexRecord
+
+- (instancetype)initWithLevel:(TLSLogLevel)level
+                      channel:(NSString *)channel
+                    timestamp:(NSDate *)timestamp
+                  logFilePath:(NSString *)logFilePath
+                       offset:(unsigned long long)offset
+                         data:(NSData *)data
+{
+    if (self = [super init]) {
+        _level = level;
+        _channel = [channel copy];
+        _timestamp = timestamp;
+        _logFilePath = [logFilePath copy];
+        _offset = offset;
+        _data = data;
+    }
+    return self;
+}
+
+- (instancetype)init
+{
+    [self doesNotRecognizeSelector:_cmd];
+    abort();
+}
+
+@end
+
+#pragma mark - Writer
+
+@interface TLSRollingFileIndexWriter ()
+- (uint16_t)_internChannel:(NSString *)channel TLS_OBJC_DIRECT;
+@end
+
+@implementation TLSRollingFileIndexWriter
+{
+    FILE *_indexFile;
+    NSUInteger _blockSize;
+    NSMutableDictionary<NSString *, NSNumber *> *_channelIds;
+
+    TLSLogIndexBlockHeader _block;
+    TLSLogIndexEntry *_entries;
+    uint32_t _entriesCapacity;
+}
+
+- (instancetype)initWithLogFilePath:(NSString *)logFilePath
+                          blockSize:(NSUInteger)blockSize
+{
+    if (self = [super init]) {
+        _indexFile = fopen(TLSLogIndexFilePathForLogFilePath(logFilePath).UTF8String, "w");
+        if (!_indexFile) {
+            return nil;
+        }
+        _blockSize = MAX(blockSize, (NSUInteger)1024);
+        _channelIds = [[NSMutableDictionary alloc] init];
+
+        const uint32_t version = TLS_LOG_INDEX_VERSION;
+        fwrite(kIndexMagic, sizeof(kIndexMagic), 1, _indexFile);
+        fwrite(&version, sizeof(version), 1, _indexFile);
+    }
+    return self;
+}
+
+- (instancetype)init
+{
+    [self doesNotRecognizeSelector:_cmd];
+    abort();
+}
+
+- (void)dealloc
+{
+    [self close];
+    free(_entries);
+}
+
+- (uint16_t)_internChannel:(NSString *)channel
+{
+    NSNumber *channelIdNumber = _channelIds[channel];
+    if (channelIdNumber) {
+        return (uint16_t)channelIdNumber.unsignedIntValue;
+    }
+
+    if (_channelIds.count >= TLS_LOG_INDEX_OVERFLOW_CHANNEL_ID) {
+        // out of ids, the overflow channel can only be matched by channel agnostic queries
+        return TLS_LOG_INDEX_OVERFLOW_CHANNEL_ID;
+    }
+
+    // seal the block in progress first so that readers always encounter
+    // a channel definition before any block that references it
+    [self sealCurrentBlock];
+
+    const uint16_t channelId = (uint16_t)_channelIds.count;
+    _channelIds[channel] = @(channelId);
+
+    NSData *channelData = [channel dataUsingEncoding:NSUTF8StringEncoding];
+    const uint16_t length = (uint16_t)MIN(channelData.length, (NSUInteger)UINT16_MAX);
+    fwrite(&kIndexRecordTypeChannel, sizeof(uint8_t), 1, _indexFile);
+    fwrite(&channelId, sizeof(channelId), 1, _indexFile);
+    fwrite(&length, sizeof(length), 1, _indexFile);
+    fwrite(channelData.bytes, 1, length, _indexFile);
+
+    return channelId;
+}
+
+- (void)addRecordAtOffset:(unsigned long long)offset
+                   length:(NSUInteger)length
+                    level:(TLSLogLevel)level
+                  channel:(NSString *)channel
+                timestamp:(CFAbsoluteTime)timestamp
+{
+    if (!_indexFile) {
+        return;
+    }
+
+    const uint16_t channelId = [self _internChannel:channel];
+
+    if (_block.recordCount > 0 && (offset < _block.offset || (offset - _block.offset) > UINT32_MAX)) {
+        [self sealCurrentBlock];
+    }
+
+    if (0 == _block.recordCount) {
+        memset(&_block, 0, sizeof(_block));
+        _block.offset = offset;
+        _block.minTimestamp = timestamp;
+        _block.maxTimestamp = timestamp;
+    }
+
+    if (_block.recordCount == _entriesCapacity) {
+        const uint32_t newCapacity = MAX(_entriesCapacity * 2, (uint32_t)64);
+        TLSLogIndexEntry *newEntries = realloc(_entries, sizeof(TLSLogIndexEntry) * newCapacity);
+        if (!newEntries) {
+            return;
+        }
+        _entries = newEntries;
+        _entriesCapacity = newCapacity;
+    }
+
+    // timestamps can go backwards (records are stamped on the calling thread),
+    // keep min/max accurate and deltas relative to the first record
+    TLSLogIndexEntry *entry = &_entries[_block.recordCount];
+    entry->offset = (uint32_t)(offset - _block.offset);
+    entry->length = (uint32_t)MIN(length, (NSUInteger)UINT32_MAX);
+    entry->timestampDelta = (float)(timestamp - _block.minTimestamp);
+    entry->channelId = channelId;
+    entry->level = (uint8_t)level;
+    entry->reserved = 0;
+
+    _block.recordCount++;
+    _block.length = (offset + length) - _block.offset;
+    _block.levelMask |= (uint32_t)(1 << level);
+    _block.maxTimestamp = MAX(_block.maxTimestamp, timestamp);
+    _SetChannelBit(_block.channelBitmap, channelId);
+
+    if (_block.length >= _blockSize) {
+        [self sealCurrentBlock];
+    }
+}
+
+- (void)sealCurrentBlock
+{
+    if (!_indexFile || 0 == _block.recordCount) {
+        return;
+    }
+
+    // rebase deltas in case an earlier timestamp showed up after the first record
+    const double firstTimestamp = _block.minTimestamp;
+    double minTimestamp = firstTimestamp;
+    for (uint32_t i = 0; i < _block.recordCount; i++) {
+        minTimestamp = MIN(minTimestamp, firstTimestamp + (double)_entries[i].timestampDelta);
+    }
+    if (minTimestamp < firstTimestamp) {
+        const float rebase = (float)(firstTimestamp - minTimestamp);
+        for (uint32_t i = 0; i < _block.recordCount; i++) {
+            _entries[i].timestampDelta += rebase;
+        }
+        _block.minTimestamp = minTimestamp;
+    }
+
+    fwrite(&kIndexRecordTypeBlock, sizeof(uint8_t), 1, _indexFile);
+    fwrite(&_block, sizeof(_block), 1, _indexFile);
+    fwrite(_entries, sizeof(TLSLogIndexEntry), _block.recordCount, _indexFile);
+    _block.recordCount = 0;
+}
+
+- (void)flush
+{
+    if (_indexFile) {
+        fflush(_indexFile);
+    }
+}
+
+- (void)close
+{
+    if (_indexFile) {
+        [self sealCurrentBlock];
+        fflush(_indexFile);
+        fclose(_indexFile);
+        _indexFile = NULL;
+    }
+}
+
+@end
+
+#pragma mark - Reader
+
+// a matched record located by the index, its bytes are only read when it is delivered
+typedef struct {
+    uint64_t blockOffset;
+    uint64_t blockLength;
+    double timestamp;
+    uint32_t offset;        // relative to blockOffset
+    uint32_t length;
+    uint16_t channelId;
+    uint8_t level;
+} TLSLogIndexMatch;
+
+// the matches of one log file
+TLS_OBJC_FINAL
+@interface TLSLogIndexScan : NSObject
+@property (nonatomic, readonly) NSMutableData *matches;
+@property (nonatomic, readonly) NSMutableArray<NSString *> *channelNames;
+@end
+
+@implementation TLSLogIndexScan
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        _matches = [[NSMutableData alloc] init];
+        _channelNames = [[NSMutableArray alloc] init];
+    }
+    return self;
+}
+
+@end
+
+static TLSLogIndexScan *_ScanLogFileIndex(NSString *logFilePath, TLSLogIndexQuery *query);
+static TLSLogIndexScan *_ScanLogFileIndex(NSString *logFilePath, TLSLogIndexQuery *query)
+{
+    TLSLogIndexScan *scan = [[TLSLogIndexScan alloc] init];
+    NSData *indexData = [NSData dataWithContentsOfFile:TLSLogIndexFilePathForLogFilePath(logFilePath)
+                                               options:NSDataReadingMappedIfSafe
+                                                 error:NULL];
+    const uint8_t *bytes = indexData.bytes;
+    const size_t size = indexData.length;
+    if (size < 8 || 0 != memcmp(bytes, kIndexMagic, sizeof(kIndexMagic))) {
+        return scan;
+    }
+    uint32_t version;
+    memcpy(&version, bytes + 4, sizeof(version));
+    if (version != TLS_LOG_INDEX_VERSION) {
+        return scan;
+    }
+
+    const double startTime = (query.startDate) ? query.startDate.timeIntervalSinceReferenceDate : -DBL_MAX;
+    const double endTime = (query.endDate) ? query.endDate.timeIntervalSinceReferenceDate : DBL_MAX;
+    const uint32_t levelMask = (uint32_t)query.levelMask;
+    NSSet<NSString *> *channels = query.channels;
+
+    NSMutableArray<NSString *> *channelNames = scan.channelNames;
+    NSMutableIndexSet *matchingChannelIds = [[NSMutableIndexSet alloc] init];
+    uint64_t channelBitmap[TLS_LOG_INDEX_CHANNEL_BITMAP_WORDS] = { 0 };
+    if (!channels || [channels containsObject:TLSLogIndexOverflowChannel]) {
+        [matchingChannelIds addIndex:TLS_LOG_INDEX_OVERFLOW_CHANNEL_ID];
+        _SetChannelBit(channelBitmap, TLS_LOG_INDEX_OVERFLOW_CHANNEL_ID);
+    }
+
+    size_t position = 8;
+    while (position < size) {
+        const uint8_t type = bytes[position++];
+        if (kIndexRecordTypeChannel == type) {
+            uint16_t channelId, length;
+            if (position + 4 > size) {
+                break;
+            }
+            memcpy(&channelId, bytes + position, sizeof(channelId));
+            memcpy(&length, bytes + position + 2, sizeof(length));
+            position += 4;
+            if (position + length > size || TLS_LOG_INDEX_OVERFLOW_CHANNEL_ID == channelId) {
+                break;
+            }
+            NSString *channel = [[NSString alloc] initWithBytes:bytes + position
+                                                         length:length
+                                                       encoding:NSUTF8StringEncoding] ?: @"";
+            position += length;
+            while (channelNames.count <= channelId) {
+                [channelNames addObject:@""];
+            }
+            channelNames[channelId] = channel;
+            if (!channels || [channels containsObject:channel]) {
+                [matchingChannelIds addIndex:channelId];
+                _SetChannelBit(channelBitmap, channelId);
+            }
+        } else if (kIndexRecordTypeBlock == type) {
+            TLSLogIndexBlockHeader block;
+            if (position + sizeof(block) > size) {
+                break;
+            }
+            memcpy(&block, bytes + position, sizeof(block));
+            position += sizeof(block);
+            const size_t entriesSize = sizeof(TLSLogIndexEntry) * block.recordCount;
+            if (position + entriesSize > size) {
+                // partially written block (crash or still being written)
+                break;
+            }
+            const uint8_t *entryBytes = bytes + position;
+            position += entriesSize;
+
+            // sparse checks first so non-matching blocks are skipped without touching the log file
+            if (block.maxTimestamp < startTime || block.minTimestamp > endTime) {
+                continue;
+            }
+            if (0 == (block.levelMask & levelMask)) {
+                continue;
+            }
+            if (channels && !_BitmapsIntersect(block.channelBitmap, channelBitmap)) {
+                continue;
+            }
+
+            for (uint32_t i = 0; i < block.recordCount; i++) {
+                TLSLogIndexEntry entry;
+                memcpy(&entry, entryBytes + (i * sizeof(entry)), sizeof(entry));
+                const double timestamp = block.minTimestamp + (double)entry.timestampDelta;
+                if (timestamp < startTime || timestamp > endTime) {
+                    continue;
+                }
+                if (entry.level >= TLSLogLevelCount || 0 == (levelMask & (1 << entry.level))) {
+                    continue;
+                }
+                if (channels && ![matchingChannelIds containsIndex:entry.channelId]) {
+                    continue;
+                }
+                if ((uint64_t)entry.offset + entry.length > block.length) {
+                    continue;
+                }
+
+                const TLSLogIndexMatch match = {
+                    .blockOffset = block.offset,
+                    .blockLength = block.length,
+                    .timestamp = timestamp,
+                    .offset = entry.offset,
+                    .length = entry.length,
+                    .channelId = entry.channelId,
+                    .level = entry.level,
+                };
+                [scan.matches appendBytes:&match length:sizeof(match)];
+            }
+        } else {
+            // unknown or corrupt record, stop reading
+            break;
+        }
+    }
+
+    return scan;
+}
+
+static NSUInteger _DeliverLogFileMatches(NSString *logFilePath, TLSLogIndexScan *scan, TLSLogIndexRecordBlock block, BOOL *stop);
+static NSUInteger _DeliverLogFileMatches(NSString *logFilePath, TLSLogIndexScan *scan, TLSLogIndexRecordBlock block, BOOL *stop)
+{
+    const TLSLogIndexMatch *matches = scan.matches.bytes;
+    const NSUInteger matchCount = scan.matches.length / sizeof(TLSLogIndexMatch);
+    if (!matchCount) {
+        return 0;
+    }
+
+    const int fd = open(logFilePath.fileSystemRepresentation, O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+
+    // only the block of the record being delivered is held in memory
+    NSArray<NSString *> *channelNames = scan.channelNames;
+    NSMutableData *blockData = [[NSMutableData alloc] init];
+    uint64_t loadedBlockOffset = UINT64_MAX;
+    NSUInteger delivered = 0;
+    for (NSUInteger i = 0; i < matchCount && !*stop; i++) {
+        @autoreleasepool {
+            const TLSLogIndexMatch *match = &matches[i];
+            if (match->blockOffset != loadedBlockOffset) {
+                // seek straight to the block and read it in one go
+                blockData.length = (NSUInteger)match->blockLength;
+                const ssize_t bytesRead = pread(fd, blockData.mutableBytes, (size_t)match->blockLength, (off_t)match->blockOffset);
+                if (bytesRead < 0) {
+                    break;
+                }
+                blockData.length = (NSUInteger)bytesRead;
+                loadedBlockOffset = match->blockOffset;
+            }
+
+            if ((uint64_t)match->offset + match->length > blockData.length) {
+                continue;
+            }
+            NSUInteger length = match->length;
+            const char *recordBytes = (const char *)blockData.bytes + match->offset;
+            if (length > 0 && recordBytes[length - 1] == '\n') {
+                length--;
+            }
+
+            NSString *channel = (TLS_LOG_INDEX_OVERFLOW_CHANNEL_ID == match->channelId) ? TLSLogIndexOverflowChannel :
+                                (match->channelId < channelNames.count) ? channelNames[match->channelId] : @"";
+            TLSLogIndexRecord *record = [[TLSLogIndexRecord alloc] initWithLevel:(TLSLogLevel)match->level
+                                                                         channel:channel
+                                                                       timestamp:[NSDate dateWithTimeIntervalSinceReferenceDate:match->timestamp]
+                                                                     logFilePath:logFilePath
+                                                                          offset:match->blockOffset + match->offset
+                                                                            data:[NSData dataWithBytes:recordBytes length:length]];
+            block(record, stop);
+            delivered++;
+        }
+    }
+
+    close(fd);
+    return delivered;
+}
+
+NSUInteger TLSLogIndexEnumerateRecords(NSArray<NSString *> *logFilePaths,
+                                       TLSLogIndexQuery *query,
+                                       TLSLogIndexRecordBlock block)
+{
+    const NSUInteger count = logFilePaths.count;
+    if (!count || !block) {
+        return 0;
+    }
+
+    query = [query copy] ?: [[TLSLogIndexQuery alloc] init];
+    NSArray<NSString *> *paths = [logFilePaths copy];
+
+    // deliver one log file while the index of the next one is scanned,
+    // so only the compact matches of 2 log files are held at a time
+    dispatch_queue_t concurrentQueue = dispatch_get_global_queue(QOS_CLASS_UTILITY, 0);
+    __block TLSLogIndexScan *nextScan = nil;
+    dispatch_group_t nextScanGroup = dispatch_group_create();
+    dispatch_group_async(nextScanGroup, concurrentQueue, ^{
+        @autoreleasepool {
+            nextScan = _ScanLogFileIndex(paths[0], query);
+        }
+    });
+
+    NSUInteger delivered = 0;
+    BOOL stop = NO;
+    for (NSUInteger i = 0; i < count && !stop; i++) {
+        dispatch_group_wait(nextScanGroup, DISPATCH_TIME_FOREVER);
+        TLSLogIndexScan *scan = nextScan;
+        nextScan = nil;
+        if (i + 1 < count) {
+            NSString *nextPath = paths[i + 1];
+            dispatch_group_async(nextScanGroup, concurrentQueue, ^{
+                @autoreleasepool {
+                    nextScan = _ScanLogFileIndex(nextPath, query);
+                }
+            });
+        }
+        delivered += _DeliverLogFileMatches(paths[i], scan, block, &stop);
+    }
+    // don't leave a scan writing to `nextScan` after returning
+    dispatch_group_wait(nextScanGroup, DISPATCH_TIME_FOREVER);
+
+    return delivered;
+}
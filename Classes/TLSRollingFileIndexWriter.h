@@ -0,0 +1,95 @@
+//
+//  TLSRollingFileIndexWriter.h
+//  TwitterLoggingService
+//
+//  Created on 10/18/26.
+//  Copyright (c) 2026 Twitter, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//          http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+/* This header is private to Twitter Logging Service */
+
+#import "TLS_Project.h"
+#import "TLSRollingFileIndex.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*
+ Sidecar index file format (native byte order)
+
+    header:  "TLSI" (4 bytes), uint32_t version
+
+    records: uint8_t type, followed by the type's payload
+
+        'C' (channel):  uint16_t channelId, uint16_t length, char[length] (UTF-8 channel name)
+        'B' (block):    TLSLogIndexBlockHeader, TLSLogIndexEntry[header.recordCount]
+
+ A block is a sparse checkpoint covering roughly `blockSize` bytes of the log file.
+ Channels are interned per log file and only written the first time they are encountered,
+ always before the first block that references them.
+ */
+
+#define TLS_LOG_INDEX_VERSION (1)
+#define TLS_LOG_INDEX_CHANNEL_BITMAP_WORDS (4)
+#define TLS_LOG_INDEX_OVERFLOW_CHANNEL_ID (UINT16_MAX)
+
+typedef struct {
+    uint64_t offset;        // offset of the first record in the block
+    uint64_t length;        // bytes from offset to the end of the last record
+    double minTimestamp;    // CFAbsoluteTime
+    double maxTimestamp;    // CFAbsoluteTime
+    uint32_t recordCount;
+    uint32_t levelMask;
+    uint64_t channelBitmap[TLS_LOG_INDEX_CHANNEL_BITMAP_WORDS]; // bit == (channelId % 256)
+} TLSLogIndexBlockHeader;
+
+typedef struct {
+    uint32_t offset;        // relative to TLSLogIndexBlockHeader.offset
+    uint32_t length;        // including trailing newline
+    float timestampDelta;   // relative to TLSLogIndexBlockHeader.minTimestamp
+    uint16_t channelId;
+    uint8_t level;
+    uint8_t reserved;
+} TLSLogIndexEntry;
+
+/**
+ Writes the sidecar index for a single log file.
+ Not thread safe, owned by the `TLSRollingFileOutputStream` on the logging queue.
+ */
+TLS_OBJC_FINAL
+@interface TLSRollingFileIndexWriter : NSObject
+
+- (nullable instancetype)initWithLogFilePath:(NSString *)logFilePath
+                                   blockSize:(NSUInteger)blockSize;
+
+- (void)addRecordAtOffset:(unsigned long long)offset
+                   length:(NSUInteger)length
+                    level:(TLSLogLevel)level
+                  channel:(NSString *)channel
+                timestamp:(CFAbsoluteTime)timestamp;
+
+/** write out the in progress block (if any) so it is visible to readers */
+- (void)sealCurrentBlock;
+- (void)flush;
+/** seal, flush and close the index file */
+- (void)close;
+
+- (instancetype)init NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+@end
+
+//! the index file path for the given log file path
+FOUNDATION_EXTERN NSString *TLSLogIndexFilePathForLogFilePath(NSString *logFilePath);
+
+NS_ASSUME_NONNULL_END
@@ -55,7 +55,7 @@ typedef NS_ENUM(TLSFileOutputEvent, TLSRollingFileOutputEvent) {
     FOUNDATION_EXTERN NSString * const TLSRollingFileOutputStreamDefaultLogFilePrefix;         // @"log." as a prefix
 
  */
-@interface TLSRollingFileOutputStream : TLSFileOutputStream <TLSDataRetrieval, TLSFileOutputStreamEvent>
+@interface TLSRollingFileOutputStream : TLSFileOutputStream <TLSDataRetrieval, TLSIndexedDataRetrieval, TLSFileOutputStreamEvent>
 
 /**
  Max bytes per log file.
@@ -75,6 +75,16 @@ typedef NS_ENUM(TLSFileOutputEvent, TLSRollingFileOutputEvent) {
  Default is `@"log."`
  */
 @property (nonatomic, nonnull, copy, readonly) NSString *logFilePrefix;
+/**
+ The number of log file bytes covered by each checkpoint of the sidecar index.
+ When non-zero, each log file gets a sidecar index file (same path with an `idx` extension) that
+ records the offset, timestamp, level and channel of every log message along with per checkpoint
+ summaries so that `TLSLogIndexQuery` queries can skip straight to the matching records.
+ Smaller intervals make queries more selective at the cost of a larger index.
+ Default is `0` (disabled).  Minimum non-zero value is `1KB`.
+ Set before adding the stream to a `TLSLoggingService`.
+ */
+@property (nonatomic) NSUInteger indexCheckpointInterval;
 
 /**
  Initialize the `TLSRollingFileOutputStream` with the provided settings
@@ -130,6 +140,13 @@ typedef NS_ENUM(TLSFileOutputEvent, TLSRollingFileOutputEvent) {
  */
 - (nullable NSData *)tls_retrieveLoggedData:(NSUInteger)maxBytes;
 
+#pragma mark - protocol TLSIndexedDataRetrieval
+/**
+ Seal the in progress index checkpoint, flush and get the paths of the log files with their sidecar indexes.
+ Only records logged while `indexCheckpointInterval` was non-zero can be matched.
+ */
+- (nonnull NSArray<NSString *> *)tls_indexedLogFilePaths;
+
 @end
 
 FOUNDATION_EXTERN NSString * __nonnull const TLSRollingFileOutputStreamDefaultLogFilePrefix;         // @"log." as a prefix
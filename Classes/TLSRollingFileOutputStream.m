@@ -19,6 +19,7 @@
 
 #import "TLS_Project.h"
 #import "TLSLoggingService+Advanced.h"
+#import "TLSRollingFileIndexWriter.h"
 #import "TLSRollingFileOutputStream.h"
 
 NSString * const TLSRollingFileOutputStreamDefaultLogFilePrefix = @"log.";
@@ -70,11 +71,17 @@ TLS_OBJC_DIRECT_MEMBERS
 - (BOOL)_purgeOldLogsIfNeeded;
 - (nullable NSArray<NSString *> *)_getLogFiles;
 - (void)_writeStartupTimestampInfo;
+- (void)_indexData:(NSData *)data
+          atOffset:(unsigned long long)offset
+        forLogInfo:(TLSLogMessageInfo *)logInfo;
 @end
 
 @implementation TLSRollingFileOutputStream
 {
     BOOL _hasRunPrune;
+    TLSRollingFileIndexWriter *_indexWriter;
+    unsigned long long _rolloverCount;
+    unsigned long long _purgeCount;
 }
 
 - (instancetype)initWithOutError:(NSError **)errorOut
@@ -193,12 +200,19 @@ TLS_OBJC_DIRECT_MEMBERS
     [self tls_fileOutputEventBegan:TLSRollingFileOutputEventOutputLogData
                               info:info];
 
+    TLSLogMessageInfo *logInfo = self.currentLogInfo;
+    const unsigned long long offset = _bytesWritten;
+
     // The only way `data` can be `nil` is if the caller coersed it to be a `nonnull` argument.
     // Since we are just wrapping the behavior of `outputLogData:` we MUST NOT change its behavior
     // and need to pass the `data` argument in the same coersed fashion so that the base
     // implementation can maintain ownership of acting upon `data`.
     [super outputLogData:(NSData * __nonnull)data];
 
+    if (logInfo && _indexCheckpointInterval > 0) {
+        [self _indexData:data atOffset:offset forLogInfo:logInfo];
+    }
+
     [self tls_fileOutputEventFinished:TLSRollingFileOutputEventOutputLogData
                                  info:info];
     if ([self _rolloverIfNeeded] || !_hasRunPrune) {
@@ -206,6 +220,32 @@ TLS_OBJC_DIRECT_MEMBERS
     }
 }
 
+- (BOOL)openLogFilePath:(NSString *)logFilePath
+                  error:(out NSError **)error
+{
+    const BOOL didOpen = [super openLogFilePath:logFilePath error:error];
+    if (didOpen) {
+        // the new log file gets a new index, lazily created on first write
+        [_indexWriter close];
+        _indexWriter = nil;
+    }
+    return didOpen;
+}
+
+- (void)tls_flush
+{
+    [super tls_flush];
+    [_indexWriter flush];
+}
+
+- (NSDictionary<NSString *, NSNumber *> *)tls_metricCounters
+{
+    NSMutableDictionary<NSString *, NSNumber *> *counters = [[super tls_metricCounters] mutableCopy];
+    counters[TLSOutputStreamMetricRollovers] = @(__atomic_load_n(&_rolloverCount, __ATOMIC_RELAXED));
+    counters[TLSOutputStreamMetricPurges] = @(__atomic_load_n(&_purgeCount, __ATOMIC_RELAXED));
+    return counters;
+}
+
 #pragma mark - TLSDataRetrieval protocol implementations
 
 - (NSData *)tls_retrieveLoggedData:(NSUInteger)maxBytes
@@ -242,6 +282,23 @@ TLS_OBJC_DIRECT_MEMBERS
     return data; // don't copy the gobs of data we just created...
 }
 
+#pragma mark - TLSIndexedDataRetrieval protocol implementations
+
+- (NSArray<NSString *> *)tls_indexedLogFilePaths
+{
+    // make the records of the in progress checkpoint visible
+    [_indexWriter sealCurrentBlock];
+    [self tls_flush];
+
+    NSArray<NSString *> *logs = [self _getLogFiles];
+    NSString *logDirectoryPath = self.logFileDirectoryPath;
+    NSMutableArray<NSString *> *logPaths = [[NSMutableArray alloc] initWithCapacity:logs.count];
+    for (NSString *log in logs) {
+        [logPaths addObject:[logDirectoryPath stringByAppendingPathComponent:log]];
+    }
+    return logPaths;
+}
+
 #pragma mark - TLSFileOutputStreamEvent protocol implementation
 
 - (void)tls_fileOutputEventBegan:(TLSFileOutputEvent)event
@@ -347,6 +404,7 @@ TLS_OBJC_DIRECT_MEMBERS
                                                                 code:errno
                                                             userInfo:@{ @"message" : @"Log could not be rolled over" }]];
         } else {
+            __atomic_fetch_add(&_rolloverCount, 1, __ATOMIC_RELAXED);
             [self tls_fileOutputEventFinished:TLSRollingFileOutputEventRolloverLogs
                                          info:eventInfo];
         }
@@ -388,6 +446,9 @@ TLS_OBJC_DIRECT_MEMBERS
             [self tls_fileOutputEventBegan:TLSRollingFileOutputEventPurgeLog
                                       info:eventInfo];
             if ([fm removeItemAtPath:nextLog error:&err]) {
+                // the sidecar index (if any) goes with its log
+                [fm removeItemAtPath:TLSLogIndexFilePathForLogFilePath(nextLog) error:NULL];
+                __atomic_fetch_add(&_purgeCount, 1, __ATOMIC_RELAXED);
                 [self tls_fileOutputEventFinished:TLSRollingFileOutputEventPurgeLog
                                              info:eventInfo];
                 filesToDelete--;
@@ -496,4 +557,24 @@ TLS_OBJC_DIRECT_MEMBERS
     [self writeNewline];
 }
 
+- (void)_indexData:(NSData *)data
+          atOffset:(unsigned long long)offset
+        forLogInfo:(TLSLogMessageInfo *)logInfo
+{
+    if (!_indexWriter) {
+        _indexWriter = [[TLSRollingFileIndexWriter alloc] initWithLogFilePath:self.logFilePath
+                                                                    blockSize:_indexCheckpointInterval];
+        if (!_indexWriter) {
+            return;
+        }
+    }
+
+    // record the data and its newline
+    [_indexWriter addRecordAtOffset:offset
+                             length:(NSUInteger)(_bytesWritten - offset)
+                              level:logInfo.level
+                            channel:logInfo.channel
+                          timestamp:logInfo.timestamp.timeIntervalSinceReferenceDate];
+}
+
 @end
@@ -0,0 +1,563 @@
+//
+//  TLSSharedLogRingBuffer.c
+//  TwitterLoggingService
+//
+//  Created on 10/18/26.
+//  Copyright (c) 2026 Twitter, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//          http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "TLSSharedLogRingBuffer.h"
+
+#define kRingMagic      (0x544C5352) // 'TLSR'
+#define kRingVersion    (2)
+#define kHeaderSize     (256)
+#define kCacheLineSize  (64)
+
+// caps of the metadata strings of a record, the message gets the rest of the cell
+#define kMaxChannelLength       (128)
+#define kMaxThreadNameLength    (64)
+#define kMaxFileLength          (256)
+#define kMaxFunctionLength      (256)
+
+enum {
+    kStringChannel = 0,
+    kStringFile,
+    kStringFunction,
+    kStringThreadName,
+    kStringMessage,
+    kStringCount
+};
+
+#define kCellFlagHasThreadName  (1 << 0)
+
+// the claim word of a cell: the claiming process (high 32 bits), the lap of the claimed position and its state
+#define kClaimStateNone         (0)
+#define kClaimStateWriting      (1) // the producer is filling the cell in, only recycled once the producer is dead
+#define kClaimStateAbandoned    (2) // given up on by the consumer before the producer started writing
+#define kClaimLapBits           (30)
+#define kClaimLapMask           ((UINT64_C(1) << kClaimLapBits) - 1)
+
+typedef struct TLSSharedLogRingHeader {
+    // written once by the creator, `magic` last
+    _Atomic uint32_t magic;
+    uint32_t version;
+    uint32_t cellSize;
+    uint32_t cellCount;
+    char pad0[kCacheLineSize - 16];
+
+    // contended by the producers
+    _Atomic uint64_t enqueuePosition;
+    char pad1[kCacheLineSize - 8];
+
+    // consumer only (besides the counters)
+    _Atomic uint64_t dequeuePosition;
+    _Atomic uint64_t droppedCount;
+    _Atomic uint64_t abandonedCount;
+} TLSSharedLogRingHeader;
+
+_Static_assert(sizeof(TLSSharedLogRingHeader) <= kHeaderSize, "header must fit its reserved space");
+
+typedef struct TLSSharedLogCell {
+    // `position` when free, `position + 1` when committed, `position + cellCount` once recycled
+    _Atomic uint64_t sequence;
+    // the claim word, moves from an older lap to `Writing` (by the producer) or `Abandoned` (by the consumer)
+    _Atomic uint64_t claim;
+    int32_t processIdentifier;
+    uint32_t threadId;
+    int32_t level;
+    int32_t line;
+    uint16_t flags;
+    uint16_t lengths[kStringCount];
+    double timestamp;
+    double logLifespan;
+    char strings[];
+} TLSSharedLogCell;
+
+struct TLSSharedLogRing {
+    int fileDescriptor;
+    int consumerLockFileDescriptor;
+    char *consumerLockPath;
+    void *mapping;
+    size_t mappingLength;
+    TLSSharedLogRingHeader *header;
+    char *cells;
+    uint32_t cellSize;
+    uint32_t cellCount;
+
+    // consumer only
+    char *consumeBuffer;
+    uint64_t stalledPosition;
+    double stallStartTime;
+};
+
+static uint32_t _RoundUpPowerOf2(uint32_t value, uint32_t min, uint32_t max)
+{
+    uint32_t rounded = min;
+    while (rounded < value && rounded < max) {
+        rounded <<= 1;
+    }
+    return rounded;
+}
+
+static double _MonotonicTime(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ((double)ts.tv_nsec / 1e9);
+}
+
+// the length of the longest prefix of _bytes_ that fits _capacity_ without splitting a code point
+static size_t _UTF8PrefixLength(const char *bytes, size_t length, size_t capacity)
+{
+    if (length <= capacity) {
+        return length;
+    }
+    size_t prefixLength = capacity;
+    // back up over continuation bytes to the lead byte of the code point that doesn't fit
+    while (prefixLength > 0 && 0x80 == ((unsigned char)bytes[prefixLength] & 0xC0)) {
+        prefixLength--;
+    }
+    return prefixLength;
+}
+
+static uint64_t _ClaimWord(int32_t processIdentifier, uint64_t lap, uint64_t state)
+{
+    return ((uint64_t)(uint32_t)processIdentifier << 32) | ((lap & kClaimLapMask) << 2) | state;
+}
+
+static int32_t _ClaimProcessIdentifier(uint64_t claim)
+{
+    return (int32_t)(uint32_t)(claim >> 32);
+}
+
+static uint64_t _ClaimState(uint64_t claim)
+{
+    return claim & 0x3;
+}
+
+// how many laps the claim word is ahead of _lap_ (negative when behind), laps wrap around
+static int32_t _ClaimLapDifference(uint64_t claim, uint64_t lap)
+{
+    const uint64_t difference = (((claim >> 2) & kClaimLapMask) - lap) & kClaimLapMask;
+    return (difference & (UINT64_C(1) << (kClaimLapBits - 1))) ? (int32_t)difference - (int32_t)(UINT64_C(1) << kClaimLapBits) : (int32_t)difference;
+}
+
+static TLSSharedLogCell *_Cell(const TLSSharedLogRing *ring, uint64_t position)
+{
+    return (TLSSharedLogCell *)(ring->cells + ((size_t)(position & (ring->cellCount - 1)) * ring->cellSize));
+}
+
+static bool _HeaderIsValid(const TLSSharedLogRingHeader *header, off_t fileSize)
+{
+    if (kRingMagic != atomic_load_explicit(&header->magic, memory_order_acquire) || kRingVersion != header->version) {
+        return false;
+    }
+    if (header->cellSize != _RoundUpPowerOf2(header->cellSize, TLSSharedLogRingMinCellSize, TLSSharedLogRingMaxCellSize)) {
+        return false;
+    }
+    if (header->cellCount != _RoundUpPowerOf2(header->cellCount, TLSSharedLogRingMinCellCount, TLSSharedLogRingMaxCellCount)) {
+        return false;
+    }
+    return fileSize == (off_t)(kHeaderSize + ((size_t)header->cellSize * header->cellCount));
+}
+
+static int _MapRing(TLSSharedLogRing *ring, size_t length)
+{
+    void *mapping = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, ring->fileDescriptor, 0);
+    if (MAP_FAILED == mapping) {
+        return errno;
+    }
+    ring->mapping = mapping;
+    ring->mappingLength = length;
+    ring->header = (TLSSharedLogRingHeader *)mapping;
+    ring->cells = (char *)mapping + kHeaderSize;
+    return 0;
+}
+
+static void _UnmapRing(TLSSharedLogRing *ring)
+{
+    if (ring->mapping) {
+        munmap(ring->mapping, ring->mappingLength);
+        ring->mapping = NULL;
+        ring->header = NULL;
+        ring->cells = NULL;
+    }
+}
+
+// with the file locked
+static int _OpenOrCreateRing(TLSSharedLogRing *ring, uint32_t cellSize, uint32_t cellCount)
+{
+    struct stat st;
+    if (0 != fstat(ring->fileDescriptor, &st)) {
+        return errno;
+    }
+
+    if (st.st_size >= kHeaderSize) {
+        TLSSharedLogRingHeader header;
+        if (sizeof(header) == pread(ring->fileDescriptor, &header, sizeof(header), 0) && _HeaderIsValid(&header, st.st_size)) {
+            const int error = _MapRing(ring, (size_t)st.st_size);
+            if (!error) {
+                ring->cellSize = header.cellSize;
+                ring->cellCount = header.cellCount;
+            }
+            return error;
+        }
+        // never finished being created (or not a ring), start over
+    }
+
+    const size_t length = kHeaderSize + ((size_t)cellSize * cellCount);
+    if (0 != ftruncate(ring->fileDescriptor, 0) || 0 != ftruncate(ring->fileDescriptor, (off_t)length)) {
+        return errno;
+    }
+    const int error = _MapRing(ring, length);
+    if (error) {
+        return error;
+    }
+
+    ring->cellSize = cellSize;
+    ring->cellCount = cellCount;
+    for (uint32_t i = 0; i < cellCount; i++) {
+        atomic_store_explicit(&_Cell(ring, i)->sequence, i, memory_order_relaxed);
+        atomic_store_explicit(&_Cell(ring, i)->claim, _ClaimWord(0, 0, kClaimStateNone), memory_order_relaxed);
+    }
+    TLSSharedLogRingHeader *header = ring->header;
+    header->version = kRingVersion;
+    header->cellSize = cellSize;
+    header->cellCount = cellCount;
+    atomic_store_explicit(&header->enqueuePosition, 0, memory_order_relaxed);
+    atomic_store_explicit(&header->dequeuePosition, 0, memory_order_relaxed);
+    atomic_store_explicit(&header->droppedCount, 0, memory_order_relaxed);
+    atomic_store_explicit(&header->abandonedCount, 0, memory_order_relaxed);
+    atomic_store_explicit(&header->magic, kRingMagic, memory_order_release);
+    return 0;
+}
+
+TLSSharedLogRing *TLSSharedLogRingOpen(const char *path, uint32_t cellSize, uint32_t cellCount)
+{
+    TLSSharedLogRing *ring = calloc(1, sizeof(TLSSharedLogRing));
+    if (!ring) {
+        return NULL;
+    }
+    ring->consumerLockFileDescriptor = -1;
+
+    ring->fileDescriptor = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (ring->fileDescriptor < 0) {
+        free(ring);
+        return NULL;
+    }
+
+    // serialize creation between processes
+    int error = 0;
+    if (0 != flock(ring->fileDescriptor, LOCK_EX)) {
+        error = errno;
+    } else {
+        error = _OpenOrCreateRing(ring,
+                                  _RoundUpPowerOf2(cellSize, TLSSharedLogRingMinCellSize, TLSSharedLogRingMaxCellSize),
+                                  _RoundUpPowerOf2(cellCount, TLSSharedLogRingMinCellCount, TLSSharedLogRingMaxCellCount));
+        flock(ring->fileDescriptor, LOCK_UN);
+    }
+
+    if (!error) {
+        const size_t pathLength = strlen(path) + sizeof(".consumer");
+        ring->consumerLockPath = malloc(pathLength);
+        if (!ring->consumerLockPath) {
+            error = ENOMEM;
+        } else {
+            snprintf(ring->consumerLockPath, pathLength, "%s.consumer", path);
+        }
+    }
+
+    if (error) {
+        TLSSharedLogRingClose(ring);
+        errno = error;
+        return NULL;
+    }
+    return ring;
+}
+
+void TLSSharedLogRingClose(TLSSharedLogRing *ring)
+{
+    if (!ring) {
+        return;
+    }
+    _UnmapRing(ring);
+    if (ring->consumerLockFileDescriptor >= 0) {
+        close(ring->consumerLockFileDescriptor);
+    }
+    if (ring->fileDescriptor >= 0) {
+        close(ring->fileDescriptor);
+    }
+    free(ring->consumerLockPath);
+    free(ring->consumeBuffer);
+    free(ring);
+}
+
+uint32_t TLSSharedLogRingCellSize(const TLSSharedLogRing *ring)
+{
+    return ring->cellSize;
+}
+
+uint32_t TLSSharedLogRingCellCount(const TLSSharedLogRing *ring)
+{
+    return ring->cellCount;
+}
+
+uint64_t TLSSharedLogRingDroppedCount(const TLSSharedLogRing *ring)
+{
+    return atomic_load_explicit(&ring->header->droppedCount, memory_order_relaxed);
+}
+
+uint64_t TLSSharedLogRingAbandonedCount(const TLSSharedLogRing *ring)
+{
+    return atomic_load_explicit(&ring->header->abandonedCount, memory_order_relaxed);
+}
+
+bool TLSSharedLogRingPublish(TLSSharedLogRing *ring, const TLSSharedLogRecord *record)
+{
+    TLSSharedLogRingHeader *header = ring->header;
+
+    // claim a cell
+    TLSSharedLogCell *cell;
+    uint64_t position = atomic_load_explicit(&header->enqueuePosition, memory_order_relaxed);
+    for (;;) {
+        cell = _Cell(ring, position);
+        const uint64_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        const int64_t difference = (int64_t)(sequence - position);
+        if (0 == difference) {
+            if (atomic_compare_exchange_weak_explicit(&header->enqueuePosition,
+                                                      &position,
+                                                      position + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                break;
+            }
+            // `position` was reloaded by the failed exchange
+        } else if (difference < 0) {
+            // the consumer is a full lap behind
+            atomic_fetch_add_explicit(&header->droppedCount, 1, memory_order_relaxed);
+            return false;
+        } else {
+            position = atomic_load_explicit(&header->enqueuePosition, memory_order_relaxed);
+        }
+    }
+
+    // mark the cell as being written (identifying ourselves so the consumer can tell if we die before committing),
+    // unless the consumer gave up on it before we got here, the cell could already be another producer's
+    const uint64_t lap = position / ring->cellCount;
+    const uint64_t writingClaim = _ClaimWord((int32_t)getpid(), lap, kClaimStateWriting);
+    uint64_t claim = atomic_load_explicit(&cell->claim, memory_order_relaxed);
+    do {
+        const int32_t lapDifference = _ClaimLapDifference(claim, lap);
+        if (lapDifference > 0 || (0 == lapDifference && kClaimStateNone != _ClaimState(claim))) {
+            return false;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&cell->claim,
+                                                    &claim,
+                                                    writingClaim,
+                                                    memory_order_acq_rel,
+                                                    memory_order_relaxed));
+
+    const char *strings[kStringCount] = { record->channel, record->file, record->function, record->threadName, record->message };
+    const size_t lengths[kStringCount] = { record->channelLength, record->fileLength, record->functionLength, record->threadNameLength, record->messageLength };
+    const size_t caps[kStringCount] = { kMaxChannelLength, kMaxFileLength, kMaxFunctionLength, kMaxThreadNameLength, SIZE_MAX };
+    size_t available = ring->cellSize - offsetof(TLSSharedLogCell, strings);
+    char *cursor = cell->strings;
+    for (int i = 0; i < kStringCount; i++) {
+        const size_t length = (strings[i]) ? _UTF8PrefixLength(strings[i], lengths[i], (caps[i] < available) ? caps[i] : available) : 0;
+        if (length > 0) {
+            memcpy(cursor, strings[i], length);
+        }
+        cell->lengths[i] = (uint16_t)length;
+        cursor += length;
+        available -= length;
+    }
+    cell->flags = (record->threadName) ? kCellFlagHasThreadName : 0;
+    cell->processIdentifier = record->processIdentifier;
+    cell->threadId = record->threadId;
+    cell->level = record->level;
+    cell->line = record->line;
+    cell->timestamp = record->timestamp;
+    cell->logLifespan = record->logLifespan;
+
+    // commit, the consumer doesn't recycle a cell being written by a live producer
+    atomic_store_explicit(&cell->sequence, position + 1, memory_order_release);
+    return true;
+}
+
+int TLSSharedLogRingClaimConsumer(TLSSharedLogRing *ring)
+{
+    if (ring->consumerLockFileDescriptor >= 0) {
+        return 0;
+    }
+
+    const int fileDescriptor = open(ring->consumerLockPath, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fileDescriptor < 0) {
+        return errno;
+    }
+    // the lock goes away with the process, a crashed consumer doesn't lock out its successor
+    if (0 != flock(fileDescriptor, LOCK_EX | LOCK_NB)) {
+        const int error = errno;
+        close(fileDescriptor);
+        return error;
+    }
+
+    ring->consumeBuffer = malloc(ring->cellSize);
+    if (!ring->consumeBuffer) {
+        close(fileDescriptor);
+        return ENOMEM;
+    }
+    ring->consumerLockFileDescriptor = fileDescriptor;
+    ring->stalledPosition = UINT64_MAX;
+    return 0;
+}
+
+static void _RecycleCell(TLSSharedLogRing *ring, TLSSharedLogCell *cell, uint64_t position)
+{
+    atomic_store_explicit(&cell->sequence, position + ring->cellCount, memory_order_release);
+    atomic_store_explicit(&ring->header->dequeuePosition, position + 1, memory_order_relaxed);
+}
+
+static bool _ProcessIsDead(int32_t processIdentifier)
+{
+    return processIdentifier > 0 && 0 != kill(processIdentifier, 0) && ESRCH == errno;
+}
+
+static bool _HasStalled(TLSSharedLogRing *ring, uint64_t position, double stallTimeout)
+{
+    const double now = _MonotonicTime();
+    if (ring->stalledPosition != position) {
+        ring->stalledPosition = position;
+        ring->stallStartTime = now;
+        return false;
+    }
+    return (now - ring->stallStartTime) >= stallTimeout;
+}
+
+size_t TLSSharedLogRingConsume(TLSSharedLogRing *ring,
+                               size_t maxCount,
+                               double stallTimeout,
+                               TLSSharedLogRingConsumeFunction function,
+                               void *context)
+{
+    if (ring->consumerLockFileDescriptor < 0) {
+        return 0;
+    }
+
+    TLSSharedLogRingHeader *header = ring->header;
+    const size_t stringsCapacity = ring->cellSize - offsetof(TLSSharedLogCell, strings);
+    uint64_t position = atomic_load_explicit(&header->dequeuePosition, memory_order_relaxed);
+    size_t count = 0;
+    while (count < maxCount) {
+        TLSSharedLogCell *cell = _Cell(ring, position);
+        const uint64_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        const int64_t difference = (int64_t)(sequence - (position + 1));
+
+        if (difference < 0) {
+            if (atomic_load_explicit(&header->enqueuePosition, memory_order_relaxed) <= position) {
+                // empty
+                break;
+            }
+            // claimed but not committed yet
+            const uint64_t lap = position / ring->cellCount;
+            uint64_t claim = atomic_load_explicit(&cell->claim, memory_order_acquire);
+            if (0 == _ClaimLapDifference(claim, lap) && kClaimStateWriting == _ClaimState(claim)) {
+                // being written, however long it takes, unless its producer died (a suspended producer can still write)
+                if (!_ProcessIsDead(_ClaimProcessIdentifier(claim))) {
+                    break;
+                }
+                if ((int64_t)(atomic_load_explicit(&cell->sequence, memory_order_acquire) - (position + 1)) >= 0) {
+                    // committed right before dying
+                    continue;
+                }
+            } else {
+                // the producer hasn't started writing, give up on the cell for good so that it never does
+                if (!_HasStalled(ring, position, stallTimeout)) {
+                    break;
+                }
+                if (!atomic_compare_exchange_strong_explicit(&cell->claim,
+                                                             &claim,
+                                                             _ClaimWord(0, lap, kClaimStateAbandoned),
+                                                             memory_order_acq_rel,
+                                                             memory_order_acquire)) {
+                    // the producer got to it first
+                    continue;
+                }
+            }
+            atomic_fetch_add_explicit(&header->abandonedCount, 1, memory_order_relaxed);
+            _RecycleCell(ring, cell, position);
+            position++;
+            continue;
+        } else if (difference > 0) {
+            // cannot happen with a single consumer, the ring was tampered with
+            break;
+        }
+
+        // copy the record out so the cell can be recycled before calling out
+        memcpy(ring->consumeBuffer, cell, ring->cellSize);
+        _RecycleCell(ring, cell, position);
+        position++;
+
+        const TLSSharedLogCell *copy = (const TLSSharedLogCell *)ring->consumeBuffer;
+        size_t totalLength = 0;
+        for (int i = 0; i < kStringCount; i++) {
+            totalLength += copy->lengths[i];
+        }
+        if (totalLength > stringsCapacity) {
+            // torn
+            atomic_fetch_add_explicit(&header->abandonedCount, 1, memory_order_relaxed);
+            continue;
+        }
+
+        TLSSharedLogRecord record;
+        const char *cursor = copy->strings;
+        record.processIdentifier = copy->processIdentifier;
+        record.threadId = copy->threadId;
+        record.level = copy->level;
+        record.line = copy->line;
+        record.timestamp = copy->timestamp;
+        record.logLifespan = copy->logLifespan;
+        record.channel = cursor;
+        record.channelLength = copy->lengths[kStringChannel];
+        cursor += record.channelLength;
+        record.file = cursor;
+        record.fileLength = copy->lengths[kStringFile];
+        cursor += record.fileLength;
+        record.function = cursor;
+        record.functionLength = copy->lengths[kStringFunction];
+        cursor += record.functionLength;
+        record.threadName = (copy->flags & kCellFlagHasThreadName) ? cursor : NULL;
+        record.threadNameLength = copy->lengths[kStringThreadName];
+        cursor += record.threadNameLength;
+        record.message = cursor;
+        record.messageLength = copy->lengths[kStringMessage];
+
+        function(&record, context);
+        count++;
+    }
+    return count;
+}
@@ -0,0 +1,136 @@
+//
+//  TLSSharedLogRingBuffer.h
+//  TwitterLoggingService
+//
+//  Created on 10/18/26.
+//  Copyright (c) 2026 Twitter, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//          http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+/* This header is private to Twitter Logging Service */
+
+/*
+ A multi-producer, single-consumer ring of log records in a memory mapped file, shared between processes.
+
+ Plain C (no Foundation) so that producers and the consumer can be exercised as separate local
+ processes on any POSIX system.
+
+ The ring is a bounded queue of fixed size cells, each with its own sequence number (see Dmitry
+ Vyukov's bounded MPMC queue): producers claim a cell by advancing the shared enqueue position with
+ compare-and-swap, fill it in, then commit it by publishing the cell's sequence number.  The consumer
+ reads committed cells in order and recycles them.
+
+ A producer that dies between claiming and committing a cell would stall the consumer forever, so
+ claiming is 2 phased: once it has claimed a position, the producer marks the cell as being written
+ (with its process identifier) before filling it in.  The consumer recycles a cell being written only once
+ its producer is dead, a live producer (even suspended) is waited for since it could still write into the
+ cell.  A cell that stays claimed without being marked is given up on after a stall timeout, the consumer
+ marks it abandoned first so that its producer loses its record instead of writing into a recycled cell.
+ Records with inconsistent lengths (torn by a crash) are skipped too.
+
+ Producers and the consumer can be exercised as local processes with
+ TwitterLoggingServiceTests/TLSSharedLogRingBufferHarness.c
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//! Min and max `cellSize` (bytes per record), a power of 2
+#define TLSSharedLogRingMinCellSize (256)
+#define TLSSharedLogRingMaxCellSize (64 * 1024)
+//! Min and max `cellCount`, a power of 2
+#define TLSSharedLogRingMinCellCount (16)
+#define TLSSharedLogRingMaxCellCount (1024 * 1024)
+
+/** A log record, strings are UTF-8 and not NUL terminated */
+typedef struct TLSSharedLogRecord {
+    int32_t processIdentifier;
+    uint32_t threadId;
+    int32_t level;
+    int32_t line;
+    double timestamp; // seconds since 1970
+    double logLifespan;
+    const char *channel;
+    size_t channelLength;
+    const char *file;
+    size_t fileLength;
+    const char *function;
+    size_t functionLength;
+    const char *threadName; // NULL for unnamed threads
+    size_t threadNameLength;
+    const char *message;
+    size_t messageLength;
+} TLSSharedLogRecord;
+
+/** An open ring, each process (or each producer and consumer) opens its own */
+typedef struct TLSSharedLogRing TLSSharedLogRing;
+
+/**
+ Open the ring at _path_, creating it with _cellSize_ and _cellCount_ (rounded up to powers of 2 and
+ clamped) if it does not exist.  An existing ring keeps its own geometry.
+ Returns `NULL` with `errno` set on failure.
+ */
+TLSSharedLogRing *TLSSharedLogRingOpen(const char *path, uint32_t cellSize, uint32_t cellCount);
+
+/** Close the ring, releasing the consumer role if it was claimed */
+void TLSSharedLogRingClose(TLSSharedLogRing *ring);
+
+/** The size of each cell of the ring */
+uint32_t TLSSharedLogRingCellSize(const TLSSharedLogRing *ring);
+/** The number of cells of the ring */
+uint32_t TLSSharedLogRingCellCount(const TLSSharedLogRing *ring);
+
+/**
+ Publish a _record_, truncating its strings (at UTF-8 code point boundaries, message first) to fit a cell.
+ Lock free and safe to call from any thread of any process.
+ Returns `false` if the ring is full (counted as dropped) or the record was given up on by the consumer.
+ */
+bool TLSSharedLogRingPublish(TLSSharedLogRing *ring, const TLSSharedLogRecord *record);
+
+/**
+ Claim the consumer role of the ring, only 1 consumer across all processes can hold it.
+ Released when the ring is closed or the process exits (however it exits).
+ Returns `0` or the `errno` of the failure (`EWOULDBLOCK` when another consumer holds it).
+ */
+int TLSSharedLogRingClaimConsumer(TLSSharedLogRing *ring);
+
+/** Called for each consumed record, the _record_ and its strings are only valid for the duration of the call */
+typedef void (*TLSSharedLogRingConsumeFunction)(const TLSSharedLogRecord *record, void *context);
+
+/**
+ Consume up to _maxCount_ committed records, in the order they were claimed.
+ Uncommitted records are given up on when their process is dead, or once they have been stalled
+ for _stallTimeout_ seconds without their producer having started to write them.
+ Must only be called by the claimed consumer, from 1 thread at a time.
+ Returns the number of records consumed.
+ */
+size_t TLSSharedLogRingConsume(TLSSharedLogRing *ring,
+                               size_t maxCount,
+                               double stallTimeout,
+                               TLSSharedLogRingConsumeFunction function,
+                               void *context);
+
+/** The number of records dropped because the ring was full */
+uint64_t TLSSharedLogRingDroppedCount(const TLSSharedLogRing *ring);
+/** The number of records given up on by the consumer (dead or stalled producers, torn records) */
+uint64_t TLSSharedLogRingAbandonedCount(const TLSSharedLogRing *ring);
+
+#ifdef __cplusplus
+}
+#endif
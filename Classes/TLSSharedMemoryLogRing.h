@@ -0,0 +1,149 @@
+//
+//  TLSSharedMemoryLogRing.h
+//  TwitterLoggingService
+//
+//  Created on 10/18/26.
+//  Copyright (c) 2026 Twitter, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//          http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+#import <TwitterLoggingService/TLSProtocols.h>
+
+@class TLSLoggingService;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ Logging from several processes (such as an app, its extensions and its helpers) into a single
+ set of output streams.
+
+ Each producing process adds a `TLSSharedMemoryOutputStream` to its `TLSLoggingService`, which publishes
+ its log messages into a ring in a memory mapped file shared by all the processes.  One designated
+ writer process owns a `TLSSharedMemoryLogDrain` that drains the ring into its own `TLSLoggingService`
+ (see `logMessageInfo:`), tagging each log message with the `processIdentifier` of the process that
+ logged it.  There is then one set of log files with one budget, instead of one per process to merge
+ at export time.
+
+ Publishing is lock free and never blocks: a log message is dropped when the ring is full.
+ Log messages are truncated to fit the fixed size cells of the ring.
+ A process that crashes while publishing doesn't wedge the ring, the drain skips its half written log
+ message (see `stallTimeout`).
+
+ ## Constants
+
+    FOUNDATION_EXTERN const NSUInteger TLSSharedMemoryLogRingDefaultCellSize;   // 1 KB
+    FOUNDATION_EXTERN const NSUInteger TLSSharedMemoryLogRingDefaultCellCount;  // 4096 cells
+
+ @note The ring's geometry is decided by whichever process creates the ring file, the _cellSize_ and _cellCount_ of the other processes are ignored.
+ */
+@interface TLSSharedMemoryOutputStream : NSObject <TLSOutputStream>
+
+/** The path of the ring file */
+@property (nonatomic, copy, readonly) NSString *ringFilePath;
+/** The number of log messages dropped because the ring was full, by all processes */
+@property (nonatomic, readonly) uint64_t droppedCount;
+
+/**
+ Open (or create) the ring at the _ringFilePath_ to publish log messages into.
+ @param ringFilePath the path of the ring file, in a directory shared by the processes (such as an app group container)
+ @param cellSize the max bytes of a log message in the ring, a power of 2 between 256 bytes and 64 KB
+ @param cellCount the number of log messages the ring can hold, a power of 2 between 16 and 1M
+ @param errorOut an output reference to get any errors that occur while opening the ring.  If there is an error, the return value will be `nil`.
+ */
+- (nullable instancetype)initWithRingFilePath:(NSString *)ringFilePath
+                                     cellSize:(NSUInteger)cellSize
+                                    cellCount:(NSUInteger)cellCount
+                                        error:(out NSError * __nullable __autoreleasing * __nullable)errorOut NS_DESIGNATED_INITIALIZER;
+
+/** See initWithRingFilePath:cellSize:cellCount:error: with the defaults */
+- (nullable instancetype)initWithRingFilePath:(NSString *)ringFilePath
+                                        error:(out NSError * __nullable __autoreleasing * __nullable)errorOut;
+
+/** NS_UNAVAILABLE */
+- (instancetype)init NS_UNAVAILABLE;
+/** NS_UNAVAILABLE */
++ (instancetype)new NS_UNAVAILABLE;
+
+/**
+ Publish the _logInfo_ to the ring.
+ Log messages from other processes (with a `processIdentifier`) are not published again, so a writer
+ process can use the same ring as its producers without looping.
+ */
+- (void)tls_outputLogInfo:(TLSLogMessageInfo *)logInfo;
+
+@end
+
+/**
+ Drains the ring of `TLSSharedMemoryOutputStream` log messages into a `TLSLoggingService`.
+ Only 1 drain per ring can exist across all processes, the lock is released when the drain is
+ deallocated or its process exits.
+ */
+@interface TLSSharedMemoryLogDrain : NSObject
+
+/** The path of the ring file */
+@property (nonatomic, copy, readonly) NSString *ringFilePath;
+/** The service the log messages are drained into */
+@property (nonatomic, readonly) TLSLoggingService *loggingService;
+/**
+ How long a claimed log message can wait for its process to start writing it before the drain gives up on it and skips it.
+ Log messages being written are waited for as long as their process is alive, those of processes that died are skipped right away.
+ Default is `1` second
+ */
+@property (atomic) NSTimeInterval stallTimeout;
+/** The number of log messages dropped because the ring was full, by all processes */
+@property (nonatomic, readonly) uint64_t droppedCount;
+/** The number of half written log messages given up on */
+@property (nonatomic, readonly) uint64_t abandonedCount;
+
+/**
+ Open (or create) the ring at the _ringFilePath_ to drain.
+ @param ringFilePath the path of the ring file
+ @param cellSize see `TLSSharedMemoryOutputStream`
+ @param cellCount see `TLSSharedMemoryOutputStream`
+ @param loggingService the service to drain into, `nil` for `[TLSLoggingService sharedInstance]`
+ @param errorOut an output reference to get any errors that occur while opening the ring (`EWOULDBLOCK` when another drain exists).  If there is an error, the return value will be `nil`.
+ */
+- (nullable instancetype)initWithRingFilePath:(NSString *)ringFilePath
+                                     cellSize:(NSUInteger)cellSize
+                                    cellCount:(NSUInteger)cellCount
+                               loggingService:(nullable TLSLoggingService *)loggingService
+                                        error:(out NSError * __nullable __autoreleasing * __nullable)errorOut NS_DESIGNATED_INITIALIZER;
+
+/** NS_UNAVAILABLE */
+- (instancetype)init NS_UNAVAILABLE;
+/** NS_UNAVAILABLE */
++ (instancetype)new NS_UNAVAILABLE;
+
+/**
+ Drain the ring every _interval_ seconds until `stop`.
+ */
+- (void)startWithInterval:(NSTimeInterval)interval;
+
+/**
+ Stop draining the ring periodically.
+ */
+- (void)stop;
+
+/**
+ Synchronously drain what is in the ring.
+ @return the number of log messages drained
+ */
+- (NSUInteger)drain;
+
+@end
+
+FOUNDATION_EXTERN const NSUInteger TLSSharedMemoryLogRingDefaultCellSize;   // 1 KB
+FOUNDATION_EXTERN const NSUInteger TLSSharedMemoryLogRingDefaultCellCount;  // 4096 cells
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,293 @@
+//
+//  TLSSharedMemoryLogRing.m
+//  TwitterLoggingService
+//
+//  Created on 10/18/26.
+//  Copyright (c) 2026 Twitter, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//          http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+#include <unistd.h>
+
+#import "TLS_Project.h"
+#import "TLSLoggingService+Advanced.h"
+#import "TLSSharedLogRingBuffer.h"
+#import "TLSSharedMemoryLogRing.h"
+
+const NSUInteger TLSSharedMemoryLogRingDefaultCellSize = 1024;
+const NSUInteger TLSSharedMemoryLogRingDefaultCellCount = 4096;
+
+static const NSTimeInterval kDefaultStallTimeout = 1.0;
+
+static TLSSharedLogRing *_OpenRing(NSString *ringFilePath, NSUInteger cellSize, NSUInteger cellCount, NSError **errorOut);
+static TLSSharedLogRing *_OpenRing(NSString *ringFilePath, NSUInteger cellSize, NSUInteger cellCount, NSError **errorOut)
+{
+    TLSSharedLogRing *ring = (ringFilePath.length > 0) ? TLSSharedLogRingOpen(ringFilePath.fileSystemRepresentation,
+                                                                              (uint32_t)MIN(cellSize, (NSUInteger)UINT32_MAX),
+                                                                              (uint32_t)MIN(cellCount, (NSUInteger)UINT32_MAX)) : NULL;
+    if (!ring && errorOut) {
+        const int code = (ringFilePath.length > 0) ? errno : EINVAL;
+        *errorOut = [NSError errorWithDomain:NSPOSIXErrorDomain
+                                        code:code
+                                    userInfo:@{ @"message" : @"unable to open the shared memory log ring",
+                                                @"ringFilePath" : ringFilePath ?: [NSNull null] }];
+    }
+    return ring;
+}
+
+static NSString *_StringFromBytes(const char *bytes, size_t length);
+static NSString *_StringFromBytes(const char *bytes, size_t length)
+{
+    if (0 == length) {
+        return @"";
+    }
+    return [[NSString alloc] initWithBytes:bytes length:length encoding:NSUTF8StringEncoding] ?: @"";
+}
+
+static void _DrainRecord(const TLSSharedLogRecord *record, void *context);
+
+@implementation TLSSharedMemoryOutputStream
+{
+    TLSSharedLogRing *_ring;
+    pid_t _processIdentifier;
+}
+
+- (instancetype)initWithRingFilePath:(NSString *)ringFilePath
+                               error:(out NSError **)errorOut
+{
+    return [self initWithRingFilePath:ringFilePath
+                             cellSize:TLSSharedMemoryLogRingDefaultCellSize
+                            cellCount:TLSSharedMemoryLogRingDefaultCellCount
+                                error:errorOut];
+}
+
+- (instancetype)initWithRingFilePath:(NSString *)ringFilePath
+                            cellSize:(NSUInteger)cellSize
+                           cellCount:(NSUInteger)cellCount
+                               error:(out NSError **)errorOut // NS_DESIGNATED_INITIALIZER
+{
+    if (errorOut) {
+        *errorOut = nil;
+    }
+
+    TLSSharedLogRing *ring = _OpenRing(ringFilePath, cellSize, cellCount, errorOut);
+    if (!ring) {
+        return nil;
+    }
+
+    if (self = [super init]) {
+        _ringFilePath = [ringFilePath copy];
+        _ring = ring;
+        _processIdentifier = getpid();
+    } else {
+        TLSSharedLogRingClose(ring);
+    }
+    return self;
+}
+
+- (instancetype)init
+{
+    [self doesNotRecognizeSelector:_cmd];
+    abort();
+}
+
+- (void)dealloc
+{
+    TLSSharedLogRingClose(_ring);
+}
+
+- (uint64_t)droppedCount
+{
+    return TLSSharedLogRingDroppedCount(_ring);
+}
+
+- (void)tls_outputLogInfo:(TLSLogMessageInfo *)logInfo
+{
+    if (logInfo.processIdentifier != 0) {
+        // already came through a ring
+        return;
+    }
+
+    @autoreleasepool {
+        const char *channel = logInfo.channel.UTF8String;
+        const char *file = logInfo.file.UTF8String;
+        const char *function = logInfo.function.UTF8String;
+        const char *threadName = logInfo.threadName.UTF8String;
+        const char *message = logInfo.message.UTF8String;
+
+        TLSSharedLogRecord record;
+        record.processIdentifier = _processIdentifier;
+        record.threadId = logInfo.threadId;
+        record.level = (int32_t)logInfo.level;
+        record.line = (int32_t)logInfo.line;
+        record.timestamp = logInfo.timestamp.timeIntervalSince1970;
+        record.logLifespan = logInfo.logLifespan;
+        record.channel = channel;
+        record.channelLength = (channel) ? strlen(channel) : 0;
+        record.file = file;
+        record.fileLength = (file) ? strlen(file) : 0;
+        record.function = function;
+        record.functionLength = (function) ? strlen(function) : 0;
+        record.threadName = threadName;
+        record.threadNameLength = (threadName) ? strlen(threadName) : 0;
+        record.message = message;
+        record.messageLength = (message) ? strlen(message) : 0;
+        (void)TLSSharedLogRingPublish(_ring, &record);
+    }
+}
+
+@end
+
+@interface TLSSharedMemoryLogDrain ()
+- (NSUInteger)_queue_drain TLS_OBJC_DIRECT;
+@end
+
+@implementation TLSSharedMemoryLogDrain
+{
+    TLSSharedLogRing *_ring;
+    dispatch_queue_t _queue;
+    dispatch_source_t _timer;
+}
+
+- (instancetype)initWithRingFilePath:(NSString *)ringFilePath
+                            cellSize:(NSUInteger)cellSize
+                           cellCount:(NSUInteger)cellCount
+                      loggingService:(TLSLoggingService *)loggingService
+                               error:(out NSError **)errorOut // NS_DESIGNATED_INITIALIZER
+{
+    if (errorOut) {
+        *errorOut = nil;
+    }
+
+    TLSSharedLogRing *ring = _OpenRing(ringFilePath, cellSize, cellCount, errorOut);
+    if (!ring) {
+        return nil;
+    }
+
+    const int claimError = TLSSharedLogRingClaimConsumer(ring);
+    if (claimError) {
+        TLSSharedLogRingClose(ring);
+        if (errorOut) {
+            *errorOut = [NSError errorWithDomain:NSPOSIXErrorDomain
+                                            code:claimError
+                                        userInfo:@{ @"message" : @"unable to become the drain of the shared memory log ring",
+                                                    @"ringFilePath" : ringFilePath }];
+        }
+        return nil;
+    }
+
+    if (self = [super init]) {
+        _ringFilePath = [ringFilePath copy];
+        _loggingService = loggingService ?: [TLSLoggingService sharedInstance];
+        _stallTimeout = kDefaultStallTimeout;
+        _ring = ring;
+        _queue = dispatch_queue_create("TLSSharedMemoryLogDrain.queue", DISPATCH_QUEUE_SERIAL);
+    } else {
+        TLSSharedLogRingClose(ring);
+    }
+    return self;
+}
+
+- (instancetype)init
+{
+    [self doesNotRecognizeSelector:_cmd];
+    abort();
+}
+
+- (void)dealloc
+{
+    if (_timer) {
+        dispatch_source_cancel(_timer);
+    }
+    TLSSharedLogRingClose(_ring);
+}
+
+- (uint64_t)droppedCount
+{
+    return TLSSharedLogRingDroppedCount(_ring);
+}
+
+- (uint64_t)abandonedCount
+{
+    return TLSSharedLogRingAbandonedCount(_ring);
+}
+
+- (void)startWithInterval:(NSTimeInterval)interval
+{
+    dispatch_async(_queue, ^{
+        if (self->_timer) {
+            dispatch_source_cancel(self->_timer);
+        }
+        self->_timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, self->_queue);
+        const uint64_t intervalNanoseconds = (uint64_t)(MAX(interval, 0.001) * NSEC_PER_SEC);
+        dispatch_source_set_timer(self->_timer,
+                                  dispatch_time(DISPATCH_TIME_NOW, (int64_t)intervalNanoseconds),
+                                  intervalNanoseconds,
+                                  intervalNanoseconds / 10 /*leeway*/);
+        __weak typeof(self) weakSelf = self;
+        dispatch_source_set_event_handler(self->_timer, ^{
+            [weakSelf _queue_drain];
+        });
+        dispatch_resume(self->_timer);
+    });
+}
+
+- (void)stop
+{
+    dispatch_async(_queue, ^{
+        if (self->_timer) {
+            dispatch_source_cancel(self->_timer);
+            self->_timer = nil;
+        }
+    });
+}
+
+- (NSUInteger)drain
+{
+    __block NSUInteger count = 0;
+    dispatch_sync(_queue, ^{
+        count = [self _queue_drain];
+    });
+    return count;
+}
+
+- (NSUInteger)_queue_drain
+{
+    @autoreleasepool {
+        return TLSSharedLogRingConsume(_ring, SIZE_MAX, self.stallTimeout, _DrainRecord, (__bridge void *)self);
+    }
+}
+
+@end
+
+static void _DrainRecord(const TLSSharedLogRecord *record, void *context)
+{
+    TLSSharedMemoryLogDrain *drain = (__bridge TLSSharedMemoryLogDrain *)context;
+    TLSLoggingService *service = drain.loggingService;
+    const TLSLogLevel level = (record->level >= 0 && record->level < TLSLogLevelCount) ? (TLSLogLevel)record->level : TLSLogLevelDebug;
+    TLSLogMessageInfo *info = [[TLSLogMessageInfo alloc] initWithLevel:level
+                                                                  file:_StringFromBytes(record->file, record->fileLength)
+                                                              function:_StringFromBytes(record->function, record->functionLength)
+                                                                  line:record->line
+                                                               channel:_StringFromBytes(record->channel, record->channelLength)
+                                                             timestamp:[NSDate dateWithTimeIntervalSince1970:record->timestamp]
+                                                           logLifespan:record->logLifespan
+                                                              threadId:record->threadId
+                                                            threadName:(record->threadName) ? _StringFromBytes(record->threadName, record->threadNameLength) : nil
+                                                         contextObject:nil
+                                                               message:_StringFromBytes(record->message, record->messageLength)];
+    // never `0`, which means this process
+    [info tls_setProcessIdentifier:(record->processIdentifier != 0) ? record->processIdentifier : -1];
+    [service logMessageInfo:info];
+}
@@ -0,0 +1,99 @@
+//
+//  TLSWorkloadTrace.h
+//  TwitterLoggingService
+//
+//  Created on 10/18/26.
+//  Copyright (c) 2026 Twitter, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//          http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+#import <TwitterLoggingService/TLSDeclarations.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ A logging call captured by `[TLSLoggingService beginWorkloadCaptureToFilePath:error:]`.
+ Only the shape of the call is captured, never the message itself.
+ */
+typedef struct TLSWorkloadTraceRecord {
+    uint64_t time;          // nanoseconds since the capture began, when the call was made
+    uint32_t threadId;      // the mach thread id of the caller
+    uint32_t callsiteIndex; // into `[TLSWorkloadTrace callsites]`
+    uint32_t channelIndex;  // into `[TLSWorkloadTrace channels]`
+    uint32_t messageLength; // of the formatted message in UTF-8 bytes, `0` when filtered
+    uint8_t level;          // `TLSLogLevel`
+    uint8_t filtered;       // `1` when the call was filtered (or throttled, or shed) before formatting
+    uint8_t reserved[6];
+} TLSWorkloadTraceRecord;
+
+/**
+ The callsite of captured logging calls.
+ The `function` is empty for a callsite that has only been captured as filtered (the `TLSLog` macros
+ only provide the file and line until the message is logged).
+ */
+@interface TLSWorkloadTraceCallsite : NSObject
+
+/** the file of the callsite */
+@property (nonatomic, copy, readonly) NSString *file;
+/** the function of the callsite */
+@property (nonatomic, copy, readonly) NSString *function;
+/** the line of the callsite */
+@property (nonatomic, readonly) NSInteger line;
+
+/** NS_UNAVAILABLE */
+- (instancetype)init NS_UNAVAILABLE;
+/** NS_UNAVAILABLE */
++ (instancetype)new NS_UNAVAILABLE;
+
+@end
+
+/**
+ A workload trace written by `[TLSLoggingService beginWorkloadCaptureToFilePath:error:]`, to replay
+ the logging calls of a real workload against any `TLSLoggingService` setup (see the `replay`
+ benchmark of `TwitterLoggingServiceBenchmarks`).
+
+ A trace cut short (such as by the process being terminated while capturing) is read up to its last
+ complete record.
+ */
+@interface TLSWorkloadTrace : NSObject
+
+/** the captured logging calls, in the order they were made */
+@property (nonatomic, readonly) const TLSWorkloadTraceRecord *records NS_RETURNS_INNER_POINTER;
+/** the number of `records` */
+@property (nonatomic, readonly) NSUInteger recordCount;
+/** the callsites referenced by `records` */
+@property (nonatomic, copy, readonly) NSArray<TLSWorkloadTraceCallsite *> *callsites;
+/** the channels referenced by `records` */
+@property (nonatomic, copy, readonly) NSArray<NSString *> *channels;
+/** the distinct `threadId`s of `records`, in the order of their first record */
+@property (nonatomic, copy, readonly) NSArray<NSNumber *> *threadIds;
+/** the `time` of the last record, in nanoseconds */
+@property (nonatomic, readonly) uint64_t duration;
+
+/**
+ Read a workload trace.
+ @param filePath the path of the trace file
+ @param errorOut an output reference to get any errors that occur while reading.  If there is an error, the return value will be `nil`.
+ */
+- (nullable instancetype)initWithFilePath:(NSString *)filePath
+                                    error:(out NSError * __nullable __autoreleasing * __nullable)errorOut NS_DESIGNATED_INITIALIZER;
+
+/** NS_UNAVAILABLE */
+- (instancetype)init NS_UNAVAILABLE;
+/** NS_UNAVAILABLE */
++ (instancetype)new NS_UNAVAILABLE;
+
+@end
+
+NS_ASSUME_NONNULL_END
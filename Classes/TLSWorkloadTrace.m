@@ -0,0 +1,603 @@
+//
+//  TLSWorkloadTrace.m
+//  TwitterLoggingService
+//
+//  Created on 10/18/26.
+//  Copyright (c) 2026 Twitter, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//          http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <time.h>
+
+#import "TLSWorkloadTraceWriter.h"
+
+static const char kTraceMagic[4] = { 'T', 'L', 'S', 'W' };
+static const uint8_t kTraceRecordTypeChannel = 'H';
+static const uint8_t kTraceRecordTypeCallsite = 'S';
+static const uint8_t kTraceRecordTypeCall = 'L';
+static const size_t kTraceFileBufferSize = 64 * 1024;
+
+TLS_COMPILER_ASSERT(sizeof(TLSWorkloadTraceRecord) == 32, TLSWorkloadTraceRecord_size_is_part_of_the_file_format);
+
+static NSError *_TraceError(int code, NSString *message, NSString *filePath);
+static NSError *_TraceError(int code, NSString *message, NSString *filePath)
+{
+    return [NSError errorWithDomain:NSPOSIXErrorDomain
+                               code:code
+                           userInfo:@{ @"message" : message,
+                                       @"filePath" : filePath ?: [NSNull null] }];
+}
+
+static NSData *_UTF8Data(NSString *string);
+static NSData *_UTF8Data(NSString *string)
+{
+    const char *utf8 = string.UTF8String;
+    if (!utf8) {
+        return [NSData data];
+    }
+    const size_t length = strlen(utf8);
+    return [NSData dataWithBytes:utf8 length:TLSUTF8CodePointBoundary(utf8, MIN(length, (size_t)UINT16_MAX))];
+}
+
+#pragma mark - Callsite
+
+@interface TLSWorkloadTraceCallsite ()
+- (instancetype)initWithFile:(NSString *)file function:(NSString *)function line:(NSInteger)line TLS_OBJC_DIRECT;
+@end
+
+@implementation TLSWorkloadTraceCallsite
+
+- (instancetype)initWithFile:(NSString *)file function:(NSString *)function line:(NSInteger)line
+{
+    if (self = [super init]) {
+        _file = [file copy];
+        _function = [function copy];
+        _line = line;
+    }
+    return self;
+}
+
+- (instancetype)init
+{
+    [self doesNotRecognizeSelector:_cmd];
+    abort();
+}
+
+@end
+
+#pragma mark - Writer
+
+enum {
+    // calls are buffered per thread and written in batches, so capturing a call only takes the thread's own lock
+    kThreadBufferCapacity = 64,
+    // callsites are cached per thread by identity, so capturing a call does not look up (nor allocate) anything
+    kThreadCallsiteCacheSize = 64,
+};
+
+typedef struct {
+    const void *file;       // the `const char *` file or the (retained) `NSString` file, by identity
+    const void *channel;    // the (retained) `NSString` channel, by identity
+    NSInteger line;
+    bool fileIsString;
+    bool hasFunction;
+    uint32_t callsiteIndex;
+    uint32_t channelIndex;
+} TLSWorkloadCallsiteCacheEntry;
+
+typedef struct TLSWorkloadThreadBuffer {
+    const void *writer;                     // the (retained) `TLSWorkloadTraceWriter` the thread captures to
+    struct TLSWorkloadThreadBuffer *next;   // in the list of the writer, guarded by its lock
+    pthread_mutex_t lock;                   // guards the records, only contended while the writer drains them
+    size_t recordCount;
+    TLSWorkloadTraceRecord records[kThreadBufferCapacity];
+    TLSWorkloadCallsiteCacheEntry callsites[kThreadCallsiteCacheSize]; // only accessed by the thread
+} TLSWorkloadThreadBuffer;
+
+static pthread_key_t sThreadBufferKey;
+
+static size_t _CallsiteCacheSlot(const void *file, NSInteger line, const void *channel);
+static size_t _CallsiteCacheSlot(const void *file, NSInteger line, const void *channel)
+{
+    const uintptr_t hash = ((uintptr_t)file >> 4) ^ ((uintptr_t)channel >> 4) ^ ((uintptr_t)line * 0x9E3779B1);
+    return (size_t)((hash ^ (hash >> 16)) & (kThreadCallsiteCacheSize - 1));
+}
+
+static void _CallsiteCacheEntryClear(TLSWorkloadCallsiteCacheEntry *entry);
+static void _CallsiteCacheEntryClear(TLSWorkloadCallsiteCacheEntry *entry)
+{
+    if (entry->fileIsString && entry->file) {
+        CFRelease(entry->file);
+    }
+    if (entry->channel) {
+        CFRelease(entry->channel);
+    }
+    memset(entry, 0, sizeof(*entry));
+}
+
+static void _ThreadBufferDestroy(void *value);
+
+@interface TLSWorkloadTraceWriter ()
+- (uint32_t)_internChannel:(NSString *)channel TLS_OBJC_DIRECT;
+- (uint32_t)_internCallsiteFile:(NSString *)file function:(nullable NSString *)function line:(NSInteger)line TLS_OBJC_DIRECT;
+- (nullable TLSWorkloadThreadBuffer *)_currentThreadBuffer TLS_OBJC_DIRECT;
+- (void)_detachThreadBuffer:(TLSWorkloadThreadBuffer *)buffer TLS_OBJC_DIRECT;
+- (void)_writeRecords:(const TLSWorkloadTraceRecord *)records count:(size_t)count TLS_OBJC_DIRECT;
+- (void)_drainThreadBuffers TLS_OBJC_DIRECT;
+@end
+
+@implementation TLSWorkloadTraceWriter
+{
+    // guards everything below, taken when a thread's buffer is full or a callsite is new to a thread
+    pthread_mutex_t _lock;
+    FILE *_traceFile;
+    NSMutableDictionary<NSString *, NSNumber *> *_channelIndexes;
+    NSMutableDictionary<NSString *, NSNumber *> *_callsiteIndexes;
+    NSMutableIndexSet *_callsitesWithFunction;
+    TLSWorkloadThreadBuffer *_threadBuffers;
+    atomic_bool _closed;
+}
+
+- (instancetype)initWithFilePath:(NSString *)filePath
+                           error:(out NSError **)errorOut
+{
+    if (self = [super init]) {
+        pthread_mutex_init(&_lock, NULL);
+        atomic_init(&_closed, false);
+        _traceFile = fopen(filePath.fileSystemRepresentation, "w");
+        if (!_traceFile) {
+            if (errorOut) {
+                *errorOut = _TraceError(errno, @"unable to create the workload trace file", filePath);
+            }
+            return nil;
+        }
+        setvbuf(_traceFile, NULL, _IOFBF, kTraceFileBufferSize);
+        _channelIndexes = [[NSMutableDictionary alloc] init];
+        _callsiteIndexes = [[NSMutableDictionary alloc] init];
+        _callsitesWithFunction = [[NSMutableIndexSet alloc] init];
+        _startTime = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+
+        const uint32_t version = TLS_WORKLOAD_TRACE_VERSION;
+        fwrite(kTraceMagic, sizeof(kTraceMagic), 1, _traceFile);
+        fwrite(&version, sizeof(version), 1, _traceFile);
+    }
+    return self;
+}
+
+- (instancetype)init
+{
+    [self doesNotRecognizeSelector:_cmd];
+    abort();
+}
+
+- (void)dealloc
+{
+    // every thread buffer retains the writer, they are all detached by now
+    [self close];
+    pthread_mutex_destroy(&_lock);
+}
+
+- (uint32_t)_internChannel:(NSString *)channel
+{
+    NSNumber *channelIndexNumber = _channelIndexes[channel];
+    if (channelIndexNumber) {
+        return channelIndexNumber.unsignedIntValue;
+    }
+
+    const uint32_t channelIndex = (uint32_t)_channelIndexes.count;
+    _channelIndexes[channel] = @(channelIndex);
+
+    NSData *channelData = _UTF8Data(channel);
+    const uint16_t length = (uint16_t)channelData.length;
+    fwrite(&kTraceRecordTypeChannel, sizeof(uint8_t), 1, _traceFile);
+    fwrite(&channelIndex, sizeof(channelIndex), 1, _traceFile);
+    fwrite(&length, sizeof(length), 1, _traceFile);
+    fwrite(channelData.bytes, 1, length, _traceFile);
+
+    return channelIndex;
+}
+
+- (uint32_t)_internCallsiteFile:(NSString *)file function:(nullable NSString *)function line:(NSInteger)line
+{
+    NSString *key = [NSString stringWithFormat:@"%@:%ld", file, (long)line];
+    NSNumber *callsiteIndexNumber = _callsiteIndexes[key];
+    uint32_t callsiteIndex;
+    if (callsiteIndexNumber) {
+        callsiteIndex = callsiteIndexNumber.unsignedIntValue;
+        if (!function || [_callsitesWithFunction containsIndex:callsiteIndex]) {
+            return callsiteIndex;
+        }
+        // first captured filtered, define it again now that the function is known
+    } else {
+        callsiteIndex = (uint32_t)_callsiteIndexes.count;
+        _callsiteIndexes[key] = @(callsiteIndex);
+    }
+    if (function) {
+        [_callsitesWithFunction addIndex:callsiteIndex];
+    }
+
+    NSData *fileData = _UTF8Data(file);
+    NSData *functionData = _UTF8Data(function);
+    const int32_t line32 = (int32_t)line;
+    const uint16_t fileLength = (uint16_t)fileData.length;
+    const uint16_t functionLength = (uint16_t)functionData.length;
+    fwrite(&kTraceRecordTypeCallsite, sizeof(uint8_t), 1, _traceFile);
+    fwrite(&callsiteIndex, sizeof(callsiteIndex), 1, _traceFile);
+    fwrite(&line32, sizeof(line32), 1, _traceFile);
+    fwrite(&fileLength, sizeof(fileLength), 1, _traceFile);
+    fwrite(&functionLength, sizeof(functionLength), 1, _traceFile);
+    fwrite(fileData.bytes, 1, fileLength, _traceFile);
+    fwrite(functionData.bytes, 1, functionLength, _traceFile);
+
+    return callsiteIndex;
+}
+
+- (nullable TLSWorkloadThreadBuffer *)_currentThreadBuffer
+{
+    static dispatch_once_t sOnceToken;
+    dispatch_once(&sOnceToken, ^{
+        pthread_key_create(&sThreadBufferKey, _ThreadBufferDestroy);
+    });
+
+    TLSWorkloadThreadBuffer *buffer = pthread_getspecific(sThreadBufferKey);
+    if (buffer && buffer->writer == (__bridge const void *)self) {
+        return buffer;
+    }
+    if (buffer) {
+        // the thread last captured to a previous writer
+        pthread_setspecific(sThreadBufferKey, NULL);
+        _ThreadBufferDestroy(buffer);
+    }
+
+    buffer = calloc(1, sizeof(TLSWorkloadThreadBuffer));
+    if (!buffer) {
+        return NULL;
+    }
+    pthread_mutex_init(&buffer->lock, NULL);
+    buffer->writer = CFBridgingRetain(self);
+    pthread_mutex_lock(&_lock);
+    buffer->next = _threadBuffers;
+    _threadBuffers = buffer;
+    pthread_mutex_unlock(&_lock);
+    pthread_setspecific(sThreadBufferKey, buffer);
+    return buffer;
+}
+
+- (void)_detachThreadBuffer:(TLSWorkloadThreadBuffer *)buffer
+{
+    pthread_mutex_lock(&_lock);
+    pthread_mutex_lock(&buffer->lock);
+    [self _writeRecords:buffer->records count:buffer->recordCount];
+    pthread_mutex_unlock(&buffer->lock);
+    for (TLSWorkloadThreadBuffer **link = &_threadBuffers; *link; link = &(*link)->next) {
+        if (*link == buffer) {
+            *link = buffer->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&_lock);
+
+    for (size_t i = 0; i < kThreadCallsiteCacheSize; i++) {
+        _CallsiteCacheEntryClear(&buffer->callsites[i]);
+    }
+    pthread_mutex_destroy(&buffer->lock);
+    free(buffer);
+}
+
+- (void)_writeRecords:(const TLSWorkloadTraceRecord *)records count:(size_t)count
+{
+    if (!_traceFile) {
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        fwrite(&kTraceRecordTypeCall, sizeof(uint8_t), 1, _traceFile);
+        fwrite(&records[i], sizeof(TLSWorkloadTraceRecord), 1, _traceFile);
+    }
+}
+
+- (void)_drainThreadBuffers
+{
+    for (TLSWorkloadThreadBuffer *buffer = _threadBuffers; buffer; buffer = buffer->next) {
+        pthread_mutex_lock(&buffer->lock);
+        [self _writeRecords:buffer->records count:buffer->recordCount];
+        buffer->recordCount = 0;
+        pthread_mutex_unlock(&buffer->lock);
+    }
+}
+
+- (void)addCallAtTime:(uint64_t)time
+             threadId:(uint32_t)threadId
+                level:(TLSLogLevel)level
+              channel:(NSString *)channel
+                 file:(const char *)file
+           fileString:(NSString *)fileString
+             function:(NSString *)function
+                 line:(NSInteger)line
+        messageLength:(NSUInteger)messageLength
+             filtered:(BOOL)filtered
+{
+    if (atomic_load_explicit(&_closed, memory_order_relaxed)) {
+        return;
+    }
+    TLSWorkloadThreadBuffer *buffer = [self _currentThreadBuffer];
+    if (!buffer) {
+        return;
+    }
+
+    NSString *channelKey = channel ?: @"";
+    const void *fileKey = (file) ? (const void *)file : (__bridge const void *)fileString;
+    TLSWorkloadCallsiteCacheEntry *entry = &buffer->callsites[_CallsiteCacheSlot(fileKey, line, (__bridge const void *)channelKey)];
+    if (entry->file != fileKey ||
+        entry->line != line ||
+        entry->channel != (__bridge const void *)channelKey ||
+        (function && !entry->hasFunction)) {
+
+        // new to the thread (or its function is now known), intern it
+        uint32_t callsiteIndex = 0;
+        uint32_t channelIndex = 0;
+        @autoreleasepool {
+            pthread_mutex_lock(&_lock);
+            const BOOL open = (_traceFile != NULL);
+            if (open) {
+                channelIndex = [self _internChannel:channelKey];
+                callsiteIndex = [self _internCallsiteFile:((file) ? @(file) : fileString) ?: @""
+                                                 function:function
+                                                     line:line];
+            }
+            pthread_mutex_unlock(&_lock);
+            if (!open) {
+                return;
+            }
+        }
+
+        // retain the strings so that their addresses identify them for as long as they are cached
+        _CallsiteCacheEntryClear(entry);
+        entry->fileIsString = (NULL == file);
+        entry->file = (file) ? (const void *)file : CFBridgingRetain(fileString);
+        entry->channel = CFBridgingRetain(channelKey);
+        entry->line = line;
+        entry->hasFunction = (function != nil);
+        entry->callsiteIndex = callsiteIndex;
+        entry->channelIndex = channelIndex;
+    }
+
+    TLSWorkloadTraceRecord record = { 0 };
+    record.time = (time > _startTime) ? time - _startTime : 0;
+    record.threadId = threadId;
+    record.channelIndex = entry->channelIndex;
+    record.callsiteIndex = entry->callsiteIndex;
+    record.messageLength = (uint32_t)MIN(messageLength, (NSUInteger)UINT32_MAX);
+    record.level = (uint8_t)level;
+    record.filtered = (filtered) ? 1 : 0;
+
+    // write a full buffer after letting go of it (the writer's lock is taken before the buffer's when draining)
+    TLSWorkloadTraceRecord fullRecords[kThreadBufferCapacity];
+    size_t fullRecordCount = 0;
+    pthread_mutex_lock(&buffer->lock);
+    buffer->records[buffer->recordCount++] = record;
+    if (kThreadBufferCapacity == buffer->recordCount) {
+        memcpy(fullRecords, buffer->records, sizeof(fullRecords));
+        fullRecordCount = buffer->recordCount;
+        buffer->recordCount = 0;
+    }
+    pthread_mutex_unlock(&buffer->lock);
+
+    if (fullRecordCount > 0) {
+        pthread_mutex_lock(&_lock);
+        [self _writeRecords:fullRecords count:fullRecordCount];
+        pthread_mutex_unlock(&_lock);
+    }
+}
+
+- (void)flush
+{
+    pthread_mutex_lock(&_lock);
+    if (_traceFile) {
+        [self _drainThreadBuffers];
+        fflush(_traceFile);
+    }
+    pthread_mutex_unlock(&_lock);
+}
+
+- (void)close
+{
+    pthread_mutex_lock(&_lock);
+    if (_traceFile) {
+        atomic_store_explicit(&_closed, true, memory_order_relaxed);
+        [self _drainThreadBuffers];
+        fflush(_traceFile);
+        fclose(_traceFile);
+        _traceFile = NULL;
+        // threads hold on to the writer until they capture to another one (or exit), only keep what they use
+        _channelIndexes = nil;
+        _callsiteIndexes = nil;
+        _callsitesWithFunction = nil;
+    }
+    pthread_mutex_unlock(&_lock);
+}
+
+@end
+
+static void _ThreadBufferDestroy(void *value);
+static void _ThreadBufferDestroy(void *value)
+{
+    TLSWorkloadThreadBuffer *buffer = value;
+    TLSWorkloadTraceWriter *writer = CFBridgingRelease(buffer->writer);
+    [writer _detachThreadBuffer:buffer];
+}
+
+#pragma mark - Reader
+
+static int _RecordTimeCompare(const void *record1, const void *record2);
+static int _RecordTimeCompare(const void *record1, const void *record2)
+{
+    const uint64_t time1 = ((const TLSWorkloadTraceRecord *)record1)->time;
+    const uint64_t time2 = ((const TLSWorkloadTraceRecord *)record2)->time;
+    return (time1 < time2) ? -1 : ((time1 > time2) ? 1 : 0);
+}
+
+@implementation TLSWorkloadTrace
+{
+    NSMutableData *_recordsData;
+}
+
+- (instancetype)initWithFilePath:(NSString *)filePath
+                           error:(out NSError **)errorOut // NS_DESIGNATED_INITIALIZER
+{
+    NSError *error = nil;
+    NSData *traceData = [NSData dataWithContentsOfFile:filePath options:NSDataReadingMappedIfSafe error:&error];
+    if (!traceData) {
+        if (errorOut) {
+            *errorOut = error;
+        }
+        return nil;
+    }
+
+    const uint8_t *bytes = traceData.bytes;
+    const size_t size = traceData.length;
+    uint32_t version = 0;
+    if (size >= 8) {
+        memcpy(&version, bytes + 4, sizeof(version));
+    }
+    if (size < 8 || 0 != memcmp(bytes, kTraceMagic, sizeof(kTraceMagic)) || version != TLS_WORKLOAD_TRACE_VERSION) {
+        if (errorOut) {
+            *errorOut = _TraceError(EFTYPE, @"not a workload trace file", filePath);
+        }
+        return nil;
+    }
+
+    if (self = [super init]) {
+        _recordsData = [[NSMutableData alloc] init];
+        NSMutableArray<NSString *> *channels = [[NSMutableArray alloc] init];
+        NSMutableArray<TLSWorkloadTraceCallsite *> *callsites = [[NSMutableArray alloc] init];
+        NSMutableArray<NSNumber *> *threadIds = [[NSMutableArray alloc] init];
+        NSMutableSet<NSNumber *> *seenThreadIds = [[NSMutableSet alloc] init];
+        BOOL malformed = NO;
+
+        size_t position = 8;
+        while (position < size && !malformed) {
+            const uint8_t type = bytes[position++];
+            if (kTraceRecordTypeCall == type) {
+                TLSWorkloadTraceRecord record;
+                if (position + sizeof(record) > size) {
+                    break; // cut short
+                }
+                memcpy(&record, bytes + position, sizeof(record));
+                position += sizeof(record);
+                if (record.channelIndex >= channels.count || record.callsiteIndex >= callsites.count) {
+                    malformed = YES;
+                    break;
+                }
+                [_recordsData appendBytes:&record length:sizeof(record)];
+                _duration = MAX(_duration, record.time);
+            } else if (kTraceRecordTypeChannel == type) {
+                uint32_t channelIndex;
+                uint16_t length;
+                if (position + sizeof(channelIndex) + sizeof(length) > size) {
+                    break;
+                }
+                memcpy(&channelIndex, bytes + position, sizeof(channelIndex));
+                memcpy(&length, bytes + position + sizeof(channelIndex), sizeof(length));
+                position += sizeof(channelIndex) + sizeof(length);
+                if (position + length > size) {
+                    break;
+                }
+                if (channelIndex != channels.count) {
+                    malformed = YES;
+                    break;
+                }
+                [channels addObject:[[NSString alloc] initWithBytes:bytes + position length:length encoding:NSUTF8StringEncoding] ?: @""];
+                position += length;
+            } else if (kTraceRecordTypeCallsite == type) {
+                uint32_t callsiteIndex;
+                int32_t line;
+                uint16_t fileLength, functionLength;
+                if (position + 12 > size) {
+                    break;
+                }
+                memcpy(&callsiteIndex, bytes + position, sizeof(callsiteIndex));
+                memcpy(&line, bytes + position + 4, sizeof(line));
+                memcpy(&fileLength, bytes + position + 8, sizeof(fileLength));
+                memcpy(&functionLength, bytes + position + 10, sizeof(functionLength));
+                position += 12;
+                if (position + fileLength + functionLength > size) {
+                    break;
+                }
+                if (callsiteIndex > callsites.count) {
+                    malformed = YES;
+                    break;
+                }
+                NSString *file = [[NSString alloc] initWithBytes:bytes + position length:fileLength encoding:NSUTF8StringEncoding];
+                NSString *function = [[NSString alloc] initWithBytes:bytes + position + fileLength length:functionLength encoding:NSUTF8StringEncoding];
+                position += fileLength + functionLength;
+                TLSWorkloadTraceCallsite *callsite = [[TLSWorkloadTraceCallsite alloc] initWithFile:file ?: @""
+                                                                                          function:function ?: @""
+                                                                                              line:line];
+                if (callsiteIndex == callsites.count) {
+                    [callsites addObject:callsite];
+                } else {
+                    callsites[callsiteIndex] = callsite;
+                }
+            } else {
+                malformed = YES;
+            }
+        }
+
+        if (malformed) {
+            if (errorOut) {
+                *errorOut = _TraceError(EFTYPE, @"malformed workload trace file", filePath);
+            }
+            return nil;
+        }
+
+        // written in batches per thread, put them back in the order they were made (stable, for calls made at the same time)
+        TLSWorkloadTraceRecord *records = _recordsData.mutableBytes;
+        const NSUInteger recordCount = _recordsData.length / sizeof(TLSWorkloadTraceRecord);
+        if (recordCount > 1) {
+            mergesort(records, recordCount, sizeof(TLSWorkloadTraceRecord), _RecordTimeCompare);
+        }
+        for (NSUInteger i = 0; i < recordCount; i++) {
+            NSNumber *threadId = @(records[i].threadId);
+            if (![seenThreadIds containsObject:threadId]) {
+                [seenThreadIds addObject:threadId];
+                [threadIds addObject:threadId];
+            }
+        }
+
+        _channels = [channels copy];
+        _callsites = [callsites copy];
+        _threadIds = [threadIds copy];
+    }
+    return self;
+}
+
+- (instancetype)init
+{
+    [self doesNotRecognizeSelector:_cmd];
+    abort();
+}
+
+- (const TLSWorkloadTraceRecord *)records
+{
+    return _recordsData.bytes;
+}
+
+- (NSUInteger)recordCount
+{
+    return _recordsData.length / sizeof(TLSWorkloadTraceRecord);
+}
+
+@end
@@ -0,0 +1,94 @@
+//
+//  TLSWorkloadTraceWriter.h
+//  TwitterLoggingService
+//
+//  Created on 10/18/26.
+//  Copyright (c) 2026 Twitter, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//          http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+/* This header is private to Twitter Logging Service */
+
+#import "TLS_Project.h"
+#import "TLSWorkloadTrace.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*
+ Workload trace file format (native byte order)
+
+    header:  "TLSW" (4 bytes), uint32_t version
+
+    records: uint8_t type, followed by the type's payload
+
+        'H' (channel):   uint32_t channelIndex, uint16_t length, char[length] (UTF-8 channel name)
+        'S' (callsite):  uint32_t callsiteIndex, int32_t line, uint16_t fileLength, uint16_t functionLength,
+                         char[fileLength], char[functionLength] (UTF-8)
+        'L' (call):      TLSWorkloadTraceRecord
+
+ Channels and callsites are interned and written the first time they are encountered, always
+ before the first call that references them.  A callsite first captured without a function is
+ written again (with the same index) once its function is known.
+
+ Calls are buffered per thread and written in batches: they are in the order they were made per
+ thread, not across threads (the reader sorts them by time).
+ */
+
+#define TLS_WORKLOAD_TRACE_VERSION (1)
+
+/**
+ Writes a workload trace, owned by the `TLSLoggingService`.
+
+ Thread safe: a call is captured into a buffer of the calling thread, with its callsite and channel
+ cached per thread by identity, so the writer's lock is only taken when the buffer is full or the
+ callsite is new to the thread.  A thread's buffer holds on to the writer until the thread
+ captures to another writer or exits.
+ */
+TLS_OBJC_FINAL
+@interface TLSWorkloadTraceWriter : NSObject
+
+/** the `CLOCK_UPTIME_RAW` time (in nanoseconds) the capture began, record times are relative to it */
+@property (nonatomic, readonly) uint64_t startTime;
+
+- (nullable instancetype)initWithFilePath:(NSString *)filePath
+                                    error:(out NSError * __nullable __autoreleasing * __nullable)errorOut;
+
+/**
+ Add a call
+ @param time the `CLOCK_UPTIME_RAW` time (in nanoseconds) of the call
+ @param file the file of the callsite as a C string (for calls filtered by the `TLSLog` macros), or `NULL` to use _fileString_
+ @param fileString the file of the callsite, used when _file_ is `NULL`
+ @param function the function of the callsite, `nil` if not known
+ @param messageLength the length of the formatted message in UTF-8 bytes
+ */
+- (void)addCallAtTime:(uint64_t)time
+             threadId:(uint32_t)threadId
+                level:(TLSLogLevel)level
+              channel:(NSString *)channel
+                 file:(nullable const char *)file
+           fileString:(nullable NSString *)fileString
+             function:(nullable NSString *)function
+                 line:(NSInteger)line
+        messageLength:(NSUInteger)messageLength
+             filtered:(BOOL)filtered;
+
+- (void)flush;
+- (void)close;
+
+- (instancetype)init NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+@end
+
+NS_ASSUME_NONNULL_END
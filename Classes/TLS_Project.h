@@ -42,6 +42,18 @@
 //! Best effort attempt to get the binary name of the current process
 FOUNDATION_EXTERN NSString *TLSGetProcessBinaryName(void);
 
+struct iovec;
+//! `writev` all of _iov_ (which is modified), retrying partial and interrupted writes.  Returns `0` or the `errno` of the failure.
+FOUNDATION_EXTERN int TLSWriteVectorFully(int fileDescriptor, struct iovec *iov, int iovcnt);
+
+//! The length of the UTF-8 _bytes_ without a trailing partial code point
+FOUNDATION_EXTERN size_t TLSUTF8CodePointBoundary(const char *bytes, size_t length);
+
+//! The bytes written to the _file_ that are still in its stdio buffer (`0` when unknown for the C library).  Async-signal-safe, but racy against a concurrent writer.
+FOUNDATION_EXTERN size_t TLSStdioUnflushedBytes(FILE *file, const char **bytesOut);
+//! Mark the bytes of `TLSStdioUnflushedBytes` as written, once written by other means, so that the next flush does not write them again.  Async-signal-safe, but racy against a concurrent writer.
+FOUNDATION_EXTERN void TLSStdioDiscardUnflushedBytes(FILE *file);
+
 /** Does the `mask` have at least 1 of the bits in `flags` set */
 #define TLS_BITMASK_INTERSECTS_FLAGS(mask, flags)   (((mask) & (flags)) != 0)
 /** Does the `mask` have all of the bits in `flags` set */
@@ -85,3 +97,57 @@ FOUNDATION_EXTERN NSString *TLSGetProcessBinaryName(void);
 # define TLS_OBJC_FINAL
 #endif // #if TLS_SUPPORTS_OBJC_FINAL
 
+#pragma mark - Project only methods
+
+#import <TwitterLoggingService/TLSDeclarations.h>
+
+@interface TLSLogMessageInfo (Project)
+/** Take ownership of the `malloc`ed _fields_, which are freed with the `TLSLogMessageInfo`.  Only call before the info is shared. */
+- (void)tls_adoptFields:(TLSLogField *)fields count:(NSUInteger)count;
+/** Set the `sequenceNumber`.  Only call before the info is shared. */
+- (void)tls_setSequenceNumber:(uint64_t)sequenceNumber;
+/** Set the `processIdentifier`.  Only call before the info is shared. */
+- (void)tls_setProcessIdentifier:(pid_t)processIdentifier;
+/** Set (or drop, with `nil`) the whole `payload` (retained, not copied, when immutable) and its `maximumPayloadRenderedLength`.  Only call before the info is shared. */
+- (void)tls_setPayload:(nullable NSData *)payload maximumRenderedLength:(NSUInteger)maximumRenderedLength;
+/** A copy with a different _message_, such as a redacted one (the cached compositions are not copied) */
+- (TLSLogMessageInfo *)tls_infoWithMessage:(NSString *)message;
+/** A copy with a different _message_ and _contextObject_, such as its snapshot (the cached compositions are not copied) */
+- (TLSLogMessageInfo *)tls_infoWithMessage:(NSString *)message contextObject:(nullable id)contextObject;
+/**
+ A copy to keep around for a while: no context object, no cached compositions and at most
+ _maximumPayloadLength_ bytes of the payload (composing it still reports the full payload length)
+ */
+- (TLSLogMessageInfo *)tls_compactInfoWithMaximumPayloadLength:(NSUInteger)maximumPayloadLength;
+@end
+
+@class TLSFileOutputStream;
+
+/** Write the buffered output of the _stream_ to its file descriptor, see `TLSEmergencyLogDumpUnflushedOutput`.  Async-signal-safe. */
+FOUNDATION_EXTERN int TLSFileOutputStreamWriteUnflushedBytes(TLSFileOutputStream * __unsafe_unretained stream, size_t *lengthOut);
+/** Flush and close the log file of the _stream_ (to bound the number of open files), writes are dropped until it is reopened */
+FOUNDATION_EXTERN void TLSFileOutputStreamCloseLogFile(TLSFileOutputStream *stream);
+/** Reopen the log file closed by `TLSFileOutputStreamCloseLogFile` for appending, `bytesWritten` carries on from where it was */
+FOUNDATION_EXTERN BOOL TLSFileOutputStreamReopenLogFile(TLSFileOutputStream *stream, NSError * __nullable __autoreleasing * __nullable errorOut);
+
+@class TLSLogContextSnapshotLedger;
+
+@interface TLSLogContextSnapshot (Project)
+/**
+ Account for the `byteCost` of the snapshot in the _ledger_ until it is deallocated.
+ A snapshot is accounted for once, by the first ledger, and is `YES` after that.
+ @return `NO` if the snapshot would exceed the _budget_ of the _ledger_ (`0` for no budget)
+ */
+- (BOOL)tls_accountInLedger:(TLSLogContextSnapshotLedger *)ledger budget:(NSUInteger)budget;
+@end
+
+#import <TwitterLoggingService/TLSLogRedactor.h>
+
+@interface TLSLogRedactor (Project)
+/**
+ The copy of the _info_ to give a redacted output stream: the `message` and the `TLSLogFieldTypeString` field values
+ are redacted and the payload is dropped (it is binary, there is nothing to match in it).
+ @return the copy, `nil` when there is nothing to redact and no payload (output the _info_ itself)
+ */
+- (nullable TLSLogMessageInfo *)tls_redactedInfo:(TLSLogMessageInfo *)info;
+@end
@@ -28,9 +28,22 @@
 #import <TwitterLoggingService/TLSConsoleOutputStreams.h>
 #import <TwitterLoggingService/TLSCrashlyticsOutputStream.h>
 #import <TwitterLoggingService/TLSDeclarations.h>
+#import <TwitterLoggingService/TLSEmergencyLog.h>
 #import <TwitterLoggingService/TLSFileOutputStream+Protected.h>
 #import <TwitterLoggingService/TLSFileOutputStream.h>
+#import <TwitterLoggingService/TLSFlightRecorderOutputStream.h>
+#import <TwitterLoggingService/TLSJSONLinesOutputStreams.h>
+#import <TwitterLoggingService/TLSLogIngestionRecord.h>
+#import <TwitterLoggingService/TLSLogIngestionSource.h>
+#import <TwitterLoggingService/TLSLogRedactor.h>
+#import <TwitterLoggingService/TLSLogShipper.h>
+#import <TwitterLoggingService/TLSLogThrottle.h>
+#import <TwitterLoggingService/TLSLoggingMetrics.h>
 #import <TwitterLoggingService/TLSLoggingService+Advanced.h>
 #import <TwitterLoggingService/TLSLoggingService.h>
+#import <TwitterLoggingService/TLSPartitionedRollingFileOutputStream.h>
 #import <TwitterLoggingService/TLSProtocols.h>
+#import <TwitterLoggingService/TLSRollingFileIndex.h>
 #import <TwitterLoggingService/TLSRollingFileOutputStream.h>
+#import <TwitterLoggingService/TLSSharedMemoryLogRing.h>
+#import <TwitterLoggingService/TLSWorkloadTrace.h>
@@ -0,0 +1,742 @@
+//
+//  main.m
+//  TwitterLoggingServiceBenchmarks
+//
+//  Created on 10/18/26.
+//  Copyright (c) 2026 Twitter, Inc.
+//
+
+#include <fcntl.h>
+#include <mach/mach.h>
+#include <mach/mach_time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/sysctl.h>
+#include <unistd.h>
+
+#import <TwitterLoggingService/TwitterLoggingService.h>
+
+/*
+ Benchmarks for the logging pipeline, results are written as JSON for tracking across releases.
+
+    TwitterLoggingServiceBenchmarks [--iterations N] [--benchmark NAME]... [--output PATH]
+                                    [--trace PATH [--streams NAME[,NAME]...] [--speed X]]
+
+ Benchmarks (all run by default):
+
+    canlog      `TLSCanLog` ns/call, filtered and unfiltered, with 1 to 64 threads
+    enqueue     caller side latency percentiles of `TLSLogEx`, with 1 and 8 threads
+    streams     end to end throughput of each built-in output stream (log and `flush`)
+    compose     `composeFormattedMessageWithOptions:` ns/call per option set
+    rollover    `TLSRollingFileOutputStream` write latency percentiles, with and without a rollover (and prune)
+    replay      replays a workload trace (`--trace`, see `[TLSLoggingService beginWorkloadCaptureToFilePath:error:]`)
+                with its timing and threads against the `--streams` (the stream names of `streams`, default
+                `TLSBenchmarkStream`), sped up by `--speed` (default 1, 0 for no waiting): caller latency
+                percentiles, throughput and the memory footprint high-water mark.  Only run with a `--trace`.
+
+ Run a Release build, progress goes to stderr and the results to stdout (or `--output`).
+ */
+
+static NSString * const kChannel = @"Benchmark";
+static NSString * const kFile = @"main.m";
+static NSString * const kFunction = @"Benchmark()";
+
+static NSMutableArray<NSDictionary *> *sResults;
+
+#pragma mark - Helpers
+
+static uint64_t _NowNanoseconds(void)
+{
+    static mach_timebase_info_data_t sTimebase;
+    static dispatch_once_t sOnceToken;
+    dispatch_once(&sOnceToken, ^{
+        mach_timebase_info(&sTimebase);
+    });
+    return mach_absolute_time() * sTimebase.numer / sTimebase.denom;
+}
+
+static int _CompareSamples(const void *lhs, const void *rhs)
+{
+    const uint64_t a = *(const uint64_t *)lhs;
+    const uint64_t b = *(const uint64_t *)rhs;
+    return (a < b) ? -1 : (a > b) ? 1 : 0;
+}
+
+//! sorts the _samples_ (nanoseconds)
+static NSDictionary<NSString *, NSNumber *> *_Percentiles(uint64_t *samples, size_t count)
+{
+    if (0 == count) {
+        return @{ @"count" : @0 };
+    }
+
+    qsort(samples, count, sizeof(uint64_t), _CompareSamples);
+    uint64_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        total += samples[i];
+    }
+    uint64_t (^percentile)(double) = ^uint64_t(double p) {
+        return samples[MIN((size_t)(p * (double)count), count - 1)];
+    };
+    return @{ @"count" : @(count),
+              @"meanNs" : @((double)total / (double)count),
+              @"p50Ns" : @(percentile(0.50)),
+              @"p90Ns" : @(percentile(0.90)),
+              @"p99Ns" : @(percentile(0.99)),
+              @"p999Ns" : @(percentile(0.999)),
+              @"maxNs" : @(samples[count - 1]) };
+}
+
+static void _AddResult(NSString *benchmark, NSDictionary *parameters, NSDictionary *metrics)
+{
+    [sResults addObject:@{ @"benchmark" : benchmark,
+                           @"parameters" : parameters,
+                           @"metrics" : metrics }];
+    fprintf(stderr, "%s %s\n", benchmark.UTF8String, parameters.description.UTF8String);
+}
+
+static NSString *_TemporaryDirectory(NSString *name)
+{
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:[NSString stringWithFormat:@"TLSBenchmarks-%d/%@", getpid(), name]];
+    [[NSFileManager defaultManager] removeItemAtPath:path error:NULL];
+    [[NSFileManager defaultManager] createDirectoryAtPath:path withIntermediateDirectories:YES attributes:nil error:NULL];
+    return path;
+}
+
+static NSArray<TLSLogMessageInfo *> *_MessageInfos(NSUInteger count)
+{
+    NSDate *timestamp = [NSDate date];
+    NSMutableArray<TLSLogMessageInfo *> *infos = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger i = 0; i < count; i++) {
+        [infos addObject:[[TLSLogMessageInfo alloc] initWithLevel:(i % 4 == 0) ? TLSLogLevelWarning : TLSLogLevelInformation
+                                                             file:kFile
+                                                         function:kFunction
+                                                             line:(NSInteger)__LINE__
+                                                          channel:kChannel
+                                                        timestamp:timestamp
+                                                      logLifespan:1.0
+                                                         threadId:pthread_mach_thread_np(pthread_self())
+                                                       threadName:@"benchmark"
+                                                    contextObject:nil
+                                                          message:[NSString stringWithFormat:@"message %tu with a typical amount of text: user=%d state=%@", i, 12345, @"active"]]];
+    }
+    return infos;
+}
+
+#pragma mark - Benchmark Stream
+
+//! counts what it outputs, filters `TLSLogLevelDebug`
+@interface TLSBenchmarkStream : NSObject <TLSOutputStream>
+@property (atomic, readonly) uint64_t outputCount;
+@end
+
+@implementation TLSBenchmarkStream
+{
+    atomic_ullong _outputCount;
+}
+
+- (uint64_t)outputCount
+{
+    return atomic_load(&_outputCount);
+}
+
+- (TLSFilterStatus)tls_shouldFilterLevel:(TLSLogLevel)level
+                                 channel:(NSString *)channel
+                           contextObject:(id)contextObject
+{
+    return (TLSLogLevelDebug == level) ? TLSFilterStatusCannotLogLevel : TLSFilterStatusOK;
+}
+
+- (void)tls_outputLogInfo:(TLSLogMessageInfo *)logInfo
+{
+    atomic_fetch_add(&_outputCount, 1);
+}
+
+@end
+
+#pragma mark - canlog
+
+typedef struct {
+    __unsafe_unretained TLSLoggingService *service;
+    TLSLogLevel level;
+    NSUInteger iterations;
+    atomic_bool *start;
+    uint64_t elapsedNs;
+    NSUInteger permitted;
+} TLSCanLogThreadContext;
+
+static void *_CanLogThreadMain(void *arg)
+{
+    TLSCanLogThreadContext *context = arg;
+    while (!atomic_load(context->start)) {
+        // spin so every thread starts together
+    }
+
+    NSUInteger permitted = 0;
+    const uint64_t start = _NowNanoseconds();
+    for (NSUInteger i = 0; i < context->iterations; i++) {
+        permitted += TLSCanLog(context->service, context->level, kChannel, nil) ? 1 : 0;
+    }
+    context->elapsedNs = _NowNanoseconds() - start;
+    context->permitted = permitted;
+    return NULL;
+}
+
+static void _BenchmarkCanLog(NSUInteger iterations)
+{
+    TLSLoggingService *service = [[TLSLoggingService alloc] init];
+    [service addOutputStream:[[TLSBenchmarkStream alloc] init]];
+    [service flush];
+
+    for (NSNumber *filtered in @[ @YES, @NO ]) {
+        for (NSUInteger threadCount = 1; threadCount <= 64; threadCount *= 2) {
+            TLSCanLogThreadContext contexts[64];
+            pthread_t threads[64];
+            atomic_bool start = false;
+            for (NSUInteger i = 0; i < threadCount; i++) {
+                contexts[i] = (TLSCanLogThreadContext){ .service = service,
+                                                        .level = filtered.boolValue ? TLSLogLevelDebug : TLSLogLevelError,
+                                                        .iterations = iterations,
+                                                        .start = &start };
+                pthread_create(&threads[i], NULL, _CanLogThreadMain, &contexts[i]);
+            }
+
+            const uint64_t wallStart = _NowNanoseconds();
+            atomic_store(&start, true);
+            uint64_t threadNs = 0;
+            for (NSUInteger i = 0; i < threadCount; i++) {
+                pthread_join(threads[i], NULL);
+                threadNs += contexts[i].elapsedNs;
+            }
+            const uint64_t wallNs = _NowNanoseconds() - wallStart;
+
+            const double calls = (double)(iterations * threadCount);
+            _AddResult(@"canlog",
+                       @{ @"filtered" : filtered, @"threads" : @(threadCount), @"iterations" : @(iterations) },
+                       @{ @"nsPerCall" : @((double)threadNs / calls),
+                          @"callsPerSecond" : @(calls / ((double)wallNs / NSEC_PER_SEC)),
+                          @"permitted" : @(contexts[0].permitted) });
+        }
+    }
+}
+
+#pragma mark - enqueue
+
+static void _BenchmarkEnqueue(NSUInteger iterations)
+{
+    for (NSUInteger threadCount = 1; threadCount <= 8; threadCount *= 8) {
+        TLSLoggingService *service = [[TLSLoggingService alloc] init];
+        TLSBenchmarkStream *stream = [[TLSBenchmarkStream alloc] init];
+        [service addOutputStream:stream];
+        [service flush];
+
+        const NSUInteger perThread = iterations / threadCount;
+        uint64_t *samples = calloc(perThread * threadCount, sizeof(uint64_t));
+        const uint64_t wallStart = _NowNanoseconds();
+        dispatch_apply(threadCount, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t t) {
+            uint64_t *threadSamples = samples + (t * perThread);
+            for (NSUInteger i = 0; i < perThread; i++) {
+                @autoreleasepool {
+                    const uint64_t start = _NowNanoseconds();
+                    TLSLogEx(service, TLSLogLevelInformation, kChannel, kFile, kFunction, __LINE__, nil, 0, @"message %tu with a typical amount of text: user=%d state=%@", i, 12345, @"active");
+                    threadSamples[i] = _NowNanoseconds() - start;
+                }
+            }
+        });
+        const uint64_t enqueuedNs = _NowNanoseconds() - wallStart;
+        [service flush];
+        const uint64_t drainedNs = _NowNanoseconds() - wallStart;
+
+        NSMutableDictionary *metrics = [_Percentiles(samples, perThread * threadCount) mutableCopy];
+        metrics[@"enqueuedPerSecond"] = @((double)(perThread * threadCount) / ((double)enqueuedNs / NSEC_PER_SEC));
+        metrics[@"drainedPerSecond"] = @((double)stream.outputCount / ((double)drainedNs / NSEC_PER_SEC));
+        _AddResult(@"enqueue", @{ @"threads" : @(threadCount), @"iterations" : @(perThread * threadCount) }, metrics);
+        free(samples);
+    }
+}
+
+#pragma mark - streams
+
+static NSDictionary<NSString *, id<TLSOutputStream> (^)(void)> *_StreamFactories(NSString *directory)
+{
+    return @{
+        @"TLSStdErrOutputStream" : ^id<TLSOutputStream>(void) {
+            return [[TLSStdErrOutputStream alloc] init];
+        },
+        @"TLSNSLogOutputStream" : ^id<TLSOutputStream>(void) {
+            return [[TLSNSLogOutputStream alloc] init];
+        },
+        @"TLSOSLogOutputStream" : ^id<TLSOutputStream>(void) {
+            return [TLSOSLogOutputStream supported] ? [[TLSOSLogOutputStream alloc] init] : nil;
+        },
+        @"TLSFileOutputStream" : ^id<TLSOutputStream>(void) {
+            return [[TLSFileOutputStream alloc] initWithLogFileDirectoryPath:directory logFileName:@"file.log" error:NULL];
+        },
+        @"TLSFileOutputStream (asynchronous writes)" : ^id<TLSOutputStream>(void) {
+            TLSFileOutputStream *stream = [[TLSFileOutputStream alloc] initWithLogFileDirectoryPath:directory logFileName:@"async.log" error:NULL];
+            stream.asynchronousWriteBufferSize = 64 * 1024;
+            return stream;
+        },
+        @"TLSRollingFileOutputStream" : ^id<TLSOutputStream>(void) {
+            return [[TLSRollingFileOutputStream alloc] initWithLogFileDirectoryPath:directory logFilePrefix:@"rolling." maxLogFiles:10 maxBytesPerLogFile:(1024 * 1024) error:NULL];
+        },
+        @"TLSJSONLinesFileOutputStream" : ^id<TLSOutputStream>(void) {
+            return [[TLSJSONLinesFileOutputStream alloc] initWithLogFileDirectoryPath:directory logFileName:@"file.jsonl" error:NULL];
+        },
+        @"TLSRollingJSONLinesFileOutputStream" : ^id<TLSOutputStream>(void) {
+            return [[TLSRollingJSONLinesFileOutputStream alloc] initWithLogFileDirectoryPath:directory logFilePrefix:@"json." maxLogFiles:10 maxBytesPerLogFile:(1024 * 1024) error:NULL];
+        },
+        @"TLSPartitionedRollingFileOutputStream" : ^id<TLSOutputStream>(void) {
+            NSArray<TLSRollingFilePartition *> *partitions = @[ [[TLSRollingFilePartition alloc] initWithName:@"all" channels:nil maxLogFiles:10 maxBytesPerLogFile:(1024 * 1024)] ];
+            return [[TLSPartitionedRollingFileOutputStream alloc] initWithLogFileDirectoryPath:directory logFilePrefix:@"partitioned." partitions:partitions maxOpenFiles:4 error:NULL];
+        },
+    };
+}
+
+static void _BenchmarkStreams(NSUInteger iterations)
+{
+    NSString *directory = _TemporaryDirectory(@"streams");
+    NSDictionary<NSString *, id<TLSOutputStream> (^)(void)> *factories = _StreamFactories(directory);
+
+    for (NSString *name in [factories.allKeys sortedArrayUsingSelector:@selector(compare:)]) {
+        id<TLSOutputStream> stream = factories[name]();
+        if (!stream) {
+            fprintf(stderr, "skipping %s\n", name.UTF8String);
+            continue;
+        }
+
+        TLSLoggingService *service = [[TLSLoggingService alloc] init];
+        [service addOutputStream:stream];
+        [service flush];
+
+        // keep console streams from flooding the terminal (`os_log` goes to the system log)
+        fflush(stderr);
+        const int savedStdErr = dup(STDERR_FILENO);
+        const int devNull = open("/dev/null", O_WRONLY);
+        dup2(devNull, STDERR_FILENO);
+
+        const uint64_t start = _NowNanoseconds();
+        for (NSUInteger i = 0; i < iterations; i++) {
+            @autoreleasepool {
+                TLSLogEx(service, (i % 4 == 0) ? TLSLogLevelWarning : TLSLogLevelInformation, kChannel, kFile, kFunction, __LINE__, nil, 0, @"message %tu with a typical amount of text: user=%d state=%@", i, 12345, @"active");
+            }
+        }
+        [service flush];
+        const uint64_t elapsedNs = _NowNanoseconds() - start;
+
+        dup2(savedStdErr, STDERR_FILENO);
+        close(savedStdErr);
+        close(devNull);
+
+        [service removeOutputStream:stream];
+        _AddResult(@"streams",
+                   @{ @"stream" : name, @"iterations" : @(iterations) },
+                   @{ @"messagesPerSecond" : @((double)iterations / ((double)elapsedNs / NSEC_PER_SEC)),
+                      @"nsPerMessage" : @((double)elapsedNs / (double)iterations) });
+    }
+
+    [[NSFileManager defaultManager] removeItemAtPath:directory error:NULL];
+}
+
+#pragma mark - compose
+
+static void _BenchmarkCompose(NSUInteger iterations)
+{
+    NSDictionary<NSString *, NSNumber *> *optionSets = @{
+        @"none" : @(TLSComposeLogMessageInfoNoOptions),
+        @"default" : @(TLSComposeLogMessageInfoDefaultOptions),
+        @"timestampSinceLoggingStarted" : @(TLSComposeLogMessageInfoLogTimestampAsTimeSinceLoggingStarted),
+        @"timestampLocal" : @(TLSComposeLogMessageInfoLogTimestampAsLocalTime),
+        @"timestampUTC" : @(TLSComposeLogMessageInfoLogTimestampAsUTCTime),
+        @"thread" : @(TLSComposeLogMessageInfoLogThreadId | TLSComposeLogMessageInfoLogThreadName),
+        @"channelAndLevel" : @(TLSComposeLogMessageInfoLogChannel | TLSComposeLogMessageInfoLogLevel),
+        @"callsiteAlways" : @(TLSComposeLogMessageInfoLogCallsiteInfoAlways),
+        @"all" : @(TLSComposeLogMessageInfoDefaultOptions | TLSComposeLogMessageInfoLogThreadName | TLSComposeLogMessageInfoLogCallsiteInfoAlways),
+    };
+    TLSLogMessageInfo *info = _MessageInfos(1).firstObject;
+
+    for (NSString *name in [optionSets.allKeys sortedArrayUsingSelector:@selector(compare:)]) {
+        const TLSComposeLogMessageInfoOptions options = optionSets[name].integerValue | TLSComposeLogMessageInfoDoNotCache;
+        NSUInteger length = 0;
+        const uint64_t start = _NowNanoseconds();
+        for (NSUInteger i = 0; i < iterations; i++) {
+            @autoreleasepool {
+                length += [info composeFormattedMessageWithOptions:options].length;
+            }
+        }
+        const uint64_t elapsedNs = _NowNanoseconds() - start;
+        _AddResult(@"compose",
+                   @{ @"options" : name, @"iterations" : @(iterations) },
+                   @{ @"nsPerCall" : @((double)elapsedNs / (double)iterations),
+                      @"averageLength" : @((double)length / (double)iterations) });
+    }
+}
+
+#pragma mark - rollover
+
+static void _BenchmarkRollover(NSUInteger iterations)
+{
+    NSString *directory = _TemporaryDirectory(@"rollover");
+    TLSRollingFileOutputStream *stream = [[TLSRollingFileOutputStream alloc] initWithLogFileDirectoryPath:directory
+                                                                                            logFilePrefix:@"rollover."
+                                                                                              maxLogFiles:4
+                                                                                       maxBytesPerLogFile:(16 * 1024)
+                                                                                                    error:NULL];
+    NSArray<TLSLogMessageInfo *> *infos = _MessageInfos(iterations);
+    uint64_t *writeSamples = calloc(iterations, sizeof(uint64_t));
+    uint64_t *rolloverSamples = calloc(iterations, sizeof(uint64_t));
+    size_t writeCount = 0;
+    size_t rolloverCount = 0;
+
+    NSString *logFilePath = stream.logFilePath;
+    for (TLSLogMessageInfo *info in infos) {
+        @autoreleasepool {
+            const uint64_t start = _NowNanoseconds();
+            [stream tls_outputLogInfo:info];
+            const uint64_t elapsedNs = _NowNanoseconds() - start;
+            if (![stream.logFilePath isEqualToString:logFilePath]) {
+                // once there are `maxLogFiles` files, every rollover also prunes
+                logFilePath = stream.logFilePath;
+                rolloverSamples[rolloverCount++] = elapsedNs;
+            } else {
+                writeSamples[writeCount++] = elapsedNs;
+            }
+        }
+    }
+    [stream tls_flush];
+
+    _AddResult(@"rollover", @{ @"kind" : @"write", @"iterations" : @(iterations) }, _Percentiles(writeSamples, writeCount));
+    _AddResult(@"rollover", @{ @"kind" : @"rollover", @"iterations" : @(iterations) }, _Percentiles(rolloverSamples, rolloverCount));
+    free(writeSamples);
+    free(rolloverSamples);
+    [[NSFileManager defaultManager] removeItemAtPath:directory error:NULL];
+}
+
+#pragma mark - replay
+
+static uint64_t _PhysicalFootprint(void)
+{
+    task_vm_info_data_t info;
+    mach_msg_type_number_t count = TASK_VM_INFO_COUNT;
+    if (KERN_SUCCESS != task_info(mach_task_self(), TASK_VM_INFO, (task_info_t)&info, &count)) {
+        return 0;
+    }
+    return info.phys_footprint;
+}
+
+//! sleep most of the way then spin, sleeping alone oversleeps by more than the gaps between calls
+static void _WaitUntilNanoseconds(uint64_t target)
+{
+    uint64_t now = _NowNanoseconds();
+    if (target > now + 200 * NSEC_PER_USEC) {
+        const uint64_t sleepNs = target - now - 100 * NSEC_PER_USEC;
+        const struct timespec duration = { .tv_sec = (time_t)(sleepNs / NSEC_PER_SEC), .tv_nsec = (long)(sleepNs % NSEC_PER_SEC) };
+        nanosleep(&duration, NULL);
+    }
+    while (_NowNanoseconds() < target) {
+        // spin
+    }
+}
+
+typedef struct {
+    __unsafe_unretained TLSLoggingService *service;
+    __unsafe_unretained TLSWorkloadTrace *trace;
+    __unsafe_unretained NSArray<NSString *> *files;
+    __unsafe_unretained NSArray<NSString *> *functions;
+    __unsafe_unretained NSString *padding;
+    TLSLogCallsite *callsites;
+    const uint32_t *recordIndexes;
+    size_t recordCount;
+    double speed;
+    atomic_bool *start;
+    uint64_t startTime;
+    uint64_t *samples; // by record index
+    uint64_t maxLagNs;
+} TLSReplayThreadContext;
+
+static void *_ReplayThreadMain(void *arg)
+{
+    TLSReplayThreadContext *context = arg;
+    while (!atomic_load(context->start)) {
+        // spin so every thread starts together
+    }
+
+    const TLSWorkloadTraceRecord *records = context->trace.records;
+    NSArray<NSString *> *channels = context->trace.channels;
+    for (size_t i = 0; i < context->recordCount; i++) {
+        @autoreleasepool {
+            const uint32_t recordIndex = context->recordIndexes[i];
+            const TLSWorkloadTraceRecord *record = &records[recordIndex];
+            const TLSLogLevel level = (TLSLogLevel)record->level;
+            NSString *channel = channels[record->channelIndex];
+            TLSLogCallsite *callsite = &context->callsites[record->callsiteIndex];
+            NSString *message = (record->filtered) ? nil : [context->padding substringToIndex:record->messageLength];
+
+            if (context->speed > 0) {
+                const uint64_t target = context->startTime + (uint64_t)((double)record->time / context->speed);
+                const uint64_t now = _NowNanoseconds();
+                if (now < target) {
+                    _WaitUntilNanoseconds(target);
+                } else {
+                    context->maxLagNs = MAX(context->maxLagNs, now - target);
+                }
+            }
+
+            // the calls the `TLSLog` macros make, logging what was logged when captured (whatever the replay streams filter)
+            const uint64_t start = _NowNanoseconds();
+            (void)TLSCanLogCallsite(context->service, level, channel, nil, callsite);
+            if (!record->filtered) {
+                TLSLogEx(context->service, level, channel, context->files[record->callsiteIndex], context->functions[record->callsiteIndex], callsite->line, nil, 0, @"%@", message);
+            }
+            context->samples[recordIndex] = _NowNanoseconds() - start;
+        }
+    }
+    return NULL;
+}
+
+static void _BenchmarkReplay(NSString *tracePath, NSArray<NSString *> *streamNames, double speed)
+{
+    NSError *error = nil;
+    TLSWorkloadTrace *trace = [[TLSWorkloadTrace alloc] initWithFilePath:tracePath error:&error];
+    if (!trace) {
+        fprintf(stderr, "%s\n", error.description.UTF8String);
+        return;
+    }
+    const NSUInteger recordCount = trace.recordCount;
+    const TLSWorkloadTraceRecord *records = trace.records;
+
+    NSString *directory = _TemporaryDirectory(@"replay");
+    NSDictionary<NSString *, id<TLSOutputStream> (^)(void)> *factories = _StreamFactories(directory);
+    TLSLoggingService *service = [[TLSLoggingService alloc] init];
+    for (NSString *name in streamNames) {
+        id<TLSOutputStream> stream = ([name isEqualToString:@"TLSBenchmarkStream"]) ? [[TLSBenchmarkStream alloc] init] : factories[name] ? factories[name]() : nil;
+        if (!stream) {
+            fprintf(stderr, "unknown or unsupported stream %s\n", name.UTF8String);
+            return;
+        }
+        [service addOutputStream:stream];
+    }
+    [service flush];
+
+    // the callsites (for throttles to resolve) and messages are prepared up front, outside the timed calls
+    const NSUInteger callsiteCount = trace.callsites.count;
+    TLSLogCallsite *callsites = calloc(MAX(callsiteCount, (NSUInteger)1), sizeof(TLSLogCallsite));
+    NSMutableArray<NSString *> *files = [NSMutableArray arrayWithCapacity:callsiteCount];
+    NSMutableArray<NSString *> *functions = [NSMutableArray arrayWithCapacity:callsiteCount];
+    for (NSUInteger i = 0; i < callsiteCount; i++) {
+        TLSWorkloadTraceCallsite *callsite = trace.callsites[i];
+        callsites[i].file = strdup(callsite.file.UTF8String);
+        callsites[i].line = (int)callsite.line;
+        [files addObject:callsite.file];
+        [functions addObject:callsite.function];
+    }
+    uint32_t maxMessageLength = 0;
+    NSUInteger loggedCount = 0;
+    NSMutableDictionary<NSNumber *, NSMutableData *> *recordIndexesByThread = [NSMutableDictionary dictionary];
+    for (NSNumber *threadId in trace.threadIds) {
+        recordIndexesByThread[threadId] = [NSMutableData data];
+    }
+    for (uint32_t i = 0; i < recordCount; i++) {
+        maxMessageLength = MAX(maxMessageLength, records[i].messageLength);
+        loggedCount += (records[i].filtered) ? 0 : 1;
+        [recordIndexesByThread[@(records[i].threadId)] appendBytes:&i length:sizeof(i)];
+    }
+    NSString *padding = [@"" stringByPaddingToLength:maxMessageLength withString:@"x" startingAtIndex:0];
+
+    const NSUInteger threadCount = trace.threadIds.count;
+    uint64_t *samples = calloc(MAX(recordCount, (NSUInteger)1), sizeof(uint64_t));
+    TLSReplayThreadContext *contexts = calloc(MAX(threadCount, (NSUInteger)1), sizeof(TLSReplayThreadContext));
+    pthread_t *threads = calloc(MAX(threadCount, (NSUInteger)1), sizeof(pthread_t));
+    atomic_bool start = false;
+    for (NSUInteger t = 0; t < threadCount; t++) {
+        NSData *recordIndexes = recordIndexesByThread[trace.threadIds[t]];
+        contexts[t] = (TLSReplayThreadContext){ .service = service,
+                                                .trace = trace,
+                                                .files = files,
+                                                .functions = functions,
+                                                .padding = padding,
+                                                .callsites = callsites,
+                                                .recordIndexes = recordIndexes.bytes,
+                                                .recordCount = recordIndexes.length / sizeof(uint32_t),
+                                                .speed = speed,
+                                                .start = &start,
+                                                .samples = samples };
+        pthread_create(&threads[t], NULL, _ReplayThreadMain, &contexts[t]);
+    }
+
+    // sample the footprint while replaying, until the output has drained
+    static atomic_ullong sPeakFootprint;
+    const uint64_t baselineFootprint = _PhysicalFootprint();
+    atomic_store(&sPeakFootprint, baselineFootprint);
+    dispatch_source_t sampler = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, dispatch_get_global_queue(QOS_CLASS_UTILITY, 0));
+    dispatch_source_set_timer(sampler, DISPATCH_TIME_NOW, 5 * NSEC_PER_MSEC, NSEC_PER_MSEC);
+    dispatch_source_set_event_handler(sampler, ^{
+        const uint64_t footprint = _PhysicalFootprint();
+        uint64_t peak = atomic_load(&sPeakFootprint);
+        while (footprint > peak && !atomic_compare_exchange_weak(&sPeakFootprint, &peak, footprint)) {
+            // `peak` reloaded
+        }
+    });
+    dispatch_resume(sampler);
+
+    const uint64_t wallStart = _NowNanoseconds();
+    for (NSUInteger t = 0; t < threadCount; t++) {
+        contexts[t].startTime = wallStart;
+    }
+    atomic_store(&start, true);
+    uint64_t maxLagNs = 0;
+    for (NSUInteger t = 0; t < threadCount; t++) {
+        pthread_join(threads[t], NULL);
+        maxLagNs = MAX(maxLagNs, contexts[t].maxLagNs);
+    }
+    const uint64_t calledNs = _NowNanoseconds() - wallStart;
+    [service flush];
+    const uint64_t drainedNs = _NowNanoseconds() - wallStart;
+    dispatch_source_cancel(sampler);
+    const uint64_t footprint = _PhysicalFootprint();
+
+    uint64_t *loggedSamples = calloc(MAX(loggedCount, (NSUInteger)1), sizeof(uint64_t));
+    size_t loggedSampleCount = 0;
+    for (NSUInteger i = 0; i < recordCount; i++) {
+        if (!records[i].filtered) {
+            loggedSamples[loggedSampleCount++] = samples[i];
+        }
+    }
+
+    _AddResult(@"replay",
+               @{ @"trace" : tracePath.lastPathComponent,
+                  @"streams" : [streamNames componentsJoinedByString:@","],
+                  @"speed" : @(speed),
+                  @"threads" : @(threadCount),
+                  @"records" : @(recordCount),
+                  @"traceDurationNs" : @(trace.duration) },
+               @{ @"callerLatency" : _Percentiles(samples, recordCount),
+                  @"loggedCallerLatency" : _Percentiles(loggedSamples, loggedSampleCount),
+                  @"callsPerSecond" : @((double)recordCount / ((double)calledNs / NSEC_PER_SEC)),
+                  @"loggedPerSecond" : @((double)loggedCount / ((double)drainedNs / NSEC_PER_SEC)),
+                  @"calledNs" : @(calledNs),
+                  @"drainedNs" : @(drainedNs),
+                  @"maxScheduleLagNs" : @(maxLagNs),
+                  @"baselineFootprintBytes" : @(baselineFootprint),
+                  @"peakFootprintBytes" : @(MAX(atomic_load(&sPeakFootprint), footprint)),
+                  @"drainedFootprintBytes" : @(footprint) });
+
+    for (NSUInteger i = 0; i < callsiteCount; i++) {
+        free((void *)callsites[i].file);
+    }
+    free(callsites);
+    free(samples);
+    free(loggedSamples);
+    free(contexts);
+    free(threads);
+    [[NSFileManager defaultManager] removeItemAtPath:directory error:NULL];
+}
+
+#pragma mark - main
+
+static NSDictionary *_HostInfo(void)
+{
+    char model[256] = { 0 };
+    size_t modelLength = sizeof(model) - 1;
+    sysctlbyname("hw.model", model, &modelLength, NULL, 0);
+    NSProcessInfo *processInfo = [NSProcessInfo processInfo];
+    return @{ @"model" : @(model),
+              @"os" : processInfo.operatingSystemVersionString,
+              @"activeProcessorCount" : @(processInfo.activeProcessorCount),
+              @"physicalMemory" : @(processInfo.physicalMemory) };
+}
+
+static void _PrintUsage(void)
+{
+    fprintf(stderr, "usage: TwitterLoggingServiceBenchmarks [--iterations N] [--benchmark canlog|enqueue|streams|compose|rollover|replay]... [--output PATH]\n"
+                    "                                       [--trace PATH [--streams NAME[,NAME]...] [--speed X]]\n");
+}
+
+int main(int argc, const char * argv[])
+{
+    @autoreleasepool {
+        NSUInteger iterations = 100000;
+        NSMutableSet<NSString *> *selected = [NSMutableSet set];
+        NSString *outputPath = nil;
+        NSString *tracePath = nil;
+        NSArray<NSString *> *streamNames = @[ @"TLSBenchmarkStream" ];
+        double speed = 1.0;
+        for (int i = 1; i < argc; i++) {
+            NSString *argument = @(argv[i]);
+            NSString *value = (i + 1 < argc) ? @(argv[i + 1]) : nil;
+            if ([argument isEqualToString:@"--iterations"] && value.integerValue > 0) {
+                iterations = (NSUInteger)value.integerValue;
+                i++;
+            } else if ([argument isEqualToString:@"--benchmark"] && value) {
+                [selected addObject:value];
+                i++;
+            } else if ([argument isEqualToString:@"--output"] && value) {
+                outputPath = value;
+                i++;
+            } else if ([argument isEqualToString:@"--trace"] && value) {
+                tracePath = value;
+                i++;
+            } else if ([argument isEqualToString:@"--streams"] && value.length > 0) {
+                streamNames = [value componentsSeparatedByString:@","];
+                i++;
+            } else if ([argument isEqualToString:@"--speed"] && value && value.doubleValue >= 0) {
+                speed = value.doubleValue;
+                i++;
+            } else {
+                _PrintUsage();
+                return 1;
+            }
+        }
+
+        NSDictionary<NSString *, void (^)(NSUInteger)> *benchmarks = @{
+            @"canlog" : ^(NSUInteger count) { _BenchmarkCanLog(count * 10); },
+            @"enqueue" : ^(NSUInteger count) { _BenchmarkEnqueue(count); },
+            @"streams" : ^(NSUInteger count) { _BenchmarkStreams(count); },
+            @"compose" : ^(NSUInteger count) { _BenchmarkCompose(count); },
+            @"rollover" : ^(NSUInteger count) { _BenchmarkRollover(count); },
+            @"replay" : ^(NSUInteger count) { _BenchmarkReplay(tracePath, streamNames, speed); },
+        };
+        for (NSString *name in selected) {
+            if (!benchmarks[name] || ([name isEqualToString:@"replay"] && !tracePath)) {
+                _PrintUsage();
+                return 1;
+            }
+        }
+
+        sResults = [NSMutableArray array];
+        for (NSString *name in @[ @"canlog", @"enqueue", @"streams", @"compose", @"rollover", @"replay" ]) {
+            const BOOL runByDefault = ![name isEqualToString:@"replay"] || (tracePath != nil);
+            if ((selected.count == 0 && runByDefault) || [selected containsObject:name]) {
+                @autoreleasepool {
+                    benchmarks[name](iterations);
+                }
+            }
+        }
+
+        NSISO8601DateFormatter *formatter = [[NSISO8601DateFormatter alloc] init];
+        NSDictionary *report = @{ @"date" : [formatter stringFromDate:[NSDate date]],
+#if DEBUG
+                                  @"configuration" : @"Debug",
+#else
+                                  @"configuration" : @"Release",
+#endif
+                                  @"host" : _HostInfo(),
+                                  @"iterations" : @(iterations),
+                                  @"results" : sResults };
+        NSError *error = nil;
+        NSData *data = [NSJSONSerialization dataWithJSONObject:report options:NSJSONWritingPrettyPrinted error:&error];
+        if (!data) {
+            fprintf(stderr, "%s\n", error.description.UTF8String);
+            return 1;
+        }
+        if (outputPath) {
+            if (![data writeToFile:outputPath options:NSDataWritingAtomic error:&error]) {
+                fprintf(stderr, "%s\n", error.description.UTF8String);
+                return 1;
+            }
+        } else {
+            fwrite(data.bytes, 1, data.length, stdout);
+            fputc('\n', stdout);
+        }
+    }
+    return 0;
+}
@@ -6,7 +6,10 @@
 //  Copyright (c) 2016 Twitter, Inc.
 //
 
+#include <arpa/inet.h>
+#include <netinet/in.h>
 #include <pthread.h>
+#include <sys/socket.h>
 
 #import <TwitterLoggingService/TwitterLoggingService.h>
 #import <XCTest/XCTest.h>
@@ -24,6 +27,17 @@ static BOOL IsConsoleChannelOn(NSString *channel);
 - (void)setChannel:(NSString *)channel on:(BOOL)on;
 @end
 
+typedef void(^TestCallbackLoggerBlock)(TLSLogMessageInfo *info);
+
+@interface TestCallbackLogger : NSObject <TLSOutputStream>
+- (instancetype)initWithCallback:(TestCallbackLoggerBlock)callback;
+@end
+
+@interface TestServiceDelegate : NSObject <TLSLoggingServiceDelegate>
+@property (atomic, copy) void (^metricsCallback)(TLSLoggingMetrics *metrics);
+@property (atomic, copy) void (^isolationCallback)(id<TLSOutputStream> stream);
+@end
+
 @interface TestStdErrLogger : TLSStdErrOutputStream
 @end
 
@@ -33,6 +47,21 @@ static BOOL IsConsoleChannelOn(NSString *channel);
 @interface TestFileLogger : TLSFileOutputStream
 @end
 
+// stand-in for a heavy context object (such as a view controller)
+@interface TestSnapshottingContext : NSObject <TLSLogContextSnapshotting>
+@property (nonatomic, copy) NSString *identifier;
+@end
+
+// stand-in for a log shipping endpoint, a local HTTP server that records the requests it receives
+@interface TestShippingServer : NSObject
+@property (atomic) NSInteger statusCode;
+@property (nonatomic, readonly) NSURL *endpointURL;
+// the header fields are lowercased
+@property (atomic, readonly) NSArray<NSDictionary<NSString *, NSString *> *> *requestHeaders;
+@property (atomic, readonly) NSArray<NSData *> *bodies;
+- (void)stop;
+@end
+
 @interface TLSLoggingTests : XCTestCase
 @end
 
@@ -463,6 +492,84 @@ static NSMutableDictionary *sRuntimes;
     XCTAssertEqual(bytes, expectedBytes, @"file size doesn't match expectations");
 }
 
+- (void)testLoggingFile7
+{
+    NSError *error = nil;
+    TLSFileOutputStream *stream = [[TLSFileOutputStream alloc] initWithLogFileName:@"TLSFileOutputStreamAsyncTest.log" error:&error];
+    XCTAssertNil(error, @"TLSFileOutputStream should have succeeded");
+    stream.asynchronousWriteBufferSize = 1;
+    XCTAssertEqual((NSUInteger)(4 * 1024), stream.asynchronousWriteBufferSize, @"asynchronousWriteBufferSize should have been capped!");
+    stream.asynchronousWriteBufferCount = 3;
+    XCTAssertEqual((NSUInteger)3, stream.asynchronousWriteBufferCount, @"asynchronousWriteBufferCount differs!");
+
+    NSMutableString *expected = [[NSMutableString alloc] init];
+    for (int i = 0; i < TEST_MX_COUNT; i++) {
+        NSString *line = [NSString stringWithFormat:@"TLSFileOutputStream asynchronous data %d", i];
+        [stream outputLogData:[line dataUsingEncoding:stream.tls_loggedDataEncoding]];
+        [expected appendString:line];
+        [expected appendString:@"\n"];
+    }
+    [stream tls_flush];
+
+    NSString *string = [[NSString alloc] initWithContentsOfFile:stream.logFilePath encoding:stream.tls_loggedDataEncoding error:NULL];
+    XCTAssertEqualObjects(expected, string, @"asynchronously written data doesn't match expectations");
+    XCTAssertEqual(expected.length, stream.bytesWritten, @"TLSFileOutputStream bytes written should equal %tu", expected.length);
+    XCTAssertEqual(0ULL, stream.bytesDropped);
+    XCTAssertNil(stream.lastWriteError);
+    XCTAssertEqualObjects(@0, [stream tls_metricCounters][TLSOutputStreamMetricBytesDropped]);
+
+    // switching back to synchronous writes continues where the I/O thread left off
+    stream.asynchronousWriteBufferSize = 0;
+    [stream outputLogData:[@"sync" dataUsingEncoding:stream.tls_loggedDataEncoding]];
+    [stream tls_flush];
+    [expected appendString:@"sync\n"];
+    string = [[NSString alloc] initWithContentsOfFile:stream.logFilePath encoding:stream.tls_loggedDataEncoding error:NULL];
+    XCTAssertEqualObjects(expected, string, @"synchronously written data doesn't match expectations");
+}
+
+- (void)testLoggingFile8
+{
+    NSError *error = nil;
+    TLSFileOutputStream *stream = [[TLSFileOutputStream alloc] initWithLogFileName:@"TLSFileOutputStreamDurabilityTest.log" error:&error];
+    XCTAssertNil(error, @"TLSFileOutputStream should have succeeded");
+    [stream setDurability:TLSFileOutputDurabilityFlush forLevels:TLSLogLevelMaskWarning];
+    [stream setDurability:TLSFileOutputDurabilitySync forLevels:TLSLogLevelMaskError | TLSLogLevelMaskCritical];
+    stream.minimumSyncInterval = 60.0;
+    XCTAssertEqual(TLSFileOutputDurabilityBuffered, [stream durabilityForLevel:TLSLogLevelInformation]);
+    XCTAssertEqual(TLSFileOutputDurabilityFlush, [stream durabilityForLevel:TLSLogLevelWarning]);
+    XCTAssertEqual(TLSFileOutputDurabilitySync, [stream durabilityForLevel:TLSLogLevelError]);
+
+    TEST_CHANNEL_ON(TLSLogChannelDefault);
+    const TLSLogLevel levels[] = { TLSLogLevelInformation, TLSLogLevelInformation, TLSLogLevelWarning, TLSLogLevelError, TLSLogLevelError, TLSLogLevelCritical };
+    for (size_t i = 0; i < (sizeof(levels) / sizeof(levels[0])); i++) {
+        LogStream(stream, levels[i], TLSLogChannelDefault, @(__FILE__), @(__PRETTY_FUNCTION__), __LINE__, @"durability");
+    }
+
+    // 1 warning flush + 3 error/critical flushes, only the first of which syncs
+    XCTAssertEqual(4ULL, stream.flushCount);
+    XCTAssertEqual(1ULL, stream.syncCount);
+    XCTAssertEqual(2ULL, stream.rateLimitedSyncCount);
+
+    [stream tls_flush];
+    XCTAssertEqual(5ULL, stream.flushCount);
+
+    // a rate limited sync is made up for by a trailing sync at the end of the window
+    TLSFileOutputStream *trailingStream = [[TLSFileOutputStream alloc] initWithLogFileName:@"TLSFileOutputStreamTrailingSyncTest.log" error:&error];
+    XCTAssertNil(error);
+    [trailingStream setDurability:TLSFileOutputDurabilitySync forLevels:TLSLogLevelMaskError];
+    trailingStream.minimumSyncInterval = 0.1;
+    for (NSUInteger i = 0; i < 3; i++) {
+        LogStream(trailingStream, TLSLogLevelError, TLSLogChannelDefault, @(__FILE__), @(__PRETTY_FUNCTION__), __LINE__, @"trailing");
+    }
+    TEST_CHANNEL_OFF(TLSLogChannelDefault);
+    XCTAssertEqual(1ULL, trailingStream.syncCount);
+    XCTAssertEqual(2ULL, trailingStream.rateLimitedSyncCount);
+    for (NSUInteger i = 0; i < 50 && trailingStream.syncCount < 2; i++) {
+        [NSThread sleepForTimeInterval:0.02];
+    }
+    XCTAssertEqual(2ULL, trailingStream.syncCount, @"one trailing sync for both rate limited syncs");
+}
+
 - (void)testLoggingFileNSLogCombo
 {
     TEST_START
@@ -744,6 +851,1269 @@ static NSMutableDictionary *sRuntimes;
     XCTAssertTrue(logs.length > 0, @"the minimum bytes you can cap is the maximum bytes per files, not 0");
 }
 
+- (void)testLoggingRollingFileIndex
+{
+    TEST_START
+    NSString *path = [[TLSRollingFileOutputStream defaultLogFileDirectoryPath] stringByAppendingPathComponent:@"TLSLoggingIndex"];
+    [[NSFileManager defaultManager] removeItemAtPath:path error:NULL];
+    NSError *error = nil;
+    TLSRollingFileOutputStream *stream = [[TLSRollingFileOutputStream alloc] initWithLogFileDirectoryPath:path logFilePrefix:@"idx." maxLogFiles:5 maxBytesPerLogFile:(1024 * 16) error:&error];
+    XCTAssertNil(error, @"TLSRollingFileOutputStream should have succeeded");
+    stream.indexCheckpointInterval = 1024;
+    [sLoggingService addOutputStream:stream];
+
+    NSDate *startDate = [NSDate date];
+    for (int i = 0; i < TEST_COUNT; i++) {
+        TLSLogError(@"IndexA", @"error A %d", i);
+        TLSLogWarning(@"IndexA", @"warning A %d", i);
+        TLSLogError(@"IndexB", @"error B %d", i);
+    }
+    [sLoggingService flush];
+
+    TLSLogIndexQuery *query = [[TLSLogIndexQuery alloc] init];
+    query.channels = [NSSet setWithObject:@"IndexA"];
+    query.levelMask = TLSLogLevelMaskError;
+    query.startDate = startDate;
+    __block NSUInteger count = 0;
+    [sLoggingService enumerateIndexedRecordsFromOutputStream:stream matchingQuery:query usingBlock:^(TLSLogIndexRecord *record, BOOL *stop) {
+        XCTAssertEqualObjects(record.channel, @"IndexA");
+        XCTAssertEqual(record.level, TLSLogLevelError);
+        NSString *line = [[NSString alloc] initWithData:record.data encoding:NSUTF8StringEncoding];
+        XCTAssertTrue([line hasSuffix:[NSString stringWithFormat:@"error A %tu", count]], @"%@", line);
+        count++;
+    }];
+    XCTAssertEqual(count, (NSUInteger)TEST_COUNT);
+
+    query.channels = nil;
+    query.levelMask = TLSLogLevelMaskAll;
+    count = 0;
+    [sLoggingService enumerateIndexedRecordsFromOutputStream:stream matchingQuery:query usingBlock:^(TLSLogIndexRecord *record, BOOL *stop) {
+        if (++count == 10) {
+            *stop = YES;
+        }
+    }];
+    XCTAssertEqual(count, (NSUInteger)10);
+
+    query.startDate = [NSDate dateWithTimeIntervalSinceNow:60];
+    query.endDate = nil;
+    count = 0;
+    [sLoggingService enumerateIndexedRecordsFromOutputStream:stream matchingQuery:query usingBlock:^(TLSLogIndexRecord *record, BOOL *stop) {
+        count++;
+    }];
+    XCTAssertEqual(count, (NSUInteger)0);
+
+    // the query runs off the logging queue, the block can log and flush
+    query.startDate = startDate;
+    query.channels = [NSSet setWithObject:@"IndexB"];
+    count = 0;
+    [sLoggingService enumerateIndexedRecordsFromOutputStream:stream matchingQuery:query usingBlock:^(TLSLogIndexRecord *record, BOOL *stop) {
+        TLSLogError(@"IndexC", @"visited record %tu", count);
+        [sLoggingService flush];
+        if (++count == 3) {
+            *stop = YES;
+        }
+    }];
+    XCTAssertEqual(count, (NSUInteger)3);
+    query.channels = [NSSet setWithObject:@"IndexC"];
+    query.levelMask = TLSLogLevelMaskAll;
+    count = 0;
+    [sLoggingService enumerateIndexedRecordsFromOutputStream:stream matchingQuery:query usingBlock:^(TLSLogIndexRecord *record, BOOL *stop) {
+        count++;
+    }];
+    XCTAssertEqual(count, (NSUInteger)3);
+
+    [sLoggingService removeOutputStream:stream];
+    TEST_STOP
+}
+
+- (void)testLoggingPartitionedRollingFile
+{
+    NSString *path = [[TLSFileOutputStream defaultLogFileDirectoryPath] stringByAppendingPathComponent:@"TLSLoggingPartitioned"];
+    [[NSFileManager defaultManager] removeItemAtPath:path error:NULL];
+
+    NSError *error = nil;
+    NSArray<TLSRollingFilePartition *> *partitions = @[ [[TLSRollingFilePartition alloc] initWithName:@"network" channels:[NSSet setWithObjects:@"HTTP", @"Socket", nil] maxLogFiles:2 maxBytesPerLogFile:1024],
+                                                      [[TLSRollingFilePartition alloc] initWithName:@"media" channels:[NSSet setWithObject:@"Media"] maxLogFiles:3 maxBytesPerLogFile:1024] ];
+    TLSPartitionedRollingFileOutputStream *stream = [[TLSPartitionedRollingFileOutputStream alloc] initWithLogFileDirectoryPath:path logFilePrefix:nil partitions:partitions maxOpenFiles:1 error:&error];
+    XCTAssertNotNil(stream);
+    XCTAssertNil(error);
+    XCTAssertEqual(TLSFilterStatusOK, [stream tls_shouldFilterLevel:TLSLogLevelError channel:@"HTTP" contextObject:nil]);
+    XCTAssertEqual(TLSFilterStatusCannotLogChannel, [stream tls_shouldFilterLevel:TLSLogLevelError channel:@"Other" contextObject:nil]);
+
+    NSArray<NSString *> *channels = @[ @"HTTP", @"Media", @"Socket" ];
+    for (NSString *channel in channels) {
+        TEST_CHANNEL_ON(channel);
+    }
+    for (int i = 0; i < TEST_COUNT; i++) {
+        LogStream(stream, TLSLogLevelError, channels[(NSUInteger)i % channels.count], @(__FILE__), @(__PRETTY_FUNCTION__), __LINE__, @"partitioned %d", i);
+    }
+    for (NSString *channel in channels) {
+        TEST_CHANNEL_OFF(channel);
+    }
+    [stream tls_flush];
+
+    // with a single open file, every message reopens its partition's log file for appending
+    NSDictionary<NSString *, NSNumber *> *counters = [stream tls_metricCounters];
+    XCTAssertGreaterThan(counters[TLSOutputStreamMetricBytesWritten].unsignedLongLongValue, 0ULL);
+    XCTAssertGreaterThan(counters[TLSOutputStreamMetricRollovers].unsignedLongLongValue, 0ULL);
+    XCTAssertGreaterThan(counters[TLSOutputStreamMetricPurges].unsignedLongLongValue, 0ULL);
+
+    XCTAssertEqual((NSUInteger)2, [stream logFilePathsForPartitionNamed:@"network"].count, @"network partition should have been pruned to 2 log files");
+    XCTAssertEqual((NSUInteger)3, [stream logFilePathsForPartitionNamed:@"media"].count, @"media partition should have been pruned to 3 log files");
+    XCTAssertNil([stream logFilePathsForPartitionNamed:@"other"]);
+
+    NSString *media = [[NSString alloc] initWithData:[stream retrieveLoggedDataForPartitionNamed:@"media" maxBytes:NSUIntegerMax] encoding:NSUTF8StringEncoding];
+    XCTAssertTrue([media containsString:@"Media"]);
+    XCTAssertFalse([media containsString:@"HTTP"]);
+    XCTAssertFalse([media containsString:@"Socket"]);
+
+    // a new stream picks up the existing log files with a single scan
+    stream = [[TLSPartitionedRollingFileOutputStream alloc] initWithLogFileDirectoryPath:path logFilePrefix:nil partitions:partitions maxOpenFiles:1 error:&error];
+    XCTAssertEqual((NSUInteger)3, [stream logFilePathsForPartitionNamed:@"media"].count);
+
+    // invalid partitions
+    partitions = @[ [[TLSRollingFilePartition alloc] initWithName:@"a" channels:[NSSet setWithObject:@"HTTP"] maxLogFiles:2 maxBytesPerLogFile:1024],
+                    [[TLSRollingFilePartition alloc] initWithName:@"b" channels:[NSSet setWithObject:@"HTTP"] maxLogFiles:2 maxBytesPerLogFile:1024] ];
+    stream = [[TLSPartitionedRollingFileOutputStream alloc] initWithLogFileDirectoryPath:path logFilePrefix:nil partitions:partitions maxOpenFiles:1 error:&error];
+    XCTAssertNil(stream);
+    XCTAssertNotNil(error);
+}
+
+- (void)testLoggingFlightRecorder
+{
+    NSString *path = [[TLSFileOutputStream defaultLogFileDirectoryPath] stringByAppendingPathComponent:@"TLSLoggingFlightRecorder"];
+    [[NSFileManager defaultManager] removeItemAtPath:path error:NULL];
+
+    NSError *error = nil;
+    TLSFlightRecorderOutputStream *stream = [[TLSFlightRecorderOutputStream alloc] initWithLogFileDirectoryPath:path logFilePrefix:nil maxBytes:4 * 1024 window:0 maxRecordings:2 error:&error];
+    XCTAssertNotNil(stream);
+    XCTAssertNil(error);
+    stream.postTriggerDuration = 0.1;
+    stream.triggerChannels = [NSSet setWithObject:@"Watchdog"];
+
+    TEST_CHANNEL_ON(@"Flight");
+    TEST_CHANNEL_ON(@"Watchdog");
+
+    // nothing is written until triggered and only the newest log messages fit
+    for (int i = 0; i < TEST_COUNT; i++) {
+        LogStream(stream, TLSLogLevelDebug, @"Flight", @(__FILE__), @(__PRETTY_FUNCTION__), __LINE__, @"debug %d", i);
+    }
+    XCTAssertEqual((NSUInteger)0, stream.recordingFilePaths.count);
+    XCTAssertFalse(stream.isRecording);
+
+    LogStream(stream, TLSLogLevelError, @"Flight", @(__FILE__), @(__PRETTY_FUNCTION__), __LINE__, @"error");
+    LogStream(stream, TLSLogLevelDebug, @"Flight", @(__FILE__), @(__PRETTY_FUNCTION__), __LINE__, @"after error");
+    XCTAssertTrue(stream.isRecording);
+    XCTAssertEqual((NSUInteger)1, stream.recordingFilePaths.count);
+    [stream tls_flush];
+    NSString *recording = [NSString stringWithContentsOfFile:stream.recordingFilePaths.lastObject encoding:NSUTF8StringEncoding error:NULL];
+    XCTAssertTrue([recording containsString:([NSString stringWithFormat:@"debug %d\n", TEST_COUNT - 1])]);
+    XCTAssertFalse([recording containsString:@"debug 0\n"]);
+    XCTAssertTrue([recording containsString:@"error"]);
+    XCTAssertTrue([recording containsString:@"after error"]);
+
+    // the recording ends once past the post trigger duration
+    [NSThread sleepForTimeInterval:0.2];
+    LogStream(stream, TLSLogLevelInformation, @"Flight", @(__FILE__), @(__PRETTY_FUNCTION__), __LINE__, @"between recordings");
+    XCTAssertFalse(stream.isRecording);
+
+    // trigger channels and explicit triggers, pruned to the newest 2 recordings
+    LogStream(stream, TLSLogLevelInformation, @"Watchdog", @(__FILE__), @(__PRETTY_FUNCTION__), __LINE__, @"stall");
+    [NSThread sleepForTimeInterval:0.2];
+    LogStream(stream, TLSLogLevelInformation, @"Flight", @(__FILE__), @(__PRETTY_FUNCTION__), __LINE__, @"after stall");
+    [stream triggerWithReason:@"test"];
+    XCTAssertEqual((NSUInteger)2, stream.recordingFilePaths.count);
+    NSString *stall = [NSString stringWithContentsOfFile:stream.recordingFilePaths.firstObject encoding:NSUTF8StringEncoding error:NULL];
+    XCTAssertTrue([stall containsString:@"between recordings"]);
+    XCTAssertTrue([stall containsString:@"stall"]);
+    NSString *retrieved = [[NSString alloc] initWithData:[stream tls_retrieveLoggedData:NSUIntegerMax] encoding:NSUTF8StringEncoding];
+    XCTAssertTrue([retrieved containsString:@"trigger (test)"]);
+    XCTAssertTrue([retrieved containsString:@"after stall"]);
+
+    // the log messages in memory count against the retrieval budget too, newest first
+    [NSThread sleepForTimeInterval:0.2];
+    for (int i = 0; i < 10; i++) {
+        LogStream(stream, TLSLogLevelDebug, @"Flight", @(__FILE__), @(__PRETTY_FUNCTION__), __LINE__, @"budget %d", i);
+    }
+    XCTAssertFalse(stream.isRecording);
+    NSData *budgeted = [stream tls_retrieveLoggedData:512];
+    XCTAssertLessThanOrEqual(budgeted.length, (NSUInteger)512);
+    retrieved = [[NSString alloc] initWithData:budgeted encoding:NSUTF8StringEncoding];
+    XCTAssertTrue([retrieved containsString:@"budget 9\n"]);
+    XCTAssertFalse([retrieved containsString:@"trigger (test)"]);
+    TEST_CHANNEL_OFF(@"Flight");
+    TEST_CHANNEL_OFF(@"Watchdog");
+
+    // a new stream picks up the existing recordings
+    stream = [[TLSFlightRecorderOutputStream alloc] initWithLogFileDirectoryPath:path logFilePrefix:nil maxBytes:4 * 1024 window:0 maxRecordings:2 error:&error];
+    XCTAssertEqual((NSUInteger)2, stream.recordingFilePaths.count);
+}
+
+- (void)testLoggingThrottle
+{
+    TLSLoggingService *service = [[TLSLoggingService alloc] init];
+    TestLogger *testLogger = [[TestLogger alloc] init];
+    testLogger.shouldFilterChannelsThatAreOff = NO;
+    [service addOutputStream:testLogger];
+    [service dispatchSynchronousTransaction:^{}];
+
+    NSString *sampledChannel = @"Sampled";
+    NSString *limitedChannel = @"Limited";
+    [service setThrottle:[TLSLogThrottle throttleWithSampleInterval:10] forChannel:sampledChannel];
+    [service setThrottle:[TLSLogThrottle throttleWithMaximumMessagesPerSecond:0.001 burst:5] forChannel:limitedChannel];
+
+    NSUInteger sampled = 0;
+    NSUInteger limited = 0;
+    for (int i = 0; i < 100; i++) {
+        if (TLSCanLogCallsite(service, TLSLogLevelError, sampledChannel, nil, TLSLogCurrentCallsite())) {
+            sampled++;
+        }
+        if (TLSCanLogCallsite(service, TLSLogLevelError, limitedChannel, nil, TLSLogCurrentCallsite())) {
+            limited++;
+        }
+    }
+    XCTAssertEqual((NSUInteger)10, sampled);
+    XCTAssertEqual((NSUInteger)5, limited);
+
+    // sampling doesn't end a suppression, only 1 summary per callsite on flush
+    [service flush];
+    XCTAssertEqual((NSUInteger)2, testLogger.loggedMessages);
+
+    [service setThrottle:nil forChannel:limitedChannel];
+    XCTAssertTrue(TLSCanLogCallsite(service, TLSLogLevelError, limitedChannel, nil, TLSLogCurrentCallsite()));
+
+    // callsite throttle
+    limited = 0;
+    [service setThrottle:[TLSLogThrottle throttleWithSampleInterval:1000] forCallsiteFile:@(__FILE__) line:__LINE__ + 2];
+    for (int i = 0; i < 100; i++) {
+        if (TLSCanLogCallsite(service, TLSLogLevelError, limitedChannel, nil, TLSLogCurrentCallsite())) {
+            limited++;
+        }
+    }
+    XCTAssertEqual((NSUInteger)1, limited);
+}
+
+- (void)testLoggingCoalescing
+{
+    TLSLoggingService *service = [[TLSLoggingService alloc] init];
+    service.repeatedMessageCoalescingInterval = 60;
+    TestLogger *testLogger = [[TestLogger alloc] init];
+    testLogger.shouldFilterChannelsThatAreOff = NO;
+    [service addOutputStream:testLogger];
+
+    NSString *channel = @"Coalesced";
+    for (int i = 0; i < TEST_COUNT; i++) {
+        [service logWithLevel:TLSLogLevelError channel:channel file:@(__FILE__) function:@(__PRETTY_FUNCTION__) line:__LINE__ contextObject:nil options:0 message:@"failed"];
+    }
+    [service flush];
+    XCTAssertEqual((NSUInteger)2, testLogger.loggedMessages, @"first message + repeated summary");
+
+    // a different message ends the run
+    for (int i = 0; i < 3; i++) {
+        [service logWithLevel:TLSLogLevelError channel:channel file:@(__FILE__) function:@(__PRETTY_FUNCTION__) line:__LINE__ contextObject:nil options:0 message:@"failed"];
+    }
+    [service logWithLevel:TLSLogLevelError channel:channel file:@(__FILE__) function:@(__PRETTY_FUNCTION__) line:__LINE__ contextObject:nil options:0 message:@"recovered"];
+    [service flush];
+    XCTAssertEqual((NSUInteger)5, testLogger.loggedMessages, @"first message + repeated summary + recovered");
+
+    service.repeatedMessageCoalescingInterval = 0;
+    for (int i = 0; i < TEST_COUNT; i++) {
+        [service logWithLevel:TLSLogLevelError channel:channel file:@(__FILE__) function:@(__PRETTY_FUNCTION__) line:__LINE__ contextObject:nil options:0 message:@"failed"];
+    }
+    [service flush];
+    XCTAssertEqual((NSUInteger)(5 + TEST_COUNT), testLogger.loggedMessages);
+}
+
+- (void)testLoggingBoundedFormat
+{
+    __block NSString *message = nil;
+    TLSLoggingService *service = [[TLSLoggingService alloc] init];
+    TestCallbackLogger *stream = [[TestCallbackLogger alloc] initWithCallback:^(TLSLogMessageInfo *info) {
+        message = info.message;
+    }];
+    [service addOutputStream:stream];
+    service.maximumMessageByteLength = 64;
+
+    NSString *payload = [@"" stringByPaddingToLength:(5 * 1024 * 1024) withString:@"\U0001F600" startingAtIndex:0];
+    TLSLogString(service, TLSLogLevelError, @"Bounded", @(__FILE__), @(__PRETTY_FUNCTION__), __LINE__, nil, 0, payload);
+    [service flush];
+    XCTAssertTrue([message hasSuffix:TLSLogMessageTruncationMarker]);
+    XCTAssertLessThanOrEqual([message lengthOfBytesUsingEncoding:NSUTF8StringEncoding], (NSUInteger)64);
+    NSString *content = [message substringToIndex:message.length - TLSLogMessageTruncationMarker.length];
+    XCTAssertEqual((NSUInteger)0, content.length % 2, @"emoji must not be split");
+    XCTAssertTrue([payload hasPrefix:content]);
+
+    TLSLogEx(service, TLSLogLevelError, @"Bounded", @(__FILE__), @(__PRETTY_FUNCTION__), __LINE__, nil, 0, @"%d %5.2f %s %@ %lu%%", 1, 2.5, "three", @4, 5UL);
+    [service flush];
+    XCTAssertEqualObjects(@"1  2.50 three 4 5%", message);
+
+    TLSLogEx(service, TLSLogLevelError, @"Bounded", @(__FILE__), @(__PRETTY_FUNCTION__), __LINE__, nil, TLSLogMessageOptionsIgnoringMaximumSafeMessageLength, @"%@", payload);
+    [service flush];
+    XCTAssertEqual(payload.length, message.length);
+
+    // growing the buffer for a conversion must not consume its argument again
+    service.maximumMessageByteLength = 4096;
+    TLSLogEx(service, TLSLogLevelError, @"Bounded", @(__FILE__), @(__PRETTY_FUNCTION__), __LINE__, nil, 0, @"%2000d|%d", 1, 2);
+    [service flush];
+    XCTAssertEqual((NSUInteger)2002, message.length);
+    XCTAssertTrue([message hasSuffix:@"1|2"]);
+}
+
+- (void)testLoggingFields
+{
+    __block TLSLogMessageInfo *loggedInfo = nil;
+    TLSLoggingService *service = [[TLSLoggingService alloc] init];
+    [service addOutputStream:[[TestCallbackLogger alloc] initWithCallback:^(TLSLogMessageInfo *info) {
+        loggedInfo = info;
+    }]];
+
+    TLSLogFieldsEx(service, TLSLogLevelError, @"Fields", @(__FILE__), @(__PRETTY_FUNCTION__), __LINE__, nil, 0,
+                   TLSLogFieldList(TLSLogFieldInteger("status", 503),
+                                   TLSLogFieldDouble("elapsed", 0.25),
+                                   TLSLogFieldBool("retry", YES),
+                                   TLSLogFieldCString("host", "api.twitter.com"),
+                                   TLSLogFieldString("reason", @"service unavailable, try again later")),
+                   @"request %@", @"failed");
+    [service flush];
+
+    XCTAssertEqualObjects(@"request failed", loggedInfo.message);
+    XCTAssertEqual((NSUInteger)5, loggedInfo.fieldCount);
+    XCTAssertEqual(TLSLogFieldTypeInteger, loggedInfo.fields[0].type);
+    XCTAssertEqual(503, loggedInfo.fields[0].value.integerValue);
+    XCTAssertEqual(0, strcmp("host", loggedInfo.fields[3].key));
+    XCTAssertEqual((size_t)TLSLogFieldStringCapacity, strlen(loggedInfo.fields[4].value.stringValue), @"long strings are truncated");
+
+    __block NSUInteger enumerated = 0;
+    [loggedInfo enumerateFieldsUsingBlock:^(const TLSLogField *field, BOOL *stop) {
+        enumerated++;
+        *stop = (TLSLogFieldTypeBool == field->type);
+    }];
+    XCTAssertEqual((NSUInteger)3, enumerated);
+
+    NSString *text = [loggedInfo composeFormattedMessageWithOptions:TLSComposeLogMessageInfoNoOptions];
+    XCTAssertEqualObjects(@" : request failed status=503 elapsed=0.25 retry=true host=api.twitter.com reason=\"service unavailable, tr\"", text);
+
+    // doubles round trip and string values stay on one line
+    TLSLogFieldsEx(service, TLSLogLevelError, @"Fields", @(__FILE__), @(__PRETTY_FUNCTION__), __LINE__, nil, 0,
+                   TLSLogFieldList(TLSLogFieldDouble("ratio", 0.1 + 0.2),
+                                   TLSLogFieldCString("body", "a\nb\t\"c\"\x01")),
+                   @"parsed");
+    [service flush];
+    text = [loggedInfo composeFormattedMessageWithOptions:TLSComposeLogMessageInfoNoOptions];
+    XCTAssertEqualObjects(@" : parsed ratio=0.30000000000000004 body=\"a\\nb\\t\\\"c\\\"\\u0001\"", text);
+}
+
+- (void)testLoggingJSONLines
+{
+    NSString *path = [[TLSFileOutputStream defaultLogFileDirectoryPath] stringByAppendingPathComponent:@"TLSLoggingJSONLines"];
+    [[NSFileManager defaultManager] removeItemAtPath:path error:NULL];
+    [[NSFileManager defaultManager] createDirectoryAtPath:path withIntermediateDirectories:YES attributes:nil error:NULL];
+    NSError *error = nil;
+    TLSJSONLinesFileOutputStream *jsonStream = [[TLSJSONLinesFileOutputStream alloc] initWithLogFileDirectoryPath:path logFileName:@"log.jsonl" error:&error];
+    XCTAssertNil(error);
+    TLSFileOutputStream *textStream = [[TLSFileOutputStream alloc] initWithLogFileDirectoryPath:path logFileName:@"log.txt" error:&error];
+    XCTAssertNil(error);
+
+    NSString *tricky = @"\"quoted\" back\\slash\ttab\nnewline \x01 café \U0001F600 and a long clean run of plain ascii text";
+    const NSUInteger count = TEST_COUNT * 10;
+    TEST_CHANNEL_ON(@"JSON");
+
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    for (NSUInteger i = 0; i < count; i++) {
+        LogStream(textStream, TLSLogLevelWarning, @"JSON", @(__FILE__), @(__PRETTY_FUNCTION__), __LINE__, @"%tu %@", i, tricky);
+    }
+    [textStream tls_flush];
+    const CFAbsoluteTime textDuration = CFAbsoluteTimeGetCurrent() - start;
+
+    start = CFAbsoluteTimeGetCurrent();
+    for (NSUInteger i = 0; i < count; i++) {
+        LogStream(jsonStream, TLSLogLevelWarning, @"JSON", @(__FILE__), @(__PRETTY_FUNCTION__), __LINE__, @"%tu %@", i, tricky);
+    }
+    [jsonStream tls_flush];
+    const CFAbsoluteTime jsonDuration = CFAbsoluteTimeGetCurrent() - start;
+    TEST_CHANNEL_OFF(@"JSON");
+    NSLog(@"%tu messages: text %f s (%.0f msg/s), JSON Lines %f s (%.0f msg/s)", count, textDuration, count / textDuration, jsonDuration, count / jsonDuration);
+
+    NSString *contents = [NSString stringWithContentsOfFile:jsonStream.logFilePath encoding:NSUTF8StringEncoding error:NULL];
+    NSArray<NSString *> *lines = [contents componentsSeparatedByString:@"\n"];
+    XCTAssertEqual(count + 1, lines.count, @"one line per message and a trailing newline");
+    [lines enumerateObjectsUsingBlock:^(NSString *line, NSUInteger idx, BOOL *stop) {
+        if (idx == count) {
+            XCTAssertEqual((NSUInteger)0, line.length);
+            return;
+        }
+        NSDictionary *object = [NSJSONSerialization JSONObjectWithData:[line dataUsingEncoding:NSUTF8StringEncoding] options:0 error:NULL];
+        XCTAssertEqualObjects(([NSString stringWithFormat:@"%tu %@", idx, tricky]), object[@"message"]);
+        XCTAssertEqualObjects(@"warning", object[@"level"]);
+        XCTAssertEqualObjects(@"JSON", object[@"channel"]);
+        XCTAssertEqualObjects(TLSCurrentThreadName(), object[@"thread"]);
+        XCTAssertGreaterThan([object[@"lifespan"] doubleValue], 0.0);
+        XCTAssertNil(object[@"fields"]);
+        *stop = (idx > 10);
+    }];
+
+    [jsonStream resetAndReturnError:NULL];
+    TLSLoggingService *service = [[TLSLoggingService alloc] init];
+    [service addOutputStream:jsonStream];
+    TLSLogFieldsEx(service, TLSLogLevelError, @"JSON", @(__FILE__), @(__PRETTY_FUNCTION__), __LINE__, nil, 0,
+                   TLSLogFieldList(TLSLogFieldInteger("status", 503),
+                                   TLSLogFieldDouble("elapsed", 0.1),
+                                   TLSLogFieldBool("retry", NO),
+                                   TLSLogFieldCString("host", "api.\"twitter\".com")),
+                   @"request failed");
+    [service flush];
+    contents = [NSString stringWithContentsOfFile:jsonStream.logFilePath encoding:NSUTF8StringEncoding error:NULL];
+    NSDictionary *object = [NSJSONSerialization JSONObjectWithData:[contents dataUsingEncoding:NSUTF8StringEncoding] options:0 error:NULL];
+    NSDictionary *expectedFields = @{ @"status" : @503, @"elapsed" : @0.1, @"retry" : @NO, @"host" : @"api.\"twitter\".com" };
+    XCTAssertEqualObjects(expectedFields, object[@"fields"]);
+
+    [[NSFileManager defaultManager] removeItemAtPath:path error:NULL];
+}
+
+- (void)testLoggingMetrics
+{
+    TLSLoggingService *service = [[TLSLoggingService alloc] init];
+    TestLogger *testLogger = [[TestLogger alloc] init];
+    testLogger.shouldFilterChannelsThatAreOff = NO;
+    testLogger.permittedLoggingLevels = TLSLogLevelMaskError;
+    [service addOutputStream:testLogger];
+
+    NSString *channel = @"Metrics";
+    for (int i = 0; i < 10; i++) {
+        [service logWithLevel:TLSLogLevelError channel:channel file:@(__FILE__) function:@(__PRETTY_FUNCTION__) line:__LINE__ contextObject:nil options:0 message:@"error %d", i];
+    }
+    for (int i = 0; i < 5; i++) {
+        [service logWithLevel:TLSLogLevelWarning channel:channel file:@(__FILE__) function:@(__PRETTY_FUNCTION__) line:__LINE__ contextObject:nil options:0 message:@"warning %d", i];
+    }
+    [service flush];
+    const BOOL canLogWarning = TLSCanLog(service, TLSLogLevelWarning, channel, nil);
+
+    TLSLoggingMetrics *metrics = [service metricsSnapshot];
+    XCTAssertEqual(15ULL, metrics.submittedCount);
+    XCTAssertEqual(10ULL, metrics.outputCount);
+    XCTAssertEqual(5ULL, metrics.streamFilteredCount);
+    XCTAssertEqual(0ULL, metrics.droppedCount);
+    XCTAssertEqual(canLogWarning ? 0ULL : 1ULL, metrics.canLogFilteredCount);
+    XCTAssertEqual((NSUInteger)0, metrics.transactionQueueDepth);
+    XCTAssertEqual((NSUInteger)0, metrics.loggingQueueDepth);
+    XCTAssertEqual(15ULL, metrics.transactionLatency.count);
+    XCTAssertEqual((NSUInteger)1, metrics.streamMetrics.count);
+    TLSOutputStreamMetrics *streamMetrics = metrics.streamMetrics.firstObject;
+    XCTAssertEqual((id)testLogger, (id)streamMetrics.stream);
+    XCTAssertEqual(10ULL, streamMetrics.outputCount);
+    XCTAssertEqual(5ULL, streamMetrics.filteredCount);
+    XCTAssertEqual(10ULL, streamMetrics.outputDuration.count);
+    XCTAssertGreaterThan([streamMetrics.outputDuration durationAtPercentile:0.99], 0);
+    XCTAssertEqualObjects(@{}, streamMetrics.counters);
+
+    // file output streams report their own counters
+    NSString *directory = [NSTemporaryDirectory() stringByAppendingPathComponent:[NSUUID UUID].UUIDString];
+    TLSFileOutputStream *fileStream = [[TLSFileOutputStream alloc] initWithLogFileDirectoryPath:directory logFileName:@"metrics.log" error:NULL];
+    XCTAssertNotNil(fileStream);
+    [service addOutputStream:fileStream];
+    [service logWithLevel:TLSLogLevelError channel:channel file:@(__FILE__) function:@(__PRETTY_FUNCTION__) line:__LINE__ contextObject:nil options:0 message:@"to file"];
+    [service flush];
+    for (TLSOutputStreamMetrics *fileStreamMetrics in [service metricsSnapshot].streamMetrics) {
+        if (fileStreamMetrics.stream == fileStream) {
+            XCTAssertEqual(1ULL, fileStreamMetrics.outputCount);
+            XCTAssertGreaterThan(fileStreamMetrics.counters[TLSOutputStreamMetricBytesWritten].unsignedLongLongValue, 0ULL);
+            XCTAssertGreaterThan(fileStreamMetrics.counters[TLSOutputStreamMetricFlushes].unsignedLongLongValue, 0ULL);
+        }
+    }
+
+    // periodic reporting
+    XCTestExpectation *expectation = [self expectationWithDescription:@"metrics reported"];
+    expectation.assertForOverFulfill = NO;
+    TestServiceDelegate *delegate = [[TestServiceDelegate alloc] init];
+    delegate.metricsCallback = ^(TLSLoggingMetrics *reportedMetrics) {
+        if (reportedMetrics.submittedCount == 16) {
+            [expectation fulfill];
+        }
+    };
+    service.delegate = delegate;
+    service.metricsReportingInterval = 0.05;
+    [self waitForExpectationsWithTimeout:5.0 handler:NULL];
+    service.metricsReportingInterval = 0;
+    XCTAssertEqual(0.0, service.metricsReportingInterval);
+
+    [service removeOutputStream:fileStream];
+    [service flush];
+    XCTAssertEqual((NSUInteger)1, [service metricsSnapshot].streamMetrics.count);
+    [[NSFileManager defaultManager] removeItemAtPath:directory error:NULL];
+}
+
+- (void)testLoggingSlowStreamIsolation
+{
+    TLSLoggingService *service = [[TLSLoggingService alloc] init];
+    service.outputStreamLatencyBudget = 0.001;
+    service.isolatedOutputStreamBufferCount = 4;
+    TestLogger *fastLogger = [[TestLogger alloc] init];
+    fastLogger.shouldFilterChannelsThatAreOff = NO;
+    TestCallbackLogger *slowLogger = [[TestCallbackLogger alloc] initWithCallback:^(TLSLogMessageInfo *info) {
+        [NSThread sleepForTimeInterval:0.005];
+    }];
+    [service addOutputStream:fastLogger];
+    [service addOutputStream:slowLogger];
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"slow stream isolated"];
+    TestServiceDelegate *delegate = [[TestServiceDelegate alloc] init];
+    delegate.isolationCallback = ^(id<TLSOutputStream> stream) {
+        XCTAssertEqual((id)slowLogger, (id)stream);
+        [expectation fulfill];
+    };
+    service.delegate = delegate;
+
+    const NSUInteger count = 100;
+    for (NSUInteger i = 0; i < count; i++) {
+        [service logWithLevel:TLSLogLevelError channel:@"Isolation" file:@(__FILE__) function:@(__PRETTY_FUNCTION__) line:__LINE__ contextObject:nil options:0 message:@"message %tu", i];
+    }
+    [self waitForExpectationsWithTimeout:5.0 handler:NULL];
+    [service flush];
+
+    // the fast stream kept up, the slow stream dropped what didn't fit in its buffer
+    XCTAssertEqual(count, fastLogger.loggedMessages);
+    for (TLSOutputStreamMetrics *streamMetrics in [service metricsSnapshot].streamMetrics) {
+        if (streamMetrics.stream == slowLogger) {
+            XCTAssertTrue(streamMetrics.isIsolated);
+            XCTAssertGreaterThan(streamMetrics.droppedCount, 0ULL);
+            XCTAssertEqual((uint64_t)count, streamMetrics.outputCount + streamMetrics.droppedCount);
+        } else {
+            XCTAssertFalse(streamMetrics.isIsolated);
+            XCTAssertEqual(0ULL, streamMetrics.droppedCount);
+        }
+    }
+}
+
+- (void)testLoggingLaunchCapture
+{
+    TLSLoggingService *service = [[TLSLoggingService alloc] init];
+    [service beginLaunchCaptureWithCapacity:10];
+
+    NSString *channel = @"Launch";
+    XCTAssertTrue(TLSCanLog(service, TLSLogLevelError, channel, nil));
+    for (int i = 0; i < 15; i++) {
+        [service logWithLevel:TLSLogLevelError channel:channel file:@(__FILE__) function:@(__PRETTY_FUNCTION__) line:__LINE__ contextObject:nil options:0 message:@"%d", i];
+    }
+    [service dispatchSynchronousTransaction:^{}];
+    NSDate *addedTimestamp = [NSDate date];
+
+    NSMutableArray<TLSLogMessageInfo *> *firstInfos = [[NSMutableArray alloc] init];
+    NSMutableArray<TLSLogMessageInfo *> *secondInfos = [[NSMutableArray alloc] init];
+    NSMutableArray<TLSLogMessageInfo *> *lateInfos = [[NSMutableArray alloc] init];
+    [service addOutputStream:[[TestCallbackLogger alloc] initWithCallback:^(TLSLogMessageInfo *info) {
+        [firstInfos addObject:info];
+    }]];
+    [service flush];
+    [service addOutputStream:[[TestCallbackLogger alloc] initWithCallback:^(TLSLogMessageInfo *info) {
+        [secondInfos addObject:info];
+    }]];
+    [service flush];
+
+    // the first 10 log messages, in order, with their original timestamps
+    for (NSArray<TLSLogMessageInfo *> *infos in @[firstInfos, secondInfos]) {
+        XCTAssertEqual((NSUInteger)10, infos.count);
+        [infos enumerateObjectsUsingBlock:^(TLSLogMessageInfo *info, NSUInteger idx, BOOL *stop) {
+            XCTAssertEqualObjects(([NSString stringWithFormat:@"%tu", idx]), info.message);
+            XCTAssertLessThan([info.timestamp timeIntervalSinceDate:addedTimestamp], 0);
+        }];
+    }
+
+    [service endLaunchCapture];
+    [service addOutputStream:[[TestCallbackLogger alloc] initWithCallback:^(TLSLogMessageInfo *info) {
+        [lateInfos addObject:info];
+    }]];
+    [service flush];
+    XCTAssertEqual((NSUInteger)0, lateInfos.count);
+
+    // a stream removed and added again is only replayed what it missed
+    service = [[TLSLoggingService alloc] init];
+    [service beginLaunchCaptureWithCapacity:10];
+    NSMutableArray<TLSLogMessageInfo *> *readdedInfos = [[NSMutableArray alloc] init];
+    TestCallbackLogger *readdedStream = [[TestCallbackLogger alloc] initWithCallback:^(TLSLogMessageInfo *info) {
+        [readdedInfos addObject:info];
+    }];
+    for (int i = 0; i < 3; i++) {
+        [service logWithLevel:TLSLogLevelError channel:channel file:@(__FILE__) function:@(__PRETTY_FUNCTION__) line:__LINE__ contextObject:nil options:0 message:@"%d", i];
+    }
+    [service addOutputStream:readdedStream];
+    [service flush];
+    XCTAssertEqual((NSUInteger)3, readdedInfos.count);
+    [service removeOutputStream:readdedStream];
+    for (int i = 3; i < 5; i++) {
+        [service logWithLevel:TLSLogLevelError channel:channel file:@(__FILE__) function:@(__PRETTY_FUNCTION__) line:__LINE__ contextObject:nil options:0 message:@"%d", i];
+    }
+    [service addOutputStream:readdedStream];
+    [service flush];
+    [service removeOutputStream:readdedStream];
+    [service addOutputStream:readdedStream];
+    [service flush];
+    XCTAssertEqual((NSUInteger)5, readdedInfos.count);
+    [readdedInfos enumerateObjectsUsingBlock:^(TLSLogMessageInfo *info, NSUInteger idx, BOOL *stop) {
+        XCTAssertEqualObjects(([NSString stringWithFormat:@"%tu", idx]), info.message);
+    }];
+    [service endLaunchCapture];
+}
+
+- (void)testLoggingPriorityLane
+{
+    TLSLoggingService *service = [[TLSLoggingService alloc] init];
+    service.priorityLaneEnabled = YES;
+    dispatch_semaphore_t backlogSemaphore = dispatch_semaphore_create(0);
+    NSMutableArray<TLSLogMessageInfo *> *infos = [[NSMutableArray alloc] init];
+    [service addOutputStream:[[TestCallbackLogger alloc] initWithCallback:^(TLSLogMessageInfo *info) {
+        if (0 == infos.count) {
+            // hold the logging queue until the backlog has built up
+            dispatch_semaphore_wait(backlogSemaphore, DISPATCH_TIME_FOREVER);
+        }
+        [infos addObject:info];
+    }]];
+
+    NSString *channel = @"Priority";
+    for (int i = 0; i < TEST_COUNT; i++) {
+        [service logWithLevel:TLSLogLevelInformation channel:channel file:@(__FILE__) function:@(__PRETTY_FUNCTION__) line:__LINE__ contextObject:nil options:0 message:@"backlog %d", i];
+    }
+    [service logWithLevel:TLSLogLevelError channel:channel file:@(__FILE__) function:@(__PRETTY_FUNCTION__) line:__LINE__ contextObject:nil options:0 message:@"error"];
+    [service dispatchSynchronousTransaction:^{}];
+    dispatch_semaphore_signal(backlogSemaphore);
+    [service flush];
+
+    // the error overtook the backlog still waiting behind the first message
+    XCTAssertEqual((NSUInteger)(TEST_COUNT + 1), infos.count);
+    TLSLogMessageInfo *errorInfo = infos[1];
+    XCTAssertEqual(TLSLogLevelError, errorInfo.level);
+    XCTAssertEqual((uint64_t)(TEST_COUNT + 1), errorInfo.sequenceNumber);
+    XCTAssertTrue([[errorInfo composeFormattedMessageWithOptions:TLSComposeLogMessageInfoLogSequenceNumber] hasPrefix:([NSString stringWithFormat:@"[#%d]", TEST_COUNT + 1])]);
+    uint64_t lastSequenceNumber = 0;
+    for (TLSLogMessageInfo *info in infos) {
+        if (info != errorInfo) {
+            XCTAssertGreaterThan(info.sequenceNumber, lastSequenceNumber);
+            lastSequenceNumber = info.sequenceNumber;
+        }
+    }
+}
+
+- (void)testLoggingLoadShedding
+{
+    TLSLoggingService *service = [[TLSLoggingService alloc] init];
+    service.loadSheddingBacklogThreshold = 10;
+    dispatch_semaphore_t backlogSemaphore = dispatch_semaphore_create(0);
+    NSMutableArray<TLSLogMessageInfo *> *infos = [[NSMutableArray alloc] init];
+    [service addOutputStream:[[TestCallbackLogger alloc] initWithCallback:^(TLSLogMessageInfo *info) {
+        if (0 == infos.count) {
+            // hold the logging queue until the backlog has built up
+            dispatch_semaphore_wait(backlogSemaphore, DISPATCH_TIME_FOREVER);
+        }
+        [infos addObject:info];
+    }]];
+
+    NSString *channel = @"Shedding";
+    for (int i = 0; i < TEST_COUNT; i++) {
+        [service logWithLevel:TLSLogLevelInformation channel:channel file:@(__FILE__) function:@(__PRETTY_FUNCTION__) line:__LINE__ contextObject:nil options:0 message:@"backlog %d", i];
+    }
+    [service dispatchSynchronousTransaction:^{}];
+
+    // shedding below warnings until the backlog clears
+    XCTAssertFalse(TLSCanLog(service, TLSLogLevelInformation, channel, nil));
+    XCTAssertTrue(TLSCanLog(service, TLSLogLevelError, channel, nil));
+    [service logWithLevel:TLSLogLevelError channel:channel file:@(__FILE__) function:@(__PRETTY_FUNCTION__) line:__LINE__ contextObject:nil options:0 message:@"error"];
+    dispatch_semaphore_signal(backlogSemaphore);
+    [service flush];
+    // the transition logged once the backlog cleared
+    [service flush];
+    XCTAssertTrue(TLSCanLog(service, TLSLogLevelInformation, channel, nil));
+
+    NSMutableArray<NSString *> *transitions = [[NSMutableArray alloc] init];
+    NSUInteger backlogCount = 0;
+    BOOL loggedError = NO;
+    for (TLSLogMessageInfo *info in infos) {
+        if ([info.channel isEqualToString:TLSLoggingServiceChannel]) {
+            XCTAssertEqual(TLSLogLevelWarning, info.level);
+            [transitions addObject:info.message];
+        } else if (TLSLogLevelError == info.level) {
+            loggedError = YES;
+        } else {
+            backlogCount++;
+        }
+    }
+    XCTAssertTrue(loggedError);
+    XCTAssertEqual((NSUInteger)2, transitions.count);
+    XCTAssertTrue([transitions.firstObject hasPrefix:@"load shedding started"]);
+    XCTAssertTrue([transitions.lastObject hasPrefix:@"load shedding ended"]);
+
+    TLSLoggingMetrics *metrics = [service metricsSnapshot];
+    XCTAssertGreaterThan(metrics.shedCount, 0ULL);
+    XCTAssertEqual((uint64_t)TEST_COUNT, backlogCount + metrics.shedCount - 1 /* the TLSCanLog check */);
+}
+
+- (void)testLoggingSharedMemoryRing
+{
+    NSString *directory = [[TLSFileOutputStream defaultLogFileDirectoryPath] stringByAppendingPathComponent:@"TLSLoggingSharedMemory"];
+    [[NSFileManager defaultManager] removeItemAtPath:directory error:NULL];
+    [[NSFileManager defaultManager] createDirectoryAtPath:directory withIntermediateDirectories:YES attributes:nil error:NULL];
+    NSString *ringFilePath = [directory stringByAppendingPathComponent:@"shared.ring"];
+
+    // the producing "process"
+    NSError *error = nil;
+    TLSLoggingService *producerService = [[TLSLoggingService alloc] init];
+    TLSSharedMemoryOutputStream *producer = [[TLSSharedMemoryOutputStream alloc] initWithRingFilePath:ringFilePath cellSize:256 cellCount:64 error:&error];
+    XCTAssertNotNil(producer);
+    XCTAssertNil(error);
+    [producerService addOutputStream:producer];
+
+    // the writer "process"
+    TLSLoggingService *writerService = [[TLSLoggingService alloc] init];
+    NSMutableArray<TLSLogMessageInfo *> *infos = [[NSMutableArray alloc] init];
+    [writerService addOutputStream:[[TestCallbackLogger alloc] initWithCallback:^(TLSLogMessageInfo *info) {
+        [infos addObject:info];
+    }]];
+    TLSSharedMemoryLogDrain *drain = [[TLSSharedMemoryLogDrain alloc] initWithRingFilePath:ringFilePath cellSize:0 cellCount:0 loggingService:writerService error:&error];
+    XCTAssertNotNil(drain);
+    XCTAssertNil(error);
+    XCTAssertNil([[TLSSharedMemoryLogDrain alloc] initWithRingFilePath:ringFilePath cellSize:0 cellCount:0 loggingService:writerService error:&error]);
+    XCTAssertEqual(EWOULDBLOCK, error.code);
+
+    NSString *channel = @"Shared";
+    for (int i = 0; i < 10; i++) {
+        [producerService logWithLevel:TLSLogLevelWarning channel:channel file:@(__FILE__) function:@(__PRETTY_FUNCTION__) line:__LINE__ contextObject:nil options:0 message:@"shared %d", i];
+    }
+    NSString *longMessage = [@"" stringByPaddingToLength:1000 withString:@"x" startingAtIndex:0];
+    [producerService logWithLevel:TLSLogLevelWarning channel:channel file:@(__FILE__) function:@(__PRETTY_FUNCTION__) line:__LINE__ contextObject:nil options:0 message:@"%@", longMessage];
+    [producerService flush];
+
+    XCTAssertEqual((NSUInteger)11, [drain drain]);
+    XCTAssertEqual((NSUInteger)0, [drain drain]);
+    [writerService flush];
+
+    // in order, with the producer's process identifier, truncated to fit the ring
+    XCTAssertEqual((NSUInteger)11, infos.count);
+    for (int i = 0; i < 10; i++) {
+        TLSLogMessageInfo *info = infos[(NSUInteger)i];
+        XCTAssertEqualObjects(([NSString stringWithFormat:@"shared %d", i]), info.message);
+        XCTAssertEqualObjects(channel, info.channel);
+        XCTAssertEqual(TLSLogLevelWarning, info.level);
+        XCTAssertEqual(getpid(), info.processIdentifier);
+        XCTAssertTrue([[info composeFormattedMessage] containsString:([NSString stringWithFormat:@"[pid:%d]", getpid()])]);
+    }
+    XCTAssertGreaterThan(infos.lastObject.message.length, (NSUInteger)0);
+    XCTAssertLessThan(infos.lastObject.message.length, longMessage.length);
+
+    // a full ring drops rather than blocks
+    for (int i = 0; i < 100; i++) {
+        [producerService logWithLevel:TLSLogLevelWarning channel:channel file:@(__FILE__) function:@(__PRETTY_FUNCTION__) line:__LINE__ contextObject:nil options:0 message:@"overflow %d", i];
+    }
+    [producerService flush];
+    XCTAssertEqual((NSUInteger)64, [drain drain]);
+    XCTAssertEqual((uint64_t)36, drain.droppedCount);
+}
+
+- (void)testLoggingRedaction
+{
+    TLSLogRedactor *redactor = [[TLSLogRedactor alloc] initWithLiterals:@[ @"hunter2" ]
+                                                                   keys:@[ @"token=", @"password:" ]
+                                                           tokenClasses:TLSLogRedactionTokenClassesAll
+                                                        caseInsensitive:YES
+                                                            replacement:@"***"];
+    XCTAssertNil([redactor redactedString:@"nothing to see here, 12345"]);
+    XCTAssertEqualObjects(@"GET /a?TOKEN=***&b=1", [redactor redactedString:@"GET /a?TOKEN=abc&b=1"]);
+    XCTAssertEqualObjects(@"login *** with password: \"***\"", [redactor redactedString:@"login jane.doe+x@example.co.uk with password: \"hunter2\""]);
+    XCTAssertEqualObjects(@"user *** said *** ✓", [redactor redactedString:@"user 1234567890 said hunter2 ✓"]);
+    XCTAssertEqualObjects(@"bearer ***", [redactor redactedString:@"bearer a1b2c3d4e5f6g7h8i9j0k1"]);
+    // an embedded NUL does not end the scan
+    XCTAssertEqualObjects(([NSString stringWithFormat:@"a%Cb ***", (unichar)0]), [redactor redactedString:[NSString stringWithFormat:@"a%Cb hunter2", (unichar)0]]);
+
+    TLSLoggingService *service = [[TLSLoggingService alloc] init];
+    NSMutableArray<TLSLogMessageInfo *> *redactedInfos1 = [[NSMutableArray alloc] init];
+    NSMutableArray<TLSLogMessageInfo *> *redactedInfos2 = [[NSMutableArray alloc] init];
+    NSMutableArray<TLSLogMessageInfo *> *infos = [[NSMutableArray alloc] init];
+    TestCallbackLogger *redactedStream1 = [[TestCallbackLogger alloc] initWithCallback:^(TLSLogMessageInfo *info) {
+        [redactedInfos1 addObject:info];
+    }];
+    TestCallbackLogger *redactedStream2 = [[TestCallbackLogger alloc] initWithCallback:^(TLSLogMessageInfo *info) {
+        [redactedInfos2 addObject:info];
+    }];
+    TestCallbackLogger *stream = [[TestCallbackLogger alloc] initWithCallback:^(TLSLogMessageInfo *info) {
+        [infos addObject:info];
+    }];
+    [service addOutputStream:redactedStream1];
+    [service addOutputStream:redactedStream2];
+    [service addOutputStream:stream];
+    [service setRedactor:redactor forOutputStream:redactedStream1];
+    [service setRedactor:redactor forOutputStream:redactedStream2];
+
+    [service logWithLevel:TLSLogLevelWarning channel:@"Redact" file:@(__FILE__) function:@(__PRETTY_FUNCTION__) line:__LINE__ contextObject:nil options:0 message:@"password: hunter2"];
+    [service logWithLevel:TLSLogLevelWarning channel:@"Redact" file:@(__FILE__) function:@(__PRETTY_FUNCTION__) line:__LINE__ contextObject:nil options:0 message:@"clean"];
+    [service flush];
+
+    XCTAssertEqual((NSUInteger)2, redactedInfos1.count);
+    XCTAssertEqual((NSUInteger)2, redactedInfos2.count);
+    XCTAssertEqual((NSUInteger)2, infos.count);
+    XCTAssertEqualObjects(@"password: ***", redactedInfos1[0].message);
+    XCTAssertEqualObjects(@"password: hunter2", infos[0].message);
+    XCTAssertEqual(infos[0].sequenceNumber, redactedInfos1[0].sequenceNumber);
+    // redacted once, shared by the streams
+    XCTAssertEqual(redactedInfos1[0], redactedInfos2[0]);
+    // nothing to redact, nothing copied
+    XCTAssertEqual(infos[1], redactedInfos1[1]);
+
+    // string field values are redacted too, payloads are dropped
+    TLSLogFieldsEx(service, TLSLogLevelWarning, @"Redact", @(__FILE__), @(__PRETTY_FUNCTION__), __LINE__, nil, 0,
+                   TLSLogFieldList(TLSLogFieldInteger("attempt", 1234567),
+                                   TLSLogFieldCString("secret", "hunter2"),
+                                   TLSLogFieldCString("host", "api.twitter.com")),
+                   @"login");
+    const uint8_t bytes[] = { 'h', 'u', 'n', 't', 'e', 'r', '2' };
+    NSData *payload = [NSData dataWithBytes:bytes length:sizeof(bytes)];
+    TLSLogDataEx(service, TLSLogLevelWarning, @"Redact", @(__FILE__), @(__PRETTY_FUNCTION__), __LINE__, nil, 0, payload, @"upload");
+    [service flush];
+
+    XCTAssertEqual((NSUInteger)4, redactedInfos1.count);
+    XCTAssertEqualObjects(@"login", redactedInfos1[2].message);
+    XCTAssertEqual((NSUInteger)3, redactedInfos1[2].fieldCount);
+    XCTAssertEqual(1234567, redactedInfos1[2].fields[0].value.integerValue);
+    XCTAssertEqual(0, strcmp("***", redactedInfos1[2].fields[1].value.stringValue));
+    XCTAssertEqual(0, strcmp("api.twitter.com", redactedInfos1[2].fields[2].value.stringValue));
+    XCTAssertEqual(0, strcmp("hunter2", infos[2].fields[1].value.stringValue));
+    XCTAssertEqualObjects(@"upload", redactedInfos1[3].message);
+    XCTAssertNil(redactedInfos1[3].payload);
+    XCTAssertEqualObjects(@"", [redactedInfos1[3] composePayloadWithEncoding:TLSLogPayloadEncodingHex]);
+    XCTAssertEqual(payload, infos[3].payload);
+
+    [service setRedactor:nil forOutputStream:redactedStream1];
+    [service logWithLevel:TLSLogLevelWarning channel:@"Redact" file:@(__FILE__) function:@(__PRETTY_FUNCTION__) line:__LINE__ contextObject:nil options:0 message:@"password: hunter2"];
+    [service flush];
+    XCTAssertEqualObjects(@"password: hunter2", redactedInfos1[4].message);
+    XCTAssertEqualObjects(@"password: ***", redactedInfos2[4].message);
+}
+
+- (void)testLoggingShipper
+{
+    NSString *directory = [[TLSFileOutputStream defaultLogFileDirectoryPath] stringByAppendingPathComponent:@"TLSLoggingShipper"];
+    [[NSFileManager defaultManager] removeItemAtPath:directory error:NULL];
+    [[NSFileManager defaultManager] createDirectoryAtPath:directory withIntermediateDirectories:YES attributes:nil error:NULL];
+    TestShippingServer *server = [[TestShippingServer alloc] init];
+    XCTAssertNotNil(server);
+
+    NSError *error = nil;
+    TLSRollingFileOutputStream *stream = [[TLSRollingFileOutputStream alloc] initWithLogFileDirectoryPath:directory logFilePrefix:@"ship." maxLogFiles:100 maxBytesPerLogFile:1024 error:&error];
+    XCTAssertNotNil(stream);
+    TLSLoggingService *service = [[TLSLoggingService alloc] init];
+    [service addOutputStream:stream];
+    for (int i = 0; i < 50; i++) {
+        [service logWithLevel:TLSLogLevelWarning channel:@"Shipping" file:@(__FILE__) function:@(__PRETTY_FUNCTION__) line:__LINE__ contextObject:nil options:0 message:@"shipped %d", i];
+    }
+    [service flush];
+
+    TLSLogShipper *(^newShipper)(void) = ^{
+        NSError *shipperError = nil;
+        TLSLogShipper *shipper = [[TLSLogShipper alloc] initWithRollingFileOutputStream:stream loggingService:service endpointURL:server.endpointURL error:&shipperError];
+        XCTAssertNil(shipperError);
+        shipper.maxBatchBytes = 1024;
+        return shipper;
+    };
+    NSError *(^ship)(TLSLogShipper *) = ^(TLSLogShipper *shipper) {
+        __block NSError *shipError = nil;
+        XCTestExpectation *expectation = [self expectationWithDescription:@"shipped"];
+        [shipper shipWithCompletion:^(NSError *completionError) {
+            shipError = completionError;
+            [expectation fulfill];
+        }];
+        [self waitForExpectationsWithTimeout:10.0 handler:NULL];
+        return shipError;
+    };
+
+    // failures don't advance the cursor
+    TLSLogShipper *shipper = newShipper();
+    server.statusCode = 503;
+    XCTAssertNotNil(ship(shipper));
+    XCTAssertEqual((uint64_t)1, shipper.failedAttemptCount);
+    XCTAssertEqual((uint64_t)0, shipper.shippedByteCount);
+
+    server.statusCode = 200;
+    XCTAssertNil(ship(shipper));
+    XCTAssertGreaterThan(shipper.shippedBatchCount, (uint64_t)1);
+
+    // every byte of every log file, once, in order
+    NSMutableData *logged = [[NSMutableData alloc] init];
+    for (NSString *name in [[[NSFileManager defaultManager] contentsOfDirectoryAtPath:directory error:NULL] sortedArrayUsingSelector:@selector(compare:)]) {
+        if ([name.pathExtension isEqualToString:@"log"]) {
+            [logged appendData:[NSData dataWithContentsOfFile:[directory stringByAppendingPathComponent:name]]];
+        }
+    }
+    XCTAssertEqual((uint64_t)logged.length, shipper.shippedByteCount);
+    NSArray<NSDictionary<NSString *, NSString *> *> *requestHeaders = server.requestHeaders;
+    XCTAssertEqualObjects(@"gzip", requestHeaders.lastObject[@"content-encoding"]);
+    XCTAssertNotNil(requestHeaders.lastObject[TLSLogShipperBatchIdHeaderField.lowercaseString]);
+    if (@available(iOS 13.0, macOS 10.15, tvOS 13.0, watchOS 6.0, *)) {
+        NSMutableData *shipped = [[NSMutableData alloc] init];
+        NSArray<NSData *> *bodies = server.bodies;
+        for (NSUInteger i = 1 /* skip the failure */; i < bodies.count; i++) {
+            // strip the gzip header and trailer, the rest is raw deflate
+            NSData *deflated = [bodies[i] subdataWithRange:NSMakeRange(10, bodies[i].length - 18)];
+            [shipped appendData:[deflated decompressedDataUsingAlgorithm:NSDataCompressionAlgorithmZlib error:NULL]];
+        }
+        XCTAssertEqualObjects(logged, shipped);
+    }
+
+    // a restart resumes from the persisted cursor
+    const NSUInteger requestCount = requestHeaders.count;
+    shipper = newShipper();
+    XCTAssertNil(ship(shipper));
+    XCTAssertEqual(requestCount, server.requestHeaders.count);
+    // not flushed, the shipper flushes the service
+    [service logWithLevel:TLSLogLevelWarning channel:@"Shipping" file:@(__FILE__) function:@(__PRETTY_FUNCTION__) line:__LINE__ contextObject:nil options:0 message:@"after restart"];
+    XCTAssertNil(ship(shipper));
+    XCTAssertEqual((uint64_t)1, shipper.shippedBatchCount);
+    XCTAssertLessThan(shipper.shippedByteCount, (uint64_t)1024);
+
+    // a corrupt cursor starts over from the oldest log file
+    XCTAssertTrue([[@"corrupt" dataUsingEncoding:NSUTF8StringEncoding] writeToFile:shipper.cursorFilePath atomically:YES]);
+    shipper = newShipper();
+    XCTAssertNotNil(shipper);
+    XCTAssertNil(ship(shipper));
+    unsigned long long loggedLength = 0;
+    for (NSString *name in [[NSFileManager defaultManager] contentsOfDirectoryAtPath:directory error:NULL]) {
+        if ([name.pathExtension isEqualToString:@"log"]) {
+            loggedLength += [[NSFileManager defaultManager] attributesOfItemAtPath:[directory stringByAppendingPathComponent:name] error:NULL].fileSize;
+        }
+    }
+    XCTAssertEqual((uint64_t)loggedLength, shipper.shippedByteCount);
+
+    // the budget holds batches back
+    [service logWithLevel:TLSLogLevelWarning channel:@"Shipping" file:@(__FILE__) function:@(__PRETTY_FUNCTION__) line:__LINE__ contextObject:nil options:0 message:@"over budget"];
+    [service flush];
+    shipper = newShipper();
+    shipper.networkBudgetBytesPerHour = 1;
+    XCTAssertNil(ship(shipper));
+    [service logWithLevel:TLSLogLevelWarning channel:@"Shipping" file:@(__FILE__) function:@(__PRETTY_FUNCTION__) line:__LINE__ contextObject:nil options:0 message:@"held back"];
+    [service flush];
+    XCTAssertEqual(EDQUOT, ship(shipper).code);
+    XCTAssertEqual((uint64_t)1, shipper.shippedBatchCount);
+
+    [server stop];
+}
+
+- (void)testLoggingIngestionSource
+{
+    TLSLoggingService *service = [[TLSLoggingService alloc] init];
+    NSMutableArray<TLSLogMessageInfo *> *infos = [[NSMutableArray alloc] init];
+    [service addOutputStream:[[TestCallbackLogger alloc] initWithCallback:^(TLSLogMessageInfo *info) {
+        [infos addObject:info];
+    }]];
+
+    int fileDescriptors[2];
+    XCTAssertEqual(0, pipe(fileDescriptors));
+    TLSLogIngestionSource *source = [[TLSLogIngestionSource alloc] initWithFileDescriptor:fileDescriptors[0] loggingService:service];
+    [source start];
+
+    // 1 write holding many records, then a record split across writes
+    NSMutableData *records = [[NSMutableData alloc] init];
+    for (int i = 0; i < 10; i++) {
+        [records appendData:TLSLogIngestionRecordData(TLSLogLevelWarning, @"External", @"producer.c", @"produce", i, nil, [NSString stringWithFormat:@"external %d", i])];
+    }
+    XCTAssertEqual((ssize_t)records.length, write(fileDescriptors[1], records.bytes, records.length));
+    NSData *split = TLSLogIngestionRecordData(TLSLogLevelError, @"External", nil, nil, 0, [NSDate dateWithTimeIntervalSince1970:1000], @"split");
+    XCTAssertEqual((ssize_t)5, write(fileDescriptors[1], split.bytes, 5));
+    [source waitUntilIngested];
+    XCTAssertEqual((ssize_t)split.length - 5, write(fileDescriptors[1], (const uint8_t *)split.bytes + 5, split.length - 5));
+    [source waitUntilIngested];
+    [service flush];
+
+    XCTAssertEqual((uint64_t)11, source.ingestedCount);
+    XCTAssertEqual((NSUInteger)11, infos.count);
+    for (int i = 0; i < 10; i++) {
+        TLSLogMessageInfo *info = infos[(NSUInteger)i];
+        XCTAssertEqualObjects(([NSString stringWithFormat:@"external %d", i]), info.message);
+        XCTAssertEqual(TLSLogLevelWarning, info.level);
+        XCTAssertEqual((NSInteger)i, info.line);
+        XCTAssertEqualObjects(@"produce", info.function);
+        XCTAssertEqual(getpid(), info.processIdentifier);
+        // interned
+        XCTAssertEqual(infos.firstObject.channel, info.channel);
+    }
+    XCTAssertEqualObjects(@"split", infos.lastObject.message);
+    XCTAssertEqual(1000.0, infos.lastObject.timestamp.timeIntervalSince1970);
+
+    // capped like the messages formatted by the service
+    service.maximumMessageByteLength = 32;
+    NSString *longMessage = [@"" stringByPaddingToLength:100 withString:@"x" startingAtIndex:0];
+    NSData *longRecord = TLSLogIngestionRecordData(TLSLogLevelWarning, @"External", nil, nil, 0, nil, longMessage);
+    XCTAssertEqual((ssize_t)longRecord.length, write(fileDescriptors[1], longRecord.bytes, longRecord.length));
+    [source waitUntilIngested];
+    [service flush];
+    XCTAssertEqual((NSUInteger)12, infos.count);
+    XCTAssertLessThanOrEqual([infos.lastObject.message lengthOfBytesUsingEncoding:NSUTF8StringEncoding], (NSUInteger)32);
+    XCTAssertTrue([infos.lastObject.message hasSuffix:TLSLogMessageTruncationMarker]);
+    service.maximumMessageByteLength = 0;
+
+    // a malformed record closes the connection
+    const uint8_t garbage[8] = { 4, 0, 0, 0, 0xff, 0xff, 0xff, 0xff };
+    XCTAssertEqual((ssize_t)sizeof(garbage), write(fileDescriptors[1], garbage, sizeof(garbage)));
+    [source waitUntilIngested];
+    XCTAssertEqual((uint64_t)1, source.malformedCount);
+    XCTAssertEqual((uint64_t)12, source.ingestedCount);
+
+    [source stop];
+    close(fileDescriptors[1]);
+}
+
+- (void)testLoggingContextSnapshots
+{
+    TLSLoggingService *service = [[TLSLoggingService alloc] init];
+    dispatch_semaphore_t backlogSemaphore = dispatch_semaphore_create(0);
+    NSMutableArray<TLSLogMessageInfo *> *infos = [[NSMutableArray alloc] init];
+    [service addOutputStream:[[TestCallbackLogger alloc] initWithCallback:^(TLSLogMessageInfo *info) {
+        if (0 == infos.count) {
+            // hold the logging queue while the log message is in flight
+            dispatch_semaphore_wait(backlogSemaphore, DISPATCH_TIME_FOREVER);
+        }
+        [infos addObject:info];
+    }]];
+    [service flush];
+
+    __weak TestSnapshottingContext *weakContext = nil;
+    @autoreleasepool {
+        TestSnapshottingContext *context = [[TestSnapshottingContext alloc] init];
+        context.identifier = @"screen";
+        weakContext = context;
+        TLSLogEx(service, TLSLogLevelError, @"Snapshot", @(__FILE__), @(__PRETTY_FUNCTION__), __LINE__, context, 0, @"with context");
+    }
+    [service dispatchSynchronousTransaction:^{}];
+
+    // only the snapshot is in flight
+    XCTAssertNil(weakContext);
+    TLSLoggingMetrics *metrics = [service metricsSnapshot];
+    XCTAssertEqual((uint64_t)1, metrics.contextSnapshotCount);
+    XCTAssertGreaterThan(metrics.contextSnapshotByteCost, (uint64_t)0);
+    const uint64_t byteCost = metrics.contextSnapshotByteCost;
+
+    // over budget, logged with a minimal snapshot
+    service.contextSnapshotByteBudget = (NSUInteger)byteCost * 2;
+    TestSnapshottingContext *overBudgetContext = [[TestSnapshottingContext alloc] init];
+    overBudgetContext.identifier = @"over budget";
+    TLSLogEx(service, TLSLogLevelError, @"Snapshot", @(__FILE__), @(__PRETTY_FUNCTION__), __LINE__, overBudgetContext, 0, @"minimal context");
+    [service dispatchSynchronousTransaction:^{}];
+
+    // not even a minimal snapshot fits, dropped
+    service.contextSnapshotByteBudget = (NSUInteger)byteCost + 1;
+    TLSLogEx(service, TLSLogLevelError, @"Snapshot", @(__FILE__), @(__PRETTY_FUNCTION__), __LINE__, overBudgetContext, 0, @"dropped");
+    XCTAssertEqual((uint64_t)1, [service metricsSnapshot].droppedCount);
+    dispatch_semaphore_signal(backlogSemaphore);
+    [service flush];
+
+    @autoreleasepool {
+        XCTAssertEqual((NSUInteger)2, infos.count);
+        TLSLogContextSnapshot *snapshot = infos[0].contextObject;
+        XCTAssertTrue([snapshot isKindOfClass:[TLSLogContextSnapshot class]]);
+        XCTAssertEqualObjects(@"TestSnapshottingContext", snapshot.objectClassName);
+        XCTAssertEqualObjects(@"screen", snapshot.filterKey);
+        XCTAssertEqualObjects(@"screen", snapshot.fields[@"identifier"]);
+        XCTAssertTrue([snapshot.fields[@"date"] isKindOfClass:[NSString class]]);
+        XCTAssertEqual(byteCost, (uint64_t)snapshot.byteCost);
+        TLSLogContextSnapshot *minimalSnapshot = infos[1].contextObject;
+        XCTAssertTrue([minimalSnapshot isKindOfClass:[TLSLogContextSnapshot class]]);
+        XCTAssertEqualObjects(@"TestSnapshottingContext", minimalSnapshot.objectClassName);
+        XCTAssertEqualObjects(@"over budget", minimalSnapshot.filterKey);
+        XCTAssertEqual((NSUInteger)0, minimalSnapshot.fields.count);
+        // the full snapshot of both, then the minimal snapshot of the dropped one
+        XCTAssertEqual((uint64_t)3, [service metricsSnapshot].contextSnapshotDroppedCount);
+        [infos removeAllObjects];
+    }
+
+    // released with the last log message holding it
+    XCTAssertEqual((uint64_t)0, [service metricsSnapshot].contextSnapshotCount);
+    XCTAssertEqual((uint64_t)0, [service metricsSnapshot].contextSnapshotByteCost);
+
+    // log messages built outside of the service are snapshotted too, on a copy
+    service.contextSnapshotByteBudget = 0;
+    NSDate *timestamp = [NSDate date];
+    TLSLogMessageInfo *externalInfo = [[TLSLogMessageInfo alloc] initWithLevel:TLSLogLevelError
+                                                                          file:@(__FILE__)
+                                                                      function:@(__PRETTY_FUNCTION__)
+                                                                          line:__LINE__
+                                                                       channel:@"Snapshot"
+                                                                     timestamp:timestamp
+                                                                   logLifespan:0
+                                                                      threadId:pthread_mach_thread_np(pthread_self())
+                                                                    threadName:TLSCurrentThreadName()
+                                                                 contextObject:overBudgetContext
+                                                                       message:@"external"];
+    [service logMessageInfo:externalInfo];
+    [service flush];
+    XCTAssertEqual((NSUInteger)1, infos.count);
+    XCTAssertNotEqual(externalInfo, infos[0]);
+    XCTAssertEqualObjects(@"external", infos[0].message);
+    XCTAssertTrue([infos[0].contextObject isKindOfClass:[TLSLogContextSnapshot class]]);
+    XCTAssertGreaterThan(infos[0].sequenceNumber, (uint64_t)0);
+    XCTAssertEqual((id)overBudgetContext, externalInfo.contextObject);
+    XCTAssertEqual((uint64_t)0, externalInfo.sequenceNumber);
+}
+
+- (void)testLoggingPayload
+{
+    TLSLoggingService *service = [[TLSLoggingService alloc] init];
+    service.maximumSafeMessageLength = 24;
+    NSMutableArray<TLSLogMessageInfo *> *infos = [[NSMutableArray alloc] init];
+    [service addOutputStream:[[TestCallbackLogger alloc] initWithCallback:^(TLSLogMessageInfo *info) {
+        [infos addObject:info];
+    }]];
+
+    const uint8_t bytes[] = { 0x00, 0x01, 0xab, 0xcd, 0xef, 0x10, 0x00, 0x01, 0xab, 0xcd, 0xef, 0x10 };
+    NSData *payload = [NSData dataWithBytes:bytes length:sizeof(bytes)];
+    TLSLogDataEx(service, TLSLogLevelError, @"Payload", @(__FILE__), @(__PRETTY_FUNCTION__), __LINE__, nil, 0, payload, @"cap");
+    TLSLogDataEx(service, TLSLogLevelError, @"Payload", @(__FILE__), @(__PRETTY_FUNCTION__), __LINE__, nil, TLSLogMessageOptionsIgnoringMaximumSafeMessageLength, payload, @"uncapped");
+    TLSLogDataEx(service, TLSLogLevelError, @"Payload", @(__FILE__), @(__PRETTY_FUNCTION__), __LINE__, nil, 0, payload, @"only mark");
+    TLSLogDataEx(service, TLSLogLevelError, @"Payload", @(__FILE__), @(__PRETTY_FUNCTION__), __LINE__, nil, 0, payload, @"the message takes it all");
+    [service flush];
+
+    XCTAssertEqual((NSUInteger)4, infos.count);
+
+    // held by reference, rendered (marker included) within what the message leaves of the maximum safe length
+    XCTAssertEqual(payload, infos[0].payload);
+    XCTAssertEqual((NSUInteger)21, infos[0].maximumPayloadRenderedLength);
+    XCTAssertEqualObjects(@"0001abcd...(+8 bytes)", [infos[0] composePayloadWithEncoding:TLSLogPayloadEncodingHex]);
+    XCTAssertEqualObjects(@"AAGrze8QAAGrze8Q", [infos[0] composePayloadWithEncoding:TLSLogPayloadEncodingBase64]);
+    XCTAssertEqualObjects(@" : cap payload=<12 bytes>", [infos[0] composeFormattedMessageWithOptions:TLSComposeLogMessageInfoNoOptions]);
+
+    XCTAssertEqual((NSUInteger)0, infos[1].maximumPayloadRenderedLength);
+    XCTAssertEqualObjects(@"0001abcdef100001abcdef10", [infos[1] composePayloadWithEncoding:TLSLogPayloadEncodingHex]);
+    XCTAssertEqualObjects(@" : uncapped payload=AAGrze8QAAGrze8Q", [infos[1] composeFormattedMessageWithOptions:TLSComposeLogMessageInfoLogPayloadAsBase64]);
+
+    // only the marker fits
+    XCTAssertEqual((NSUInteger)15, infos[2].maximumPayloadRenderedLength);
+    XCTAssertEqualObjects(@"...(+12 bytes)", [infos[2] composePayloadWithEncoding:TLSLogPayloadEncodingHex]);
+    XCTAssertEqualObjects(@"...(+12 bytes)", [infos[2] composePayloadWithEncoding:TLSLogPayloadEncodingBase64]);
+
+    // the message takes it all, not even the marker fits
+    XCTAssertEqual((NSUInteger)1, infos[3].maximumPayloadRenderedLength);
+    XCTAssertEqualObjects(@"", [infos[3] composePayloadWithEncoding:TLSLogPayloadEncodingHex]);
+}
+
+- (void)testLoggingEmergencyLog
+{
+    NSString *path = [[TLSFileOutputStream defaultLogFileDirectoryPath] stringByAppendingPathComponent:@"TLSLoggingEmergencyLog"];
+    [[NSFileManager defaultManager] removeItemAtPath:path error:NULL];
+    [[NSFileManager defaultManager] createDirectoryAtPath:path withIntermediateDirectories:YES attributes:nil error:NULL];
+    NSError *error = nil;
+    TLSFileOutputStream *stdioStream = [[TLSFileOutputStream alloc] initWithLogFileDirectoryPath:path logFileName:@"stdio.log" error:&error];
+    XCTAssertNil(error);
+    TLSFileOutputStream *asyncStream = [[TLSFileOutputStream alloc] initWithLogFileDirectoryPath:path logFileName:@"async.log" error:&error];
+    XCTAssertNil(error);
+    asyncStream.asynchronousWriteBufferSize = 16 * 1024;
+    TLSEmergencyLog *emergencyLog = [[TLSEmergencyLog alloc] initWithFilePath:[path stringByAppendingPathComponent:@"emergency.log"] error:&error];
+    XCTAssertNil(error);
+    XCTAssertTrue([emergencyLog addFileOutputStream:stdioStream]);
+    XCTAssertTrue([emergencyLog addFileOutputStream:asyncStream]);
+
+    // buffered, not flushed
+    [stdioStream writeString:@"in the stdio buffer\n"];
+    [asyncStream writeString:@"in the active buffer\n"];
+    XCTAssertEqualObjects(@"", [NSString stringWithContentsOfFile:stdioStream.logFilePath encoding:NSUTF8StringEncoding error:NULL]);
+    XCTAssertEqualObjects(@"", [NSString stringWithContentsOfFile:asyncStream.logFilePath encoding:NSUTF8StringEncoding error:NULL]);
+
+    XCTAssertEqual(0, TLSEmergencyLogWriteRecord(emergencyLog, TLSLogLevelEmergency, "Crash", "SIGSEGV"));
+    size_t bytesDumped = 0;
+    XCTAssertEqual(0, TLSEmergencyLogDumpUnflushedOutput(emergencyLog, &bytesDumped));
+    XCTAssertEqual(strlen("in the stdio buffer\n") + strlen("in the active buffer\n"), bytesDumped);
+
+    XCTAssertEqualObjects(@"in the stdio buffer\n", [NSString stringWithContentsOfFile:stdioStream.logFilePath encoding:NSUTF8StringEncoding error:NULL]);
+    XCTAssertEqualObjects(@"in the active buffer\n", [NSString stringWithContentsOfFile:asyncStream.logFilePath encoding:NSUTF8StringEncoding error:NULL]);
+    NSString *record = [NSString stringWithContentsOfFile:emergencyLog.filePath encoding:NSUTF8StringEncoding error:NULL];
+    XCTAssertTrue([record hasPrefix:@"[EMERGENCY]["]);
+    XCTAssertTrue([record hasSuffix:([NSString stringWithFormat:@"][pid:%d][Crash][OMG] : SIGSEGV\n", getpid()])]);
+
+    [emergencyLog removeFileOutputStream:stdioStream];
+    [emergencyLog removeFileOutputStream:asyncStream];
+    XCTAssertEqual(0, TLSEmergencyLogDumpUnflushedOutput(emergencyLog, &bytesDumped));
+    XCTAssertEqual((size_t)0, bytesDumped);
+
+    // the dumped bytes are not written again by flushing or closing the streams
+    [stdioStream tls_flush];
+    [asyncStream tls_flush];
+    NSString *stdioLogFilePath = stdioStream.logFilePath;
+    NSString *asyncLogFilePath = asyncStream.logFilePath;
+    stdioStream = nil;
+    asyncStream = nil;
+    XCTAssertEqualObjects(@"in the stdio buffer\n", [NSString stringWithContentsOfFile:stdioLogFilePath encoding:NSUTF8StringEncoding error:NULL]);
+    XCTAssertEqualObjects(@"in the active buffer\n", [NSString stringWithContentsOfFile:asyncLogFilePath encoding:NSUTF8StringEncoding error:NULL]);
+}
+
+- (void)testLoggingWorkloadCapture
+{
+    TLSLoggingService *service = [[TLSLoggingService alloc] init];
+    [service addOutputStream:[[TestCallbackLogger alloc] initWithCallback:^(TLSLogMessageInfo *info) {}]];
+    NSString *channel = @"Workload";
+    [service setThrottle:[TLSLogThrottle throttleWithMaximumMessagesPerSecond:0.001 burst:2] forChannel:channel];
+    [service dispatchSynchronousTransaction:^{}];
+
+    NSString *tracePath = [NSTemporaryDirectory() stringByAppendingPathComponent:@"TLSLoggingTests.workload"];
+    NSError *error = nil;
+    XCTAssertTrue([service beginWorkloadCaptureToFilePath:tracePath error:&error], @"%@", error);
+
+    // 2 logged then 2 throttled (filtered) from the same callsite, then 1 from another thread
+    TLSLogCallsite *callsite = TLSLogCurrentCallsite();
+    for (NSUInteger i = 0; i < 4; i++) {
+        if (TLSCanLogCallsite(service, TLSLogLevelWarning, channel, nil, callsite)) {
+            TLSLogEx(service, TLSLogLevelWarning, channel, @(callsite->file), @(__PRETTY_FUNCTION__), callsite->line, nil, 0, @"%@", [@"" stringByPaddingToLength:(10 * (i + 1)) withString:@"x" startingAtIndex:0]);
+        }
+    }
+    dispatch_group_t group = dispatch_group_create();
+    dispatch_group_async(group, dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^{
+        TLSLogEx(service, TLSLogLevelError, @"Other", @(__FILE__), @(__PRETTY_FUNCTION__), __LINE__, nil, 0, @"other ✓");
+    });
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    [service endWorkloadCapture];
+    [service flush];
+
+    TLSWorkloadTrace *trace = [[TLSWorkloadTrace alloc] initWithFilePath:tracePath error:&error];
+    XCTAssertNotNil(trace, @"%@", error);
+    XCTAssertEqual((NSUInteger)5, trace.recordCount);
+    XCTAssertEqual((NSUInteger)2, trace.threadIds.count);
+    XCTAssertEqualObjects((@[channel, @"Other"]), trace.channels);
+    XCTAssertEqual((NSUInteger)2, trace.callsites.count);
+    XCTAssertEqualObjects(@(callsite->file), trace.callsites[0].file);
+    XCTAssertEqualObjects(@(__PRETTY_FUNCTION__), trace.callsites[0].function);
+    XCTAssertEqual((NSInteger)callsite->line, trace.callsites[0].line);
+
+    const TLSWorkloadTraceRecord *records = trace.records;
+    for (NSUInteger i = 0; i < 4; i++) {
+        XCTAssertEqual((uint32_t)0, records[i].callsiteIndex);
+        XCTAssertEqual((uint32_t)0, records[i].channelIndex);
+        XCTAssertEqual((uint8_t)TLSLogLevelWarning, records[i].level);
+        XCTAssertEqual((uint8_t)((i < 2) ? 0 : 1), records[i].filtered);
+        XCTAssertEqual((uint32_t)((i < 2) ? 10 * (i + 1) : 0), records[i].messageLength);
+        XCTAssertEqual(trace.threadIds.firstObject.unsignedIntValue, records[i].threadId);
+        if (i > 0) {
+            XCTAssertGreaterThanOrEqual(records[i].time, records[i - 1].time);
+        }
+    }
+    XCTAssertEqual((uint32_t)1, records[4].callsiteIndex);
+    XCTAssertEqual((uint32_t)1, records[4].channelIndex);
+    XCTAssertEqual((uint32_t)9, records[4].messageLength, @"in UTF-8 bytes");
+    XCTAssertNotEqual(records[0].threadId, records[4].threadId);
+    XCTAssertEqual(records[4].time, trace.duration);
+
+    // buffered per thread, written in batches and read back in time order
+    XCTAssertTrue([service beginWorkloadCaptureToFilePath:tracePath error:&error], @"%@", error);
+    dispatch_apply(4, dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^(size_t iteration) {
+        for (NSUInteger i = 0; i < 100; i++) {
+            TLSLogEx(service, TLSLogLevelError, @"Other", @(__FILE__), @(__PRETTY_FUNCTION__), __LINE__, nil, 0, @"batch %zu", iteration);
+        }
+    });
+    [service endWorkloadCapture];
+    [service flush];
+
+    trace = [[TLSWorkloadTrace alloc] initWithFilePath:tracePath error:&error];
+    XCTAssertNotNil(trace, @"%@", error);
+    XCTAssertEqual((NSUInteger)400, trace.recordCount);
+    XCTAssertEqual((NSUInteger)1, trace.callsites.count);
+    records = trace.records;
+    for (NSUInteger i = 1; i < 400; i++) {
+        XCTAssertGreaterThanOrEqual(records[i].time, records[i - 1].time);
+    }
+
+    [[NSFileManager defaultManager] removeItemAtPath:tracePath error:NULL];
+}
+
 - (void)testLoggingRollingNSLogCombo
 {
     TEST_START
@@ -1040,6 +2410,44 @@ static NSMutableDictionary *sRuntimes;
 
 @end
 
+@implementation TestCallbackLogger
+{
+    TestCallbackLoggerBlock _callback;
+}
+
+- (instancetype)initWithCallback:(TestCallbackLoggerBlock)callback
+{
+    if (self = [super init]) {
+        _callback = [callback copy];
+    }
+    return self;
+}
+
+- (void)tls_outputLogInfo:(TLSLogMessageInfo *)logInfo
+{
+    _callback(logInfo);
+}
+
+@end
+
+@implementation TestServiceDelegate
+
+- (void)tls_loggingService:(TLSLoggingService *)service didCaptureMetrics:(TLSLoggingMetrics *)metrics
+{
+    if (self.metricsCallback) {
+        self.metricsCallback(metrics);
+    }
+}
+
+- (void)tls_loggingService:(TLSLoggingService *)service didIsolateOutputStream:(id<TLSOutputStream>)stream averageOutputDuration:(NSTimeInterval)averageOutputDuration
+{
+    if (self.isolationCallback) {
+        self.isolationCallback(stream);
+    }
+}
+
+@end
+
 @implementation TestStdErrLogger
 
 - (TLSFilterStatus)tls_shouldFilterLevel:(TLSLogLevel)level channel:(NSString *)channel contextObject:(id)contextObject
@@ -1070,6 +2478,163 @@ static NSMutableDictionary *sRuntimes;
 @implementation TestRollingFileLogger
 @end
 
+@implementation TestSnapshottingContext
+
+- (TLSLogContextSnapshot *)tls_logContextSnapshot
+{
+    return [[TLSLogContextSnapshot alloc] initWithObject:self
+                                               filterKey:self.identifier
+                                                  fields:@{ @"identifier" : self.identifier, @"date" : [NSDate dateWithTimeIntervalSince1970:0] }];
+}
+
+@end
+
+@implementation TestShippingServer
+{
+    dispatch_queue_t _queue;
+    dispatch_source_t _listeningSource;
+    NSMutableArray<NSDictionary<NSString *, NSString *> *> *_requestHeaders;
+    NSMutableArray<NSData *> *_bodies;
+}
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        _statusCode = 200;
+        _requestHeaders = [[NSMutableArray alloc] init];
+        _bodies = [[NSMutableArray alloc] init];
+        _queue = dispatch_queue_create("TestShippingServer.queue", DISPATCH_QUEUE_SERIAL);
+
+        // any free port on the loopback interface
+        const int listeningFileDescriptor = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_len = sizeof(address);
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = 0;
+        socklen_t addressLength = sizeof(address);
+        if (listeningFileDescriptor < 0 ||
+            bind(listeningFileDescriptor, (const struct sockaddr *)&address, sizeof(address)) != 0 ||
+            listen(listeningFileDescriptor, SOMAXCONN) != 0 ||
+            getsockname(listeningFileDescriptor, (struct sockaddr *)&address, &addressLength) != 0) {
+            if (listeningFileDescriptor >= 0) {
+                close(listeningFileDescriptor);
+            }
+            return nil;
+        }
+        _endpointURL = [NSURL URLWithString:[NSString stringWithFormat:@"http://127.0.0.1:%u/logs", ntohs(address.sin_port)]];
+
+        __weak typeof(self) weakSelf = self;
+        _listeningSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, (uintptr_t)listeningFileDescriptor, 0, _queue);
+        dispatch_source_set_event_handler(_listeningSource, ^{
+            const int fileDescriptor = accept(listeningFileDescriptor, NULL, NULL);
+            if (fileDescriptor >= 0) {
+                [weakSelf _serveConnection:fileDescriptor];
+                close(fileDescriptor);
+            }
+        });
+        dispatch_source_set_cancel_handler(_listeningSource, ^{
+            close(listeningFileDescriptor);
+        });
+        dispatch_resume(_listeningSource);
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [self stop];
+}
+
+- (void)stop
+{
+    @synchronized (self) {
+        if (_listeningSource) {
+            dispatch_source_cancel(_listeningSource);
+            _listeningSource = nil;
+        }
+    }
+}
+
+- (NSArray<NSDictionary<NSString *, NSString *> *> *)requestHeaders
+{
+    @synchronized (self) {
+        return [_requestHeaders copy];
+    }
+}
+
+- (NSArray<NSData *> *)bodies
+{
+    @synchronized (self) {
+        return [_bodies copy];
+    }
+}
+
+// 1 request per connection (responses close it), read with blocking reads
+- (void)_serveConnection:(int)fileDescriptor
+{
+    const int on = 1;
+    (void)setsockopt(fileDescriptor, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+
+    NSMutableData *received = [[NSMutableData alloc] init];
+    NSData *headerTerminator = [NSData dataWithBytes:"\r\n\r\n" length:4];
+    NSRange terminatorRange = NSMakeRange(NSNotFound, 0);
+    NSMutableDictionary<NSString *, NSString *> *headers = [[NSMutableDictionary alloc] init];
+    NSUInteger contentLength = 0;
+    uint8_t buffer[4096];
+    while (1) {
+        if (NSNotFound == terminatorRange.location) {
+            terminatorRange = [received rangeOfData:headerTerminator options:0 range:NSMakeRange(0, received.length)];
+            if (terminatorRange.location != NSNotFound) {
+                NSString *head = [[NSString alloc] initWithData:[received subdataWithRange:NSMakeRange(0, terminatorRange.location)] encoding:NSUTF8StringEncoding];
+                NSArray<NSString *> *lines = [head componentsSeparatedByString:@"\r\n"];
+                for (NSUInteger i = 1 /* skip the request line */; i < lines.count; i++) {
+                    const NSRange colon = [lines[i] rangeOfString:@":"];
+                    if (colon.location != NSNotFound) {
+                        NSString *field = [lines[i] substringToIndex:colon.location].lowercaseString;
+                        headers[field] = [[lines[i] substringFromIndex:NSMaxRange(colon)] stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+                    }
+                }
+                contentLength = (NSUInteger)headers[@"content-length"].integerValue;
+            }
+        }
+        if (terminatorRange.location != NSNotFound && received.length >= NSMaxRange(terminatorRange) + contentLength) {
+            break;
+        }
+        const ssize_t readLength = read(fileDescriptor, buffer, sizeof(buffer));
+        if (readLength < 0 && EINTR == errno) {
+            continue;
+        }
+        if (readLength <= 0) {
+            return;
+        }
+        [received appendBytes:buffer length:(NSUInteger)readLength];
+    }
+
+    const NSInteger statusCode = self.statusCode;
+    @synchronized (self) {
+        [_requestHeaders addObject:headers];
+        [_bodies addObject:[received subdataWithRange:NSMakeRange(NSMaxRange(terminatorRange), contentLength)]];
+    }
+
+    NSString *response = [NSString stringWithFormat:@"HTTP/1.1 %ld Test\r\nContent-Length: 0\r\nConnection: close\r\n\r\n", (long)statusCode];
+    const char *responseBytes = response.UTF8String;
+    size_t writtenLength = 0;
+    while (writtenLength < strlen(responseBytes)) {
+        const ssize_t result = write(fileDescriptor, responseBytes + writtenLength, strlen(responseBytes) - writtenLength);
+        if (result < 0 && EINTR == errno) {
+            continue;
+        }
+        if (result <= 0) {
+            return;
+        }
+        writtenLength += (size_t)result;
+    }
+}
+
+@end
+
 static void LogStream(id<TLSOutputStream> stream, TLSLogLevel level, NSString *channel, NSString *file, NSString *function, unsigned int line, NSString *format, ...)
 {
     NSDate *timestamp = [NSDate date];
@@ -0,0 +1,440 @@
+//
+//  TLSSharedLogRingBufferHarness.c
+//  TwitterLoggingService
+//
+//  Created on 10/18/26.
+//  Copyright (c) 2026 Twitter, Inc.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//          http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+/*
+ Multi-process harness for the shared log ring (TLSSharedLogRingBuffer.c), run outside of Xcode on any
+ POSIX system (Linux included) since it takes real processes:
+
+    cc -std=gnu11 -O2 -IClasses -o /tmp/TLSSharedLogRingBufferHarness \
+        Classes/TLSSharedLogRingBuffer.c TwitterLoggingServiceTests/TLSSharedLogRingBufferHarness.c
+    /tmp/TLSSharedLogRingBufferHarness
+
+ 1. A producer process is suspended (SIGSTOP) in the middle of writing a record, for many stall timeouts:
+    the consumer must wait for it instead of recycling its cell, and lose none of its records.
+ 2. Producer processes publish numbered records as fast as they can while this process consumes them:
+    - producer 0 is repeatedly suspended for longer than the stall timeout, none of its published records can be lost
+    - producer 1 is killed (SIGKILL), the consumer must not wedge on its last record
+    - the others run undisturbed
+ Every consumed record is checked to be intact and in order.  Exits with 0 on success.
+ */
+
+#include <errno.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "TLSSharedLogRingBuffer.h"
+
+#define kProducerCount      (4)
+#define kRecordCount        (50000)
+#define kSuspendedProducer  (0)
+#define kKilledProducer     (1)
+#define kStallTimeout       (0.005)
+
+typedef struct HarnessProducerState {
+    _Atomic uint64_t publishedCount; // updated by the producer
+    uint64_t consumedCount;
+    int64_t lastLine;
+} HarnessProducerState;
+
+typedef struct HarnessContext {
+    HarnessProducerState *producers;
+    uint64_t failureCount;
+} HarnessContext;
+
+typedef struct HarnessRing {
+    char path[64];
+    TLSSharedLogRing *ring;
+    HarnessProducerState *producers;
+} HarnessRing;
+
+static double _Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ((double)ts.tv_nsec / 1e9);
+}
+
+static void _Sleep(double seconds)
+{
+    struct timespec ts = { (time_t)seconds, (long)((seconds - (double)(time_t)seconds) * 1e9) };
+    while (0 != nanosleep(&ts, &ts) && EINTR == errno) {
+    }
+}
+
+static char _FillCharacter(int32_t line)
+{
+    return (char)('a' + (line % 26));
+}
+
+static size_t _FillLength(int32_t line)
+{
+    return (size_t)(line % 300);
+}
+
+// Ring
+
+// a small ring so that it laps (and fills up) a lot, claimed by this process
+static bool _OpenRing(HarnessRing *harnessRing)
+{
+    strcpy(harnessRing->path, "/tmp/TLSSharedLogRingBufferHarness.XXXXXX");
+    const int fileDescriptor = mkstemp(harnessRing->path);
+    if (fileDescriptor < 0) {
+        perror("mkstemp");
+        return false;
+    }
+    close(fileDescriptor);
+
+    harnessRing->ring = TLSSharedLogRingOpen(harnessRing->path, 512, 64);
+    if (!harnessRing->ring) {
+        perror("TLSSharedLogRingOpen");
+        return false;
+    }
+    const int error = TLSSharedLogRingClaimConsumer(harnessRing->ring);
+    if (error) {
+        fprintf(stderr, "TLSSharedLogRingClaimConsumer: %s\n", strerror(error));
+        return false;
+    }
+
+    harnessRing->producers = mmap(NULL,
+                                  sizeof(HarnessProducerState) * kProducerCount,
+                                  PROT_READ | PROT_WRITE,
+                                  MAP_SHARED | MAP_ANONYMOUS,
+                                  -1,
+                                  0);
+    if (MAP_FAILED == harnessRing->producers) {
+        perror("mmap");
+        return false;
+    }
+    for (uint32_t i = 0; i < kProducerCount; i++) {
+        harnessRing->producers[i].lastLine = -1;
+    }
+    return true;
+}
+
+static void _CloseRing(HarnessRing *harnessRing)
+{
+    TLSSharedLogRingClose(harnessRing->ring);
+    munmap(harnessRing->producers, sizeof(HarnessProducerState) * kProducerCount);
+    unlink(harnessRing->path);
+    char consumerLockPath[sizeof(harnessRing->path) + sizeof(".consumer")];
+    snprintf(consumerLockPath, sizeof(consumerLockPath), "%s.consumer", harnessRing->path);
+    unlink(consumerLockPath);
+}
+
+// Producing
+
+// fills in _record_ with numbered record _line_ of _producerIndex_, _message_ must fit the message
+static void _PrepareRecord(TLSSharedLogRecord *record, char *message, uint32_t producerIndex, int32_t line)
+{
+    char header[32];
+    const int headerLength = snprintf(header, sizeof(header), "%u:%d:", producerIndex, line);
+    const size_t fillLength = _FillLength(line);
+    memcpy(message, header, (size_t)headerLength);
+    memset(message + headerLength, _FillCharacter(line), fillLength);
+
+    memset(record, 0, sizeof(*record));
+    record->processIdentifier = getpid();
+    record->threadId = producerIndex;
+    record->level = 6;
+    record->line = line;
+    record->timestamp = (double)time(NULL);
+    record->channel = "Harness";
+    record->channelLength = strlen("Harness");
+    record->file = __FILE__;
+    record->fileLength = strlen(__FILE__);
+    record->function = __FUNCTION__;
+    record->functionLength = strlen(__FUNCTION__);
+    record->message = message;
+    record->messageLength = (size_t)headerLength + fillLength;
+}
+
+static TLSSharedLogRing *_ProducerOpenRing(const char *path)
+{
+    TLSSharedLogRing *ring = TLSSharedLogRingOpen(path, 0, 0);
+    if (!ring) {
+        perror("producer TLSSharedLogRingOpen");
+        _exit(2);
+    }
+    return ring;
+}
+
+static void _Produce(const char *path, uint32_t producerIndex, HarnessProducerState *state)
+{
+    TLSSharedLogRing *ring = _ProducerOpenRing(path);
+    char message[512];
+    uint64_t publishedCount = 0;
+    for (int32_t line = 0; line < kRecordCount; line++) {
+        TLSSharedLogRecord record;
+        _PrepareRecord(&record, message, producerIndex, line);
+        // give the consumer a chance when the ring is full, without ever blocking on it
+        for (int attempt = 0; attempt < 100; attempt++) {
+            if (TLSSharedLogRingPublish(ring, &record)) {
+                atomic_store_explicit(&state->publishedCount, ++publishedCount, memory_order_release);
+                break;
+            }
+            sched_yield();
+        }
+    }
+    TLSSharedLogRingClose(ring);
+    _exit(0);
+}
+
+static void *sFaultingPage;
+static size_t sPageSize;
+
+// the producer faults while copying the message into its cell: suspend it right there
+static void _SuspendOnFault(int signal)
+{
+    (void)signal;
+    mprotect(sFaultingPage, sPageSize, PROT_READ | PROT_WRITE);
+    raise(SIGSTOP);
+}
+
+static void _ProduceSuspendingMidRecord(const char *path, uint32_t producerIndex, HarnessProducerState *state, int32_t suspendedLine, int32_t recordCount)
+{
+    TLSSharedLogRing *ring = _ProducerOpenRing(path);
+
+    // the message of the suspended record straddles an unreadable page
+    sPageSize = (size_t)sysconf(_SC_PAGESIZE);
+    char *pages = mmap(NULL, 2 * sPageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED == pages) {
+        perror("producer mmap");
+        _exit(2);
+    }
+    sFaultingPage = pages + sPageSize;
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = _SuspendOnFault;
+    sigaction(SIGSEGV, &action, NULL);
+    sigaction(SIGBUS, &action, NULL);
+
+    char message[512];
+    uint64_t publishedCount = 0;
+    for (int32_t line = 0; line < recordCount; line++) {
+        TLSSharedLogRecord record;
+        if (line == suspendedLine) {
+            char *straddlingMessage = (char *)sFaultingPage - 8;
+            _PrepareRecord(&record, straddlingMessage, producerIndex, line);
+            mprotect(sFaultingPage, sPageSize, PROT_NONE);
+        } else {
+            _PrepareRecord(&record, message, producerIndex, line);
+        }
+        if (TLSSharedLogRingPublish(ring, &record)) {
+            atomic_store_explicit(&state->publishedCount, ++publishedCount, memory_order_release);
+        }
+    }
+    TLSSharedLogRingClose(ring);
+    _exit(0);
+}
+
+// Consuming
+
+static void _Consume(const TLSSharedLogRecord *record, void *context)
+{
+    HarnessContext *harness = context;
+    if (record->threadId >= kProducerCount) {
+        fprintf(stderr, "unknown producer %u\n", record->threadId);
+        harness->failureCount++;
+        return;
+    }
+
+    HarnessProducerState *state = &harness->producers[record->threadId];
+    char expectedHeader[32];
+    const int headerLength = snprintf(expectedHeader, sizeof(expectedHeader), "%u:%d:", record->threadId, record->line);
+    bool intact = record->line > state->lastLine;
+    intact = intact && record->messageLength == (size_t)headerLength + _FillLength(record->line);
+    intact = intact && 0 == memcmp(record->message, expectedHeader, (size_t)headerLength);
+    for (size_t i = (size_t)headerLength; intact && i < record->messageLength; i++) {
+        intact = (_FillCharacter(record->line) == record->message[i]);
+    }
+    intact = intact && record->fileLength == strlen(__FILE__) && 0 == memcmp(record->file, __FILE__, record->fileLength);
+    if (!intact) {
+        fprintf(stderr, "bad record from producer %u (line %d, last line %lld): %.*s\n",
+                record->threadId,
+                record->line,
+                (long long)state->lastLine,
+                (int)record->messageLength,
+                record->message);
+        harness->failureCount++;
+    }
+    state->lastLine = record->line;
+    state->consumedCount++;
+}
+
+// consume until every producer exited and the ring stayed empty for a while
+static void _ConsumeUntilDone(HarnessRing *harnessRing, HarnessContext *harness, unsigned int runningCount)
+{
+    double idleStartTime = 0;
+    for (;;) {
+        const size_t count = TLSSharedLogRingConsume(harnessRing->ring, SIZE_MAX, kStallTimeout, _Consume, harness);
+        int status;
+        while (runningCount > 0 && waitpid(-1, &status, WNOHANG) > 0) {
+            runningCount--;
+        }
+        if (count > 0 || runningCount > 0) {
+            idleStartTime = 0;
+        } else if (0 == idleStartTime) {
+            idleStartTime = _Now();
+        } else if (_Now() - idleStartTime > 0.2) {
+            break;
+        }
+        if (0 == count) {
+            _Sleep(0.0005);
+        }
+    }
+}
+
+static void _CheckCounts(HarnessRing *harnessRing, HarnessContext *harness, int32_t killedProducerIndex)
+{
+    for (uint32_t i = 0; i < kProducerCount; i++) {
+        const HarnessProducerState *state = &harnessRing->producers[i];
+        const uint64_t publishedCount = atomic_load_explicit(&state->publishedCount, memory_order_acquire);
+        printf("  producer %u: published %llu, consumed %llu\n",
+               i,
+               (unsigned long long)publishedCount,
+               (unsigned long long)state->consumedCount);
+        // the killed producer can die between committing a record and counting it
+        const bool matches = ((int32_t)i == killedProducerIndex) ? (state->consumedCount - publishedCount <= 1)
+                                                                  : (state->consumedCount == publishedCount);
+        if (!matches) {
+            fprintf(stderr, "producer %u lost records\n", i);
+            harness->failureCount++;
+        }
+    }
+    printf("  dropped %llu, abandoned %llu\n",
+           (unsigned long long)TLSSharedLogRingDroppedCount(harnessRing->ring),
+           (unsigned long long)TLSSharedLogRingAbandonedCount(harnessRing->ring));
+}
+
+// Scenarios
+
+static uint64_t _RunSuspendedMidRecordScenario(void)
+{
+    printf("suspended mid record\n");
+    HarnessRing harnessRing;
+    if (!_OpenRing(&harnessRing)) {
+        return 1;
+    }
+    HarnessContext harness = { harnessRing.producers, 0 };
+
+    const int32_t recordCount = 20;
+    const pid_t processIdentifier = fork();
+    if (processIdentifier < 0) {
+        perror("fork");
+        return 1;
+    } else if (0 == processIdentifier) {
+        _ProduceSuspendingMidRecord(harnessRing.path, 0, &harnessRing.producers[0], recordCount / 2, recordCount);
+    }
+
+    int status;
+    if (processIdentifier != waitpid(processIdentifier, &status, WUNTRACED) || !WIFSTOPPED(status)) {
+        fprintf(stderr, "the producer did not suspend itself\n");
+        return 1;
+    }
+    const double suspensionTime = _Now();
+    while (_Now() - suspensionTime < 50 * kStallTimeout) {
+        TLSSharedLogRingConsume(harnessRing.ring, SIZE_MAX, kStallTimeout, _Consume, &harness);
+        _Sleep(0.0005);
+    }
+    if (harnessRing.producers[0].consumedCount != (uint64_t)recordCount / 2) {
+        fprintf(stderr, "consumed %llu records past a suspended producer\n", (unsigned long long)harnessRing.producers[0].consumedCount);
+        harness.failureCount++;
+    }
+    kill(processIdentifier, SIGCONT);
+    _ConsumeUntilDone(&harnessRing, &harness, 1);
+
+    _CheckCounts(&harnessRing, &harness, -1);
+    if (harnessRing.producers[0].consumedCount != (uint64_t)recordCount || 0 != TLSSharedLogRingAbandonedCount(harnessRing.ring)) {
+        fprintf(stderr, "the suspended producer lost records\n");
+        harness.failureCount++;
+    }
+    _CloseRing(&harnessRing);
+    return harness.failureCount;
+}
+
+static uint64_t _RunConcurrentScenario(void)
+{
+    printf("concurrent producers\n");
+    HarnessRing harnessRing;
+    if (!_OpenRing(&harnessRing)) {
+        return 1;
+    }
+    HarnessContext harness = { harnessRing.producers, 0 };
+
+    pid_t processIdentifiers[kProducerCount];
+    for (uint32_t i = 0; i < kProducerCount; i++) {
+        processIdentifiers[i] = fork();
+        if (processIdentifiers[i] < 0) {
+            perror("fork");
+            return 1;
+        } else if (0 == processIdentifiers[i]) {
+            _Produce(harnessRing.path, i, &harnessRing.producers[i]);
+        }
+    }
+
+    // a second consumer is refused
+    TLSSharedLogRing *otherRing = TLSSharedLogRingOpen(harnessRing.path, 0, 0);
+    if (!otherRing || EWOULDBLOCK != TLSSharedLogRingClaimConsumer(otherRing)) {
+        fprintf(stderr, "a second consumer was not refused\n");
+        harness.failureCount++;
+    }
+    TLSSharedLogRingClose(otherRing);
+
+    const double startTime = _Now();
+    unsigned int suspensionCount = 0;
+    while (suspensionCount < 20) {
+        TLSSharedLogRingConsume(harnessRing.ring, SIZE_MAX, kStallTimeout, _Consume, &harness);
+        const double elapsed = _Now() - startTime;
+        if (3 == suspensionCount) {
+            kill(processIdentifiers[kKilledProducer], SIGKILL);
+        }
+        if (elapsed > 0.01 * (suspensionCount + 1)) {
+            // suspended for 4 stall timeouts, while the consumer keeps consuming
+            kill(processIdentifiers[kSuspendedProducer], SIGSTOP);
+            const double suspensionTime = _Now();
+            while (_Now() - suspensionTime < 4 * kStallTimeout) {
+                TLSSharedLogRingConsume(harnessRing.ring, SIZE_MAX, kStallTimeout, _Consume, &harness);
+            }
+            kill(processIdentifiers[kSuspendedProducer], SIGCONT);
+            suspensionCount++;
+        }
+    }
+    _ConsumeUntilDone(&harnessRing, &harness, kProducerCount);
+
+    _CheckCounts(&harnessRing, &harness, kKilledProducer);
+    _CloseRing(&harnessRing);
+    return harness.failureCount;
+}
+
+int main(void)
+{
+    uint64_t failureCount = _RunSuspendedMidRecordScenario();
+    failureCount += _RunConcurrentScenario();
+    printf("%s\n", (failureCount) ? "FAILED" : "PASSED");
+    return (failureCount) ? 1 : 0;
+}